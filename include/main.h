@@ -3,15 +3,25 @@
 #include "skse64_common/Relocation.h"
 #include "skse64/PapyrusVM.h"
 #include "skse64/GameReferences.h"
+#include "skse64/GameEvents.h"
 
 
 typedef bool(*_IsInMenuMode)(VMClassRegistry* registry, UInt32 stackId);
-RelocAddr<_IsInMenuMode> IsInMenuMode(0x009F32A0);
+extern _IsInMenuMode IsInMenuMode; // set by ResolveGameAddresses
 
 typedef bool(*_IAnimationGraphManagerHolder_NotifyAnimationGraph)(IAnimationGraphManagerHolder *_this, const BSFixedString &a_eventName); // 01
 typedef bool(*_IAnimationGraphManagerHolder_GetAnimationVariableInt)(IAnimationGraphManagerHolder *_this, const BSFixedString &a_variableName, SInt32 &a_out); // 11
 typedef bool(*_IAnimationGraphManagerHolder_GetAnimationVariableBool)(IAnimationGraphManagerHolder *_this, const BSFixedString &a_variableName, bool &a_out); // 12
 
+// BSAnimationGraphEvent, as sent to the TESObjectREFR::animGraphEventSink of the ref whose graph raised it
+struct AnimationGraphEvent
+{
+	BSFixedString tag;
+	TESObjectREFR *holder;
+	BSFixedString payload;
+};
+typedef EventResult(*_AnimationGraphEventSink_ReceiveEvent)(void *_this, AnimationGraphEvent *evn, void *dispatcher); // 01
+
 
 inline UInt64 *get_vtbl(void *object) { return *((UInt64 **)object); }
 
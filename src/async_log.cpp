@@ -0,0 +1,189 @@
+#include <chrono>
+#include <cstdio>
+
+#include "async_log.h"
+
+
+AsyncLog::~AsyncLog()
+{
+	// Same as PoseRecorder: joining from a static destructor can deadlock on the loader lock at process exit
+	if (thread.joinable()) {
+		stopRequested = true;
+		thread.detach();
+	}
+}
+
+bool AsyncLog::Start(Sink newSink, uint32_t capacity, uint32_t newFlushIntervalMs)
+{
+	if (thread.joinable() || !newSink) return false;
+
+	uint32_t size = 1;
+	while (size < capacity) size <<= 1;
+
+	slots = std::vector<Slot>(size);
+	for (uint32_t i = 0; i < size; i++) {
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	mask = size - 1;
+	enqueuePosition = 0;
+	dequeuePosition = 0;
+	sink = newSink;
+	flushIntervalMs = newFlushIntervalMs;
+	stopRequested = false;
+
+	thread = std::thread(&AsyncLog::FlusherThread, this);
+	return true;
+}
+
+void AsyncLog::Stop()
+{
+	if (!thread.joinable()) return;
+	stopRequested = true;
+	thread.join();
+}
+
+AsyncLog::Slot * AsyncLog::Claim(uint64_t &position)
+{
+	if (slots.empty()) return nullptr;
+
+	position = enqueuePosition.load(std::memory_order_relaxed);
+	for (;;) {
+		Slot &slot = slots[position & mask];
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		int64_t difference = (int64_t)(sequence - position);
+		if (difference == 0) {
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) return &slot;
+		}
+		else if (difference < 0) {
+			return nullptr; // full
+		}
+		else {
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool AsyncLog::FlushOne(char *line, size_t size)
+{
+	Slot &slot = slots[dequeuePosition & mask];
+	if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) return false;
+
+	// Copy out and free the slot before formatting, so producers get it back sooner
+	Record record = slot.record;
+	slot.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+	dequeuePosition++;
+
+	Format(record, line, size);
+	sink(record.level, record.timestampNs, line);
+	numWritten.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void AsyncLog::FlusherThread()
+{
+	char line[1024];
+	for (;;) {
+		bool isStopping = stopRequested.load();
+
+		while (FlushOne(line, sizeof(line))) {}
+
+		uint64_t dropped = numDropped.load(std::memory_order_relaxed);
+		if (dropped != numDroppedReported) {
+			snprintf(line, sizeof(line), "%llu log messages dropped, the log was written faster than it could be flushed", (unsigned long long)(dropped - numDroppedReported));
+			sink(kLevel_Warning, MonotonicNs(), line);
+			numDroppedReported = dropped;
+		}
+
+		if (isStopping) return;
+		std::this_thread::sleep_for(std::chrono::milliseconds(flushIntervalMs));
+	}
+}
+
+// Formats one argument with its own conversion spec, with the length modifier replaced to match how it was stored
+static int FormatArg(char *out, size_t size, const char *specBegin, const char *specEnd, AsyncLog::ArgType type, uint64_t value, const char *text)
+{
+	char spec[32];
+	size_t length = 0;
+	const char *p = specBegin;
+
+	// flags, width, precision
+	while (p < specEnd && length < sizeof(spec) - 4 && !strchr("hljztL", *p) && p != specEnd - 1) spec[length++] = *p++;
+	// skip the original length modifier
+	while (p < specEnd - 1 && strchr("hljztL", *p)) p++;
+	char conversion = *(specEnd - 1);
+
+	switch (conversion) {
+	case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+		if (conversion != 'c') {
+			spec[length++] = 'l';
+			spec[length++] = 'l';
+		}
+		spec[length++] = conversion;
+		spec[length] = 0;
+		if (type == AsyncLog::kArg_Double) {
+			double d; memcpy(&d, &value, sizeof(d));
+			value = (uint64_t)(int64_t)d;
+		}
+		if (conversion == 'c') return snprintf(out, size, spec, (int)value);
+		if (conversion == 'd' || conversion == 'i') return snprintf(out, size, spec, (long long)value);
+		return snprintf(out, size, spec, (unsigned long long)value);
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+		spec[length++] = conversion;
+		spec[length] = 0;
+		double d;
+		if (type == AsyncLog::kArg_Double) memcpy(&d, &value, sizeof(d));
+		else if (type == AsyncLog::kArg_Int) d = (double)(int64_t)value;
+		else d = (double)value;
+		return snprintf(out, size, spec, d);
+	}
+	case 's':
+		spec[length++] = 's';
+		spec[length] = 0;
+		return snprintf(out, size, spec, type == AsyncLog::kArg_String ? text + value : "(not a string)");
+	case 'p':
+		spec[length++] = 'p';
+		spec[length] = 0;
+		return snprintf(out, size, spec, (void *)(uintptr_t)value);
+	default:
+		return snprintf(out, size, "%%%c", conversion);
+	}
+}
+
+size_t AsyncLog::Format(const Record &record, char *out, size_t size)
+{
+	if (!size) return 0;
+
+	size_t used = 0;
+	int arg = 0;
+	const char *p = record.format;
+	while (*p && used + 1 < size) {
+		if (*p != '%') {
+			out[used++] = *p++;
+			continue;
+		}
+		if (p[1] == '%') {
+			out[used++] = '%';
+			p += 2;
+			continue;
+		}
+
+		// Find the end of the conversion spec
+		const char *specEnd = p + 1;
+		while (*specEnd && !strchr("diuxXocfFeEgGaAsp", *specEnd)) specEnd++;
+		if (!*specEnd) break;
+		specEnd++;
+
+		int written;
+		if (arg < record.numArgs) {
+			written = FormatArg(out + used, size - used, p, specEnd, record.types[arg], record.values[arg], record.text);
+			arg++;
+		}
+		else {
+			written = snprintf(out + used, size - used, "(missing)");
+		}
+		if (written > 0) used += (size_t)written < size - used ? (size_t)written : size - used - 1;
+		p = specEnd;
+	}
+	out[used] = 0;
+	return used;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "clock.h"
+
+
+// Log backend that never does I/O on the calling thread.
+// Write() copies the format pointer and the raw argument values into a preallocated lock-free ring (multiple producers,
+// one consumer). A background thread turns them into text and hands the lines to a sink. When the ring is full the
+// message is dropped and counted instead of waiting.
+class AsyncLog
+{
+public:
+	enum Level : uint8_t
+	{
+		kLevel_Error = 0,
+		kLevel_Warning,
+		kLevel_Message,
+		kLevel_Debug
+	};
+
+	// Called from the flusher thread only, one line at a time, without a trailing newline
+	typedef void (*Sink)(Level level, uint64_t timestampNs, const char *text);
+
+	static const int maxArgs = 8;
+	// String arguments are copied in here, and truncated if they do not fit. Room for a whole profiler or latency report
+	// line, logbench checks that they fit.
+	static const int textCapacity = 256;
+
+	enum ArgType : uint8_t
+	{
+		kArg_Int,
+		kArg_UInt,
+		kArg_Double,
+		kArg_String, // value is the offset into text
+		kArg_Pointer
+	};
+
+	struct Record
+	{
+		uint64_t timestampNs;
+		const char *format; // must be a string literal, it is read later on another thread
+		Level level;
+		uint8_t numArgs;
+		uint16_t textUsed;
+		ArgType types[maxArgs];
+		uint64_t values[maxArgs];
+		char text[textCapacity];
+	};
+
+	~AsyncLog();
+
+	// capacity is rounded up to a power of two
+	bool Start(Sink sink, uint32_t capacity = 1024, uint32_t flushIntervalMs = 20);
+	// Writes out everything still in the ring, then stops the flusher
+	void Stop();
+
+	void SetLevel(Level newLevel) { level.store(newLevel, std::memory_order_relaxed); }
+	Level GetLevel() const { return level.load(std::memory_order_relaxed); }
+	bool IsEnabled(Level messageLevel) const { return messageLevel <= GetLevel(); }
+
+	// printf style. Never blocks, allocates, or touches a file. Integers, floats, pointers and strings are supported.
+	template <typename... Args>
+	void Write(Level messageLevel, const char *format, const Args &... args)
+	{
+		static_assert(sizeof...(Args) <= maxArgs, "too many log arguments");
+		if (!IsEnabled(messageLevel)) return;
+
+		uint64_t position;
+		Slot *slot = Claim(position);
+		if (!slot) {
+			numDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		Record &record = slot->record;
+		record.timestampNs = MonotonicNs();
+		record.format = format;
+		record.level = messageLevel;
+		record.numArgs = 0;
+		record.textUsed = 0;
+		int dummy[] = { 0, (Capture(record, args), 0)... };
+		(void)dummy;
+
+		slot->sequence.store(position + 1, std::memory_order_release);
+	}
+
+	template <typename... Args> void Error(const char *format, const Args &... args) { Write(kLevel_Error, format, args...); }
+	template <typename... Args> void Warning(const char *format, const Args &... args) { Write(kLevel_Warning, format, args...); }
+	template <typename... Args> void Message(const char *format, const Args &... args) { Write(kLevel_Message, format, args...); }
+	template <typename... Args> void Debug(const char *format, const Args &... args) { Write(kLevel_Debug, format, args...); }
+
+	uint64_t NumWritten() const { return numWritten.load(std::memory_order_relaxed); }
+	uint64_t NumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+	// Turns a record into text, the way the flusher does. Returns the length written.
+	static size_t Format(const Record &record, char *out, size_t size);
+
+private:
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> sequence; // == position when free for the producer of position, position + 1 once written
+		Record record;
+	};
+
+	Slot * Claim(uint64_t &position);
+	bool FlushOne(char *line, size_t size);
+	void FlusherThread();
+
+	static void CaptureString(Record &record, const char *string)
+	{
+		if (!string) string = "(null)";
+		size_t available = textCapacity - record.textUsed;
+		size_t length = strlen(string);
+		if (length >= available) length = available ? available - 1 : 0;
+
+		record.types[record.numArgs] = kArg_String;
+		record.values[record.numArgs] = record.textUsed;
+		record.numArgs++;
+		if (available) {
+			memcpy(record.text + record.textUsed, string, length);
+			record.text[record.textUsed + length] = 0;
+			record.textUsed += (uint16_t)(length + 1);
+		}
+	}
+
+	template <typename T>
+	static void Capture(Record &record, const T &value)
+	{
+		if constexpr (std::is_same<T, std::string>::value) {
+			CaptureString(record, value.c_str());
+		}
+		else if constexpr (std::is_same<typename std::decay<T>::type, const char *>::value || std::is_same<typename std::decay<T>::type, char *>::value) {
+			CaptureString(record, value);
+		}
+		else {
+			ArgType type;
+			uint64_t bits = 0;
+			if constexpr (std::is_floating_point<T>::value) {
+				double d = (double)value;
+				memcpy(&bits, &d, sizeof(bits));
+				type = kArg_Double;
+			}
+			else if constexpr (std::is_pointer<T>::value) {
+				bits = (uint64_t)(uintptr_t)value;
+				type = kArg_Pointer;
+			}
+			else if constexpr (std::is_enum<T>::value || std::is_signed<T>::value) {
+				bits = (uint64_t)(int64_t)value;
+				type = kArg_Int;
+			}
+			else {
+				static_assert(std::is_integral<T>::value, "unsupported log argument type");
+				bits = (uint64_t)value;
+				type = kArg_UInt;
+			}
+			record.types[record.numArgs] = type;
+			record.values[record.numArgs] = bits;
+			record.numArgs++;
+		}
+	}
+
+	std::vector<Slot> slots;
+	uint64_t mask = 0;
+	alignas(64) std::atomic<uint64_t> enqueuePosition = 0; // producers
+	alignas(64) uint64_t dequeuePosition = 0; // flusher only
+
+	std::atomic<Level> level = kLevel_Message;
+	std::atomic<uint64_t> numWritten = 0;
+	std::atomic<uint64_t> numDropped = 0;
+	uint64_t numDroppedReported = 0;
+
+	Sink sink = nullptr;
+	uint32_t flushIntervalMs = 20;
+	std::atomic<bool> stopRequested = false;
+	std::thread thread;
+};
+
+// The plugin's log. Lines end up in DualWieldBlockVR.log.
+extern AsyncLog g_asyncLog;
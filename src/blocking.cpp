@@ -0,0 +1,745 @@
+#include <cmath>
+
+#include "blocking.h"
+#include "dual_hand_classifier.h"
+
+
+namespace BlockCore
+{
+	Matrix33 operator*(const Matrix33 &a, const Matrix33 &b)
+	{
+		Matrix33 result;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				result.data[i][j] = a.data[i][0] * b.data[0][j] + a.data[i][1] * b.data[1][j] + a.data[i][2] * b.data[2][j];
+			}
+		}
+		return result;
+	}
+
+	Matrix33 Transpose(const Matrix33 &r)
+	{
+		Matrix33 result;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				result.data[i][j] = r.data[j][i];
+			}
+		}
+		return result;
+	}
+
+	Transform operator*(const Transform &a, const Transform &b)
+	{
+		Transform result;
+		result.rot = a.rot * b.rot;
+		result.pos = a.pos + a.rot * (b.pos * a.scale);
+		result.scale = a.scale * b.scale;
+		return result;
+	}
+
+	Transform InverseTransform(const Transform &t)
+	{
+		Transform result;
+		result.rot = Transpose(t.rot);
+		result.scale = t.scale ? 1.f / t.scale : 1.f;
+		result.pos = -(result.rot * (t.pos * result.scale));
+		return result;
+	}
+
+	Quaternion QuaternionNormalized(const Quaternion &q)
+	{
+		float length = std::sqrt(DotProduct(q, q));
+		if (length) {
+			return QuaternionMultiply(q, 1.0f / length);
+		}
+		return QuaternionIdentity();
+	}
+
+	Quaternion QuaternionFromMatrix(const Matrix33 &r)
+	{
+		const float (&m)[3][3] = r.data;
+		float trace = m[0][0] + m[1][1] + m[2][2];
+		Quaternion q;
+		if (trace > 0) {
+			float s = std::sqrt(trace + 1.f) * 2.f;
+			q = { 0.25f * s, (m[2][1] - m[1][2]) / s, (m[0][2] - m[2][0]) / s, (m[1][0] - m[0][1]) / s };
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+			float s = std::sqrt(1.f + m[0][0] - m[1][1] - m[2][2]) * 2.f;
+			q = { (m[2][1] - m[1][2]) / s, 0.25f * s, (m[0][1] + m[1][0]) / s, (m[0][2] + m[2][0]) / s };
+		}
+		else if (m[1][1] > m[2][2]) {
+			float s = std::sqrt(1.f + m[1][1] - m[0][0] - m[2][2]) * 2.f;
+			q = { (m[0][2] - m[2][0]) / s, (m[0][1] + m[1][0]) / s, 0.25f * s, (m[1][2] + m[2][1]) / s };
+		}
+		else {
+			float s = std::sqrt(1.f + m[2][2] - m[0][0] - m[1][1]) * 2.f;
+			q = { (m[1][0] - m[0][1]) / s, (m[0][2] + m[2][0]) / s, (m[1][2] + m[2][1]) / s, 0.25f * s };
+		}
+		return QuaternionNormalized(q);
+	}
+
+	Matrix33 MatrixFromQuaternion(const Quaternion &q)
+	{
+		float w = q.w, x = q.x, y = q.y, z = q.z;
+
+		Matrix33 r;
+		r.data[0][0] = 1.f - 2.f * (y * y + z * z); r.data[0][1] = 2.f * (x * y - w * z);       r.data[0][2] = 2.f * (x * z + w * y);
+		r.data[1][0] = 2.f * (x * y + w * z);       r.data[1][1] = 1.f - 2.f * (x * x + z * z); r.data[1][2] = 2.f * (y * z - w * x);
+		r.data[2][0] = 2.f * (x * z - w * y);       r.data[2][1] = 2.f * (y * z + w * x);       r.data[2][2] = 1.f - 2.f * (x * x + y * y);
+		return r;
+	}
+
+	// Rotation of angle radians around a unit axis (Rodrigues)
+	static Matrix33 AxisAngleRotation(const Vector3 &axis, float angle)
+	{
+		float c = std::cos(angle), s = std::sin(angle), t = 1.f - c;
+		float x = axis.x, y = axis.y, z = axis.z;
+
+		Matrix33 r;
+		r.data[0][0] = t * x * x + c;     r.data[0][1] = t * x * y - s * z; r.data[0][2] = t * x * z + s * y;
+		r.data[1][0] = t * x * y + s * z; r.data[1][1] = t * y * y + c;     r.data[1][2] = t * y * z - s * x;
+		r.data[2][0] = t * x * z - s * y; r.data[2][1] = t * y * z + s * x; r.data[2][2] = t * z * z + c;
+		return r;
+	}
+
+	Transform PredictTransform(const Transform &transform, const Motion &motion, float seconds, float havokWorldScale)
+	{
+		Transform result = transform;
+		result.pos = transform.pos + motion.velocity * (seconds / havokWorldScale);
+
+		// Angular velocity is in world axes, so the extra rotation goes on the left
+		float rate = std::sqrt(DotProduct(motion.angularVelocity, motion.angularVelocity));
+		if (rate > 1e-6f) {
+			result.rot = AxisAngleRotation(motion.angularVelocity * (1.f / rate), rate * seconds) * transform.rot;
+		}
+		return result;
+	}
+
+	float PredictSpeed(float speed, float lastSpeed, float secondsSinceLast, float seconds)
+	{
+		if (secondsSinceLast <= 0) return speed;
+
+		float current = std::sqrt(speed);
+		float rate = (current - std::sqrt(lastSpeed)) / secondsSinceLast;
+		if (rate >= 0) return speed;
+
+		float predicted = current + rate * seconds;
+		return predicted > 0 ? predicted * predicted : 0;
+	}
+
+	static const float twoPi = 6.28318531f;
+
+	// Exponential smoothing weight for one step of a first order low pass. Its lag behind a ramp is the time constant.
+	static float SmoothingFactor(float seconds, float cutoffHz, float &timeConstant)
+	{
+		timeConstant = 1.f / (twoPi * cutoffHz);
+		return 1.f / (1.f + timeConstant / seconds);
+	}
+
+	float FilterOneEuro(OneEuroState &state, const OneEuroParams &params, float value, float seconds, float &lagSeconds)
+	{
+		lagSeconds = 0;
+		if (!state.isValid) {
+			state.value = value;
+			state.derivative = 0;
+			state.isValid = true;
+			return value;
+		}
+		if (seconds <= 0) return state.value;
+
+		float derivativeTimeConstant;
+		float derivative = (value - state.value) / seconds;
+		state.derivative += SmoothingFactor(seconds, params.derivativeCutoffHz, derivativeTimeConstant) * (derivative - state.derivative);
+
+		float cutoffHz = params.minCutoffHz + params.beta * std::abs(state.derivative);
+		state.value += SmoothingFactor(seconds, cutoffHz, lagSeconds) * (value - state.value);
+		return state.value;
+	}
+
+	Matrix33 FilterOneEuro(OneEuroRotationState &state, const OneEuroParams &params, const Matrix33 &rotation, float seconds, float &lagSeconds)
+	{
+		lagSeconds = 0;
+		Quaternion q = QuaternionFromMatrix(rotation);
+		if (!state.isValid) {
+			state.value = q;
+			state.angularSpeed = 0;
+			state.isValid = true;
+			return rotation;
+		}
+		if (seconds <= 0) return MatrixFromQuaternion(state.value);
+
+		// q and -q are the same rotation, blend towards whichever is nearer
+		float cosHalfAngle = DotProduct(state.value, q);
+		if (cosHalfAngle < 0) {
+			q = QuaternionMultiply(q, -1.f);
+			cosHalfAngle = -cosHalfAngle;
+		}
+		float angle = 2.f * std::acos(cosHalfAngle < 1.f ? cosHalfAngle : 1.f);
+
+		float derivativeTimeConstant;
+		state.angularSpeed += SmoothingFactor(seconds, params.derivativeCutoffHz, derivativeTimeConstant) * (angle / seconds - state.angularSpeed);
+
+		// Normalized lerp, close enough to a slerp for the small steps between two frames
+		float cutoffHz = params.minCutoffHz + params.beta * state.angularSpeed;
+		float alpha = SmoothingFactor(seconds, cutoffHz, lagSeconds);
+		state.value = QuaternionNormalized(QuaternionAdd(QuaternionMultiply(state.value, 1.f - alpha), QuaternionMultiply(q, alpha)));
+		return MatrixFromQuaternion(state.value);
+	}
+
+	// The enabled jitter filters applied to a copy of the frame. They start over after a gap in valid updates.
+	static const FrameInput & FilterFrame(JitterFilterState &filter, const Config &config, const FrameInput &input, bool wasLastUpdateValid, FrameInput &filtered)
+	{
+		if (!config.speedFilter.IsEnabled() && !config.rotationFilter.IsEnabled()) return input;
+
+		if (!wasLastUpdateValid) filter = JitterFilterState();
+		float seconds = filter.lastNs && input.timestampNs > filter.lastNs ? (float)((input.timestampNs - filter.lastNs) * 1e-9) : 0;
+		filter.lastNs = input.timestampNs;
+
+		filtered = input;
+		if (config.speedFilter.IsEnabled()) {
+			float *speeds[2] = { &filtered.rightHandSpeed, &filtered.leftHandSpeed };
+			for (int hand = 0; hand < 2; hand++) {
+				float speed = FilterOneEuro(filter.speeds[hand], config.speedFilter, std::sqrt(*speeds[hand]), seconds, filter.lagSeconds[kJitterFilter_RightSpeed + hand]);
+				*speeds[hand] = speed * speed;
+			}
+		}
+		if (config.rotationFilter.IsEnabled()) {
+			Transform *transforms[3] = { &filtered.hmd, &filtered.rightWand, &filtered.leftWand };
+			for (int device = 0; device < 3; device++) {
+				transforms[device]->rot = FilterOneEuro(filter.rotations[device], config.rotationFilter, transforms[device]->rot, seconds, filter.lagSeconds[kJitterFilter_HmdRotation + device]);
+			}
+		}
+		return filtered;
+	}
+
+	bool IsDualWielding(const Config &config, HandEquip mainHand, HandEquip offHand)
+	{
+		// Unarmed is okay
+		if (mainHand == HandEquip::Unarmed && offHand == HandEquip::Unarmed) return true;
+
+		// If not unarmed, both hands need to have something
+		if (mainHand == HandEquip::Unarmed || offHand == HandEquip::Unarmed) return false;
+
+		// main hand has to be a weapon, and not two-handed
+		if (mainHand != HandEquip::OneHanded) return false;
+
+		// offhand can be weapon or spell or torch, or shield if enabled
+		switch (offHand) {
+		case HandEquip::OneHanded:
+		case HandEquip::TwoHanded:
+		case HandEquip::Spell:
+		case HandEquip::Torch:
+			return true;
+		case HandEquip::Shield:
+			return config.isShieldEnabled;
+		default:
+			return false;
+		}
+	}
+
+	WeaponType WeaponTypeFromHandEquip(HandEquip equip)
+	{
+		switch (equip) {
+		case HandEquip::Unarmed:
+			return WeaponType::Unarmed;
+		case HandEquip::Spell:
+			return WeaponType::Spell;
+		case HandEquip::Torch:
+			return WeaponType::Torch;
+		case HandEquip::Shield:
+			return WeaponType::Shield;
+		default:
+			return WeaponType::Other;
+		}
+	}
+
+	static const char *s_weaponTypeNames[] = {
+		"HandToHand", "Sword", "Dagger", "WarAxe", "Mace", "Greatsword", "Battleaxe", "Bow", "Staff", "Crossbow",
+		"Unarmed", "Spell", "Torch", "Shield", "Other", "Any"
+	};
+	static_assert(sizeof(s_weaponTypeNames) / sizeof(s_weaponTypeNames[0]) == numWeaponTypes + 1, "a name for every WeaponType");
+
+	const char * WeaponTypeName(WeaponType type)
+	{
+		int index = (int)type;
+		return index <= numWeaponTypes ? s_weaponTypeNames[index] : "Other";
+	}
+
+	static char ToLower(char c)
+	{
+		return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+	}
+
+	bool ParseWeaponType(const char *name, WeaponType &out)
+	{
+		for (int i = 0; i <= numWeaponTypes; i++) {
+			const char *a = name, *b = s_weaponTypeNames[i];
+			while (*a && ToLower(*a) == ToLower(*b)) {
+				a++;
+				b++;
+			}
+			if (!*a && !*b) {
+				out = (WeaponType)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void BuildWeaponProfiles(Config &config, const WeaponProfile *profiles, int numProfiles)
+	{
+		for (int main = 0; main < numWeaponTypes; main++) {
+			for (int off = 0; off < numWeaponTypes; off++) {
+				WeaponThresholds &cell = config.weaponProfiles[main][off];
+				cell = config.dualWield;
+
+				int bestSpecificity = -1;
+				for (int i = 0; i < numProfiles; i++) {
+					const WeaponProfile &profile = profiles[i];
+					bool isMainAny = profile.mainWeapon == WeaponType::Any;
+					bool isOffAny = profile.offWeapon == WeaponType::Any;
+					if (!isMainAny && (int)profile.mainWeapon != main) continue;
+					if (!isOffAny && (int)profile.offWeapon != off) continue;
+
+					int specificity = (isMainAny ? 0 : 1) + (isOffAny ? 0 : 1);
+					if (specificity >= bestSpecificity) {
+						cell = profile.thresholds;
+						bestSpecificity = specificity;
+					}
+				}
+			}
+		}
+	}
+
+	static int PopCount(uint32_t bits)
+	{
+		bits = bits - ((bits >> 1) & 0x55555555u);
+		bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+		return (int)((((bits + (bits >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+	}
+
+	bool GetIsBlockingMode(State &state, const Config &config, bool isBlocking, uint64_t nowNs)
+	{
+		IsBlockingHistory &history = state.isBlockingHistory;
+
+		history.newest = (history.newest + 1) % IsBlockingHistory::capacity;
+		history.timestampsNs[history.newest] = nowNs;
+		const uint32_t newestBit = 1u << history.newest;
+		history.valueBits = isBlocking ? history.valueBits | newestBit : history.valueBits & ~newestBit;
+		if (history.count < IsBlockingHistory::capacity) history.count++;
+
+		const uint64_t windowNs = (uint64_t)((double)config.isBlockingDebounceMs * 1e6);
+		if (windowNs == 0) return isBlocking; // no debounce, and an empty window would vote true
+
+		// Nearly always every stored value is the same, and then so is the vote. Bits that were never written are 0.
+		int numTrue = PopCount(history.valueBits);
+		if (numTrue == 0) return false;
+		if (numTrue == history.count) return true;
+
+		// Each sample speaks for the time since the sample before it
+		uint64_t trueNs = 0, falseNs = 0, coveredNs = 0;
+		int index = history.newest;
+		for (int i = 0; i < history.count && coveredNs < windowNs; i++) {
+			uint64_t timestamp = history.timestampsNs[index];
+			int prevIndex = (index + IsBlockingHistory::capacity - 1) % IsBlockingHistory::capacity;
+			uint64_t span = (i + 1 < history.count && timestamp > history.timestampsNs[prevIndex]) ? timestamp - history.timestampsNs[prevIndex] : maxIsBlockingSampleSpanNs;
+			if (span > maxIsBlockingSampleSpanNs) span = maxIsBlockingSampleSpanNs;
+			if (span > windowNs - coveredNs) span = windowNs - coveredNs;
+			if (nowNs - timestamp >= windowNs) break;
+
+			if (history.valueBits & (1u << index)) trueNs += span;
+			else falseNs += span;
+			coveredNs += span;
+			index = prevIndex;
+		}
+
+		return trueNs >= falseNs;
+	}
+
+	struct WeaponPoseMetrics
+	{
+		float handForwardDotWithHmdDown; // > 0 means the sword is pointing down
+		float handForwardDotWithHmdForward; // close to 0 means the sword is not pointing towards or away from the hmd
+		float hmdToHandVerticalDistance; // Distance of hand away from hmd along hmd up axis
+	};
+
+	static WeaponPoseMetrics GetWeaponPoseMetrics(const Config &config, const Transform &hmdPose, const Transform &handPose)
+	{
+		Vector3 handForward = ForwardVector(handPose.rot);
+		Vector3 hmdForward = ForwardVector(hmdPose.rot);
+		Vector3 hmdDown = -UpVector(hmdPose.rot);
+
+		Vector3 hmdToHand = (handPose.pos - hmdPose.pos) * config.havokWorldScale; // Vector pointing from the hmd to the hand, in meters
+
+		WeaponPoseMetrics metrics;
+		metrics.handForwardDotWithHmdDown = DotProduct(handForward, hmdDown);
+		metrics.handForwardDotWithHmdForward = DotProduct(handForward, hmdForward);
+		metrics.hmdToHandVerticalDistance = DotProduct(hmdDown, hmdToHand);
+		return metrics;
+	}
+
+	HandStatus GetHandBlockingStatus(const Config &config, const HandSample &currentSample, const HandSample &predictedSample, bool isBlocking)
+	{
+		return GetHandBlockingStatus(config, config.dualWield, currentSample, predictedSample, isBlocking);
+	}
+
+	HandStatus GetHandBlockingStatus(const Config &config, const WeaponThresholds &t, const HandSample &currentSample, const HandSample &predictedSample, bool isBlocking)
+	{
+
+		WeaponPoseMetrics current = GetWeaponPoseMetrics(config, currentSample.hmd, currentSample.hand);
+		WeaponPoseMetrics predicted = &predictedSample == &currentSample ? current : GetWeaponPoseMetrics(config, predictedSample.hmd, predictedSample.hand);
+
+		if (predictedSample.speed <= t.maxSpeedEnter &&
+			predicted.handForwardDotWithHmdDown >= t.handForwardHmdDownEnter &&
+			std::abs(predicted.handForwardDotWithHmdForward) <= t.handForwardHmdForwardEnter &&
+			std::abs(predicted.hmdToHandVerticalDistance) <= t.hmdToHandDistanceUpEnter) {
+
+			if (!isBlocking) {
+				// Start blocking
+				return kHandStatus_Start;
+			}
+		}
+		else if (currentSample.speed > t.maxSpeedExit ||
+			current.handForwardDotWithHmdDown < t.handForwardHmdDownExit ||
+			std::abs(current.handForwardDotWithHmdForward) > t.handForwardHmdForwardExit ||
+			std::abs(current.hmdToHandVerticalDistance) > t.hmdToHandDistanceUpExit) {
+
+			if (isBlocking) {
+				// Stop blocking
+				return kHandStatus_Stop;
+			}
+		}
+		return kHandStatus_None;
+	}
+
+	struct UnarmedPoseMetrics
+	{
+		float handForwardDotWithHmdOutwards;
+		float hmdToHandVerticalDistance; // Distance of hand away from hmd along hmd up axis
+	};
+
+	static UnarmedPoseMetrics GetUnarmedPoseMetrics(const Config &config, const Transform &hmdPose, const Transform &handPose, bool isLeft)
+	{
+		Vector3 handForward = ForwardVector(handPose.rot);
+		Vector3 hmdUp = UpVector(hmdPose.rot);
+		Vector3 hmdRight = RightVector(hmdPose.rot);
+
+		Vector3 hmdToHand = (handPose.pos - hmdPose.pos) * config.havokWorldScale; // Vector pointing from the hmd to the hand, in meters
+
+		UnarmedPoseMetrics metrics;
+		metrics.handForwardDotWithHmdOutwards = DotProduct(handForward, hmdRight);
+		if (isLeft) metrics.handForwardDotWithHmdOutwards *= -1.f;
+		metrics.hmdToHandVerticalDistance = DotProduct(hmdUp, hmdToHand);
+		return metrics;
+	}
+
+	HandStatus GetHandBlockingStatusUnarmed(const Config &config, const HandSample &currentSample, const HandSample &predictedSample, bool isBlocking, bool isLeft)
+	{
+		const UnarmedThresholds &t = config.unarmed;
+
+		UnarmedPoseMetrics current = GetUnarmedPoseMetrics(config, currentSample.hmd, currentSample.hand, isLeft);
+		UnarmedPoseMetrics predicted = &predictedSample == &currentSample ? current : GetUnarmedPoseMetrics(config, predictedSample.hmd, predictedSample.hand, isLeft);
+
+		if (predictedSample.speed <= t.maxSpeedEnter &&
+			predicted.handForwardDotWithHmdOutwards >= t.handForwardHmdRightEnter &&
+			std::abs(predicted.hmdToHandVerticalDistance) <= t.hmdToHandDistanceUpEnter) {
+
+			if (!isBlocking) {
+				// Start blocking
+				return kHandStatus_Start;
+			}
+		}
+		else if (currentSample.speed > t.maxSpeedExit ||
+			current.handForwardDotWithHmdOutwards < t.handForwardHmdRightExit ||
+			std::abs(current.hmdToHandVerticalDistance) > t.hmdToHandDistanceUpExit) {
+
+			if (isBlocking) {
+				// Stop blocking
+				return kHandStatus_Stop;
+			}
+		}
+		return kHandStatus_None;
+	}
+
+	// Everything the hand tests look at in one frame
+	struct HandsInput
+	{
+		const Config &config;
+		const WeaponThresholds &weapon; // the profile for this weapon pair
+		HandSample current[kNumHandIndices];
+		HandSample enter[kNumHandIndices]; // predicted, or the current samples again
+		bool isBlocking;
+		bool isBlockingInternal;
+		bool isMainLeft;
+	};
+
+	template <HandMode mode>
+	static HandStatus GetHandStatus(const HandsInput &in, int hand);
+
+	template <>
+	HandStatus GetHandStatus<kHandMode_Armed>(const HandsInput &in, int hand)
+	{
+		return GetHandBlockingStatus(in.config, in.weapon, in.current[hand], in.enter[hand], in.isBlocking);
+	}
+
+	template <>
+	HandStatus GetHandStatus<kHandMode_Unarmed>(const HandsInput &in, int hand)
+	{
+		bool isLeft = (hand == kHandIndex_Main) == in.isMainLeft;
+		return GetHandBlockingStatusUnarmed(in.config, in.current[hand], in.enter[hand], in.isBlocking, isLeft);
+	}
+
+	template <>
+	HandStatus GetHandStatus<kHandMode_Shield>(const HandsInput &in, int)
+	{
+		return !in.isBlockingInternal && in.isBlocking ? kHandStatus_Stop : kHandStatus_None;
+	}
+
+	template <>
+	HandStatus GetHandStatus<kHandMode_Stop>(const HandsInput &, int)
+	{
+		return kHandStatus_Stop; // Hand not being a weapon/shield (so spell) means it should say to stop blocking
+	}
+
+	// One of these per pair of hand modes, so Update does not branch on what the hands hold
+	template <HandMode mainMode, HandMode offMode, bool isDualHandClassifierEnabled>
+	static void GetHandStatuses(const HandsInput &in, HandStatus (&out)[kNumHandIndices])
+	{
+		if constexpr (isDualHandClassifierEnabled && mainMode == offMode && (mainMode == kHandMode_Armed || mainMode == kHandMode_Unarmed)) {
+			// Both hands tested in one pass
+			GetDualHandBlockingStatus(in.config, in.weapon, in.current, in.enter, in.isBlocking, mainMode == kHandMode_Unarmed, in.isMainLeft, out);
+		}
+		else {
+			out[kHandIndex_Main] = GetHandStatus<mainMode>(in, kHandIndex_Main);
+			out[kHandIndex_Off] = GetHandStatus<offMode>(in, kHandIndex_Off);
+		}
+	}
+
+	typedef void (*HandStatusesFunction)(const HandsInput &in, HandStatus (&out)[kNumHandIndices]);
+
+	template <bool isDual, HandMode mainMode>
+	struct HandStatusesRow
+	{
+		static constexpr HandStatusesFunction functions[kNumHandModes] = {
+			GetHandStatuses<mainMode, kHandMode_Armed, isDual>,
+			GetHandStatuses<mainMode, kHandMode_Unarmed, isDual>,
+			GetHandStatuses<mainMode, kHandMode_Shield, isDual>,
+			GetHandStatuses<mainMode, kHandMode_Stop, isDual>
+		};
+	};
+
+	template <bool isDual>
+	static HandStatusesFunction GetHandStatusesFunction(HandMode mainMode, HandMode offMode)
+	{
+		static constexpr const HandStatusesFunction *rows[kNumHandModes] = {
+			HandStatusesRow<isDual, kHandMode_Armed>::functions,
+			HandStatusesRow<isDual, kHandMode_Unarmed>::functions,
+			HandStatusesRow<isDual, kHandMode_Shield>::functions,
+			HandStatusesRow<isDual, kHandMode_Stop>::functions
+		};
+		return rows[mainMode][offMode];
+	}
+
+	static void ReadOutHand(const Config &config, HandMode mode, const HandSample &sample, bool isLeft, HandStatus status, HandReadout &out)
+	{
+		out.mode = mode;
+		out.status = status;
+		out.speed = sample.speed;
+		if (mode == kHandMode_Unarmed) {
+			UnarmedPoseMetrics metrics = GetUnarmedPoseMetrics(config, sample.hmd, sample.hand, isLeft);
+			out.facing = metrics.handForwardDotWithHmdOutwards;
+			out.across = 0;
+			out.verticalDistance = metrics.hmdToHandVerticalDistance;
+		}
+		else {
+			WeaponPoseMetrics metrics = GetWeaponPoseMetrics(config, sample.hmd, sample.hand);
+			out.facing = metrics.handForwardDotWithHmdDown;
+			out.across = metrics.handForwardDotWithHmdForward;
+			out.verticalDistance = metrics.hmdToHandVerticalDistance;
+		}
+	}
+
+	Decision ApplyRequest(State &state, const Config &config, Decision request, bool isBlocking, uint64_t nowNs)
+	{
+		// Catch up with the graph: confirmations, notifications it never acted on, and blocks it started or dropped by itself
+		bool isNotifyTimedOut = IsCooldownOver(state.lastNotifyNs, nowNs, config.notifyTimeoutMs);
+		switch (state.phase) {
+		case kBlockPhase_Idle:
+			if (isBlocking) state.phase = kBlockPhase_Blocking;
+			break;
+		case kBlockPhase_PendingStart:
+			if (isBlocking) state.phase = kBlockPhase_Blocking;
+			else if (isNotifyTimedOut) state.phase = kBlockPhase_Idle;
+			break;
+		case kBlockPhase_Blocking:
+			if (!isBlocking) state.phase = kBlockPhase_Idle;
+			break;
+		case kBlockPhase_PendingStop:
+			if (!isBlocking) state.phase = kBlockPhase_Idle;
+			else if (isNotifyTimedOut) state.phase = kBlockPhase_Blocking;
+			break;
+		}
+
+		if (request == kDecision_StartBlocking) {
+			if (!IsCooldownOver(state.lastBlockStartNs, nowNs, config.blockCooldownMs)) return kDecision_None; // Do not try to block more than once every n ms
+			if (state.phase != kBlockPhase_Idle) {
+				if (IsCooldownOver(state.lastStartSuppressedNs, nowNs, config.blockCooldownMs)) {
+					state.notifyCounts.numStartsSuppressed++;
+					state.lastStartSuppressedNs = nowNs;
+				}
+				return kDecision_None;
+			}
+			state.phase = kBlockPhase_PendingStart;
+			state.lastBlockStartNs = nowNs;
+			state.notifyCounts.numStartsSent++;
+		}
+		else if (request == kDecision_StopBlocking) {
+			if (!IsCooldownOver(state.lastBlockStopNs, nowNs, config.blockCooldownMs)) return kDecision_None; // Do not try to stop blocking more than once every n ms
+			if (state.phase != kBlockPhase_PendingStart && state.phase != kBlockPhase_Blocking) {
+				if (IsCooldownOver(state.lastStopSuppressedNs, nowNs, config.blockCooldownMs)) {
+					state.notifyCounts.numStopsSuppressed++;
+					state.lastStopSuppressedNs = nowNs;
+				}
+				return kDecision_None;
+			}
+			state.phase = kBlockPhase_PendingStop;
+			state.lastBlockStopNs = nowNs;
+			state.notifyCounts.numStopsSent++;
+		}
+		else {
+			return kDecision_None;
+		}
+		state.lastNotifyNs = nowNs;
+		return request;
+	}
+
+	Decision CancelBlock(State &state, bool wasLastUpdateValid)
+	{
+		if (!wasLastUpdateValid) return kDecision_None;
+
+		// The graph is not followed while not dual wielding, so this is the last word either way
+		bool isBlockUp = state.phase == kBlockPhase_PendingStart || state.phase == kBlockPhase_Blocking;
+		state.phase = kBlockPhase_Idle;
+		if (!isBlockUp) {
+			state.notifyCounts.numStopsSuppressed++;
+			return kDecision_None;
+		}
+		state.notifyCounts.numStopsSent++;
+		return kDecision_StopBlocking;
+	}
+
+	void RevertDecision(State &state, Decision decision, uint64_t decidedNs)
+	{
+		// The notification before it in the same direction was at least a cooldown earlier, so forgetting the time is enough
+		if (decision == kDecision_StartBlocking) {
+			state.notifyCounts.numStartsSent--;
+			if (!decidedNs || state.lastBlockStartNs != decidedNs) return;
+			state.lastBlockStartNs = 0;
+			if (state.phase == kBlockPhase_PendingStart && state.lastNotifyNs == decidedNs) state.phase = kBlockPhase_Idle;
+		}
+		else if (decision == kDecision_StopBlocking) {
+			state.notifyCounts.numStopsSent--;
+			if (!decidedNs || state.lastBlockStopNs != decidedNs) return;
+			state.lastBlockStopNs = 0;
+			// Catching up drops this again if the graph is not blocking either
+			if (state.phase == kBlockPhase_PendingStop && state.lastNotifyNs == decidedNs) state.phase = kBlockPhase_Blocking;
+		}
+	}
+
+	Decision Update(State &state, const Config &config, const FrameInput &rawInput)
+	{
+		if (!rawInput.isActive) return kDecision_None;
+
+		bool wasLastUpdateValid = state.isLastUpdateValid;
+		state.isLastUpdateValid = false;
+
+		if (!IsDualWielding(config, rawInput.mainHand, rawInput.offHand)) {
+			// If we switched weapons away from dual wielding, cancel existing block state
+			return CancelBlock(state, wasLastUpdateValid);
+		}
+
+		// Smooth out tracking jitter before anything looks at the speeds and orientations
+		FrameInput filteredInput;
+		const FrameInput &input = FilterFrame(state.jitterFilter, config, rawInput, wasLastUpdateValid, filteredInput);
+
+		// Check if the player is blocking
+		bool isBlocking = GetIsBlockingMode(state, config, input.isBlockingGraph, input.timestampNs);
+		state.isBlocking = isBlocking;
+
+		bool isLeftHanded = input.isLeftHanded;
+
+		const Transform &mainWand = isLeftHanded ? input.leftWand : input.rightWand;
+		const Transform &offhandWand = isLeftHanded ? input.rightWand : input.leftWand;
+		float mainWandSpeed = isLeftHanded ? input.leftHandSpeed : input.rightHandSpeed;
+		float offhandWandSpeed = isLeftHanded ? input.rightHandSpeed : input.leftHandSpeed;
+
+		HandSample mainSample = { input.hmd, mainWand, mainWandSpeed };
+		HandSample offhandSample = { input.hmd, offhandWand, offhandWandSpeed };
+
+		// Without prediction the enter tests look at the current samples, and nothing is copied
+		Transform predictedHmd, predictedMainWand, predictedOffhandWand;
+		HandSample predictedMainSample = { predictedHmd, predictedMainWand, mainWandSpeed };
+		HandSample predictedOffhandSample = { predictedHmd, predictedOffhandWand, offhandWandSpeed };
+		bool isPredicting = config.predictionLookaheadMs > 0;
+		if (isPredicting) {
+			float seconds = config.predictionLookaheadMs * 0.001f;
+			predictedHmd = PredictTransform(input.hmd, input.hmdMotion, seconds, config.havokWorldScale);
+			predictedMainWand = PredictTransform(mainWand, isLeftHanded ? input.leftWandMotion : input.rightWandMotion, seconds, config.havokWorldScale);
+			predictedOffhandWand = PredictTransform(offhandWand, isLeftHanded ? input.rightWandMotion : input.leftWandMotion, seconds, config.havokWorldScale);
+
+			// The speed limit is what usually holds a block back, the hand is in the guard pose a few frames before it slows down
+			if (wasLastUpdateValid && input.timestampNs > state.lastHandSpeedNs) {
+				float secondsSinceLast = (float)((input.timestampNs - state.lastHandSpeedNs) * 1e-9);
+				predictedMainSample.speed = PredictSpeed(mainWandSpeed, isLeftHanded ? state.lastLeftHandSpeed : state.lastRightHandSpeed, secondsSinceLast, seconds);
+				predictedOffhandSample.speed = PredictSpeed(offhandWandSpeed, isLeftHanded ? state.lastRightHandSpeed : state.lastLeftHandSpeed, secondsSinceLast, seconds);
+			}
+		}
+		const HandSample &mainEnterSample = isPredicting ? predictedMainSample : mainSample;
+		const HandSample &offhandEnterSample = isPredicting ? predictedOffhandSample : offhandSample;
+
+		state.lastRightHandSpeed = input.rightHandSpeed;
+		state.lastLeftHandSpeed = input.leftHandSpeed;
+		state.lastHandSpeedNs = input.timestampNs;
+
+		// Weapon thresholds for this pair of weapon types, flattened at load
+		const WeaponThresholds &weapon = config.weaponProfiles[(int)input.mainWeapon][(int)input.offWeapon];
+
+		HandsInput hands = {
+			config, weapon,
+			{ mainSample, offhandSample },
+			{ mainEnterSample, offhandEnterSample },
+			isBlocking, input.isBlockingInternal, isLeftHanded
+		};
+		HandMode mainMode = handModeByEquip[(int)input.mainHand];
+		HandMode offMode = handModeByEquip[(int)input.offHand];
+		HandStatusesFunction getHandStatuses = config.isDualHandClassifierEnabled ? GetHandStatusesFunction<true>(mainMode, offMode) : GetHandStatusesFunction<false>(mainMode, offMode);
+
+		HandStatus statuses[kNumHandIndices];
+		getHandStatuses(hands, statuses);
+		HandStatus mainHandBlockStatus = statuses[kHandIndex_Main];
+		HandStatus offHandBlockStatus = statuses[kHandIndex_Off];
+
+		if (config.isHandReadoutEnabled) {
+			ReadOutHand(config, mainMode, mainSample, isLeftHanded, mainHandBlockStatus, state.hands[kHandIndex_Main]);
+			ReadOutHand(config, offMode, offhandSample, !isLeftHanded, offHandBlockStatus, state.hands[kHandIndex_Off]);
+		}
+
+		// Both weapons crossed in front of the face holds a block like a third hand would. Without it, it never holds one.
+		HandStatus crossGuardStatus = kHandStatus_Stop;
+		if (config.isCrossGuardEnabled && mainMode == kHandMode_Armed && offMode == kHandMode_Armed) {
+			crossGuardStatus = GetCrossGuardStatus(TestCrossGuard(config, hands.current, hands.enter), isBlocking);
+		}
+
+		Decision request = kDecision_None;
+		if (mainHandBlockStatus == kHandStatus_Start || offHandBlockStatus == kHandStatus_Start || crossGuardStatus == kHandStatus_Start) { // Either hand is in blocking position
+			request = kDecision_StartBlocking;
+		}
+		else if (mainHandBlockStatus == kHandStatus_Stop && offHandBlockStatus == kHandStatus_Stop && crossGuardStatus == kHandStatus_Stop) { // Both hands are not blocking
+			request = kDecision_StopBlocking;
+		}
+		state.lastRequest = request;
+		state.isLastUpdateValid = true;
+		return ApplyRequest(state, config, request, isBlocking, input.timestampNs);
+	}
+}
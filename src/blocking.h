@@ -0,0 +1,393 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Headless block detection. Nothing in here touches SKSE or game types, so it builds on its own and can be driven by recorded frames outside the game.
+namespace BlockCore
+{
+	struct Vector3 { float x, y, z; };
+
+	// Same layout as NiMatrix33. Columns are the right / forward / up basis vectors.
+	struct Matrix33 { float data[3][3]; };
+
+	// Same layout as NiTransform
+	struct Transform
+	{
+		Matrix33 rot;
+		Vector3 pos;
+		float scale;
+	};
+
+	inline Vector3 operator+(const Vector3 &a, const Vector3 &b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline Vector3 operator-(const Vector3 &a, const Vector3 &b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Vector3 operator*(const Vector3 &a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+	inline Vector3 operator-(const Vector3 &a) { return { -a.x, -a.y, -a.z }; }
+	inline float DotProduct(const Vector3 &a, const Vector3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline Vector3 RightVector(const Matrix33 &r) { return { r.data[0][0], r.data[1][0], r.data[2][0] }; }
+	inline Vector3 ForwardVector(const Matrix33 &r) { return { r.data[0][1], r.data[1][1], r.data[2][1] }; }
+	inline Vector3 UpVector(const Matrix33 &r) { return { r.data[0][2], r.data[1][2], r.data[2][2] }; }
+	inline Vector3 operator*(const Matrix33 &r, const Vector3 &v)
+	{
+		return {
+			r.data[0][0] * v.x + r.data[0][1] * v.y + r.data[0][2] * v.z,
+			r.data[1][0] * v.x + r.data[1][1] * v.y + r.data[1][2] * v.z,
+			r.data[2][0] * v.x + r.data[2][1] * v.y + r.data[2][2] * v.z
+		};
+	}
+	Matrix33 operator*(const Matrix33 &a, const Matrix33 &b);
+	Matrix33 Transpose(const Matrix33 &r);
+
+	// Same conventions as NiTransform: (a * b) applies b first, then a
+	Transform operator*(const Transform &a, const Transform &b);
+	Transform InverseTransform(const Transform &t);
+
+	// Same layout as NiQuaternion, and the same helpers as math_utils has for it
+	struct Quaternion { float w, x, y, z; };
+
+	inline float DotProduct(const Quaternion &a, const Quaternion &b) { return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline Quaternion QuaternionIdentity() { return { 1, 0, 0, 0 }; }
+	inline Quaternion QuaternionMultiply(const Quaternion &q, float multiplier) { return { q.w * multiplier, q.x * multiplier, q.y * multiplier, q.z * multiplier }; }
+	inline Quaternion QuaternionAdd(const Quaternion &a, const Quaternion &b) { return { a.w + b.w, a.x + b.x, a.y + b.y, a.z + b.z }; }
+	Quaternion QuaternionNormalized(const Quaternion &q);
+	Quaternion QuaternionFromMatrix(const Matrix33 &r);
+	Matrix33 MatrixFromQuaternion(const Quaternion &q);
+
+	// Linear and angular velocity of a tracked device, in game world axes
+	struct Motion
+	{
+		Vector3 velocity; // m/s
+		Vector3 angularVelocity; // rad/s, rotation axis scaled by the rate
+	};
+
+	// What a hand is holding, as far as blocking cares
+	enum class HandEquip : uint8_t
+	{
+		Unarmed,
+		OneHanded,
+		TwoHanded,
+		Spell,
+		Torch,
+		Shield,
+		Other
+	};
+
+	// What a hand is holding in enough detail to pick a [DualWield] profile. The weapons are the game's
+	// TESObjectWEAP::GameData::type codes, so the plugin gets them with a cast.
+	enum class WeaponType : uint8_t
+	{
+		HandToHand = 0,
+		Sword,
+		Dagger,
+		WarAxe,
+		Mace,
+		Greatsword,
+		Battleaxe,
+		Bow,
+		Staff,
+		Crossbow,
+		Unarmed,
+		Spell,
+		Torch,
+		Shield,
+		Other,
+		Any // only in profiles, matches every type
+	};
+	const int numWeaponTypes = (int)WeaponType::Any;
+
+	// For frames that only know the HandEquip (old traces, generated sessions). Weapons become Other, which uses [DualWield].
+	WeaponType WeaponTypeFromHandEquip(HandEquip equip);
+
+	// The names used in profile section names and traces: Sword, WarAxe, Any... Parsing ignores case.
+	const char * WeaponTypeName(WeaponType type);
+	bool ParseWeaponType(const char *name, WeaponType &out);
+
+	// Which block test a hand gets
+	enum HandMode : uint8_t
+	{
+		kHandMode_Armed = 0, // weapon / torch
+		kHandMode_Unarmed,
+		kHandMode_Shield, // stops the block if the game is not blocking with the shield itself
+		kHandMode_Stop, // spells etc., always say stop
+		kNumHandModes
+	};
+
+	// Indexed by HandEquip
+	constexpr HandMode handModeByEquip[] = { kHandMode_Unarmed, kHandMode_Armed, kHandMode_Armed, kHandMode_Stop, kHandMode_Armed, kHandMode_Shield, kHandMode_Stop };
+
+	// Result of the per-hand tests
+	enum HandStatus
+	{
+		kHandStatus_None = 0,
+		kHandStatus_Stop = 1,
+		kHandStatus_Start = 2
+	};
+
+	// What the caller should tell the animation graph this frame
+	enum Decision
+	{
+		kDecision_None = 0,
+		kDecision_StartBlocking,
+		kDecision_StopBlocking
+	};
+
+	// Where the block we asked the animation graph for stands, as far as the debounced IsBlocking shows. blockStart and
+	// blockStop are only sent when the tests want something other than this, since each one walks the behavior graph.
+	enum BlockPhase
+	{
+		kBlockPhase_Idle = 0, // not blocking
+		kBlockPhase_PendingStart, // blockStart sent, IsBlocking has not shown it yet
+		kBlockPhase_Blocking, // started by us or by the game
+		kBlockPhase_PendingStop // blockStop sent, IsBlocking has not dropped yet
+	};
+
+	struct WeaponThresholds
+	{
+		float maxSpeedEnter = 2;
+		float maxSpeedExit = 3;
+		float handForwardHmdDownEnter = -0.6f;
+		float handForwardHmdDownExit = -0.6f;
+		float handForwardHmdForwardEnter = 0.4f;
+		float handForwardHmdForwardExit = 0.6f;
+		float hmdToHandDistanceUpEnter = 0.35f;
+		float hmdToHandDistanceUpExit = 0.35f;
+	};
+
+	struct UnarmedThresholds
+	{
+		float maxSpeedEnter = 1;
+		float maxSpeedExit = 1.5f;
+		float handForwardHmdRightEnter = 0.5f;
+		float handForwardHmdRightExit = 0.4f;
+		float hmdToHandDistanceUpEnter = 0.35f;
+		float hmdToHandDistanceUpExit = 0.35f;
+	};
+
+	// Both weapons crossed in an X in front of the face (dual_hand_classifier.h). Each blade is a segment bladeLength
+	// long from the hand along its forward vector.
+	struct CrossGuardThresholds
+	{
+		float bladeLength = 0.8f; // meters
+		float maxSpeedEnter = 2; // squared, both hands
+		float maxSpeedExit = 3;
+		float maxBladeDistanceEnter = 0.06f; // closest approach of the two blades, meters
+		float maxBladeDistanceExit = 0.1f;
+		float bladeDotEnter = 0.7f; // |main blade . off blade| must be below this, 0.7 is about 45 degrees between them
+		float bladeDotExit = 0.8f;
+		float minForwardDistanceEnter = 0.15f; // where the blades cross, in front of the hmd along its forward axis, meters
+		float minForwardDistanceExit = 0.1f;
+		float maxVerticalDistanceEnter = 0.3f; // where the blades cross, away from the hmd along its up axis, meters
+		float maxVerticalDistanceExit = 0.4f;
+	};
+
+	// A [DualWield.<Main>.<Off>] section. Either type can be Any.
+	struct WeaponProfile
+	{
+		WeaponType mainWeapon;
+		WeaponType offWeapon;
+		WeaponThresholds thresholds;
+	};
+
+	// Speed adaptive low pass (the One Euro filter). The cutoff is minCutoffHz while the signal holds still and rises by
+	// beta per unit/s of change, so jitter is smoothed away at rest while fast movements pass with little lag.
+	struct OneEuroParams
+	{
+		float minCutoffHz = 0; // 0 disables the filter
+		float beta = 0;
+		float derivativeCutoffHz = 1; // for the rate of change that beta is applied to
+
+		bool IsEnabled() const { return minCutoffHz > 0; }
+	};
+
+	struct OneEuroState
+	{
+		float value = 0;
+		float derivative = 0;
+		bool isValid = false;
+	};
+
+	struct OneEuroRotationState
+	{
+		Quaternion value = { 1, 0, 0, 0 };
+		float angularSpeed = 0; // rad/s, the derivative
+		bool isValid = false;
+	};
+
+	// Each returns the filtered value. lagSeconds is how far the output trails a steadily changing input at the cutoff used.
+	float FilterOneEuro(OneEuroState &state, const OneEuroParams &params, float value, float seconds, float &lagSeconds);
+	Matrix33 FilterOneEuro(OneEuroRotationState &state, const OneEuroParams &params, const Matrix33 &rotation, float seconds, float &lagSeconds);
+
+	struct Config
+	{
+		Config()
+		{
+			for (auto &row : weaponProfiles) {
+				for (WeaponThresholds &thresholds : row) thresholds = dualWield;
+			}
+		}
+
+		WeaponThresholds dualWield;
+		// The weapon thresholds Update uses for each main hand / off hand weapon type pair: dualWield, overridden by the
+		// profiles. Flattened by BuildWeaponProfiles, which has to run again whenever dualWield changes.
+		WeaponThresholds weaponProfiles[numWeaponTypes][numWeaponTypes];
+		UnarmedThresholds unarmed;
+		CrossGuardThresholds crossGuard;
+		bool isCrossGuardEnabled = false; // also block with both weapons crossed in front of the face
+		bool isShieldEnabled = false;
+		float havokWorldScale = 0.0142875f; // game units -> meters
+		float blockCooldownMs = 333; // time to ignore further block starts after a start, or stops after a stop
+		float isBlockingDebounceMs = 55; // window over which the IsBlocking animation variable is majority voted
+		float predictionLookaheadMs = 0; // run the enter tests on poses extrapolated this far ahead along their velocities. 0 disables prediction.
+		float notifyTimeoutMs = 500; // how long IsBlocking gets to show a blockStart / blockStop before it may be sent again
+		bool isDualHandClassifierEnabled = false; // test both hands in one vectorized pass (dual_hand_classifier.h). Same decisions, see tools/classifierbench.
+		bool isHandReadoutEnabled = false; // fill State::hands on every valid update, for telemetry. A few dot products per hand.
+		OneEuroParams speedFilter; // hand speeds, before the tests and prediction see them
+		OneEuroParams rotationFilter; // hmd and wand orientations
+	};
+
+	// Everything Update() needs from the game for a single frame
+	struct FrameInput
+	{
+		uint64_t timestampNs; // monotonic
+		uint64_t poseTimestampNs = 0; // when the poses behind the speeds and motions were sampled, for latency tracing. 0 if unknown.
+		bool isActive; // player has 3d, weapon is drawn, not in a menu, and the hmd / wand nodes exist
+		HandEquip mainHand;
+		HandEquip offHand;
+		WeaponType mainWeapon = WeaponType::Other; // picks the weapon profile
+		WeaponType offWeapon = WeaponType::Other;
+		bool isLeftHanded;
+		bool isBlockingGraph; // raw IsBlocking animation variable. Only needs to be valid when dual wielding.
+		bool isBlockingInternal; // the game itself decided to block (shield, 2h, etc.)
+		float rightHandSpeed; // squared, m/s
+		float leftHandSpeed;
+		Transform hmd;
+		Transform rightWand;
+		Transform leftWand;
+		Motion hmdMotion; // all zero if unknown, which makes the prediction a no-op
+		Motion rightWandMotion;
+		Motion leftWandMotion;
+	};
+
+	// Recent IsBlocking values with the time each was observed
+	struct IsBlockingHistory
+	{
+		static const int capacity = 32; // enough for the debounce window at any sane frame rate, and one bit per value
+
+		uint64_t timestampsNs[capacity] = {};
+		uint32_t valueBits = 0; // bit i is the value observed at timestampsNs[i]
+		int newest = 0;
+		int count = 0;
+	};
+
+	// The jitter filters, one per device and signal
+	enum JitterFilter
+	{
+		kJitterFilter_RightSpeed = 0,
+		kJitterFilter_LeftSpeed,
+		kJitterFilter_HmdRotation,
+		kJitterFilter_RightRotation,
+		kJitterFilter_LeftRotation,
+		kNumJitterFilters
+	};
+
+	struct JitterFilterState
+	{
+		OneEuroState speeds[2]; // right, left. On the speed in m/s, not the squared one.
+		OneEuroRotationState rotations[3]; // hmd, right, left
+		uint64_t lastNs = 0;
+		float lagSeconds[kNumJitterFilters] = {}; // what each filter added on the last update, 0 if it is off
+	};
+
+	// One hand's block test inputs as of the last valid update, for telemetry. The current pose, not the predicted one.
+	struct HandReadout
+	{
+		HandMode mode = kHandMode_Stop;
+		HandStatus status = kHandStatus_None;
+		float speed = 0; // squared, m/s
+		float facing = 0; // hand forward . hmd down, or . hmd outwards unarmed
+		float across = 0; // hand forward . hmd forward, weapons only
+		float verticalDistance = 0; // hmd to hand along hmd down, or hmd up unarmed, in meters
+	};
+
+	// Notifications sent to the animation graph, and the ones the block phase held back that sending on every request
+	// (once per cooldown) would have sent
+	struct NotifyCounts
+	{
+		uint64_t numStartsSent = 0;
+		uint64_t numStartsSuppressed = 0;
+		uint64_t numStopsSent = 0;
+		uint64_t numStopsSuppressed = 0;
+	};
+
+	struct State
+	{
+		bool isLastUpdateValid = false;
+		IsBlockingHistory isBlockingHistory;
+		uint64_t lastBlockStartNs = 0; // when we last tried to start blocking, 0 if never
+		uint64_t lastBlockStopNs = 0; // when we last tried to stop blocking, 0 if never
+		float lastRightHandSpeed = 0; // squared speeds from the last valid update, for predicting how the speed changes
+		float lastLeftHandSpeed = 0;
+		uint64_t lastHandSpeedNs = 0;
+		JitterFilterState jitterFilter;
+		Decision lastRequest = kDecision_None; // what the hand tests asked for on the last valid update, before the cooldowns
+		bool isBlocking = false; // IsBlocking after the debounce, as the hand tests last saw it
+		BlockPhase phase = kBlockPhase_Idle;
+		uint64_t lastNotifyNs = 0; // when blockStart / blockStop was last sent, 0 if never
+		NotifyCounts notifyCounts;
+		uint64_t lastStartSuppressedNs = 0; // suppressed ones are counted once per cooldown, as often as they would have been sent
+		uint64_t lastStopSuppressedNs = 0;
+		HandReadout hands[2]; // main, off. Only kept up to date with config.isHandReadoutEnabled.
+	};
+
+	// Longest time a single IsBlocking sample is allowed to speak for, so one sample after a long gap does not fill the whole window
+	const uint64_t maxIsBlockingSampleSpanNs = 50 * 1000 * 1000;
+
+	bool IsDualWielding(const Config &config, HandEquip mainHand, HandEquip offHand);
+
+	// Fills config.weaponProfiles from config.dualWield and the profiles. A pair gets the most specific profile that
+	// matches it (exact pair, then one side Any, then both Any), and the later one of two equally specific ones.
+	void BuildWeaponProfiles(Config &config, const WeaponProfile *profiles, int numProfiles);
+
+	// Get the mode of the IsBlocking value over the debounce window, weighted by how long each value was seen.
+	// This is needed because when you block a hit, it goes to 0 for 1 frame, then back to 1.
+	bool GetIsBlockingMode(State &state, const Config &config, bool isBlocking, uint64_t nowNs);
+
+	// True if at least cooldownMs has passed since lastNs (or lastNs was never set)
+	inline bool IsCooldownOver(uint64_t lastNs, uint64_t nowNs, float cooldownMs)
+	{
+		return lastNs == 0 || nowNs - lastNs >= (uint64_t)((double)cooldownMs * 1e6);
+	}
+
+	// Where the transform will be after the given time if it keeps moving the way it is now
+	Transform PredictTransform(const Transform &transform, const Motion &motion, float seconds, float havokWorldScale);
+
+	// Squared speed after the given time, from how fast the speed is changing. Only ever lower than the current speed,
+	// a hand that is speeding up is judged on its current speed.
+	float PredictSpeed(float speed, float lastSpeed, float secondsSinceLast, float seconds);
+
+	// One hand as the tests see it
+	struct HandSample
+	{
+		const Transform &hmd;
+		const Transform &hand;
+		float speed; // squared, m/s
+	};
+
+	// The enter test looks at the predicted sample and the exit test at the current one, so a hand that is about to
+	// settle into the guard starts the block early but nothing stops early. Pass the same sample twice to not predict.
+	HandStatus GetHandBlockingStatus(const Config &config, const HandSample &current, const HandSample &predicted, bool isBlocking);
+	// The same with a weapon profile's thresholds instead of config.dualWield
+	HandStatus GetHandBlockingStatus(const Config &config, const WeaponThresholds &thresholds, const HandSample &current, const HandSample &predicted, bool isBlocking);
+	HandStatus GetHandBlockingStatusUnarmed(const Config &config, const HandSample &current, const HandSample &predicted, bool isBlocking, bool isLeft);
+
+	// Turns what the tests ask for into the notification to send, if any. Follows the block phase along with the debounced
+	// IsBlocking first, giving up on a notification IsBlocking has not shown within notifyTimeoutMs.
+	Decision ApplyRequest(State &state, const Config &config, Decision request, bool isBlocking, uint64_t nowNs);
+	// The player stopped dual wielding. Stops the block if one of ours may still be up.
+	Decision CancelBlock(State &state, bool wasLastUpdateValid);
+	// A decision made at decidedNs never reached the graph. Takes back its count, its cooldown and the phase it moved to,
+	// so the next one is not held up by a notification that was never sent. decidedNs is 0 if the time is not known.
+	void RevertDecision(State &state, Decision decision, uint64_t decidedNs);
+
+	Decision Update(State &state, const Config &config, const FrameInput &input);
+}
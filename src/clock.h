@@ -0,0 +1,14 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+
+// Monotonic high resolution time shared by the pose thread and the game thread (QueryPerformanceCounter on Windows)
+inline uint64_t MonotonicNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline double NsToMs(uint64_t ns) { return (double)ns * 1e-6; }
+inline uint64_t MsToNs(double ms) { return (uint64_t)(ms * 1e6); }
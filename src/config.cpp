@@ -1,6 +1,8 @@
 #include <string>
 #include "skse64_common/Utilities.h"
 
+#include "async_log.h"
+
 
 namespace DualWieldBlockVR
 {
@@ -13,57 +15,24 @@ namespace DualWieldBlockVR
 			if (!runtimePath.empty()) {
 				s_configPath = runtimePath + "Data\\SKSE\\Plugins\\DualWieldBlockVR.ini";
 
-				_MESSAGE("config path = %s", s_configPath.c_str());
+				g_asyncLog.Message("config path = %s", s_configPath);
 			}
 		}
 
 		return s_configPath;
 	}
 
-	std::string GetConfigOption(const char * section, const char * key)
+	const std::string & GetAddressCachePath()
 	{
-		std::string	result;
-
-		const std::string & configPath = GetConfigPath();
-		if (!configPath.empty()) {
-			char	resultBuf[256];
-			resultBuf[0] = 0;
-
-			UInt32	resultLen = GetPrivateProfileString(section, key, NULL, resultBuf, sizeof(resultBuf), configPath.c_str());
+		static std::string s_cachePath;
 
-			result = resultBuf;
+		if (s_cachePath.empty()) {
+			std::string	runtimePath = GetRuntimeDirectory();
+			if (!runtimePath.empty()) {
+				s_cachePath = runtimePath + "Data\\SKSE\\Plugins\\DualWieldBlockVR_Addresses.txt";
+			}
 		}
 
-		return result;
-	}
-
-	bool GetConfigOptionFloat(const char *section, const char *key, float *out)
-	{
-		std::string	data = GetConfigOption(section, key);
-		if (data.empty())
-			return false;
-
-		*out = std::stof(data);
-		return true;
-	}
-
-	bool GetConfigOptionBool(const char *section, const char *key, bool *out)
-	{
-		std::string	data = GetConfigOption(section, key);
-		if (data.empty())
-			return false;
-
-		int val = std::stoi(data);
-		if (val == 1) {
-			*out = true;
-			return true;
-		}
-		else if (val == 0) {
-			*out = false;
-			return true;
-		}
-		else {
-			return false;
-		}
+		return s_cachePath;
 	}
 }
\ No newline at end of file
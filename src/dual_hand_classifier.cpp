@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "dual_hand_classifier.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define DUAL_HAND_CLASSIFIER_SSE
+#endif
+
+
+namespace BlockCore
+{
+	// Lanes 0 and 1 are the current main / off hand samples (exit tests), lanes 2 and 3 the predicted ones (enter tests)
+	static const int numLanes = 4;
+
+	// A sample passes if speed <= maxSpeed, a >= minA, |b| <= maxAbsB and |c| <= maxAbsC.
+	// Weapon: a = hand forward . hmd down, b = hand forward . hmd forward, c = hmd down . hmd to hand
+	// Unarmed: a = hand forward . hmd outwards, no b, c = hmd up . hmd to hand
+	struct LaneThresholds
+	{
+		float maxSpeed;
+		float minA;
+		float maxAbsB;
+		float maxAbsC;
+	};
+
+	static void GetLaneThresholds(const Config &config, const WeaponThresholds &weapon, bool isUnarmed, LaneThresholds &enter, LaneThresholds &exit)
+	{
+		if (isUnarmed) {
+			const UnarmedThresholds &t = config.unarmed;
+			const float noLimit = std::numeric_limits<float>::infinity(); // b is always 0, this makes its tests always pass / never fail
+			enter = { t.maxSpeedEnter, t.handForwardHmdRightEnter, noLimit, t.hmdToHandDistanceUpEnter };
+			exit = { t.maxSpeedExit, t.handForwardHmdRightExit, noLimit, t.hmdToHandDistanceUpExit };
+		}
+		else {
+			const WeaponThresholds &t = weapon;
+			enter = { t.maxSpeedEnter, t.handForwardHmdDownEnter, t.handForwardHmdForwardEnter, t.hmdToHandDistanceUpEnter };
+			exit = { t.maxSpeedExit, t.handForwardHmdDownExit, t.handForwardHmdForwardExit, t.hmdToHandDistanceUpExit };
+		}
+	}
+
+	// insideBits / outsideBits have bit i set if lane i passed / failed its thresholds
+	static void GetStatusFromLaneBits(int insideBits, int outsideBits, bool isBlocking, HandStatus (&out)[kNumHandIndices])
+	{
+		for (int hand = 0; hand < kNumHandIndices; hand++) {
+			bool isEnter = (insideBits >> (hand + 2)) & 1;
+			bool isExit = (outsideBits >> hand) & 1;
+			if (isEnter) {
+				out[hand] = isBlocking ? kHandStatus_None : kHandStatus_Start;
+			}
+			else {
+				out[hand] = isExit && isBlocking ? kHandStatus_Stop : kHandStatus_None;
+			}
+		}
+	}
+
+	void GetDualHandBlockingStatusScalar(const Config &config, const WeaponThresholds &weapon, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices],
+		bool isBlocking, bool isUnarmed, bool isMainLeft, HandStatus (&out)[kNumHandIndices])
+	{
+		LaneThresholds enter, exit;
+		GetLaneThresholds(config, weapon, isUnarmed, enter, exit);
+
+		const HandSample *samples[numLanes] = { &current[0], &current[1], &predicted[0], &predicted[1] };
+
+		int insideBits = 0, outsideBits = 0;
+		for (int lane = 0; lane < numLanes; lane++) {
+			const HandSample &sample = *samples[lane];
+			const LaneThresholds &t = lane < 2 ? exit : enter;
+			bool isLeft = (lane & 1) ? !isMainLeft : isMainLeft;
+
+			Vector3 handForward = ForwardVector(sample.hand.rot);
+			Vector3 hmdToHand = (sample.hand.pos - sample.hmd.pos) * config.havokWorldScale;
+
+			float a, b, c;
+			if (isUnarmed) {
+				a = DotProduct(handForward, RightVector(sample.hmd.rot));
+				if (isLeft) a *= -1.f;
+				b = 0;
+				c = DotProduct(UpVector(sample.hmd.rot), hmdToHand);
+			}
+			else {
+				Vector3 hmdDown = -UpVector(sample.hmd.rot);
+				a = DotProduct(handForward, hmdDown);
+				b = DotProduct(handForward, ForwardVector(sample.hmd.rot));
+				c = DotProduct(hmdDown, hmdToHand);
+			}
+
+			if (sample.speed <= t.maxSpeed && a >= t.minA && std::abs(b) <= t.maxAbsB && std::abs(c) <= t.maxAbsC) {
+				insideBits |= 1 << lane;
+			}
+			if (sample.speed > t.maxSpeed || a < t.minA || std::abs(b) > t.maxAbsB || std::abs(c) > t.maxAbsC) {
+				outsideBits |= 1 << lane;
+			}
+		}
+
+		GetStatusFromLaneBits(insideBits, outsideBits, isBlocking, out);
+	}
+
+	// Nearly parallel blades have no single closest pair of points, any will do
+	static const float parallelEpsilon = 1e-6f;
+
+	static inline float Clamp01(float x)
+	{
+		return std::min(std::max(x, 0.f), 1.f);
+	}
+
+	CrossGuardMetrics GetCrossGuardMetrics(const Config &config, const HandSample &main, const HandSample &off)
+	{
+		const Transform &hmd = main.hmd;
+		float length = config.crossGuard.bladeLength;
+
+		Vector3 mainForward = ForwardVector(main.hand.rot);
+		Vector3 offForward = ForwardVector(off.hand.rot);
+		Vector3 mainStart = (main.hand.pos - hmd.pos) * config.havokWorldScale; // meters from the hmd
+		Vector3 offStart = (off.hand.pos - hmd.pos) * config.havokWorldScale;
+		Vector3 mainBlade = mainForward * length;
+		Vector3 offBlade = offForward * length;
+
+		// Closest points mainStart + s * mainBlade and offStart + t * offBlade with s and t in [0, 1], as in Ericson's
+		// Real-Time Collision Detection 5.1.9. Instead of branching on where t lands, t is clamped and s worked out again
+		// from it, which gives the same points.
+		Vector3 r = mainStart - offStart;
+		float a = DotProduct(mainBlade, mainBlade);
+		float e = DotProduct(offBlade, offBlade);
+		float b = DotProduct(mainBlade, offBlade);
+		float c = DotProduct(mainBlade, r);
+		float f = DotProduct(offBlade, r);
+		float denominator = a * e - b * b;
+		float s = denominator > parallelEpsilon * a * e ? Clamp01((b * f - c * e) / denominator) : 0.f;
+		float t = Clamp01((b * s + f) / e);
+		s = Clamp01((b * t - c) / a);
+
+		Vector3 mainPoint = mainStart + mainBlade * s;
+		Vector3 offPoint = offStart + offBlade * t;
+		Vector3 between = mainPoint - offPoint;
+		Vector3 crossing = (mainPoint + offPoint) * 0.5f;
+
+		CrossGuardMetrics metrics;
+		metrics.bladeDistanceSquared = DotProduct(between, between);
+		metrics.bladeDot = DotProduct(mainForward, offForward);
+		metrics.crossingForward = DotProduct(ForwardVector(hmd.rot), crossing);
+		metrics.crossingUp = DotProduct(UpVector(hmd.rot), crossing);
+		return metrics;
+	}
+
+	CrossGuardTest TestCrossGuard(const Config &config, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices])
+	{
+		const CrossGuardThresholds &t = config.crossGuard;
+		CrossGuardMetrics enter = GetCrossGuardMetrics(config, predicted[kHandIndex_Main], predicted[kHandIndex_Off]);
+		CrossGuardMetrics exit = GetCrossGuardMetrics(config, current[kHandIndex_Main], current[kHandIndex_Off]);
+
+		CrossGuardTest test;
+		test.isInside = predicted[kHandIndex_Main].speed <= t.maxSpeedEnter && predicted[kHandIndex_Off].speed <= t.maxSpeedEnter &&
+			enter.bladeDistanceSquared <= t.maxBladeDistanceEnter * t.maxBladeDistanceEnter &&
+			std::abs(enter.bladeDot) <= t.bladeDotEnter &&
+			enter.crossingForward >= t.minForwardDistanceEnter &&
+			std::abs(enter.crossingUp) <= t.maxVerticalDistanceEnter;
+		test.isOutside = current[kHandIndex_Main].speed > t.maxSpeedExit || current[kHandIndex_Off].speed > t.maxSpeedExit ||
+			exit.bladeDistanceSquared > t.maxBladeDistanceExit * t.maxBladeDistanceExit ||
+			std::abs(exit.bladeDot) > t.bladeDotExit ||
+			exit.crossingForward < t.minForwardDistanceExit ||
+			std::abs(exit.crossingUp) > t.maxVerticalDistanceExit;
+		return test;
+	}
+
+#ifdef DUAL_HAND_CLASSIFIER_SSE
+	// Projections of the hand forward vector and the hmd to hand vector onto the hmd's right / forward / up axes, one
+	// axis per component. Built a row of the rotation at a time, so the sums happen in the same order as DotProduct.
+	struct LaneProjections
+	{
+		__m128 handForward;
+		__m128 hmdToHand;
+	};
+
+	static inline LaneProjections Project(const HandSample &sample, const __m128 (&hmdRows)[3], __m128 scaleAndZero)
+	{
+		const Matrix33 &hand = sample.hand.rot;
+		// x, y, z, scale of each position. The scale cancels in the subtraction and is multiplied by 0.
+		__m128 hmdToHand = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&sample.hand.pos.x), _mm_loadu_ps(&sample.hmd.pos.x)), scaleAndZero);
+
+		LaneProjections p;
+		p.handForward = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(hand.data[0][1]), hmdRows[0]),
+			_mm_mul_ps(_mm_set1_ps(hand.data[1][1]), hmdRows[1])),
+			_mm_mul_ps(_mm_set1_ps(hand.data[2][1]), hmdRows[2]));
+		p.hmdToHand = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_shuffle_ps(hmdToHand, hmdToHand, _MM_SHUFFLE(0, 0, 0, 0)), hmdRows[0]),
+			_mm_mul_ps(_mm_shuffle_ps(hmdToHand, hmdToHand, _MM_SHUFFLE(1, 1, 1, 1)), hmdRows[1])),
+			_mm_mul_ps(_mm_shuffle_ps(hmdToHand, hmdToHand, _MM_SHUFFLE(2, 2, 2, 2)), hmdRows[2]));
+		return p;
+	}
+
+	static inline void LoadRows(const Matrix33 &rot, __m128 (&rows)[3])
+	{
+		// Each row load reads one float past the row, which is the next row or the position, still inside the Transform
+		rows[0] = _mm_loadu_ps(rot.data[0]);
+		rows[1] = _mm_loadu_ps(rot.data[1]);
+		rows[2] = _mm_loadu_ps(rot.data[2]);
+	}
+
+	void GetDualHandBlockingStatus(const Config &config, const WeaponThresholds &weapon, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices],
+		bool isBlocking, bool isUnarmed, bool isMainLeft, HandStatus (&out)[kNumHandIndices])
+	{
+		LaneThresholds enter, exit;
+		GetLaneThresholds(config, weapon, isUnarmed, enter, exit);
+
+		const __m128 scaleAndZero = _mm_setr_ps(config.havokWorldScale, config.havokWorldScale, config.havokWorldScale, 0);
+
+		// Without prediction the enter lanes look at the same poses as the exit lanes, and the work is shared
+		__m128 hmdRows[3];
+		LoadRows(current[0].hmd.rot, hmdRows);
+		LaneProjections lanes[numLanes];
+		lanes[0] = Project(current[0], hmdRows, scaleAndZero);
+		lanes[1] = &current[1].hmd == &current[0].hmd ? Project(current[1], hmdRows, scaleAndZero) : (LoadRows(current[1].hmd.rot, hmdRows), Project(current[1], hmdRows, scaleAndZero));
+		bool isSamePose = &predicted[0].hmd == &current[0].hmd && &predicted[0].hand == &current[0].hand &&
+			&predicted[1].hmd == &current[1].hmd && &predicted[1].hand == &current[1].hand;
+		if (isSamePose) {
+			lanes[2] = lanes[0];
+			lanes[3] = lanes[1];
+		}
+		else {
+			LoadRows(predicted[0].hmd.rot, hmdRows);
+			lanes[2] = Project(predicted[0], hmdRows, scaleAndZero);
+			if (&predicted[1].hmd != &predicted[0].hmd) LoadRows(predicted[1].hmd.rot, hmdRows);
+			lanes[3] = Project(predicted[1], hmdRows, scaleAndZero);
+		}
+
+		// Transpose to one register per axis, lanes across
+		__m128 forwardOnRight = lanes[0].handForward, forwardOnForward = lanes[1].handForward, forwardOnUp = lanes[2].handForward, unused0 = lanes[3].handForward;
+		_MM_TRANSPOSE4_PS(forwardOnRight, forwardOnForward, forwardOnUp, unused0);
+		__m128 toHandOnRight = lanes[0].hmdToHand, toHandOnForward = lanes[1].hmdToHand, toHandOnUp = lanes[2].hmdToHand, unused1 = lanes[3].hmdToHand;
+		_MM_TRANSPOSE4_PS(toHandOnRight, toHandOnForward, toHandOnUp, unused1);
+
+		const __m128 signMask = _mm_set1_ps(-0.f);
+
+		// Negating a dot product is exact, so dot(a, -up) == -dot(a, up) bit for bit
+		__m128 a, b, c;
+		if (isUnarmed) {
+			// Outwards is right for the right hand and left for the left hand
+			float mainSign = isMainLeft ? -1.f : 1.f;
+			a = _mm_mul_ps(forwardOnRight, _mm_setr_ps(mainSign, -mainSign, mainSign, -mainSign));
+			b = _mm_setzero_ps();
+			c = toHandOnUp;
+		}
+		else {
+			a = _mm_xor_ps(forwardOnUp, signMask);
+			b = forwardOnForward;
+			c = _mm_xor_ps(toHandOnUp, signMask);
+		}
+
+		__m128 speed = _mm_setr_ps(current[0].speed, current[1].speed, predicted[0].speed, predicted[1].speed);
+
+		__m128 absB = _mm_andnot_ps(signMask, b);
+		__m128 absC = _mm_andnot_ps(signMask, c);
+
+		__m128 maxSpeed = _mm_setr_ps(exit.maxSpeed, exit.maxSpeed, enter.maxSpeed, enter.maxSpeed);
+		__m128 minA = _mm_setr_ps(exit.minA, exit.minA, enter.minA, enter.minA);
+		__m128 maxAbsB = _mm_setr_ps(exit.maxAbsB, exit.maxAbsB, enter.maxAbsB, enter.maxAbsB);
+		__m128 maxAbsC = _mm_setr_ps(exit.maxAbsC, exit.maxAbsC, enter.maxAbsC, enter.maxAbsC);
+
+		// Inside and outside are not complements of each other when something is NaN, so both are computed like the scalar tests
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(speed, maxSpeed), _mm_cmpge_ps(a, minA)),
+			_mm_and_ps(_mm_cmple_ps(absB, maxAbsB), _mm_cmple_ps(absC, maxAbsC)));
+		__m128 outside = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(speed, maxSpeed), _mm_cmplt_ps(a, minA)),
+			_mm_or_ps(_mm_cmpgt_ps(absB, maxAbsB), _mm_cmpgt_ps(absC, maxAbsC)));
+
+		GetStatusFromLaneBits(_mm_movemask_ps(inside), _mm_movemask_ps(outside), isBlocking, out);
+	}
+
+	bool IsDualHandClassifierVectorized() { return true; }
+#else
+	void GetDualHandBlockingStatus(const Config &config, const WeaponThresholds &weapon, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices],
+		bool isBlocking, bool isUnarmed, bool isMainLeft, HandStatus (&out)[kNumHandIndices])
+	{
+		GetDualHandBlockingStatusScalar(config, weapon, current, predicted, isBlocking, isUnarmed, isMainLeft, out);
+	}
+
+	bool IsDualHandClassifierVectorized() { return false; }
+#endif
+}
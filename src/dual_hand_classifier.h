@@ -0,0 +1,62 @@
+#pragma once
+
+#include "blocking.h"
+
+
+// Both hands' block tests in one pass. Four lanes are evaluated together: the main and off hand current samples, which
+// the exit tests look at, and the main and off hand predicted samples, which the enter tests look at. The weapon and
+// unarmed tests are the same shape (speed and three pose metrics against thresholds), so one kernel does both.
+//
+// Gives exactly the same result as calling GetHandBlockingStatus / GetHandBlockingStatusUnarmed for each hand:
+// the metrics are computed with the same operations in the same order, and the comparisons are the same comparisons.
+namespace BlockCore
+{
+	enum HandIndex
+	{
+		kHandIndex_Main = 0,
+		kHandIndex_Off = 1,
+		kNumHandIndices
+	};
+
+	// weapon is the armed thresholds to use, config.dualWield or a profile from config.weaponProfiles.
+	// isMainLeft only matters unarmed, where it mirrors the outwards test for the left hand
+	void GetDualHandBlockingStatus(const Config &config, const WeaponThresholds &weapon, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices],
+		bool isBlocking, bool isUnarmed, bool isMainLeft, HandStatus (&out)[kNumHandIndices]);
+
+	// The same thing a lane at a time, for platforms without SSE and to check the vector version against
+	void GetDualHandBlockingStatusScalar(const Config &config, const WeaponThresholds &weapon, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices],
+		bool isBlocking, bool isUnarmed, bool isMainLeft, HandStatus (&out)[kNumHandIndices]);
+
+	// True if GetDualHandBlockingStatus uses SSE in this build
+	bool IsDualHandClassifierVectorized();
+
+	// The cross guard: both weapons crossed in an X in front of the face. Neither blade points the way the hand tests
+	// want, so they miss it. The two blades are segments (config.crossGuard.bladeLength from each hand along its forward
+	// vector), and the test looks at how close they come, the angle between them, and where they cross relative to the hmd.
+	struct CrossGuardMetrics
+	{
+		float bladeDistanceSquared; // closest approach of the two blades, in meters squared
+		float bladeDot; // main blade direction . off blade direction, the cosine of the angle between them
+		float crossingForward; // halfway between the closest points, from the hmd along its forward axis, in meters
+		float crossingUp; // the same along the hmd's up axis
+	};
+
+	// Both samples must have the same hmd
+	CrossGuardMetrics GetCrossGuardMetrics(const Config &config, const HandSample &main, const HandSample &off);
+
+	struct CrossGuardTest
+	{
+		bool isInside; // the predicted samples pass the enter thresholds
+		bool isOutside; // the current samples fail the exit thresholds
+	};
+
+	// GetCrossGuardMetrics of the predicted pair against the enter thresholds and of the current pair against the exit ones
+	CrossGuardTest TestCrossGuard(const Config &config, const HandSample (&current)[kNumHandIndices], const HandSample (&predicted)[kNumHandIndices]);
+
+	// The same status a hand test would give
+	inline HandStatus GetCrossGuardStatus(CrossGuardTest test, bool isBlocking)
+	{
+		if (test.isInside) return isBlocking ? kHandStatus_None : kHandStatus_Start;
+		return test.isOutside && isBlocking ? kHandStatus_Stop : kHandStatus_None;
+	}
+}
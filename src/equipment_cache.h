@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+#include "blocking.h"
+
+
+// Per hand equipment classification, keyed on the equipped form pointers.
+// Equipment changes a few times a minute, so the per frame work is comparing two pointers against the last ones seen.
+// Invalidate() forces a reclassification on the next lookup, for equip events that leave the pointers the same.
+struct EquipmentCache
+{
+	const void *mainForm = nullptr;
+	const void *offForm = nullptr;
+	BlockCore::HandEquip mainHand = BlockCore::HandEquip::Unarmed;
+	BlockCore::HandEquip offHand = BlockCore::HandEquip::Unarmed;
+	BlockCore::WeaponType mainWeapon = BlockCore::WeaponType::Unarmed;
+	BlockCore::WeaponType offWeapon = BlockCore::WeaponType::Unarmed;
+	bool isDualWielding = false;
+	bool isShieldEnabled = false;
+	bool isValid = false;
+	std::atomic<bool> isDirty = false; // set from event sinks
+
+	uint32_t numMisses = 0;
+
+	void Invalidate() { isDirty.store(true, std::memory_order_relaxed); }
+
+	// classify(form, weaponType) returns the HandEquip for a form, nullptr being unarmed, and sets its WeaponType. Returns true if the cached result was used.
+	template <typename Form, typename Classify>
+	bool Lookup(const BlockCore::Config &config, Form *main, Form *off, Classify &&classify)
+	{
+		if (isValid && main == mainForm && off == offForm && config.isShieldEnabled == isShieldEnabled &&
+			!isDirty.load(std::memory_order_relaxed)) {
+			return true;
+		}
+
+		isDirty.store(false, std::memory_order_relaxed);
+		mainForm = main;
+		offForm = off;
+		mainHand = classify(main, mainWeapon);
+		offHand = classify(off, offWeapon);
+		isShieldEnabled = config.isShieldEnabled;
+		isDualWielding = BlockCore::IsDualWielding(config, mainHand, offHand);
+		isValid = true;
+		numMisses++;
+		return false;
+	}
+};
@@ -0,0 +1,16 @@
+#include "game_addresses.h"
+
+
+namespace GameAddresses
+{
+	using namespace SignatureScanner;
+
+	const Target targets[kNumAddresses] = {
+		// movss xmm0, [rip + scale] and the vector it scales, x y and z
+		{ "HavokWorldScale", kTarget_Code, "F3 0F 10 05 ?? ?? ?? ?? F3 0F 59 C8 F3 0F 59 D0 F3 0F 59 D8", 4, 8, 0, 0x15B78F4 },
+		{ "fMeleeLinearVelocityThreshold_Blocking", kTarget_GameSetting, "fMeleeLinearVelocityThreshold_Blocking", -1, 0, 0, 0x1EAE518 },
+		// The Papyrus native's start: the UI singleton, then its count of menus that pause the game
+		{ "IsInMenuMode", kTarget_Code, "40 53 48 83 EC 20 48 8B 05 ?? ?? ?? ?? 32 DB 8B 88 ?? ?? ?? ?? 85 C9", -1, 0, 0, 0x9F32A0 },
+		{ "PlayerCharacter_UpdateRefLight_vtbl", kTarget_VtableSlot, ".?AVPlayerCharacter@@", -1, 0, 0x55 * 8, 0x16E24D8 } // vtable 0x16E2230
+	};
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "signature_scanner.h"
+
+
+// The game addresses the plugin uses: where they are in 1.4.15, and how to find them in an executable where they moved
+namespace GameAddresses
+{
+	enum Address
+	{
+		kAddress_HavokWorldScale = 0,
+		kAddress_MeleeLinearVelocityThresholdBlocking,
+		kAddress_IsInMenuMode,
+		kAddress_PlayerCharacterUpdateRefLightSlot,
+		kNumAddresses
+	};
+
+	extern const SignatureScanner::Target targets[kNumAddresses];
+}
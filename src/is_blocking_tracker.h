@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+// Decides when the IsBlocking animation variable actually has to be read, instead of reading it every frame.
+// It only changes when the animation graph does something, so graph events mark it dirty. For a while after we send
+// blockStart / blockStop it is read every frame, since that is when the block logic is waiting on it, and otherwise it
+// is polled every pollIntervalMs in case it changed without an event.
+// After an event or a change it is also read every frame until it has held still for the debounce window and the poll
+// interval, so a short dip (a blocked hit) is seen frame by frame like without the tracker, even if it ends without an
+// event. replay --is-blocking-check compares the two.
+struct IsBlockingTracker
+{
+	float pollIntervalMs = 100;
+	float settleMs = 250; // how long after notifying the graph to keep reading every frame
+	float debounceMs = 55; // Config::isBlockingDebounceMs
+
+	bool value = false;
+	bool isValid = false;
+	uint64_t lastPollNs = 0;
+	uint64_t lastNotifyNs = 0; // 0 if never
+	uint64_t lastUnsettledNs = 0; // the last read after an event or that saw a change, 0 if never
+	std::atomic<bool> isDirty = false; // set by the graph event sink, which may run on another thread
+
+	uint32_t numFrames = 0;
+	uint32_t numPolls = 0;
+
+	void OnGraphEvent() { isDirty.store(true, std::memory_order_relaxed); }
+	void OnNotify(uint64_t nowNs) { lastNotifyNs = nowNs; }
+	void Invalidate() { isValid = false; } // the value was not being tracked, e.g. while not dual wielding
+
+	// poll() reads the variable from the graph
+	template <typename Poll>
+	bool Get(uint64_t nowNs, Poll &&poll)
+	{
+		numFrames++;
+
+		// Clear the flag before reading, so an event that lands during the read is not lost
+		bool isEventPending = isDirty.exchange(false, std::memory_order_relaxed);
+		const uint64_t pollIntervalNs = (uint64_t)((double)pollIntervalMs * 1e6);
+		const uint64_t holdNs = (uint64_t)((double)debounceMs * 1e6) > pollIntervalNs ? (uint64_t)((double)debounceMs * 1e6) : pollIntervalNs;
+		bool isSettling = (lastNotifyNs && nowNs - lastNotifyNs < (uint64_t)((double)settleMs * 1e6)) ||
+			(lastUnsettledNs && nowNs - lastUnsettledNs < holdNs);
+		bool isPollDue = nowNs - lastPollNs >= pollIntervalNs;
+
+		if (isEventPending || isSettling || isPollDue || !isValid) {
+			bool newValue = poll();
+			if (isEventPending || (isValid && newValue != value)) lastUnsettledNs = nowNs;
+			value = newValue;
+			isValid = true;
+			lastPollNs = nowNs;
+			numPolls++;
+		}
+		return value;
+	}
+};
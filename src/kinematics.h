@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "blocking.h"
+
+
+// Wait-free single producer / single consumer channel for the latest value of T (a triple buffer).
+// The producer always has a slot of its own to fill, the consumer always has a slot of its own to read,
+// and the third slot is swapped between them with a single atomic exchange. Neither side ever waits or retries.
+template <typename T>
+class SnapshotChannel
+{
+public:
+	SnapshotChannel() : slots(), middle(1), back(0), front(2) {}
+
+	// Producer only. Fill in the returned slot, then Publish().
+	T & BeginWrite() { return slots[back]; }
+
+	void Publish()
+	{
+		back = middle.exchange(back | dirtyBit, std::memory_order_acq_rel) & indexMask;
+	}
+
+	void Publish(const T &value)
+	{
+		BeginWrite() = value;
+		Publish();
+	}
+
+	// Consumer only. Returns the newest published value. It stays valid and unchanged until the next Read().
+	const T & Read()
+	{
+		if (middle.load(std::memory_order_relaxed) & dirtyBit) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		}
+		return slots[front];
+	}
+
+private:
+	static const uint32_t dirtyBit = 4;
+	static const uint32_t indexMask = 3;
+
+	T slots[3];
+	alignas(64) std::atomic<uint32_t> middle; // index of the shared slot, plus dirtyBit if it holds an unread value
+	alignas(64) uint32_t back; // producer's slot
+	alignas(64) uint32_t front; // consumer's slot
+};
+
+enum Hand
+{
+	kHand_Right = 0,
+	kHand_Left,
+	kNumHands
+};
+
+// Tracking space, but already converted to game axes
+struct DeviceKinematics
+{
+	BlockCore::Transform pose; // meters
+	BlockCore::Vector3 velocity; // m/s
+	BlockCore::Vector3 angularVelocity; // rad/s
+	uint64_t timestampNs; // when this device last had a valid pose, 0 if never
+};
+
+// Everything the pose thread knows about the hmd and hands at one instant. All of it comes from the same pose callback.
+struct KinematicsSnapshot
+{
+	uint64_t timestampNs; // when the snapshot was published, 0 if nothing has been published yet
+	DeviceKinematics hmd; // the hmd pose is what relates the tracking space to the game world
+	DeviceKinematics hands[kNumHands];
+
+	float SpeedSquared(Hand hand) const
+	{
+		const BlockCore::Vector3 &v = hands[hand].velocity;
+		return BlockCore::DotProduct(v, v);
+	}
+
+	// Age in ns of the given hand's data relative to now, or UINT64_MAX if that hand has never been tracked
+	uint64_t HandAgeNs(Hand hand, uint64_t nowNs) const
+	{
+		uint64_t t = hands[hand].timestampNs;
+		return t ? (nowNs > t ? nowNs - t : 0) : UINT64_MAX;
+	}
+
+	// False if either hand was last tracked more than maxAgeNs ago, or never
+	bool AreHandsFresh(uint64_t nowNs, uint64_t maxAgeNs) const
+	{
+		return HandAgeNs(kHand_Right, nowNs) <= maxAgeNs && HandAgeNs(kHand_Left, nowNs) <= maxAgeNs;
+	}
+};
@@ -0,0 +1,150 @@
+#include <cstdio>
+
+#include "latency_tracer.h"
+
+
+static inline uint64_t NsBetween(uint64_t fromNs, uint64_t toNs)
+{
+	return toNs > fromNs ? toNs - fromNs : 0;
+}
+
+LatencyTracer::Sample LatencyTracer::MakeSample(const BlockCore::FrameInput &input, const BlockCore::State &state, BlockCore::Decision decision)
+{
+	Sample sample;
+	sample.timestampNs = input.timestampNs;
+	sample.poseTimestampNs = input.poseTimestampNs;
+	sample.request = state.isLastUpdateValid ? state.lastRequest : BlockCore::kDecision_None;
+	sample.decision = decision;
+	sample.isBlockingGraph = input.isBlockingGraph;
+	sample.isBlockingDebounced = state.isBlocking;
+	sample.isBlockingInternal = input.isBlockingInternal;
+	sample.hasTestState = true;
+	return sample;
+}
+
+void LatencyTracer::Finish(Direction direction)
+{
+	Pending &p = pending[direction];
+	if (!p.graphNs) numNeverShown[direction]++;
+	p.decisionNs = 0;
+	p.graphNs = 0;
+	p.isDebounceShown = false;
+	p.isActorStateShown = false;
+}
+
+void LatencyTracer::Record(const Sample &sample)
+{
+	uint64_t now = sample.timestampNs;
+
+	for (int d = 0; d < kNumDirections; d++) {
+		Direction direction = (Direction)d;
+		Pending &p = pending[d];
+		bool isShown = direction == kDirection_Start; // the value IsBlocking and friends change to
+		BlockCore::Decision decision = direction == kDirection_Start ? BlockCore::kDecision_StartBlocking : BlockCore::kDecision_StopBlocking;
+
+		// Waiting on the game to show an earlier decision. The frame the decision was made on was read before it was sent.
+		if (p.decisionNs && now > p.decisionNs) {
+			if (!p.graphNs && sample.isBlockingGraph == isShown) {
+				p.graphNs = now;
+				stages[d][kStage_DecisionToGraph].Record(now - p.decisionNs);
+			}
+			if (sample.hasTestState && p.graphNs && !p.isDebounceShown && sample.isBlockingDebounced == isShown) {
+				p.isDebounceShown = true;
+				stages[d][kStage_Debounce].Record(now - p.graphNs);
+			}
+			if (!p.isActorStateShown && sample.isBlockingInternal == isShown) {
+				p.isActorStateShown = true;
+				stages[d][kStage_DecisionToActorState].Record(now - p.decisionNs);
+			}
+
+			bool isDone = p.graphNs && (p.isDebounceShown || !sample.hasTestState) && p.isActorStateShown;
+			bool isTimedOut = now - p.decisionNs >= MsToNs(timeoutMs);
+			if (isDone || isTimedOut) Finish(direction);
+		}
+
+		// The first update of a run that asks for this change is where the motion was recognised
+		if (sample.hasTestState && sample.request == decision) {
+			if (!p.requestNs) {
+				p.requestNs = now;
+				p.poseNs = sample.poseTimestampNs ? sample.poseTimestampNs : now;
+			}
+		}
+		else {
+			p.requestNs = 0;
+		}
+
+		if (sample.decision != decision) continue;
+
+		numDecisions[d]++;
+
+		// A newer decision either way ends whatever was still being waited on
+		for (int other = 0; other < kNumDirections; other++) {
+			if (pending[other].decisionNs) Finish((Direction)other);
+		}
+
+		uint64_t poseNs = sample.poseTimestampNs ? sample.poseTimestampNs : now;
+		if (sample.hasTestState && p.requestNs) {
+			poseNs = p.poseNs;
+			stages[d][kStage_PoseAge].Record(NsBetween(poseNs, p.requestNs));
+			stages[d][kStage_Cooldown].Record(now - p.requestNs);
+		}
+		stages[d][kStage_MotionToDecision].Record(NsBetween(poseNs, now));
+
+		p.requestNs = 0;
+		p.decisionNs = now;
+		// Whatever already showed the new value before the decision has nothing to show
+		p.graphNs = sample.isBlockingGraph == isShown ? now : 0;
+		p.isDebounceShown = sample.hasTestState && p.graphNs && sample.isBlockingDebounced == isShown;
+		p.isActorStateShown = sample.isBlockingInternal == isShown;
+	}
+}
+
+const char * LatencyTracer::StageName(Stage stage)
+{
+	switch (stage) {
+	case kStage_PoseAge: return "pose age";
+	case kStage_Cooldown: return "cooldown";
+	case kStage_MotionToDecision: return "decision";
+	case kStage_DecisionToGraph: return "graph";
+	case kStage_Debounce: return "debounce";
+	case kStage_DecisionToActorState: return "actor state";
+	default: return "?";
+	}
+}
+
+void LatencyTracer::Report(std::vector<std::string> &lines) const
+{
+	static const char *directionNames[kNumDirections] = { "start", "stop" };
+
+	char line[160];
+	snprintf(line, sizeof(line), "%-18s %10s %10s %10s %10s", "stage", "count", "p50 ms", "p99 ms", "max ms");
+	lines.push_back(line);
+
+	for (int d = 0; d < kNumDirections; d++) {
+		for (int i = 0; i < kNumStages; i++) {
+			const LatencyHistogram &histogram = stages[d][i];
+			char name[32];
+			snprintf(name, sizeof(name), "%s %s", directionNames[d], StageName((Stage)i));
+			snprintf(line, sizeof(line), "%-18s %10llu %10.2f %10.2f %10.2f", name, (unsigned long long)histogram.Count(),
+				NsToMs(histogram.Percentile(0.5)), NsToMs(histogram.Percentile(0.99)), NsToMs(histogram.Max()));
+			lines.push_back(line);
+		}
+	}
+
+	snprintf(line, sizeof(line), "decisions: %llu start (%llu never shown by IsBlocking), %llu stop (%llu never shown)",
+		(unsigned long long)numDecisions[kDirection_Start], (unsigned long long)numNeverShown[kDirection_Start],
+		(unsigned long long)numDecisions[kDirection_Stop], (unsigned long long)numNeverShown[kDirection_Stop]);
+	lines.push_back(line);
+}
+
+void LatencyTracer::Reset()
+{
+	for (auto &direction : stages) {
+		for (LatencyHistogram &histogram : direction) histogram.Reset();
+	}
+	// Changes still in flight carry over into the next report
+	for (int d = 0; d < kNumDirections; d++) {
+		numDecisions[d] = 0;
+		numNeverShown[d] = 0;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+#include "profiler.h"
+
+
+// Follows each block start / stop from the poses it was decided on to the game showing the block, and splits the
+// time into stages so it is clear where a slow block comes from:
+//
+//   pose age     pose sample -> first update whose tests ask for the change
+//   cooldown     tests ask for it -> decision (blockCooldownMs, or an earlier notification still waiting on the graph)
+//   decision     pose sample -> decision, the two above together
+//   graph        decision -> the IsBlocking graph variable shows it
+//   debounce     IsBlocking shows it -> the debounced IsBlocking the tests use shows it (isBlockingDebounceMs)
+//   actor state  decision -> IsBlockingInternal shows it
+//
+// Fed once per evaluated frame, after the decision was sent to the graph. Fixed size, never allocates while tracing.
+class LatencyTracer
+{
+public:
+	enum Stage
+	{
+		kStage_PoseAge = 0,
+		kStage_Cooldown,
+		kStage_MotionToDecision,
+		kStage_DecisionToGraph,
+		kStage_Debounce,
+		kStage_DecisionToActorState,
+		kNumStages
+	};
+
+	enum Direction
+	{
+		kDirection_Start = 0,
+		kDirection_Stop,
+		kNumDirections
+	};
+
+	// What the game showed on one frame, and what was decided on it
+	struct Sample
+	{
+		uint64_t timestampNs; // game thread
+		uint64_t poseTimestampNs; // the poses the decision was made from, 0 if unknown
+		BlockCore::Decision request; // what the tests asked for before the cooldowns
+		BlockCore::Decision decision; // what was sent to the graph this frame
+		bool isBlockingGraph;
+		bool isBlockingDebounced;
+		bool isBlockingInternal;
+		bool hasTestState; // request and isBlockingDebounced are known. Not when the tests run on the pose thread.
+	};
+
+	// After BlockCore::Update(state, config, input) on the same thread
+	static Sample MakeSample(const BlockCore::FrameInput &input, const BlockCore::State &state, BlockCore::Decision decision);
+
+	bool isEnabled = false;
+	float timeoutMs = 1000; // a change the game has not shown by then is counted as never shown
+
+	void Record(const Sample &sample);
+
+	const LatencyHistogram & GetStage(Direction direction, Stage stage) const { return stages[direction][stage]; }
+
+	// One line per direction and stage with count, p50, p99 and max in ms, then the changes the game never showed
+	void Report(std::vector<std::string> &lines) const;
+
+	void Reset();
+
+	static const char * StageName(Stage stage);
+
+private:
+	struct Pending
+	{
+		uint64_t requestNs = 0; // 0 while the tests are not asking for this direction
+		uint64_t poseNs = 0;
+		uint64_t decisionNs = 0; // 0 while not waiting on the game
+		uint64_t graphNs = 0; // when IsBlocking showed the change, 0 if not yet
+		bool isDebounceShown = false;
+		bool isActorStateShown = false;
+	};
+
+	void Finish(Direction direction);
+
+	Pending pending[kNumDirections];
+	LatencyHistogram stages[kNumDirections][kNumStages];
+	uint64_t numDecisions[kNumDirections] = {};
+	uint64_t numNeverShown[kNumDirections] = {}; // IsBlocking did not show the change within timeoutMs
+};
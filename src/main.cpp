@@ -5,51 +5,56 @@
 #include "skse64/GameSettings.h"
 #include "skse64/GameInput.h"
 #include "skse64/GameVR.h"
+#include "skse64/GameEvents.h"
+#include "skse64/PapyrusEvents.h"
 #include "skse64_common/SafeWrite.h"
 
 #include <ShlObj.h>  // CSIDL_MYDOCUMENTS
+#include <vector>
 
 #include "main.h"
 #include "version.h"  // VERSION_VERSTRING, VERSION_MAJOR
 #include "config.h"
 #include "math_utils.h"
-
-
-RelocPtr<float> g_havokWorldScale(0x15B78F4);
-RelocPtr<float> g_fMeleeLinearVelocityThreshold_Blocking(0x1EAE518);
+#include "blocking.h"
+#include "player_context.h"
+#include "pose_recorder.h"
+#include "kinematics.h"
+#include "pose_classifier.h"
+#include "profiler.h"
+#include "equipment_cache.h"
+#include "is_blocking_tracker.h"
+#include "latency_tracer.h"
+#include "telemetry.h"
+#include "async_log.h"
+#include "clock.h"
+#include "settings.h"
+#include "settings_watcher.h"
+#include "game_addresses.h"
+#include "parry.h"
+
+
+// Set by ResolveGameAddresses
+float *g_havokWorldScale = nullptr;
+float *g_fMeleeLinearVelocityThreshold_Blocking = nullptr;
+_IsInMenuMode IsInMenuMode = nullptr;
 float g_vanillaBlockingVelocityOverride = 0.4f; // 0.4f is the game's default
 
+AsyncLog g_asyncLog;
+
 PluginHandle g_pluginHandle = kPluginHandle_Invalid;
 SKSEMessagingInterface *g_messaging = nullptr;
 SKSEVRInterface *g_vrInterface = nullptr;
 
-// Config parameters for blocking conditions
-float maxSpeedEnter = 2;
-float maxSpeedExit = 3;
-float handForwardHmdDownEnter = -0.6;
-float handForwardHmdDownExit = -0.6;
-float handForwardHmdForwardEnter = 0.4;
-float handForwardHmdForwardExit = 0.6;
-float hmdToHandDistanceUpEnter = 0.35;
-float hmdToHandDistanceUpExit = 0.35;
-bool isShieldEnabled = false;
-
-// Config parameters for unarmed blocking
-float maxSpeedUnarmedEnter = 1;
-float maxSpeedUnarmedExit = 1.5;
-float handForwardHmdRightUnarmedEnter = 0.5;
-float handForwardHmdRightUnarmedExit = 0.4;
-float hmdToHandDistanceUpUnarmedEnter = 0.35;
-float hmdToHandDistanceUpUnarmedExit = 0.35;
+BlockCore::Config g_config;
+BlockCore::State g_blockState;
 
-bool isLastUpdateValid = false;
+Profiler g_profiler;
+float g_profilerDumpIntervalSeconds = 0; // 0 disables the profiler
 
-const int numPrevIsBlocking = 5; // Should be an odd number
-bool prevIsBlockings[numPrevIsBlocking];  // previous n IsBlocking animation values
-
-const int blockCooldown = 30; // number of updates to ignore block start / stop
-int lastBlockStartFrameCount = 0; // number of updates we should still wait before attempting to start blocking
-int lastBlockStopFrameCount = 0; // number of updates we should still wait before attempting to stop blocking
+// Reloads the ini when it is saved, the game thread applies it between frames
+bool g_isReloadOnChangeEnabled = true;
+SettingsWatcher g_settingsWatcher;
 
 
 TESForm * GetMainHandObject(Actor *actor)
@@ -74,24 +79,56 @@ bool IsTwoHanded(const TESObjectWEAP *weap)
 	}
 }
 
-bool IsDualWielding(TESForm *mainHandItem, TESForm *offHandItem)
+BlockCore::HandEquip GetHandEquip(TESForm *item, BlockCore::WeaponType &weaponType)
 {
-	// Unarmed is okay
-	if (!mainHandItem && !offHandItem) return true;
+	if (!item) {
+		weaponType = BlockCore::WeaponType::Unarmed;
+		return BlockCore::HandEquip::Unarmed;
+	}
 
-	// If not unarmed, both hands need to have something
-	if (!mainHandItem || !offHandItem) return false;
+	TESObjectWEAP *weapon = DYNAMIC_CAST(item, TESForm, TESObjectWEAP);
+	if (weapon) {
+		// WeaponType starts with the game's weapon type codes
+		UInt8 type = weapon->gameData.type;
+		weaponType = type < (UInt8)BlockCore::WeaponType::Unarmed ? (BlockCore::WeaponType)type : BlockCore::WeaponType::Other;
+		return IsTwoHanded(weapon) ? BlockCore::HandEquip::TwoHanded : BlockCore::HandEquip::OneHanded;
+	}
 
-	// main hand has to be a weapon, and not two-handed
-	TESObjectWEAP *mainWeapon = DYNAMIC_CAST(mainHandItem, TESForm, TESObjectWEAP);
-	if (!mainWeapon || IsTwoHanded(mainWeapon)) return false;
+	BlockCore::HandEquip equip;
+
+	switch (item->formType) {
+	case kFormType_Spell:
+		equip = BlockCore::HandEquip::Spell;
+		break;
+	case kFormType_Light:
+		equip = BlockCore::HandEquip::Torch;
+		break;
+	case kFormType_Armor:
+		equip = BlockCore::HandEquip::Shield;
+		break;
+	default:
+		equip = BlockCore::HandEquip::Other;
+		break;
+	}
+	weaponType = BlockCore::WeaponTypeFromHandEquip(equip);
+	return equip;
+}
 
-	// offhand can be weapon or spell or torch, or shield if enabled
-	if (!(offHandItem->IsWeapon() || offHandItem->formType == kFormType_Spell || offHandItem->formType == kFormType_Light
-		|| (isShieldEnabled && offHandItem->formType == kFormType_Armor))) return false;
+EquipmentCache g_equipmentCache;
 
-	return true;
-}
+// The cache already notices new forms by pointer, this catches re-equips of the same form
+class EquipEventHandler : public BSTEventSink<TESEquipEvent>
+{
+public:
+	virtual EventResult ReceiveEvent(TESEquipEvent *evn, EventDispatcher<TESEquipEvent> *dispatcher) override
+	{
+		if (evn && evn->actor && evn->actor == *g_thePlayer) {
+			g_equipmentCache.Invalidate();
+		}
+		return kEvent_Continue;
+	}
+};
+EquipEventHandler g_equipEventHandler;
 
 // True if _the game_ decided to block, not us (i.e. 1 handed exclusive block, 2 handed block, or shield is blocking)
 bool IsBlockingInternal(Actor *actor)
@@ -99,109 +136,121 @@ bool IsBlockingInternal(Actor *actor)
 	return (actor->actorState.flags08 >> 8) & 1;
 }
 
-// Get the mode of the IsBlocking value over the last few frames. This is needed because when you block a hit, it goes to 0 for 1 frame, then back to 1.
-bool GetIsBlockingMode()
+bool GetIsBlockingGraphVariable(Actor *actor)
 {
-	PlayerCharacter *player = *g_thePlayer;
 	static BSFixedString s_IsBlocking("IsBlocking");
-	bool isBlocking; get_vfunc<_IAnimationGraphManagerHolder_GetAnimationVariableBool>(&player->animGraphHolder, 0x12)(&player->animGraphHolder, s_IsBlocking, isBlocking);
-
-	int numTrue = (int)isBlocking;
-	int numFalse = (int)(!isBlocking);
-	for (int i = numPrevIsBlocking - 1; i >= 1; i--) {
-		prevIsBlockings[i] = prevIsBlockings[i - 1];
-		if (prevIsBlockings[i]) numTrue++;
-		else numFalse++;
-	}
-	prevIsBlockings[0] = isBlocking;
-	return (numTrue >= numFalse);
+	bool isBlocking = false;
+	get_vfunc<_IAnimationGraphManagerHolder_GetAnimationVariableBool>(&actor->animGraphHolder, 0x12)(&actor->animGraphHolder, s_IsBlocking, isBlocking);
+	return isBlocking;
 }
 
-// Returns 2 if we should start blocking, 1 if we should stop blocking, 0 if no effect
-int GetHandBlockingStatus(NiTransform &hmdPose, NiTransform &handPose, float handSpeed, bool isBlocking)
-{
-	NiPoint3 hmdPosition = hmdPose.pos;
-	NiMatrix33 &hmdRot = hmdPose.rot;
+// Only read IsBlocking when the graph may have changed it
+bool g_isBlockingFromGraphEvents = false;
+IsBlockingTracker g_isBlockingTracker;
 
-	NiPoint3 handPosition = handPose.pos;
-	NiMatrix33 &handRot = handPose.rot;
+_AnimationGraphEventSink_ReceiveEvent g_original_PlayerCharacter_ReceiveAnimationGraphEvent = nullptr;
+EventResult PlayerCharacter_ReceiveAnimationGraphEvent_Hook(void *_this, AnimationGraphEvent *evn, void *dispatcher)
+{
+	// Tag names differ between behavior mods, so any event counts. They only come a few times a second.
+	g_isBlockingTracker.OnGraphEvent();
+	return g_original_PlayerCharacter_ReceiveAnimationGraphEvent(_this, evn, dispatcher);
+}
 
-	NiPoint3 handForward = ForwardVector(handRot);
-	NiPoint3 hmdForward = ForwardVector(hmdRot);
-	NiPoint3 hmdDown = -UpVector(hmdRot);
+// The sink vtable is per class, so this is hooked once for the player no matter how many times the game is loaded
+void HookPlayerAnimationGraphEvents(PlayerCharacter *player)
+{
+	if (g_original_PlayerCharacter_ReceiveAnimationGraphEvent) return;
 
-	float handForwardDotWithHmdDown = DotProduct(handForward, hmdDown); // > 0 means the sword is pointing down
-	float handForwardDotWithHmdForward = DotProduct(handForward, hmdForward); // close to 0 means the sword is not pointing towards or away from the hmd
+	UInt64 *vtbl = get_vtbl(&player->animGraphEventSink);
+	g_original_PlayerCharacter_ReceiveAnimationGraphEvent = (_AnimationGraphEventSink_ReceiveEvent)vtbl[1];
+	SafeWrite64(uintptr_t(&vtbl[1]), uintptr_t(PlayerCharacter_ReceiveAnimationGraphEvent_Hook));
+	g_asyncLog.Message("Hooked player animation graph events");
+}
 
-	NiPoint3 hmdToHand = (handPosition - hmdPosition) * *g_havokWorldScale; // Vector pointing from the hmd to the hand, in meters
-	float hmdToHandVerticalDistance = DotProduct(hmdDown, hmdToHand); // Distance of hand away from hmd along hmd up axis
+bool GetIsBlocking(Actor *actor, uint64_t now)
+{
+	if (!g_isBlockingFromGraphEvents) return GetIsBlockingGraphVariable(actor);
 
-	if (handSpeed <= maxSpeedEnter &&
-		handForwardDotWithHmdDown >= handForwardHmdDownEnter &&
-		abs(handForwardDotWithHmdForward) <= handForwardHmdForwardEnter &&
-		abs(hmdToHandVerticalDistance) <= hmdToHandDistanceUpEnter) {
+	return g_isBlockingTracker.Get(now, [actor]() { return GetIsBlockingGraphVariable(actor); });
+}
 
-		if (!isBlocking) {
-			// Start blocking
-			return 2;
-		}
+// Written by the pose thread, read by the game thread
+SnapshotChannel<KinematicsSnapshot> g_handKinematics;
+float g_maxHandSampleAgeMs = 100; // 0 disables the check
+
+bool g_recordPoses = false;
+PoseRecorder g_poseRecorder;
+
+// Pose thread classification. The context goes game thread -> pose thread, decisions come back through the mailbox.
+bool g_classifyOnPoseThread = false;
+SnapshotChannel<PoseClassifier::GameContext> g_poseClassifierContext;
+// The config the pose thread tests with. Published with the context when it changed: the settings, or the world scale.
+SnapshotChannel<BlockCore::Config> g_poseThreadConfig;
+bool g_isPoseThreadConfigStale = true;
+PoseClassifier::DecisionMailbox g_poseThreadDecisions;
+BlockCore::State g_poseThreadBlockState; // only touched by the pose thread
+std::atomic<uint64_t> g_lastPoseThreadClassificationNs = 0;
+
+// Timed parries, see parry.h. The pose thread records when each hand (main, off) went into its guard, hits are judged on the game thread.
+float g_parryWindowMs = 0; // 0 disables parries
+Parry::OnsetHistory g_guardOnsets[BlockCore::kNumHandIndices];
+Parry::GuardState g_poseThreadGuards; // only touched by the pose thread
+
+void FillDevicePose(PoseTrace::DevicePose &out, vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGamePoseArrayCount, vr_src::TrackedDeviceIndex_t index)
+{
+	if (index >= unGamePoseArrayCount) {
+		memset(&out, 0, sizeof(out));
+		return;
 	}
-	else if (handSpeed > maxSpeedExit ||
-		handForwardDotWithHmdDown < handForwardHmdDownExit ||
-		abs(handForwardDotWithHmdForward) > handForwardHmdForwardExit ||
-		abs(hmdToHandVerticalDistance) > hmdToHandDistanceUpExit) {
 
-		if (isBlocking) {
-			// Stop blocking
-			return 1;
-		}
-	}
-	return 0;
+	vr_src::TrackedDevicePose_t &pose = pGamePoseArray[index];
+	memcpy(out.matrix, pose.mDeviceToAbsoluteTracking.m, sizeof(out.matrix));
+	memcpy(out.velocity, pose.vVelocity.v, sizeof(out.velocity));
+	memcpy(out.angularVelocity, pose.vAngularVelocity.v, sizeof(out.angularVelocity));
+	out.trackingResult = pose.eTrackingResult;
+	out.flags = (pose.bDeviceIsConnected ? PoseTrace::kDeviceFlag_Connected : 0) | (pose.bPoseIsValid ? PoseTrace::kDeviceFlag_PoseValid : 0);
 }
 
-// Returns 2 if we should start blocking, 1 if we should stop blocking, 0 if no effect
-int GetHandBlockingStatusUnarmed(NiTransform &hmdPose, NiTransform &handPose, float handSpeed, bool isBlocking, bool isLeft)
+void RecordPoses(vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGamePoseArrayCount, vr_src::TrackedDeviceIndex_t rightIndex, vr_src::TrackedDeviceIndex_t leftIndex)
 {
-	NiPoint3 hmdPosition = hmdPose.pos;
-	NiMatrix33 &hmdRot = hmdPose.rot;
-
-	NiPoint3 handPosition = handPose.pos;
-	NiMatrix33 &handRot = handPose.rot;
+	PoseTrace::Sample sample;
+	sample.timestampNs = MonotonicNs();
+	FillDevicePose(sample.devices[PoseTrace::kDevice_Hmd], pGamePoseArray, unGamePoseArrayCount, vr_src::k_unTrackedDeviceIndex_Hmd);
+	FillDevicePose(sample.devices[PoseTrace::kDevice_RightHand], pGamePoseArray, unGamePoseArrayCount, rightIndex);
+	FillDevicePose(sample.devices[PoseTrace::kDevice_LeftHand], pGamePoseArray, unGamePoseArrayCount, leftIndex);
+	g_poseRecorder.Push(sample);
+}
 
-	NiPoint3 handForward = ForwardVector(handRot);
-	NiPoint3 hmdUp = UpVector(hmdRot);
-	NiPoint3 hmdRight = RightVector(hmdRot);
+void FillDeviceKinematics(DeviceKinematics &out, const vr_src::TrackedDevicePose_t &pose, uint64_t now)
+{
+	PoseTrace::ToGameTransform(pose.mDeviceToAbsoluteTracking.m, 1.f, out.pose);
+	out.velocity = PoseTrace::ToGameAxes(pose.vVelocity.v);
+	out.angularVelocity = PoseTrace::ToGameAxes(pose.vAngularVelocity.v);
+	out.timestampNs = now;
+}
 
-	float handForwardDotWithHmdOutwards = DotProduct(handForward, hmdRight);
-	if (isLeft) handForwardDotWithHmdOutwards *= -1.f;
+// Only does anything while the game thread publishes a context, which it does for pose thread classification and for parries
+void RunPoseThreadTests(const KinematicsSnapshot &kinematics, uint64_t now)
+{
+	const PoseClassifier::GameContext &context = g_poseClassifierContext.Read();
 
-	NiPoint3 hmdToHand = (handPosition - hmdPosition) * *g_havokWorldScale; // Vector pointing from the hmd to the hand, in meters
-	float hmdToHandVerticalDistance = DotProduct(hmdUp, hmdToHand); // Distance of hand away from hmd along hmd up axis
+	BlockCore::FrameInput input;
+	if (!PoseClassifier::BuildFrameInput(context, kinematics, now, input)) return;
 
-	if (handSpeed <= maxSpeedUnarmedEnter &&
-		handForwardDotWithHmdOutwards >= handForwardHmdRightUnarmedEnter &&
-		abs(hmdToHandVerticalDistance) <= hmdToHandDistanceUpUnarmedEnter) {
+	// The config is published first, so this only catches the pose thread between the two
+	const BlockCore::Config &config = g_poseThreadConfig.Read();
+	if (config.havokWorldScale != context.havokWorldScale) return;
 
-		if (!isBlocking) {
-			// Start blocking
-			return 2;
-		}
+	if (context.isTrackingGuards) {
+		Parry::UpdateGuards(g_poseThreadGuards, config, input, g_guardOnsets);
 	}
-	else if (handSpeed > maxSpeedUnarmedExit ||
-		handForwardDotWithHmdOutwards < handForwardHmdRightUnarmedExit ||
-		abs(hmdToHandVerticalDistance) > hmdToHandDistanceUpUnarmedExit) {
+	if (!g_classifyOnPoseThread) return;
 
-		if (isBlocking) {
-			// Stop blocking
-			return 1;
-		}
-	}
-	return 0;
+	g_poseThreadDecisions.Reconcile(g_poseThreadBlockState);
+	g_poseThreadDecisions.Post(BlockCore::Update(g_poseThreadBlockState, config, input), now);
+	g_lastPoseThreadClassificationNs.store(now, std::memory_order_relaxed);
 }
 
-float g_rightHandSpeed = 0.f;
-float g_leftHandSpeed = 0.f;
-
 void UpdateHandSpeeds(vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGamePoseArrayCount)
 {
 	if (!g_openVR) return;
@@ -216,6 +265,11 @@ void UpdateHandSpeeds(vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGa
 	const vr_src::TrackedDeviceIndex_t rightIndex = vrSystem->GetTrackedDeviceIndexForControllerRole(vr_src::ETrackedControllerRole::TrackedControllerRole_RightHand);
 	const vr_src::TrackedDeviceIndex_t leftIndex = vrSystem->GetTrackedDeviceIndexForControllerRole(vr_src::ETrackedControllerRole::TrackedControllerRole_LeftHand);
 
+	// Record before any validity checks, tracking loss is part of what we want to capture
+	if (g_poseRecorder.IsRecording()) {
+		RecordPoses(pGamePoseArray, unGamePoseArrayCount, rightIndex, leftIndex);
+	}
+
 	if (unGamePoseArrayCount <= hmdIndex || !vrSystem->IsTrackedDeviceConnected(hmdIndex)) return;
 
 	vr_src::TrackedDevicePose_t &hmdPose = pGamePoseArray[hmdIndex];
@@ -224,36 +278,42 @@ void UpdateHandSpeeds(vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGa
 	bool isRightConnected = vrSystem->IsTrackedDeviceConnected(rightIndex);
 	bool isLeftConnected = vrSystem->IsTrackedDeviceConnected(leftIndex);
 
+	// Devices that are not tracked this time keep their last known values, along with when those were measured
+	static KinematicsSnapshot s_kinematics = {};
+	uint64_t now = MonotonicNs();
+
+	FillDeviceKinematics(s_kinematics.hmd, hmdPose, now);
+
 	for (int i = hmdIndex + 1; i < unGamePoseArrayCount; i++) {
-		if (i == rightIndex && isRightConnected) {
-			vr_src::TrackedDevicePose_t &pose = pGamePoseArray[i];
-			if (pose.bDeviceIsConnected && pose.bPoseIsValid && pose.eTrackingResult == vr_src::ETrackingResult::TrackingResult_Running_OK) {
-				NiPoint3 openvrVelocity = { pose.vVelocity.v[0], pose.vVelocity.v[1], pose.vVelocity.v[2] };
-				g_rightHandSpeed = VectorLengthSquared(openvrVelocity);
-			}
-		}
-		else if (i == leftIndex && isLeftConnected) {
-			vr_src::TrackedDevicePose_t &pose = pGamePoseArray[i];
-			if (pose.bDeviceIsConnected && pose.bPoseIsValid && pose.eTrackingResult == vr_src::ETrackingResult::TrackingResult_Running_OK) {
-				NiPoint3 openvrVelocity = { pose.vVelocity.v[0], pose.vVelocity.v[1], pose.vVelocity.v[2] };
-				g_leftHandSpeed = VectorLengthSquared(openvrVelocity);
-			}
+		Hand hand;
+		if (i == rightIndex && isRightConnected) hand = kHand_Right;
+		else if (i == leftIndex && isLeftConnected) hand = kHand_Left;
+		else continue;
+
+		vr_src::TrackedDevicePose_t &pose = pGamePoseArray[i];
+		if (pose.bDeviceIsConnected && pose.bPoseIsValid && pose.eTrackingResult == vr_src::ETrackingResult::TrackingResult_Running_OK) {
+			FillDeviceKinematics(s_kinematics.hands[hand], pose, now);
 		}
 	}
+
+	s_kinematics.timestampNs = now;
+	g_handKinematics.Publish(s_kinematics);
+
+	RunPoseThreadTests(s_kinematics, now);
 }
 
 void StartBlocking(Actor *actor)
 {
 	static BSFixedString s_blockStart("blockStart");
 	get_vfunc<_IAnimationGraphManagerHolder_NotifyAnimationGraph>(&actor->animGraphHolder, 0x1)(&actor->animGraphHolder, s_blockStart);
-	_MESSAGE("Start block");
+	g_asyncLog.Message("Start block");
 }
 
 void StopBlocking(Actor *actor)
 {
 	static BSFixedString s_blockStop("blockStop");
 	get_vfunc<_IAnimationGraphManagerHolder_NotifyAnimationGraph>(&actor->animGraphHolder, 0x1)(&actor->animGraphHolder, s_blockStop);
-	_MESSAGE("Stop block");
+	g_asyncLog.Message("Stop block");
 }
 
 bool WaitPosesCB(vr_src::TrackedDevicePose_t *pRenderPoseArray, uint32_t unRenderPoseArrayCount, vr_src::TrackedDevicePose_t *pGamePoseArray, uint32_t unGamePoseArrayCount)
@@ -262,97 +322,472 @@ bool WaitPosesCB(vr_src::TrackedDevicePose_t *pRenderPoseArray, uint32_t unRende
 	return true;
 }
 
-void Update()
+// The hmd node's world rotation is the room's rotation times the hmd's tracking space rotation, which gives us the rotation
+// that takes tracking space velocities into the game world
+void FillFrameMotions(const KinematicsSnapshot &kinematics, BlockCore::FrameInput &input)
 {
-	if (lastBlockStartFrameCount > 0)
-		lastBlockStartFrameCount--;
-	if (lastBlockStopFrameCount > 0)
-		lastBlockStopFrameCount--;
+	input.hmdMotion = {};
+	input.rightWandMotion = {};
+	input.leftWandMotion = {};
+	if (!kinematics.hmd.timestampNs) return;
+
+	BlockCore::Matrix33 trackingToWorld = input.hmd.rot * BlockCore::Transpose(kinematics.hmd.pose.rot);
+	auto toWorld = [&trackingToWorld](const DeviceKinematics &device, BlockCore::Motion &out) {
+		out.velocity = trackingToWorld * device.velocity;
+		out.angularVelocity = trackingToWorld * device.angularVelocity;
+	};
+	toWorld(kinematics.hmd, input.hmdMotion);
+	toWorld(kinematics.hands[kHand_Right], input.rightWandMotion);
+	toWorld(kinematics.hands[kHand_Left], input.leftWandMotion);
+}
 
-	PlayerCharacter *player = *g_thePlayer;
-	if (!player || !player->GetNiNode() || !player->actorState.IsWeaponDrawn()) return;
+// Fills in everything the block logic needs from the game. Returns why blocking should not be evaluated at all this frame, or kEarlyOut_None.
+Profiler::EarlyOut GatherFrameInput(PlayerCharacter *player, const KinematicsSnapshot &kinematics, BlockCore::FrameInput &input)
+{
+	if (!player || !player->GetNiNode()) return Profiler::kEarlyOut_NoPlayer;
 
-	if (IsInMenuMode(nullptr, 0)) return;
+	if (!player->actorState.IsWeaponDrawn()) return Profiler::kEarlyOut_WeaponSheathed;
 
-	NiPointer<NiAVObject> hmdNode = player->unk3F0[PlayerCharacter::Node::kNode_HmdNode];
-	if (!hmdNode) return;
+	if (IsInMenuMode(nullptr, 0)) return Profiler::kEarlyOut_MenuMode;
 
-	NiPointer<NiAVObject> rightWand = player->unk3F0[PlayerCharacter::Node::kNode_RightWandNode];
-	if (!rightWand) return;
+	// Safe without taking references, the player's 3d was checked above
+	PlayerNodes nodes;
+	if (!ReadPlayerNodes(player->unk3F0[PlayerCharacter::Node::kNode_HmdNode], player->unk3F0[PlayerCharacter::Node::kNode_RightWandNode],
+		player->unk3F0[PlayerCharacter::Node::kNode_LeftWandNode], nodes)) {
+		return Profiler::kEarlyOut_MissingNodes;
+	}
 
-	NiPointer<NiAVObject> leftWand = player->unk3F0[PlayerCharacter::Node::kNode_LeftWandNode];
-	if (!leftWand) return;
+	{
+		ScopedProfile profile(g_profiler, Profiler::kStage_Equipment);
+		if (!g_equipmentCache.Lookup(g_config, GetMainHandObject(player), GetOffHandObject(player), GetHandEquip)) {
+			g_asyncLog.Debug("Equipment changed: main hand %d (type %d), off hand %d (type %d)", (int)g_equipmentCache.mainHand, (int)g_equipmentCache.mainWeapon,
+				(int)g_equipmentCache.offHand, (int)g_equipmentCache.offWeapon);
+		}
+		input.mainHand = g_equipmentCache.mainHand;
+		input.offHand = g_equipmentCache.offHand;
+		input.mainWeapon = g_equipmentCache.mainWeapon;
+		input.offWeapon = g_equipmentCache.offWeapon;
+	}
 
-	bool wasLastUpdateValid = isLastUpdateValid;
-	isLastUpdateValid = false;
+	// Only query the graph when the result will actually be used
+	bool isDualWielding = g_equipmentCache.isDualWielding;
+	if (isDualWielding) {
+		ScopedProfile profile(g_profiler, Profiler::kStage_GraphQuery);
+		input.isBlockingGraph = GetIsBlocking(player, input.timestampNs);
+	}
+	else {
+		input.isBlockingGraph = false;
+		g_isBlockingTracker.Invalidate();
+	}
+	input.isBlockingInternal = IsBlockingInternal(player);
 
-	TESForm *mainHandItem = GetMainHandObject(player);
-	TESForm *offHandItem = GetOffHandObject(player);
-	if(!IsDualWielding(mainHandItem, offHandItem)) {
-		// If we switched weapons away from dual wielding, cancel existing block state
-		if (wasLastUpdateValid) {
-			StopBlocking(player);
+	input.isLeftHanded = *g_leftHandedMode;
+
+	input.hmd = nodes.hmd;
+	input.rightWand = nodes.rightWand;
+	input.leftWand = nodes.leftWand;
+
+	// Hmd and both hands from the same pose callback
+	input.poseTimestampNs = kinematics.timestampNs;
+	input.rightHandSpeed = kinematics.SpeedSquared(kHand_Right);
+	input.leftHandSpeed = kinematics.SpeedSquared(kHand_Left);
+	FillFrameMotions(kinematics, input);
+
+	if (!isDualWielding) return Profiler::kEarlyOut_NotDualWielding; // still evaluated, the core cancels any block we started
+
+	// A hand that lost tracking keeps its last velocity, which says nothing about how it is moving now
+	if (g_maxHandSampleAgeMs > 0 && !kinematics.AreHandsFresh(input.timestampNs, MsToNs(g_maxHandSampleAgeMs))) return Profiler::kEarlyOut_StaleHands;
+
+	return Profiler::kEarlyOut_None;
+}
+
+void DumpProfile(uint64_t intervalNs)
+{
+	std::vector<std::string> lines;
+	g_profiler.Report(lines);
+	g_profiler.Reset(); // each report covers one interval, so a slow stretch shows up rather than being averaged into everything before it
+	g_asyncLog.Message("Profile of the player update hook over the last %.0f seconds:", NsToMs(intervalNs) * 1e-3);
+	for (const std::string &line : lines) {
+		g_asyncLog.Message("  %s", line);
+	}
+	// The pose thread's state is its own, only the game thread's can be read here
+	if (!g_classifyOnPoseThread) {
+		const BlockCore::NotifyCounts &counts = g_blockState.notifyCounts;
+		g_asyncLog.Message("  Graph notified %llu blockStart, %llu blockStop, held back %llu blockStart, %llu blockStop that would not have changed anything",
+			counts.numStartsSent, counts.numStopsSent, counts.numStartsSuppressed, counts.numStopsSuppressed);
+	}
+	if (g_isBlockingFromGraphEvents && g_isBlockingTracker.numFrames) {
+		g_asyncLog.Message("  IsBlocking read on %u of %u frames", g_isBlockingTracker.numPolls, g_isBlockingTracker.numFrames);
+		g_isBlockingTracker.numPolls = g_isBlockingTracker.numFrames = 0;
+	}
+}
+
+void UpdateProfiler(uint64_t now)
+{
+	static uint64_t s_lastDumpNs = 0;
+	if (!s_lastDumpNs) s_lastDumpNs = now;
+	if (now - s_lastDumpNs >= (uint64_t)(g_profilerDumpIntervalSeconds * 1e9)) {
+		DumpProfile(now - s_lastDumpNs);
+		s_lastDumpNs = now;
+	}
+}
+
+// How long before this hook the pose thread had already classified the newest poses, i.e. the latency the pose thread mode saves
+struct PoseThreadLatencyStats
+{
+	uint64_t windowStartNs = 0;
+	uint64_t numFrames = 0;
+	uint64_t totalNs = 0;
+	uint64_t maxNs = 0;
+	uint64_t numDecisions = 0;
+	uint64_t totalDecisionAgeNs = 0;
+};
+PoseThreadLatencyStats g_poseThreadLatencyStats;
+const uint64_t poseThreadLatencyLogIntervalNs = 10ull * 1000 * 1000 * 1000;
+
+void RecordPoseThreadLatency(uint64_t now, BlockCore::Decision decision, uint64_t decisionAgeNs)
+{
+	PoseThreadLatencyStats &stats = g_poseThreadLatencyStats;
+
+	uint64_t lastClassification = g_lastPoseThreadClassificationNs.load(std::memory_order_relaxed);
+	if (lastClassification && now > lastClassification) {
+		uint64_t savedNs = now - lastClassification;
+		stats.numFrames++;
+		stats.totalNs += savedNs;
+		if (savedNs > stats.maxNs) stats.maxNs = savedNs;
+	}
+	if (decision != BlockCore::kDecision_None) {
+		stats.numDecisions++;
+		stats.totalDecisionAgeNs += decisionAgeNs;
+	}
+
+	if (!stats.windowStartNs) stats.windowStartNs = now;
+	if (now - stats.windowStartNs >= poseThreadLatencyLogIntervalNs) {
+		if (stats.numFrames) {
+			g_asyncLog.Message("Pose thread classification: %llu frames, poses classified %.2f ms (max %.2f ms) before the game thread would have. %llu decisions applied %.2f ms after they were made",
+				stats.numFrames, NsToMs(stats.totalNs) / stats.numFrames, NsToMs(stats.maxNs),
+				stats.numDecisions, stats.numDecisions ? NsToMs(stats.totalDecisionAgeNs) / stats.numDecisions : 0.0);
 		}
+		stats = PoseThreadLatencyStats();
+		stats.windowStartNs = now;
+	}
+}
+
+// Block latency from the poses to the game showing the block, see latency_tracer.h
+LatencyTracer g_latencyTracer;
+float g_latencyReportIntervalSeconds = 0; // 0 disables the tracer
+
+void RecordBlockLatency(const BlockCore::FrameInput &input, BlockCore::Decision decision, uint64_t decisionAgeNs)
+{
+	LatencyTracer::Sample sample;
+	if (g_classifyOnPoseThread) {
+		// Only the decision comes back from the pose thread, not what its tests asked for or the debounced IsBlocking
+		sample = { input.timestampNs, decision != BlockCore::kDecision_None ? input.timestampNs - decisionAgeNs : 0, BlockCore::kDecision_None, decision,
+			input.isBlockingGraph, input.isBlockingGraph, input.isBlockingInternal, false };
+	}
+	else {
+		sample = LatencyTracer::MakeSample(input, g_blockState, decision);
+	}
+	g_latencyTracer.Record(sample);
+
+	static uint64_t s_lastReportNs = 0;
+	if (!s_lastReportNs) s_lastReportNs = input.timestampNs;
+	if (input.timestampNs - s_lastReportNs >= (uint64_t)(g_latencyReportIntervalSeconds * 1e9)) {
+		std::vector<std::string> lines;
+		g_latencyTracer.Report(lines);
+		g_asyncLog.Message("Block latency over the last %.0f seconds:", NsToMs(input.timestampNs - s_lastReportNs) * 1e-3);
+		for (const std::string &line : lines) {
+			g_asyncLog.Message("  %s", line);
+		}
+		g_latencyTracer.Reset();
+		s_lastReportNs = input.timestampNs;
+	}
+}
+
+// Live block state for overlays, see telemetry.h
+Telemetry::Writer g_telemetry;
+bool g_isTelemetryEnabled = false;
+
+void PublishTelemetry(const BlockCore::FrameInput &input, BlockCore::Decision decision)
+{
+	if (!g_isTelemetryEnabled) {
+		g_telemetry.Close();
 		return;
 	}
+	if (!g_telemetry.IsOpen()) {
+		if (!g_telemetry.Open()) {
+			g_asyncLog.Warning("[WARNING] Could not create the telemetry shared memory, telemetry is off until the config is reloaded");
+			g_isTelemetryEnabled = false;
+			return;
+		}
+		g_asyncLog.Message("Telemetry shared memory created");
+	}
 
-	// Check if the player is blocking
-	bool isBlocking = GetIsBlockingMode();
+	static Telemetry::Frame s_frame = {};
+	static uint64_t s_lastProfileNs = 0;
 
-	bool isLeftHanded = *g_leftHandedMode;
+	s_frame.frameNumber++;
+	// In pose thread mode g_blockState is not the one making the decisions
+	Telemetry::FillFrame(g_classifyOnPoseThread ? nullptr : &g_blockState, g_config, input, decision, s_frame);
+	// The percentiles walk every histogram, too much to do every frame for numbers that barely move
+	if (g_profiler.isEnabled && input.timestampNs - s_lastProfileNs >= MsToNs(250)) {
+		Telemetry::FillProfile(g_profiler, s_frame);
+		s_lastProfileNs = input.timestampNs;
+	}
+	g_telemetry.Publish(s_frame);
+}
 
-	NiAVObject *mainWand = isLeftHanded ? leftWand : rightWand;
-	NiAVObject *offhandWand = isLeftHanded ? rightWand : leftWand;
-	float mainWandSpeed = isLeftHanded ? g_leftHandSpeed : g_rightHandSpeed;
-	float offhandWandSpeed = isLeftHanded ? g_rightHandSpeed : g_leftHandSpeed;
+void PublishPoseClassifierContext(const BlockCore::FrameInput &input, const KinematicsSnapshot &kinematics)
+{
+	if (g_isPoseThreadConfigStale) {
+		g_poseThreadConfig.Publish(g_config);
+		g_isPoseThreadConfigStale = false;
+	}
 
-	int mainHandBlockStatus = 0;
-	if (!mainHandItem) { // Unarmed
-		mainHandBlockStatus = GetHandBlockingStatusUnarmed(hmdNode->m_worldTransform, mainWand->m_worldTransform, mainWandSpeed, isBlocking, isLeftHanded);
+	PoseClassifier::GameContext &context = g_poseClassifierContext.BeginWrite();
+	context.timestampNs = input.timestampNs;
+	context.isActive = input.isActive && kinematics.hmd.timestampNs;
+	context.isTrackingGuards = g_parryWindowMs > 0;
+	context.havokWorldScale = g_config.havokWorldScale;
+	if (context.isActive) {
+		context.mainHand = input.mainHand;
+		context.offHand = input.offHand;
+		context.mainWeapon = input.mainWeapon;
+		context.offWeapon = input.offWeapon;
+		context.isLeftHanded = input.isLeftHanded;
+		context.isBlockingGraph = input.isBlockingGraph;
+		context.isBlockingInternal = input.isBlockingInternal;
+		PoseClassifier::FillTrackingMapping(input, kinematics, context);
 	}
-	else { // Weapon
-		mainHandBlockStatus = GetHandBlockingStatus(hmdNode->m_worldTransform, mainWand->m_worldTransform, mainWandSpeed, isBlocking);
+	g_poseClassifierContext.Publish();
+}
+
+// Sent to other mods on a parry
+EventDispatcher<SKSEModCallbackEvent> *g_modEventDispatcher = nullptr;
+
+// Game thread. The hit event comes while the game handles the hit, so now is when it landed as far as the game is concerned.
+void OnBlockedHit(TESObjectREFR *attacker, uint64_t now)
+{
+	Parry::Verdict verdict = Parry::Judge(g_guardOnsets, now, g_parryWindowMs);
+	if (!verdict.isParry) {
+		if (verdict.hand >= 0) g_asyncLog.Debug("Blocked hit, guard went up %.1f ms before it", NsToMs(verdict.guardAgeNs));
+		return;
+	}
+
+	static BSFixedString s_parryEvent("DualWieldBlockVR_Parry");
+	static BSFixedString s_mainHand("Main");
+	static BSFixedString s_offHand("Off");
+	bool isMainHand = verdict.hand == BlockCore::kHandIndex_Main;
+	float guardAgeMs = (float)NsToMs(verdict.guardAgeNs);
+	g_asyncLog.Message("Parry with the %s hand, guard went up %.1f ms before the hit", isMainHand ? "main" : "off", guardAgeMs);
+	if (g_modEventDispatcher) {
+		SKSEModCallbackEvent modEvent(s_parryEvent, isMainHand ? s_mainHand : s_offHand, guardAgeMs, attacker);
+		g_modEventDispatcher->SendEvent(&modEvent);
+	}
+}
+
+class HitEventHandler : public BSTEventSink<TESHitEvent>
+{
+public:
+	virtual EventResult ReceiveEvent(TESHitEvent *evn, EventDispatcher<TESHitEvent> *dispatcher) override
+	{
+		if (g_parryWindowMs > 0 && evn && evn->target && evn->target == *g_thePlayer && (evn->flags & TESHitEvent::kFlag_Blocked)) {
+			OnBlockedHit(evn->caster, MonotonicNs());
+		}
+		return kEvent_Continue;
 	}
+};
+HitEventHandler g_hitEventHandler;
 
-	int offHandBlockStatus = 0;
-	if (!offHandItem) { // Unarmed
-		offHandBlockStatus = GetHandBlockingStatusUnarmed(hmdNode->m_worldTransform, offhandWand->m_worldTransform, offhandWandSpeed, isBlocking, !isLeftHanded);
+// Everything that can change while the game runs. havokWorldScale is set every frame anyway.
+void ApplySettings(const Settings &settings)
+{
+	g_config = settings.config;
+	g_vanillaBlockingVelocityOverride = settings.vanillaBlockingVelocityOverride;
+	g_isBlockingTracker.pollIntervalMs = settings.isBlockingPollIntervalMs;
+	g_isBlockingTracker.debounceMs = settings.config.isBlockingDebounceMs;
+	g_maxHandSampleAgeMs = settings.maxHandSampleAgeMs;
+	g_latencyReportIntervalSeconds = settings.latencyReportIntervalSeconds;
+	g_latencyTracer.isEnabled = g_latencyReportIntervalSeconds > 0;
+	g_isTelemetryEnabled = settings.isTelemetryEnabled;
+	g_parryWindowMs = settings.parryWindowMs;
+	g_config.isHandReadoutEnabled = g_isTelemetryEnabled && !g_classifyOnPoseThread;
+	g_asyncLog.SetLevel((AsyncLog::Level)settings.logLevel);
+	g_isPoseThreadConfigStale = true;
+}
+
+bool ReadConfigOptions()
+{
+	Settings settings;
+	std::vector<std::string> errors, missing;
+	bool isValid = LoadSettings(DualWieldBlockVR::GetConfigPath(), settings, errors, &missing);
+	for (const std::string &error : errors) {
+		g_asyncLog.Warning("[WARNING] Config: %s, using the default", error);
 	}
-	else if (offHandItem->IsWeapon() || offHandItem->formType == kFormType_Light) { // Weapon / torch are the same case
-		offHandBlockStatus = GetHandBlockingStatus(hmdNode->m_worldTransform, offhandWand->m_worldTransform, offhandWandSpeed, isBlocking);
+	for (const std::string &key : missing) {
+		g_asyncLog.Warning("[WARNING] Config: %s is missing, using the default", key);
 	}
-	else if (offHandItem->formType == kFormType_Armor) { // Offhand is a shield
-		if (IsBlockingInternal(player)) {
-			offHandBlockStatus = 0;
+
+	// Only read at startup
+	g_recordPoses = settings.recordPoses;
+	g_classifyOnPoseThread = settings.classifyOnPoseThread;
+	g_profilerDumpIntervalSeconds = settings.profilerDumpIntervalSeconds;
+	g_isBlockingFromGraphEvents = settings.isBlockingFromGraphEvents;
+	g_isReloadOnChangeEnabled = settings.isReloadOnChangeEnabled;
+
+	ApplySettings(settings);
+	return isValid;
+}
+
+// Null until DataLoaded resolves the game settings, and a reload can come before that
+void ApplyVanillaBlockingVelocityOverride()
+{
+	if (g_fMeleeLinearVelocityThreshold_Blocking) {
+		*g_fMeleeLinearVelocityThreshold_Blocking = g_vanillaBlockingVelocityOverride;
+	}
+}
+
+// Game thread, between frames. A file with any bad value is not applied at all, so a half finished edit does nothing.
+void ApplySettingsReload(const SettingsWatcher::Reload &reload)
+{
+	if (!reload.errors.empty()) {
+		for (const std::string &error : reload.errors) {
+			g_asyncLog.Error("Config not reloaded: %s", error);
 		}
-		else {
-			if (isBlocking) {
-				offHandBlockStatus = 1;
-			}
+		return;
+	}
+
+	const Settings &settings = reload.settings;
+	if (settings.recordPoses != g_recordPoses || settings.classifyOnPoseThread != g_classifyOnPoseThread ||
+		settings.profilerDumpIntervalSeconds != g_profilerDumpIntervalSeconds || settings.isBlockingFromGraphEvents != g_isBlockingFromGraphEvents) {
+		g_asyncLog.Warning("[WARNING] RecordPoses, ClassifyOnPoseThread, ProfilerDumpIntervalSeconds and IsBlockingFromGraphEvents only change after a restart");
+	}
+
+	ApplySettings(settings);
+	ApplyVanillaBlockingVelocityOverride();
+	g_asyncLog.Message("Config reloaded");
+}
+
+void Update()
+{
+	PlayerCharacter *player = *g_thePlayer;
+
+	if (std::unique_ptr<SettingsWatcher::Reload> reload = g_settingsWatcher.Take()) {
+		ApplySettingsReload(*reload);
+	}
+
+	if (g_config.havokWorldScale != *g_havokWorldScale) {
+		g_config.havokWorldScale = *g_havokWorldScale;
+		g_isPoseThreadConfigStale = true;
+	}
+
+	const KinematicsSnapshot &kinematics = g_handKinematics.Read();
+
+	BlockCore::FrameInput input;
+	input.timestampNs = MonotonicNs();
+	Profiler::EarlyOut earlyOut = GatherFrameInput(player, kinematics, input);
+	input.isActive = earlyOut == Profiler::kEarlyOut_None || earlyOut == Profiler::kEarlyOut_NotDualWielding;
+	if (g_profiler.isEnabled) g_profiler.CountEarlyOut(earlyOut);
+
+	BlockCore::Decision decision;
+	uint64_t decisionAgeNs = 0;
+	if (g_classifyOnPoseThread || g_parryWindowMs > 0) {
+		PublishPoseClassifierContext(input, kinematics);
+	}
+
+	if (g_classifyOnPoseThread) {
+		// The pose thread already ran the tests, all that is left is applying its decision
+
+		decision = g_poseThreadDecisions.Take(input.timestampNs, decisionAgeNs);
+		if (!input.isActive && decision != BlockCore::kDecision_None) {
+			// Made before a menu opened or the weapon was sheathed. Handed back so the pose thread does not count it as sent.
+			g_poseThreadDecisions.ReturnTaken();
+			decision = BlockCore::kDecision_None;
 		}
+
+		RecordPoseThreadLatency(input.timestampNs, decision, decisionAgeNs);
 	}
 	else {
-		offHandBlockStatus = 1; // Offhand not being a weapon/shield (so spell) means it should say to stop blocking
+		ScopedProfile profile(g_profiler, Profiler::kStage_Tests);
+		decision = BlockCore::Update(g_blockState, g_config, input);
 	}
 
-	if (mainHandBlockStatus == 2 || offHandBlockStatus == 2) { // Either hand is in blocking position
-		if (lastBlockStartFrameCount <= 0) { // Do not try to block more than once every n updates
-			// Start blocking
+	if (decision != BlockCore::kDecision_None) {
+		ScopedProfile profile(g_profiler, Profiler::kStage_Notify);
+		if (decision == BlockCore::kDecision_StartBlocking) {
 			StartBlocking(player);
-			lastBlockStartFrameCount = blockCooldown;
 		}
-	}
-	else if (mainHandBlockStatus == 1 && offHandBlockStatus == 1) { // Both hands are not blocking
-		if (lastBlockStopFrameCount <= 0) { // Do not try to block more than once every n updates
-			// Stop blocking
+		else {
 			StopBlocking(player);
-			lastBlockStopFrameCount = blockCooldown;
 		}
+		g_isBlockingTracker.OnNotify(input.timestampNs);
 	}
-	isLastUpdateValid = true;
+
+	if (g_latencyTracer.isEnabled && input.isActive) {
+		RecordBlockLatency(input, decision, decisionAgeNs);
+	}
+
+	PublishTelemetry(input, decision);
 }
 
 
+// Looks the game addresses up in the running executable, or takes them from the cache next to the ini if it was made for
+// the same executable. Code and RTTI are there once the executable is loaded, game settings only once the game has built
+// them, so those wait for DataLoaded. Only 1.4.15 is loaded on, and its addresses win: anything not found, or found
+// somewhere else, uses those, so a signature that has gone wrong shows up in the log without breaking anything.
+uintptr_t g_gameAddresses[GameAddresses::kNumAddresses] = {};
+void ResolveGameAddresses(bool isDataLoaded)
+{
+	using namespace SignatureScanner;
+	using namespace GameAddresses;
+
+	uint64_t startNs = MonotonicNs();
+	uintptr_t base = RelocationManager::s_baseAddr;
+
+	std::vector<int> indices;
+	std::vector<Target> pending;
+	for (int i = 0; i < kNumAddresses; i++) {
+		if ((targets[i].kind == kTarget_GameSetting) != isDataLoaded) continue;
+		indices.push_back(i);
+		pending.push_back(targets[i]);
+	}
+
+	std::vector<Resolved> resolved(pending.size());
+	Image image;
+	if (ReadImage((const uint8_t *)base, base, image)) {
+		const std::string &cachePath = DualWieldBlockVR::GetAddressCachePath();
+		Cache cache;
+		ReadCache(cachePath, cache);
+		bool isCacheChanged;
+		Resolve(image, pending.data(), (int)pending.size(), cache, resolved.data(), isCacheChanged);
+		if (isCacheChanged && !WriteCache(cachePath, cache)) {
+			g_asyncLog.Warning("[WARNING] Failed to write %s", cachePath);
+		}
+	}
+	else {
+		g_asyncLog.Warning("[WARNING] Couldn't read the executable's headers");
+	}
+
+	int numCached = 0;
+	for (size_t i = 0; i < pending.size(); i++) {
+		const Target &target = pending[i];
+		if (!resolved[i].isFound && target.kind != kTarget_None) {
+			g_asyncLog.Warning("[WARNING] Couldn't find %s, using the 1.4.15 address", target.name);
+		}
+		else if (resolved[i].isFound && resolved[i].rva != target.knownRva) {
+			g_asyncLog.Warning("[WARNING] The signature for %s found %x rather than the 1.4.15 %x, using the 1.4.15 address", target.name, resolved[i].rva, target.knownRva);
+		}
+		numCached += resolved[i].isFound && resolved[i].isCached;
+		g_gameAddresses[indices[i]] = base + target.knownRva;
+	}
+
+	g_havokWorldScale = (float *)g_gameAddresses[kAddress_HavokWorldScale];
+	g_fMeleeLinearVelocityThreshold_Blocking = (float *)g_gameAddresses[kAddress_MeleeLinearVelocityThresholdBlocking];
+	IsInMenuMode = (_IsInMenuMode)g_gameAddresses[kAddress_IsInMenuMode];
+
+	g_asyncLog.Message("Resolved %d game addresses in %.2f ms, %d from the cache", (int)pending.size(), NsToMs(MonotonicNs() - startNs), numCached);
+}
+
 // Listener for SKSE Messages
 void OnSKSEMessage(SKSEMessagingInterface::Message* msg)
 {
@@ -360,13 +795,38 @@ void OnSKSEMessage(SKSEMessagingInterface::Message* msg)
 		if (msg->type == SKSEMessagingInterface::kMessage_PreLoadGame) {
 		}
 		else if (msg->type == SKSEMessagingInterface::kMessage_PostLoadGame || msg->type == SKSEMessagingInterface::kMessage_NewGame) {
+			PlayerCharacter *player = *g_thePlayer;
+			if (g_isBlockingFromGraphEvents && player) {
+				HookPlayerAnimationGraphEvents(player);
+			}
+			g_isBlockingTracker.Invalidate();
 		}
 		else if (msg->type == SKSEMessagingInterface::kMessage_DataLoaded) {
-			*g_fMeleeLinearVelocityThreshold_Blocking = g_vanillaBlockingVelocityOverride;
+			ResolveGameAddresses(true);
+			ApplyVanillaBlockingVelocityOverride();
+
+			EventDispatcherList *eventDispatcherList = GetEventDispatcherList();
+			if (eventDispatcherList) {
+				eventDispatcherList->unk4D0.AddEventSink(&g_equipEventHandler); // TESEquipEvent
+				g_asyncLog.Message("Registered for equip events");
+				eventDispatcherList->unk630.AddEventSink(&g_hitEventHandler); // TESHitEvent
+				g_asyncLog.Message("Registered for hit events");
+			}
 		}
 	}
 }
 
+// Runs on the log's flusher thread, the only place that touches the log file once the plugin is up
+void WriteLogLine(AsyncLog::Level level, uint64_t, const char *text)
+{
+	switch (level) {
+	case AsyncLog::kLevel_Error: _ERROR("%s", text); break;
+	case AsyncLog::kLevel_Warning: _WARNING("%s", text); break;
+	case AsyncLog::kLevel_Debug: _DMESSAGE("%s", text); break;
+	default: _MESSAGE("%s", text); break;
+	}
+}
+
 void ShowErrorBox(const char *errorString)
 {
 	int msgboxID = MessageBox(
@@ -377,54 +837,45 @@ void ShowErrorBox(const char *errorString)
 	);
 }
 
+// The plugin is about to fail to load, so the log is written out and stopped before the box goes up
 void ShowErrorBoxAndLog(const char *errorString)
 {
-	_ERROR(errorString);
+	g_asyncLog.Error("%s", errorString);
+	g_asyncLog.Stop();
 	ShowErrorBox(errorString);
 }
 
-bool ReadConfigOptions()
+std::string GetPoseRecordingPath()
 {
-	// Dual wield settings
-
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Settings", "VanillaBlockingVelocityOverride", &g_vanillaBlockingVelocityOverride)) return false;
-
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "MaxSpeedEnter", &maxSpeedEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "MaxSpeedExit", &maxSpeedExit)) return false;
-
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HandForwardDotWithHmdDownEnter", &handForwardHmdDownEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HandForwardDotWithHmdDownExit", &handForwardHmdDownExit)) return false;
-
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HandForwardDotWithHmdForwardEnter", &handForwardHmdForwardEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HandForwardDotWithHmdForwardExit", &handForwardHmdForwardExit)) return false;
-
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HmdToHandVerticalDistanceEnter", &hmdToHandDistanceUpEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("DualWield", "HmdToHandVerticalDistanceExit", &hmdToHandDistanceUpExit)) return false;
-
-	if (!DualWieldBlockVR::GetConfigOptionBool("DualWield", "EnableShield", &isShieldEnabled)) return false;
-
-	// Unarmed settings
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "MaxSpeedEnter", &maxSpeedUnarmedEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "MaxSpeedExit", &maxSpeedUnarmedExit)) return false;
+	char documentsPath[MAX_PATH];
+	if (FAILED(SHGetFolderPath(NULL, CSIDL_MYDOCUMENTS, NULL, SHGFP_TYPE_CURRENT, documentsPath))) return "";
 
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "HandForwardDotWithHmdRightEnter", &handForwardHmdRightUnarmedEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "HandForwardDotWithHmdRightExit", &handForwardHmdRightUnarmedExit)) return false;
+	SYSTEMTIME time;
+	GetLocalTime(&time);
 
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "HmdToHandVerticalDistanceEnter", &hmdToHandDistanceUpUnarmedEnter)) return false;
-	if (!DualWieldBlockVR::GetConfigOptionFloat("Unarmed", "HmdToHandVerticalDistanceExit", &hmdToHandDistanceUpUnarmedExit)) return false;
+	char fileName[64];
+	sprintf_s(fileName, "DualWieldBlockVR_%04d%02d%02d_%02d%02d%02d.dwbp", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
 
-	return true;
+	return std::string(documentsPath) + "\\My Games\\Skyrim VR\\SKSE\\" + fileName;
 }
 
 
 typedef void (*_TESObjectREFR_UpdateRefLight)(TESObjectREFR *_this);
 _TESObjectREFR_UpdateRefLight g_original_PlayerCharacter_UpdateRefLight = nullptr;
-static RelocPtr<_TESObjectREFR_UpdateRefLight> PlayerCharacter_UpdateRefLight_vtbl(0x16E24D8); // 0x16E2230 + 0x55 * 8
 void PlayerCharacter_UpdateRefLight_Hook(PlayerCharacter *_this)
 {
 	// This hook is a chainable vtable hook near the very end of the PlayerCharacter update, which runs after higgs/vrik main frame updates
 
-	Update();
+	if (g_profiler.isEnabled) {
+		uint64_t start = MonotonicNs();
+		Update();
+		uint64_t end = MonotonicNs();
+		g_profiler.Record(Profiler::kStage_Update, end - start);
+		UpdateProfiler(end);
+	}
+	else {
+		Update();
+	}
 
 	g_original_PlayerCharacter_UpdateRefLight(_this);
 }
@@ -436,7 +887,9 @@ extern "C" {
 		gLog.SetPrintLevel(IDebugLog::kLevel_DebugMessage);
 		gLog.SetLogLevel(IDebugLog::kLevel_DebugMessage);
 
-		_MESSAGE("DualWieldBlockVR v%s", DWBVR_VERSION_VERSTRING);
+		g_asyncLog.Start(WriteLogLine);
+
+		g_asyncLog.Message("DualWieldBlockVR v%s", DWBVR_VERSION_VERSTRING);
 
 		info->infoVersion = PluginInfo::kInfoVersion;
 		info->name = "DualWieldBlockVR";
@@ -444,12 +897,16 @@ extern "C" {
 
 		g_pluginHandle = skse->GetPluginHandle();
 
+		// A rejected plugin is never loaded, so its log stops here. Stop writes out what is still queued.
 		if (skse->isEditor) {
-			_FATALERROR("[FATAL ERROR] Loaded in editor, marking as incompatible!\n");
+			g_asyncLog.Error("[FATAL ERROR] Loaded in editor, marking as incompatible!");
+			g_asyncLog.Stop();
 			return false;
 		}
 		else if (skse->runtimeVersion != RUNTIME_VR_VERSION_1_4_15) {
-			_FATALERROR("[FATAL ERROR] Unsupported runtime version %08X!\n", skse->runtimeVersion);
+			// Only two addresses have signatures, everything else (SKSE's RelocPtrs, the offsets, the vtable indices) is 1.4.15's
+			g_asyncLog.Error("[FATAL ERROR] Unsupported runtime version %08X!", skse->runtimeVersion);
+			g_asyncLog.Stop();
 			return false;
 		}
 
@@ -458,13 +915,17 @@ extern "C" {
 
 	bool SKSEPlugin_Load(const SKSEInterface * skse)
 	{	// Called by SKSE to load this plugin
-		_MESSAGE("DualWieldBlockVR loaded");
+		g_asyncLog.Message("DualWieldBlockVR loaded");
 
 		// Registers for SKSE Messages (PapyrusVR probably still need to load, wait for SKSE message PostLoad)
-		_MESSAGE("Registering for SKSE messages");
+		g_asyncLog.Message("Registering for SKSE messages");
 		g_messaging = (SKSEMessagingInterface*)skse->QueryInterface(kInterface_Messaging);
 		g_messaging->RegisterListener(g_pluginHandle, "SKSE", OnSKSEMessage);
 
+		ResolveGameAddresses(false);
+
+		g_modEventDispatcher = (EventDispatcher<SKSEModCallbackEvent> *)g_messaging->GetEventDispatcher(SKSEMessagingInterface::kDispatcher_ModEvent);
+
 		g_vrInterface = (SKSEVRInterface *)skse->QueryInterface(kInterface_VR);
 		if (!g_vrInterface) {
 			ShowErrorBoxAndLog("[CRITICAL] Couldn't get SKSE VR interface. You probably have an outdated SKSE version.");
@@ -473,18 +934,32 @@ extern "C" {
 		g_vrInterface->RegisterForPoses(g_pluginHandle, 11, WaitPosesCB);
 
 		if (ReadConfigOptions()) {
-			_MESSAGE("Successfully read config parameters");
+			g_asyncLog.Message("Successfully read config parameters");
 		}
 		else {
-			_WARNING("[WARNING] Failed to read config options. Using defaults instead.");
+			g_asyncLog.Warning("[WARNING] Some config options were bad. Using defaults for those instead.");
+		}
+
+		if (g_isReloadOnChangeEnabled && g_settingsWatcher.Start(DualWieldBlockVR::GetConfigPath())) {
+			g_asyncLog.Message("Watching the config file for changes");
 		}
 
-		for (int i = 0; i < numPrevIsBlocking; i++) {
-			prevIsBlockings[i] = false;
+		g_profiler.isEnabled = g_profilerDumpIntervalSeconds > 0;
+
+		if (g_recordPoses) {
+			std::string path = GetPoseRecordingPath();
+			if (!path.empty() && g_poseRecorder.Start(path)) {
+				g_asyncLog.Message("Recording poses to %s", path);
+			}
+			else {
+				g_asyncLog.Warning("[WARNING] Failed to start pose recording");
+			}
 		}
 
-		g_original_PlayerCharacter_UpdateRefLight = *PlayerCharacter_UpdateRefLight_vtbl;
-		SafeWrite64(PlayerCharacter_UpdateRefLight_vtbl.GetUIntPtr(), uintptr_t(PlayerCharacter_UpdateRefLight_Hook));
+		// PlayerCharacter vtable + 0x55 * 8
+		_TESObjectREFR_UpdateRefLight *updateRefLightSlot = (_TESObjectREFR_UpdateRefLight *)g_gameAddresses[GameAddresses::kAddress_PlayerCharacterUpdateRefLightSlot];
+		g_original_PlayerCharacter_UpdateRefLight = *updateRefLightSlot;
+		SafeWrite64(uintptr_t(updateRefLightSlot), uintptr_t(PlayerCharacter_UpdateRefLight_Hook));
 
 		return true;
 	}
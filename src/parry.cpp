@@ -0,0 +1,104 @@
+#include "parry.h"
+
+
+namespace Parry
+{
+	void OnsetHistory::Enter(uint64_t nowNs)
+	{
+		uint32_t n = numEntered.load(std::memory_order_relaxed);
+		Entry &entry = entries[n & (capacity - 1)];
+		// A reader halfway through the entry this replaces sees enteredNs change under it and gives up on it
+		entry.enteredNs.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		entry.leftNs.store(0, std::memory_order_relaxed);
+		entry.enteredNs.store(nowNs, std::memory_order_release);
+		numEntered.store(n + 1, std::memory_order_release);
+	}
+
+	void OnsetHistory::Leave(uint64_t nowNs)
+	{
+		uint32_t n = numEntered.load(std::memory_order_relaxed);
+		if (!n) return;
+		entries[(n - 1) & (capacity - 1)].leftNs.store(nowNs, std::memory_order_release);
+	}
+
+	uint64_t OnsetHistory::Find(uint64_t hitNs, uint64_t &leftNs) const
+	{
+		leftNs = 0;
+		uint32_t n = numEntered.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < capacity && i < n; i++) {
+			const Entry &entry = entries[(n - 1 - i) & (capacity - 1)];
+			uint64_t entered = entry.enteredNs.load(std::memory_order_acquire);
+			uint64_t left = entry.leftNs.load(std::memory_order_acquire);
+			// Overwritten while it was read, and so is everything older
+			if (!entered || entry.enteredNs.load(std::memory_order_relaxed) != entered) return 0;
+			if (entered > hitNs) continue;
+
+			leftNs = left;
+			return entered;
+		}
+		return 0;
+	}
+
+	static BlockCore::HandStatus GetGuardStatus(const BlockCore::Config &config, const BlockCore::FrameInput &input, BlockCore::HandMode mode, const BlockCore::HandSample &sample, bool isLeft, bool isInGuard)
+	{
+		switch (mode) {
+		case BlockCore::kHandMode_Armed:
+			return BlockCore::GetHandBlockingStatus(config, config.weaponProfiles[(int)input.mainWeapon][(int)input.offWeapon], sample, sample, isInGuard);
+		case BlockCore::kHandMode_Unarmed:
+			return BlockCore::GetHandBlockingStatusUnarmed(config, sample, sample, isInGuard, isLeft);
+		default:
+			return BlockCore::kHandStatus_Stop; // a shield parries with the game's own block, spells never do
+		}
+	}
+
+	void UpdateGuards(GuardState &state, const BlockCore::Config &config, const BlockCore::FrameInput &input, OnsetHistory (&histories)[BlockCore::kNumHandIndices])
+	{
+		uint64_t now = input.timestampNs;
+		if (!input.isActive || !BlockCore::IsDualWielding(config, input.mainHand, input.offHand)) {
+			for (int hand = 0; hand < BlockCore::kNumHandIndices; hand++) {
+				if (state.isInGuard[hand]) histories[hand].Leave(now);
+				state.isInGuard[hand] = false;
+			}
+			return;
+		}
+
+		bool isLeftHanded = input.isLeftHanded;
+		BlockCore::HandSample samples[BlockCore::kNumHandIndices] = {
+			{ input.hmd, isLeftHanded ? input.leftWand : input.rightWand, isLeftHanded ? input.leftHandSpeed : input.rightHandSpeed },
+			{ input.hmd, isLeftHanded ? input.rightWand : input.leftWand, isLeftHanded ? input.rightHandSpeed : input.leftHandSpeed }
+		};
+		BlockCore::HandMode modes[BlockCore::kNumHandIndices] = { BlockCore::handModeByEquip[(int)input.mainHand], BlockCore::handModeByEquip[(int)input.offHand] };
+
+		for (int hand = 0; hand < BlockCore::kNumHandIndices; hand++) {
+			bool isLeft = (hand == BlockCore::kHandIndex_Main) == isLeftHanded;
+			BlockCore::HandStatus status = GetGuardStatus(config, input, modes[hand], samples[hand], isLeft, state.isInGuard[hand]);
+			if (status == BlockCore::kHandStatus_Start) {
+				histories[hand].Enter(now);
+				state.isInGuard[hand] = true;
+			}
+			else if (status == BlockCore::kHandStatus_Stop && state.isInGuard[hand]) {
+				histories[hand].Leave(now);
+				state.isInGuard[hand] = false;
+			}
+		}
+	}
+
+	Verdict Judge(const OnsetHistory (&histories)[BlockCore::kNumHandIndices], uint64_t hitNs, float windowMs)
+	{
+		Verdict verdict;
+		for (int hand = 0; hand < BlockCore::kNumHandIndices; hand++) {
+			uint64_t leftNs;
+			uint64_t enteredNs = histories[hand].Find(hitNs, leftNs);
+			if (!enteredNs || (leftNs && leftNs <= hitNs)) continue; // no guard, or let go before the hit
+
+			uint64_t ageNs = hitNs - enteredNs;
+			if (ageNs < verdict.guardAgeNs) {
+				verdict.guardAgeNs = ageNs;
+				verdict.hand = hand;
+			}
+		}
+		verdict.isParry = verdict.hand >= 0 && verdict.guardAgeNs <= (uint64_t)((double)windowMs * 1e6);
+		return verdict;
+	}
+}
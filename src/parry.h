@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "blocking.h"
+#include "dual_hand_classifier.h"
+
+
+// Timed parries. A blocked hit is a parry if a hand went into its guard no more than a window before the hit and was still
+// holding it. When the guard went up is taken from the pose callbacks, which run the hand tests on every pose they get:
+// the first game frame to see the guard can be a whole frame later, which at low frame rates is a good part of the window.
+namespace Parry
+{
+	// Guards entered and left by one hand, newest last. Written by one thread (the pose thread), read by any other.
+	class OnsetHistory
+	{
+	public:
+		static const uint32_t capacity = 16; // power of 2
+
+		// Writer
+		void Enter(uint64_t nowNs);
+		void Leave(uint64_t nowNs);
+
+		// Reader. When the newest guard entered at or before hitNs went up, 0 if there is none in the history.
+		// leftNs is when it was let go, 0 if it is still held. Walks back past guards entered after hitNs, of which there
+		// are at most a pose callback's worth, so in practice it looks at one or two entries.
+		uint64_t Find(uint64_t hitNs, uint64_t &leftNs) const;
+
+	private:
+		struct Entry
+		{
+			std::atomic<uint64_t> enteredNs = 0;
+			std::atomic<uint64_t> leftNs = 0;
+		};
+
+		Entry entries[capacity];
+		std::atomic<uint32_t> numEntered = 0; // the newest entry is at (numEntered - 1) % capacity
+	};
+
+	// Which hands are in their guard, as of the last pose. Only touched by the thread that writes the histories.
+	struct GuardState
+	{
+		bool isInGuard[BlockCore::kNumHandIndices] = {};
+	};
+
+	// Runs the same enter / exit tests BlockCore::Update does for each hand, but on the pose as it is: no prediction and no
+	// jitter filter, the onset is when the guard was there and not when it was about to be. Records every change in
+	// histories (main, off). Hands that cannot block, and both hands while inactive or not dual wielding, let go.
+	void UpdateGuards(GuardState &state, const BlockCore::Config &config, const BlockCore::FrameInput &input, OnsetHistory (&histories)[BlockCore::kNumHandIndices]);
+
+	struct Verdict
+	{
+		bool isParry = false;
+		int hand = -1; // the hand holding the guard that went up last, -1 if neither held one
+		uint64_t guardAgeNs = UINT64_MAX; // how long before the hit that hand's guard went up, UINT64_MAX if no hand held one
+	};
+
+	// A hit at hitNs is a parry if a hand that was holding its guard at hitNs entered it no more than windowMs before
+	Verdict Judge(const OnsetHistory (&histories)[BlockCore::kNumHandIndices], uint64_t hitNs, float windowMs);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstring>
+
+#include "skse64/NiTypes.h"
+
+#include "blocking.h"
+
+
+// The player's hmd and wand world transforms for one frame, read once before anything else runs. Later stages read
+// them from here rather than going back through the player and the nodes.
+struct alignas(64) PlayerNodes
+{
+	BlockCore::Transform hmd;
+	BlockCore::Transform rightWand;
+	BlockCore::Transform leftWand;
+};
+
+inline void CopyTransform(const NiTransform &in, BlockCore::Transform &out)
+{
+	static_assert(sizeof(NiTransform) == sizeof(BlockCore::Transform), "BlockCore::Transform must match NiTransform");
+	memcpy(&out, &in, sizeof(out));
+}
+
+// Reads the nodes through the player's own NiPointers instead of copying them, since every copy is an atomic refcount
+// increment and decrement. The player keeps its nodes referenced for as long as its 3d is loaded, so this is safe once
+// the caller has checked that, and nothing read here outlives the frame. False if any of the nodes is missing.
+template <typename Node>
+bool ReadPlayerNodes(const NiPointer<Node> &hmdNode, const NiPointer<Node> &rightWandNode, const NiPointer<Node> &leftWandNode, PlayerNodes &out)
+{
+	const Node *hmd = hmdNode.m_pObject;
+	const Node *rightWand = rightWandNode.m_pObject;
+	const Node *leftWand = leftWandNode.m_pObject;
+	if (!hmd || !rightWand || !leftWand) return false;
+
+	CopyTransform(hmd->m_worldTransform, out.hmd);
+	CopyTransform(rightWand->m_worldTransform, out.rightWand);
+	CopyTransform(leftWand->m_worldTransform, out.leftWand);
+	return true;
+}
@@ -0,0 +1,77 @@
+#include "pose_classifier.h"
+
+
+namespace PoseClassifier
+{
+	static BlockCore::Transform ToGameUnits(const BlockCore::Transform &meters, float havokWorldScale)
+	{
+		BlockCore::Transform result = meters;
+		result.pos = meters.pos * (1.f / havokWorldScale);
+		return result;
+	}
+
+	void FillTrackingMapping(const BlockCore::FrameInput &input, const KinematicsSnapshot &kinematics, GameContext &context)
+	{
+		float havokWorldScale = context.havokWorldScale;
+
+		// The hmd node is the hmd pose placed in the world. The snapshot may be a pose callback newer than the one the node was
+		// built from, which puts up to a frame of head motion into the mapping.
+		BlockCore::Transform hmdTracking = ToGameUnits(kinematics.hmd.pose, havokWorldScale);
+		context.trackingToWorld = input.hmd * BlockCore::InverseTransform(hmdTracking);
+
+		const BlockCore::Transform *wands[kNumHands] = { &input.rightWand, &input.leftWand };
+		for (int hand = 0; hand < kNumHands; hand++) {
+			BlockCore::Transform controllerWorld = context.trackingToWorld * ToGameUnits(kinematics.hands[hand].pose, havokWorldScale);
+			context.controllerToWand[hand] = BlockCore::InverseTransform(controllerWorld) * *wands[hand];
+		}
+	}
+
+	static BlockCore::Motion ToWorldMotion(const BlockCore::Matrix33 &trackingToWorld, const DeviceKinematics &device)
+	{
+		return { trackingToWorld * device.velocity, trackingToWorld * device.angularVelocity };
+	}
+
+	bool BuildFrameInput(const GameContext &context, const KinematicsSnapshot &kinematics, uint64_t nowNs, BlockCore::FrameInput &out)
+	{
+		if (!context.timestampNs || nowNs - context.timestampNs > maxContextAgeNs || !kinematics.hmd.timestampNs) return false;
+
+		float havokWorldScale = context.havokWorldScale;
+		const BlockCore::Transform &trackingToWorld = context.trackingToWorld;
+
+		out.timestampNs = nowNs;
+		out.poseTimestampNs = kinematics.timestampNs;
+		out.isActive = context.isActive;
+		out.mainHand = context.mainHand;
+		out.offHand = context.offHand;
+		out.mainWeapon = context.mainWeapon;
+		out.offWeapon = context.offWeapon;
+		out.isLeftHanded = context.isLeftHanded;
+		out.isBlockingGraph = context.isBlockingGraph;
+		out.isBlockingInternal = context.isBlockingInternal;
+		out.rightHandSpeed = kinematics.SpeedSquared(kHand_Right);
+		out.leftHandSpeed = kinematics.SpeedSquared(kHand_Left);
+
+		out.hmd = trackingToWorld * ToGameUnits(kinematics.hmd.pose, havokWorldScale);
+		out.rightWand = trackingToWorld * ToGameUnits(kinematics.hands[kHand_Right].pose, havokWorldScale) * context.controllerToWand[kHand_Right];
+		out.leftWand = trackingToWorld * ToGameUnits(kinematics.hands[kHand_Left].pose, havokWorldScale) * context.controllerToWand[kHand_Left];
+
+		out.hmdMotion = ToWorldMotion(trackingToWorld.rot, kinematics.hmd);
+		out.rightWandMotion = ToWorldMotion(trackingToWorld.rot, kinematics.hands[kHand_Right]);
+		out.leftWandMotion = ToWorldMotion(trackingToWorld.rot, kinematics.hands[kHand_Left]);
+		return true;
+	}
+
+	void DecisionMailbox::Reconcile(BlockCore::State &state)
+	{
+		for (std::atomic<uint32_t> &slot : returned) {
+			uint32_t word = slot.exchange(0, std::memory_order_acquire);
+			if (!word) continue;
+
+			// Only the low bits of the time made it through, match them against the notification the state remembers
+			BlockCore::Decision decision = (BlockCore::Decision)(word & decisionMask);
+			uint64_t lastNs = decision == BlockCore::kDecision_StartBlocking ? state.lastBlockStartNs : state.lastBlockStopNs;
+			uint64_t decidedNs = lastNs && Pack(decision, lastNs) == word ? lastNs : 0;
+			BlockCore::RevertDecision(state, decision, decidedNs);
+		}
+	}
+}
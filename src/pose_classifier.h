@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "blocking.h"
+#include "kinematics.h"
+
+
+// Block classification on the pose thread. The game thread publishes the parts of the frame only it can know
+// (equipment, IsBlocking, how tracking space maps onto the world), the pose thread runs the tests on the freshest
+// poses as soon as they arrive, and the game thread only has to apply the decision.
+namespace PoseClassifier
+{
+	// Published by the game thread every frame. The weapon types pick the thresholds out of the pose thread's own copy of
+	// the config, which is far too big to hand over with every frame.
+	struct GameContext
+	{
+		uint64_t timestampNs; // 0 if nothing has been published yet
+		bool isActive;
+		BlockCore::HandEquip mainHand;
+		BlockCore::HandEquip offHand;
+		BlockCore::WeaponType mainWeapon;
+		BlockCore::WeaponType offWeapon;
+		bool isLeftHanded;
+		bool isBlockingGraph;
+		bool isBlockingInternal;
+		bool isTrackingGuards; // time guard onsets for parries (parry.h)
+		float havokWorldScale; // the rest of the config goes to the pose thread separately, only when it changes
+		BlockCore::Transform trackingToWorld; // tracking space (game axes and units) -> game world
+		BlockCore::Transform controllerToWand[kNumHands]; // controller pose -> wand node, both in the world
+	};
+
+	// A context older than this is not used. The game thread stops publishing in menus and loading screens.
+	const uint64_t maxContextAgeNs = 100 * 1000 * 1000;
+
+	// Game thread. Derives the tracking space mapping from the hmd and wand nodes' world transforms and the poses they were built from.
+	void FillTrackingMapping(const BlockCore::FrameInput &input, const KinematicsSnapshot &kinematics, GameContext &context);
+
+	// Pose thread. Builds the frame the block tests see from the freshest poses. Returns false if the context is too old to use.
+	bool BuildFrameInput(const GameContext &context, const KinematicsSnapshot &kinematics, uint64_t nowNs, BlockCore::FrameInput &out);
+
+	// The decision and the time it was made, packed in one word: bits 0-1 are the decision, bits 2-31 the time in microseconds
+	// (wrapping every ~18 minutes, only ever used for short differences). 0 means nothing is pending.
+	// Decisions that never get applied, replaced before the game thread took them or taken while it was inactive, are handed
+	// back to the pose thread so its block state does not count them as sent.
+	class DecisionMailbox
+	{
+	public:
+		// Pose thread. A newer decision replaces one the game thread has not picked up yet, which is handed back.
+		void Post(BlockCore::Decision decision, uint64_t nowNs)
+		{
+			if (decision == BlockCore::kDecision_None) return;
+			uint32_t replaced = pending.exchange(Pack(decision, nowNs), std::memory_order_acq_rel);
+			if (replaced) HandBack(replaced);
+		}
+
+		// Game thread. Returns kDecision_None if nothing was posted since the last call. ageNs is how long ago it was made.
+		BlockCore::Decision Take(uint64_t nowNs, uint64_t &ageNs)
+		{
+			uint32_t word = pending.exchange(0, std::memory_order_acquire);
+			uint32_t timeMask = ~(uint32_t)0 >> decisionBits;
+			uint32_t ageUs = ((uint32_t)(nowNs / 1000) - (word >> decisionBits)) & timeMask;
+			ageNs = (uint64_t)ageUs * 1000;
+			lastTaken = word;
+			return (BlockCore::Decision)(word & decisionMask);
+		}
+
+		// Game thread. The decision the last Take returned is not going to be applied.
+		void ReturnTaken()
+		{
+			if (lastTaken) HandBack(lastTaken);
+			lastTaken = 0;
+		}
+
+		// Pose thread, before the next update. Reverts the decisions handed back since the last call in state.
+		void Reconcile(BlockCore::State &state);
+
+	private:
+		static const uint32_t decisionBits = 2;
+		static const uint32_t decisionMask = (1 << decisionBits) - 1;
+
+		static uint32_t Pack(BlockCore::Decision decision, uint64_t nowNs)
+		{
+			return (uint32_t)decision | ((uint32_t)(nowNs / 1000) << decisionBits);
+		}
+
+		// One slot per direction. A start and a stop can both be waiting, two of the same cannot, they are a cooldown apart.
+		void HandBack(uint32_t word)
+		{
+			returned[(word & decisionMask) - 1].store(word, std::memory_order_release);
+		}
+
+		std::atomic<uint32_t> pending = 0;
+		std::atomic<uint32_t> returned[2] = {};
+		uint32_t lastTaken = 0; // game thread only
+	};
+}
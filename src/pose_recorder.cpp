@@ -0,0 +1,122 @@
+#include <chrono>
+
+#include "pose_recorder.h"
+
+
+PoseRecorder::~PoseRecorder()
+{
+	// Joining from a static destructor can deadlock on the loader lock at process exit, so just let the thread go.
+	// Everything up to the last full block has already been written by then.
+	if (thread.joinable()) {
+		stopRequested = true;
+		thread.detach();
+	}
+}
+
+bool PoseRecorder::Start(const std::string &path, uint32_t capacity, uint32_t samplesPerBlock)
+{
+	if (IsRecording()) return false;
+
+	uint32_t size = 1;
+	while (size < capacity) size <<= 1;
+	if (samplesPerBlock == 0 || samplesPerBlock > size) samplesPerBlock = size;
+
+	file = fopen(path.c_str(), "wb");
+	if (!file) return false;
+
+	header = PoseTrace::MakeFileHeader(samplesPerBlock);
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+
+	ring.resize(size);
+	ringMask = size - 1;
+	blockSamples.resize(samplesPerBlock);
+	encoded.reserve(samplesPerBlock * 32);
+
+	head = 0;
+	tail = 0;
+	numRecorded = 0;
+	numDropped = 0;
+	numBytesWritten = sizeof(header);
+	stopRequested = false;
+
+	thread = std::thread(&PoseRecorder::WriterThread, this);
+	isRecording = true;
+	return true;
+}
+
+void PoseRecorder::Stop()
+{
+	if (!IsRecording()) return;
+
+	isRecording = false;
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopRequested = true;
+	}
+	wake.notify_one();
+	thread.join();
+
+	fclose(file);
+	file = nullptr;
+}
+
+void PoseRecorder::Push(const PoseTrace::Sample &sample)
+{
+	if (!IsRecording()) return;
+
+	uint64_t writeIndex = head.load(std::memory_order_relaxed);
+	if (writeIndex - tail.load(std::memory_order_acquire) > ringMask) {
+		numDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring[writeIndex & ringMask] = sample;
+	head.store(writeIndex + 1, std::memory_order_release);
+}
+
+bool PoseRecorder::WriteBlock(uint32_t numSamples)
+{
+	uint64_t readIndex = tail.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < numSamples; i++) {
+		blockSamples[i] = ring[(readIndex + i) & ringMask];
+	}
+	tail.store(readIndex + numSamples, std::memory_order_release);
+
+	encoded.clear();
+	PoseTrace::EncodeBlock(header, blockSamples.data(), numSamples, encoded);
+	bool ok = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+	fflush(file);
+
+	numRecorded.fetch_add(numSamples, std::memory_order_relaxed);
+	numBytesWritten.fetch_add(encoded.size(), std::memory_order_relaxed);
+	return ok;
+}
+
+void PoseRecorder::WriterThread()
+{
+	const uint32_t samplesPerBlock = header.samplesPerBlock;
+
+	while (true) {
+		{
+			// The pose thread never signals, it would have to take the lock. Poll often enough that the ring cannot fill up.
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopRequested.load(); });
+		}
+
+		bool stopping = stopRequested.load();
+
+		while (head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed) >= samplesPerBlock) {
+			if (!WriteBlock(samplesPerBlock)) break;
+		}
+
+		if (stopping) {
+			uint64_t remaining = head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+			if (remaining > 0) WriteBlock((uint32_t)remaining);
+			return;
+		}
+	}
+}
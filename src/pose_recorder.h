@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pose_trace.h"
+
+
+// Streams pose samples to a PoseTrace file.
+// The pose thread only copies samples into a preallocated ring. Encoding and disk writes happen on a background thread.
+class PoseRecorder
+{
+public:
+	~PoseRecorder();
+
+	// capacity is rounded up to a power of two
+	bool Start(const std::string &path, uint32_t capacity = 8192, uint32_t samplesPerBlock = 1024);
+	void Stop();
+
+	bool IsRecording() const { return isRecording.load(std::memory_order_relaxed); }
+
+	// Called from the pose thread. Never blocks or allocates; if the writer has fallen behind the sample is dropped.
+	void Push(const PoseTrace::Sample &sample);
+
+	uint64_t NumRecorded() const { return numRecorded.load(std::memory_order_relaxed); }
+	uint64_t NumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+	uint64_t NumBytesWritten() const { return numBytesWritten.load(std::memory_order_relaxed); }
+
+private:
+	void WriterThread();
+	bool WriteBlock(uint32_t numSamples);
+
+	std::vector<PoseTrace::Sample> ring;
+	uint64_t ringMask = 0;
+	alignas(64) std::atomic<uint64_t> head = 0; // samples pushed, written by the pose thread
+	alignas(64) std::atomic<uint64_t> tail = 0; // samples consumed, written by the writer thread
+
+	PoseTrace::FileHeader header;
+	std::vector<PoseTrace::Sample> blockSamples;
+	std::vector<uint8_t> encoded;
+	FILE *file = nullptr;
+
+	std::thread thread;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> isRecording = false;
+	std::atomic<bool> stopRequested = false;
+
+	std::atomic<uint64_t> numRecorded = 0;
+	std::atomic<uint64_t> numDropped = 0;
+	std::atomic<uint64_t> numBytesWritten = 0;
+};
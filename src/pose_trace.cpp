@@ -0,0 +1,433 @@
+#include <cmath>
+#include <cstring>
+
+#include "pose_trace.h"
+
+
+namespace PoseTrace
+{
+	// Values before this index are predicted by linear extrapolation, the rest by the previous value
+	const int numSecondOrderValues = 7;
+
+	// Residual groups that share an adaptive code length: position, rotation, velocity, angular velocity
+	const int numGroups = 4;
+	static const int s_valueGroup[numDeviceValues] = { 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 3, 3, 3 };
+
+	// Running mean of residual magnitudes, used to pick the exp-Golomb order (same idea as LOCO-I / JPEG-LS)
+	struct AdaptiveOrder
+	{
+		uint64_t sum;
+		uint32_t count;
+
+		int Order() const
+		{
+			int k = 0;
+			while (((uint64_t)count << k) < sum && k < 40) k++;
+			return k;
+		}
+
+		void Update(uint64_t value)
+		{
+			sum += value;
+			if (++count >= 32) {
+				sum >>= 1;
+				count >>= 1;
+			}
+		}
+	};
+
+	struct DeviceState
+	{
+		int64_t prev[numDeviceValues];
+		int64_t delta[numDeviceValues];
+		AdaptiveOrder orders[numGroups];
+		float quat[4]; // last quaternion, to keep the sign continuous
+		uint8_t flags;
+		int32_t trackingResult;
+		bool hasState;
+	};
+
+	static void ResetDeviceStates(DeviceState *states)
+	{
+		memset(states, 0, sizeof(DeviceState) * kNumDevices);
+		for (int i = 0; i < kNumDevices; i++) {
+			states[i].quat[0] = 1.f;
+		}
+	}
+
+	static inline uint64_t ZigZag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+	static inline int64_t UnZigZag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+	struct BitWriter
+	{
+		std::vector<uint8_t> &out;
+		uint64_t buffer = 0;
+		int numBits = 0;
+
+		explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+		void Write(uint64_t value, int bits)
+		{
+			// Split so the buffer never holds more than 64 bits
+			if (bits > 32) {
+				Write(value >> 32, bits - 32);
+				bits = 32;
+				value &= 0xFFFFFFFFull;
+			}
+			buffer = (buffer << bits) | (value & ((1ull << bits) - 1));
+			numBits += bits;
+			while (numBits >= 8) {
+				numBits -= 8;
+				out.push_back((uint8_t)(buffer >> numBits));
+			}
+		}
+
+		// Exp-Golomb code of order k
+		void WriteCode(uint64_t value, int k)
+		{
+			uint64_t shifted = (value >> k) + 1;
+			int length = 0;
+			while ((shifted >> length) > 1) length++;
+			Write(0, length);
+			Write(shifted, length + 1);
+			if (k) Write(value, k);
+		}
+
+		void Flush()
+		{
+			if (numBits) out.push_back((uint8_t)(buffer << (8 - numBits)));
+			numBits = 0;
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t *data;
+		const uint8_t *end;
+		int bitPos = 0; // within *data
+		bool isOverrun = false;
+
+		BitReader(const uint8_t *data, const uint8_t *end) : data(data), end(end) {}
+
+		uint64_t Read(int bits)
+		{
+			uint64_t value = 0;
+			while (bits-- > 0) {
+				if (data >= end) {
+					isOverrun = true;
+					return 0;
+				}
+				value = (value << 1) | ((*data >> (7 - bitPos)) & 1);
+				if (++bitPos == 8) {
+					bitPos = 0;
+					data++;
+				}
+			}
+			return value;
+		}
+
+		uint64_t ReadCode(int k)
+		{
+			int length = 0;
+			while (!isOverrun && Read(1) == 0) {
+				if (++length > 63) {
+					isOverrun = true;
+					return 0;
+				}
+			}
+			uint64_t shifted = (1ull << length) | Read(length);
+			return ((shifted - 1) << k) | (k ? Read(k) : 0);
+		}
+
+		// True if everything up to the padding of the last byte was consumed
+		bool IsAtEnd() const { return !isOverrun && (data == end || (data + 1 == end && bitPos > 0)); }
+	};
+
+	static void MatrixToQuaternion(const float m[3][4], float q[4])
+	{
+		float trace = m[0][0] + m[1][1] + m[2][2];
+		if (trace > 0) {
+			float s = 0.5f / sqrtf(trace + 1.f);
+			q[0] = 0.25f / s;
+			q[1] = (m[2][1] - m[1][2]) * s;
+			q[2] = (m[0][2] - m[2][0]) * s;
+			q[3] = (m[1][0] - m[0][1]) * s;
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+			float s = 2.f * sqrtf(1.f + m[0][0] - m[1][1] - m[2][2]);
+			q[0] = (m[2][1] - m[1][2]) / s;
+			q[1] = 0.25f * s;
+			q[2] = (m[0][1] + m[1][0]) / s;
+			q[3] = (m[0][2] + m[2][0]) / s;
+		}
+		else if (m[1][1] > m[2][2]) {
+			float s = 2.f * sqrtf(1.f + m[1][1] - m[0][0] - m[2][2]);
+			q[0] = (m[0][2] - m[2][0]) / s;
+			q[1] = (m[0][1] + m[1][0]) / s;
+			q[2] = 0.25f * s;
+			q[3] = (m[1][2] + m[2][1]) / s;
+		}
+		else {
+			float s = 2.f * sqrtf(1.f + m[2][2] - m[0][0] - m[1][1]);
+			q[0] = (m[1][0] - m[0][1]) / s;
+			q[1] = (m[0][2] + m[2][0]) / s;
+			q[2] = (m[1][2] + m[2][1]) / s;
+			q[3] = 0.25f * s;
+		}
+	}
+
+	static void QuaternionToMatrix(const float qIn[4], float m[3][4])
+	{
+		float length = sqrtf(qIn[0] * qIn[0] + qIn[1] * qIn[1] + qIn[2] * qIn[2] + qIn[3] * qIn[3]);
+		float inv = length ? 1.f / length : 1.f;
+		float w = qIn[0] * inv, x = qIn[1] * inv, y = qIn[2] * inv, z = qIn[3] * inv;
+
+		m[0][0] = 1 - 2 * (y * y + z * z); m[0][1] = 2 * (x * y - w * z); m[0][2] = 2 * (x * z + w * y);
+		m[1][0] = 2 * (x * y + w * z); m[1][1] = 1 - 2 * (x * x + z * z); m[1][2] = 2 * (y * z - w * x);
+		m[2][0] = 2 * (x * z - w * y); m[2][1] = 2 * (y * z + w * x); m[2][2] = 1 - 2 * (x * x + y * y);
+	}
+
+	static inline int64_t Quantize(float value, float unit) { return (int64_t)llroundf(value / unit); }
+
+	static void QuantizeDevice(const FileHeader &header, const DevicePose &pose, DeviceState &state, int64_t values[numDeviceValues])
+	{
+		float q[4];
+		MatrixToQuaternion(pose.matrix, q);
+		// q and -q are the same rotation. Pick the one closest to the last sample so the residuals stay small.
+		if (q[0] * state.quat[0] + q[1] * state.quat[1] + q[2] * state.quat[2] + q[3] * state.quat[3] < 0) {
+			for (int i = 0; i < 4; i++) q[i] = -q[i];
+		}
+		memcpy(state.quat, q, sizeof(q));
+
+		for (int i = 0; i < 3; i++) values[i] = Quantize(pose.matrix[i][3], header.positionUnit);
+		for (int i = 0; i < 4; i++) values[3 + i] = Quantize(q[i], header.rotationUnit);
+		for (int i = 0; i < 3; i++) values[7 + i] = Quantize(pose.velocity[i], header.velocityUnit);
+		for (int i = 0; i < 3; i++) values[10 + i] = Quantize(pose.angularVelocity[i], header.angularVelocityUnit);
+	}
+
+	static void DequantizeDevice(const FileHeader &header, const int64_t values[numDeviceValues], DevicePose &pose)
+	{
+		float q[4];
+		for (int i = 0; i < 4; i++) q[i] = values[3 + i] * header.rotationUnit;
+		QuaternionToMatrix(q, pose.matrix);
+		for (int i = 0; i < 3; i++) pose.matrix[i][3] = values[i] * header.positionUnit;
+		for (int i = 0; i < 3; i++) pose.velocity[i] = values[7 + i] * header.velocityUnit;
+		for (int i = 0; i < 3; i++) pose.angularVelocity[i] = values[10 + i] * header.angularVelocityUnit;
+	}
+
+	static inline int64_t Predict(const DeviceState &state, int index)
+	{
+		return index < numSecondOrderValues ? state.prev[index] + state.delta[index] : state.prev[index];
+	}
+
+	static inline void Advance(DeviceState &state, int index, int64_t value)
+	{
+		state.delta[index] = value - state.prev[index];
+		state.prev[index] = value;
+	}
+
+	FileHeader MakeFileHeader(uint32_t samplesPerBlock)
+	{
+		FileHeader header;
+		memcpy(header.magic, magic, sizeof(header.magic));
+		header.version = version;
+		header.headerSize = sizeof(FileHeader);
+		header.samplesPerBlock = samplesPerBlock;
+		header.positionUnit = 0.0005f;
+		header.rotationUnit = 1.f / 16384.f;
+		header.velocityUnit = 0.005f;
+		header.angularVelocityUnit = 0.005f;
+		return header;
+	}
+
+	void EncodeBlock(const FileHeader &header, const Sample *samples, uint32_t numSamples, std::vector<uint8_t> &out)
+	{
+		size_t blockStart = out.size();
+		out.resize(blockStart + sizeof(BlockHeader));
+
+		DeviceState states[kNumDevices];
+		ResetDeviceStates(states);
+		AdaptiveOrder timeOrder = {};
+
+		uint64_t firstTimestamp = numSamples ? samples[0].timestampNs : 0;
+		int64_t prevTime = 0, prevInterval = 0;
+
+		BitWriter writer(out);
+
+		for (uint32_t s = 0; s < numSamples; s++) {
+			const Sample &sample = samples[s];
+
+			int64_t time = (int64_t)((sample.timestampNs - firstTimestamp + 500) / 1000); // microseconds into the block
+			uint64_t timeResidual = ZigZag(time - (prevTime + prevInterval));
+			writer.WriteCode(timeResidual, timeOrder.Order());
+			timeOrder.Update(timeResidual);
+			prevInterval = time - prevTime;
+			prevTime = time;
+
+			for (int d = 0; d < kNumDevices; d++) {
+				const DevicePose &pose = sample.devices[d];
+				DeviceState &state = states[d];
+
+				bool stateChanged = !state.hasState || pose.flags != state.flags || pose.trackingResult != state.trackingResult;
+				writer.Write(stateChanged, 1);
+				if (stateChanged) {
+					writer.Write(pose.flags, 8);
+					writer.Write((uint32_t)pose.trackingResult, 32);
+					state.flags = pose.flags;
+					state.trackingResult = pose.trackingResult;
+					state.hasState = true;
+				}
+
+				if (!(pose.flags & kDeviceFlag_PoseValid)) continue;
+
+				int64_t values[numDeviceValues];
+				QuantizeDevice(header, pose, state, values);
+				for (int i = 0; i < numDeviceValues; i++) {
+					uint64_t residual = ZigZag(values[i] - Predict(state, i));
+					AdaptiveOrder &order = state.orders[s_valueGroup[i]];
+					writer.WriteCode(residual, order.Order());
+					order.Update(residual);
+					Advance(state, i, values[i]);
+				}
+			}
+		}
+		writer.Flush();
+
+		BlockHeader block;
+		block.payloadSize = (uint32_t)(out.size() - blockStart - sizeof(BlockHeader));
+		block.numSamples = numSamples;
+		block.firstTimestampNs = firstTimestamp;
+		memcpy(out.data() + blockStart, &block, sizeof(block));
+	}
+
+	bool DecodeBlock(const FileHeader &header, const BlockHeader &block, const uint8_t *payload, Sample *out)
+	{
+		BitReader reader(payload, payload + block.payloadSize);
+
+		DeviceState states[kNumDevices];
+		ResetDeviceStates(states);
+		AdaptiveOrder timeOrder = {};
+
+		int64_t prevTime = 0, prevInterval = 0;
+
+		for (uint32_t s = 0; s < block.numSamples; s++) {
+			Sample &sample = out[s];
+
+			uint64_t timeResidual = reader.ReadCode(timeOrder.Order());
+			timeOrder.Update(timeResidual);
+			int64_t time = prevTime + prevInterval + UnZigZag(timeResidual);
+			prevInterval = time - prevTime;
+			prevTime = time;
+			sample.timestampNs = block.firstTimestampNs + (uint64_t)time * 1000;
+
+			for (int d = 0; d < kNumDevices; d++) {
+				DevicePose &pose = sample.devices[d];
+				DeviceState &state = states[d];
+
+				if (reader.Read(1)) {
+					state.flags = (uint8_t)reader.Read(8);
+					state.trackingResult = (int32_t)(uint32_t)reader.Read(32);
+					state.hasState = true;
+				}
+
+				if (state.flags & kDeviceFlag_PoseValid) {
+					for (int i = 0; i < numDeviceValues; i++) {
+						AdaptiveOrder &order = state.orders[s_valueGroup[i]];
+						uint64_t residual = reader.ReadCode(order.Order());
+						order.Update(residual);
+						Advance(state, i, Predict(state, i) + UnZigZag(residual));
+					}
+				}
+
+				// Invalid poses repeat the last known values
+				DequantizeDevice(header, state.prev, pose);
+				pose.flags = state.flags;
+				pose.trackingResult = state.trackingResult;
+			}
+
+			if (reader.isOverrun) return false;
+		}
+
+		return reader.IsAtEnd();
+	}
+
+	bool ParseFileHeader(const uint8_t *data, size_t size, FileHeader &header, std::string &error)
+	{
+		if (size < sizeof(FileHeader)) {
+			error = "file too small";
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.headerSize < sizeof(FileHeader)) {
+			error = "not a version " + std::to_string(version) + " pose trace";
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadFile(const std::string &path, FileHeader &header, std::vector<Sample> &samples, std::string &error)
+	{
+		FILE *file = fopen(path.c_str(), "rb");
+		if (!file) {
+			error = "could not open " + path;
+			return false;
+		}
+
+		std::vector<uint8_t> data;
+		uint8_t buffer[1 << 16];
+		size_t numRead;
+		while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			data.insert(data.end(), buffer, buffer + numRead);
+		}
+		fclose(file);
+
+		if (!ParseFileHeader(data.data(), data.size(), header, error)) return false;
+
+		// A truncated final block (e.g. the game crashed mid-write) is ignored
+		size_t offset = header.headerSize;
+		while (offset + sizeof(BlockHeader) <= data.size()) {
+			BlockHeader block;
+			memcpy(&block, data.data() + offset, sizeof(block));
+			offset += sizeof(block);
+			if (offset + block.payloadSize > data.size()) break;
+
+			size_t first = samples.size();
+			samples.resize(first + block.numSamples);
+			if (!DecodeBlock(header, block, data.data() + offset, samples.data() + first)) {
+				error = "corrupt block at offset " + std::to_string(offset - sizeof(block));
+				return false;
+			}
+			offset += block.payloadSize;
+		}
+
+		return true;
+	}
+
+	void ToGameTransform(const float (&m)[3][4], float havokWorldScale, BlockCore::Transform &out)
+	{
+		BlockCore::Vector3 right = ToGameAxes(m[0][0], m[1][0], m[2][0]);
+		BlockCore::Vector3 forward = ToGameAxes(-m[0][2], -m[1][2], -m[2][2]);
+		BlockCore::Vector3 up = ToGameAxes(m[0][1], m[1][1], m[2][1]);
+
+		out.rot.data[0][0] = right.x; out.rot.data[1][0] = right.y; out.rot.data[2][0] = right.z;
+		out.rot.data[0][1] = forward.x; out.rot.data[1][1] = forward.y; out.rot.data[2][1] = forward.z;
+		out.rot.data[0][2] = up.x; out.rot.data[1][2] = up.y; out.rot.data[2][2] = up.z;
+		out.pos = ToGameAxes(m[0][3], m[1][3], m[2][3]) * (1.f / havokWorldScale);
+		out.scale = 1.f;
+	}
+
+	void FromGameTransform(const BlockCore::Transform &transform, float havokWorldScale, DevicePose &out)
+	{
+		// Inverse of ToGame is (x, y, z) -> (x, z, -y)
+		BlockCore::Vector3 right = BlockCore::RightVector(transform.rot);
+		BlockCore::Vector3 forward = BlockCore::ForwardVector(transform.rot);
+		BlockCore::Vector3 up = BlockCore::UpVector(transform.rot);
+		BlockCore::Vector3 pos = transform.pos * havokWorldScale;
+
+		float (&m)[3][4] = out.matrix;
+		m[0][0] = right.x; m[1][0] = right.z; m[2][0] = -right.y;
+		m[0][1] = up.x; m[1][1] = up.z; m[2][1] = -up.y;
+		m[0][2] = -forward.x; m[1][2] = -forward.z; m[2][2] = forward.y;
+		m[0][3] = pos.x; m[1][3] = pos.z; m[2][3] = -pos.y;
+	}
+}
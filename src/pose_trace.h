@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+
+
+// Binary pose trace format.
+//
+// A file is a FileHeader followed by independently decodable blocks. Each block is a BlockHeader and a bit-packed payload
+// of up to samplesPerBlock samples. Values are quantized to the units in the file header, then stored as residuals against
+// a prediction from the previous samples of the same block (linear extrapolation for position / rotation / time, previous
+// value for velocities). Residuals are written as exp-Golomb codes whose order adapts to the recent residual size, so a
+// steady device costs a few bits per value.
+namespace PoseTrace
+{
+	const char magic[4] = { 'D', 'W', 'B', 'P' };
+	const uint16_t version = 1;
+
+	enum Device
+	{
+		kDevice_Hmd = 0,
+		kDevice_RightHand,
+		kDevice_LeftHand,
+		kNumDevices
+	};
+
+	enum DeviceFlags : uint8_t
+	{
+		kDeviceFlag_Connected = 1 << 0,
+		kDeviceFlag_PoseValid = 1 << 1
+	};
+
+	// Mirrors vr::TrackedDevicePose_t
+	struct DevicePose
+	{
+		float matrix[3][4]; // device to absolute tracking
+		float velocity[3]; // m/s
+		float angularVelocity[3]; // rad/s
+		int32_t trackingResult;
+		uint8_t flags;
+	};
+
+	struct Sample
+	{
+		uint64_t timestampNs; // monotonic
+		DevicePose devices[kNumDevices];
+	};
+
+#pragma pack(push, 1)
+	struct FileHeader
+	{
+		char magic[4];
+		uint16_t version;
+		uint16_t headerSize;
+		uint32_t samplesPerBlock;
+		float positionUnit; // meters
+		float rotationUnit; // quaternion component
+		float velocityUnit; // m/s
+		float angularVelocityUnit; // rad/s
+	};
+
+	struct BlockHeader
+	{
+		uint32_t payloadSize;
+		uint32_t numSamples;
+		uint64_t firstTimestampNs;
+	};
+#pragma pack(pop)
+
+	// Number of quantized values per device: position xyz, rotation quaternion wxyz, velocity xyz, angular velocity xyz
+	const int numDeviceValues = 13;
+
+	FileHeader MakeFileHeader(uint32_t samplesPerBlock);
+
+	// Appends one block (header + payload) to out
+	void EncodeBlock(const FileHeader &header, const Sample *samples, uint32_t numSamples, std::vector<uint8_t> &out);
+
+	// Decodes a block payload. Returns false if the payload is malformed.
+	bool DecodeBlock(const FileHeader &header, const BlockHeader &block, const uint8_t *payload, Sample *out);
+
+	// Checks the file header at the start of data. Blocks start at header.headerSize.
+	bool ParseFileHeader(const uint8_t *data, size_t size, FileHeader &header, std::string &error);
+
+	// Reads and decodes the whole file. pose_trace_reader.h reads one in place instead.
+	bool ReadFile(const std::string &path, FileHeader &header, std::vector<Sample> &samples, std::string &error);
+
+	// OpenVR tracking space (meters, y up, -z forward) <-> game space (game units, z up, y forward).
+	// Device axes map the same way, so a controller's -z (where it points) becomes the wand's forward.
+	// The wand node's small angular offset from the controller is not modelled.
+	inline BlockCore::Vector3 ToGameAxes(float x, float y, float z) { return { x, -z, y }; }
+	inline BlockCore::Vector3 ToGameAxes(const float v[3]) { return ToGameAxes(v[0], v[1], v[2]); }
+	void ToGameTransform(const float (&matrix)[3][4], float havokWorldScale, BlockCore::Transform &out);
+	inline void ToGameTransform(const DevicePose &pose, float havokWorldScale, BlockCore::Transform &out) { ToGameTransform(pose.matrix, havokWorldScale, out); }
+	void FromGameTransform(const BlockCore::Transform &transform, float havokWorldScale, DevicePose &out);
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+
+#include "pose_trace_reader.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace PoseTrace
+{
+	bool MappedTrace::Map(const std::string &path, std::string &error)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			error = "could not open " + path;
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(FileHeader)) {
+			CloseHandle(file);
+			error = "file too small";
+			return false;
+		}
+
+		// The mapping keeps the file open
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) {
+			error = "could not map " + path;
+			return false;
+		}
+		void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view) {
+			CloseHandle(mapping);
+			error = "could not map " + path;
+			return false;
+		}
+		data = (const uint8_t *)view;
+		size = (size_t)fileSize.QuadPart;
+		mappingHandle = mapping;
+		return true;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			error = "could not open " + path;
+			return false;
+		}
+		struct stat status;
+		if (fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(FileHeader)) {
+			close(fd);
+			error = "file too small";
+			return false;
+		}
+
+		void *view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file open
+		if (view == MAP_FAILED) {
+			error = "could not map " + path;
+			return false;
+		}
+		data = (const uint8_t *)view;
+		size = (size_t)status.st_size;
+		return true;
+#endif
+	}
+
+	bool MappedTrace::Open(const std::string &path, std::string &error)
+	{
+		Close();
+		if (!Map(path, error)) return false;
+		if (!ParseFileHeader(data, size, header, error)) {
+			Close();
+			return false;
+		}
+
+		// Only the headers are read, the payloads stay on disk until a block is decoded
+		size_t offset = header.headerSize;
+		while (offset + sizeof(BlockHeader) <= size) {
+			BlockIndexEntry entry;
+			memcpy(&entry.header, data + offset, sizeof(entry.header));
+			offset += sizeof(entry.header);
+			if (offset + entry.header.payloadSize > size) break;
+
+			entry.payload = data + offset;
+			entry.firstSample = numSamples;
+			blocks.push_back(entry);
+			numSamples += entry.header.numSamples;
+			offset += entry.header.payloadSize;
+		}
+		return true;
+	}
+
+	void MappedTrace::Close()
+	{
+		if (data) {
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+			CloseHandle((HANDLE)mappingHandle);
+#else
+			munmap((void *)data, size);
+#endif
+		}
+		data = nullptr;
+		size = 0;
+		mappingHandle = nullptr;
+		blocks.clear();
+		numSamples = 0;
+	}
+
+	size_t MappedTrace::FindBlock(uint64_t timestampNs) const
+	{
+		auto after = std::upper_bound(blocks.begin(), blocks.end(), timestampNs, [](uint64_t t, const BlockIndexEntry &entry) {
+			return t < entry.header.firstTimestampNs;
+		});
+		return after == blocks.begin() ? 0 : (size_t)(after - blocks.begin()) - 1;
+	}
+
+	bool MappedTrace::DecodeBlock(size_t block, std::vector<Sample> &out) const
+	{
+		const BlockIndexEntry &entry = blocks[block];
+		out.resize(entry.header.numSamples);
+		return PoseTrace::DecodeBlock(header, entry.header, entry.payload, out.data());
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pose_trace.h"
+
+
+// Reads a pose trace in place, through a read only mapping of the file. Opening it only walks the block headers, to index
+// where each block starts and which samples and times it holds. Every block is a keyframe (nothing in it is predicted from
+// the block before), so any run of blocks decodes on its own straight out of the mapping, and several threads can decode
+// different parts of the same file at once.
+namespace PoseTrace
+{
+	struct BlockIndexEntry
+	{
+		BlockHeader header;
+		const uint8_t *payload; // in the mapping
+		uint64_t firstSample; // index of the block's first sample in the whole trace
+	};
+
+	class MappedTrace
+	{
+	public:
+		MappedTrace() = default;
+		MappedTrace(const MappedTrace &) = delete;
+		MappedTrace & operator=(const MappedTrace &) = delete;
+		~MappedTrace() { Close(); }
+
+		// A truncated final block is left out of the index, like ReadFile does
+		bool Open(const std::string &path, std::string &error);
+		void Close();
+
+		const FileHeader & Header() const { return header; }
+		const std::vector<BlockIndexEntry> & Blocks() const { return blocks; }
+		uint64_t NumSamples() const { return numSamples; }
+
+		// The block holding the newest sample at or before timestampNs, or the first block if there is none
+		size_t FindBlock(uint64_t timestampNs) const;
+
+		// Decodes one block into out, which is resized to its samples. Returns false if the block is corrupt.
+		bool DecodeBlock(size_t block, std::vector<Sample> &out) const;
+
+	private:
+		bool Map(const std::string &path, std::string &error);
+
+		FileHeader header = {};
+		std::vector<BlockIndexEntry> blocks;
+		uint64_t numSamples = 0;
+		const uint8_t *data = nullptr;
+		size_t size = 0;
+		void *mappingHandle = nullptr; // Windows only, closed with the view
+	};
+}
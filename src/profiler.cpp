@@ -0,0 +1,124 @@
+#include <cstdio>
+
+#include "profiler.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+static inline int HighestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+int LatencyHistogram::BucketIndex(uint64_t ns)
+{
+	const uint64_t subBuckets = 1 << subBucketBits;
+	if (ns < subBuckets) return (int)ns; // small values get a bucket each
+
+	int bit = HighestBit(ns);
+	int sub = (int)((ns >> (bit - subBucketBits)) & (subBuckets - 1));
+	return ((bit - subBucketBits + 1) << subBucketBits) + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index)
+{
+	const int subBuckets = 1 << subBucketBits;
+	if (index < subBuckets) return (uint64_t)index;
+
+	int bit = (index >> subBucketBits) + subBucketBits - 1;
+	int sub = index & (subBuckets - 1);
+	uint64_t lower = ((uint64_t)(subBuckets + sub)) << (bit - subBucketBits);
+	uint64_t width = 1ull << (bit - subBucketBits);
+	return lower + width - 1;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const
+{
+	if (!count) return 0;
+
+	uint64_t target = (uint64_t)(fraction * (double)count);
+	if (target >= count) target = count - 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < numBuckets; i++) {
+		seen += buckets[i];
+		if (seen > target) {
+			uint64_t bound = BucketUpperBound(i);
+			return bound < max ? bound : max;
+		}
+	}
+	return max;
+}
+
+void LatencyHistogram::Add(const LatencyHistogram &other)
+{
+	for (int i = 0; i < numBuckets; i++) buckets[i] += other.buckets[i];
+	count += other.count;
+	if (other.max > max) max = other.max;
+}
+
+void LatencyHistogram::Reset()
+{
+	*this = LatencyHistogram();
+}
+
+const char * Profiler::StageName(Stage stage)
+{
+	switch (stage) {
+	case kStage_Update: return "update";
+	case kStage_Equipment: return "equipment";
+	case kStage_GraphQuery: return "graph query";
+	case kStage_Tests: return "tests";
+	case kStage_Notify: return "notify";
+	default: return "?";
+	}
+}
+
+const char * Profiler::EarlyOutName(EarlyOut reason)
+{
+	switch (reason) {
+	case kEarlyOut_None: return "evaluated";
+	case kEarlyOut_NoPlayer: return "no player";
+	case kEarlyOut_WeaponSheathed: return "weapon sheathed";
+	case kEarlyOut_MenuMode: return "menu mode";
+	case kEarlyOut_MissingNodes: return "missing nodes";
+	case kEarlyOut_NotDualWielding: return "not dual wielding";
+	case kEarlyOut_StaleHands: return "stale hands";
+	default: return "?";
+	}
+}
+
+void Profiler::Report(std::vector<std::string> &lines) const
+{
+	char line[160];
+	snprintf(line, sizeof(line), "%-12s %10s %10s %10s %10s", "stage", "count", "p50 us", "p99 us", "max us");
+	lines.push_back(line);
+
+	for (int i = 0; i < kNumStages; i++) {
+		const LatencyHistogram &histogram = stages[i];
+		snprintf(line, sizeof(line), "%-12s %10llu %10.2f %10.2f %10.2f", StageName((Stage)i), (unsigned long long)histogram.Count(),
+			histogram.Percentile(0.5) * 1e-3, histogram.Percentile(0.99) * 1e-3, histogram.Max() * 1e-3);
+		lines.push_back(line);
+	}
+
+	std::string frames = "frames:";
+	for (int i = 0; i < kNumEarlyOuts; i++) {
+		snprintf(line, sizeof(line), " %s %llu%s", EarlyOutName((EarlyOut)i), (unsigned long long)earlyOuts[i], i + 1 < kNumEarlyOuts ? "," : "");
+		frames += line;
+	}
+	lines.push_back(frames);
+}
+
+void Profiler::Reset()
+{
+	for (LatencyHistogram &histogram : stages) histogram.Reset();
+	for (uint64_t &count : earlyOuts) count = 0;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+
+
+// Log-bucketed latency histogram. Fixed size, recording is a couple of instructions and never allocates.
+// Each power of two is split into 4 buckets, so reported percentiles are within 25% of the true value.
+class LatencyHistogram
+{
+public:
+	static const int subBucketBits = 2;
+	static const int numBuckets = 64 << subBucketBits;
+
+	void Record(uint64_t ns)
+	{
+		buckets[BucketIndex(ns)]++;
+		count++;
+		if (ns > max) max = ns;
+	}
+
+	uint64_t Count() const { return count; }
+	uint64_t Max() const { return max; }
+
+	// Upper bound of the bucket holding the given fraction of samples, 0 if empty
+	uint64_t Percentile(double fraction) const;
+
+	void Add(const LatencyHistogram &other);
+	void Reset();
+
+	static int BucketIndex(uint64_t ns);
+	static uint64_t BucketUpperBound(int index);
+
+private:
+	uint32_t buckets[numBuckets] = {};
+	uint64_t count = 0;
+	uint64_t max = 0;
+};
+
+// Per-stage timings of the player update hook, plus why frames were skipped
+class Profiler
+{
+public:
+	enum Stage
+	{
+		kStage_Update = 0, // the whole hook
+		kStage_Equipment, // classifying what is in each hand
+		kStage_GraphQuery, // reading IsBlocking from the animation graph
+		kStage_Tests, // BlockCore::Update
+		kStage_Notify, // sending blockStart / blockStop to the animation graph
+		kNumStages
+	};
+
+	enum EarlyOut
+	{
+		kEarlyOut_None = 0,
+		kEarlyOut_NoPlayer, // no player or no 3d
+		kEarlyOut_WeaponSheathed,
+		kEarlyOut_MenuMode,
+		kEarlyOut_MissingNodes, // hmd or wand node missing
+		kEarlyOut_NotDualWielding,
+		kEarlyOut_StaleHands, // a controller has not been tracked for longer than MaxHandSampleAgeMs
+		kNumEarlyOuts
+	};
+
+	bool isEnabled = false;
+
+	void Record(Stage stage, uint64_t ns) { stages[stage].Record(ns); }
+	void CountEarlyOut(EarlyOut reason, uint64_t count = 1) { earlyOuts[reason] += count; }
+
+	const LatencyHistogram & GetStage(Stage stage) const { return stages[stage]; }
+	uint64_t GetEarlyOutCount(EarlyOut reason) const { return earlyOuts[reason]; }
+
+	// One line per stage with count, p50, p99 and max, then the early-out counts
+	void Report(std::vector<std::string> &lines) const;
+
+	void Reset();
+
+	static const char * StageName(Stage stage);
+	static const char * EarlyOutName(EarlyOut reason);
+
+private:
+	LatencyHistogram stages[kNumStages];
+	uint64_t earlyOuts[kNumEarlyOuts] = {};
+};
+
+// Times the enclosing scope into a stage. Costs nothing but a branch when the profiler is off.
+class ScopedProfile
+{
+public:
+	ScopedProfile(Profiler &profiler, Profiler::Stage stage) : profiler(profiler), stage(stage), startNs(profiler.isEnabled ? MonotonicNs() : 0) {}
+	~ScopedProfile() { if (startNs) profiler.Record(stage, MonotonicNs() - startNs); }
+
+private:
+	Profiler &profiler;
+	Profiler::Stage stage;
+	uint64_t startNs;
+};
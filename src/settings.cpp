@@ -0,0 +1,311 @@
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "settings.h"
+
+
+enum FieldType
+{
+	kField_Float = 0,
+	kField_Int,
+	kField_Bool
+};
+
+struct Field
+{
+	const char *section;
+	const char *key;
+	FieldType type;
+	void *value;
+	float min = 0; // bools and ints without a range leave these
+	float max = 0;
+	bool isSeen = false;
+};
+
+struct WeaponField
+{
+	const char *key;
+	float BlockCore::WeaponThresholds::*value;
+	float min;
+	float max;
+};
+
+static const float s_noMax = INFINITY;
+
+// The keys of [DualWield] and the weapon profile sections
+static const WeaponField s_weaponFields[] = {
+	{ "MaxSpeedEnter", &BlockCore::WeaponThresholds::maxSpeedEnter, 0, s_noMax },
+	{ "MaxSpeedExit", &BlockCore::WeaponThresholds::maxSpeedExit, 0, s_noMax },
+	{ "HandForwardDotWithHmdDownEnter", &BlockCore::WeaponThresholds::handForwardHmdDownEnter, -1, 1 },
+	{ "HandForwardDotWithHmdDownExit", &BlockCore::WeaponThresholds::handForwardHmdDownExit, -1, 1 },
+	{ "HandForwardDotWithHmdForwardEnter", &BlockCore::WeaponThresholds::handForwardHmdForwardEnter, -1, 1 },
+	{ "HandForwardDotWithHmdForwardExit", &BlockCore::WeaponThresholds::handForwardHmdForwardExit, -1, 1 },
+	{ "HmdToHandVerticalDistanceEnter", &BlockCore::WeaponThresholds::hmdToHandDistanceUpEnter, 0, s_noMax },
+	{ "HmdToHandVerticalDistanceExit", &BlockCore::WeaponThresholds::hmdToHandDistanceUpExit, 0, s_noMax },
+};
+static const int s_numWeaponFields = sizeof(s_weaponFields) / sizeof(s_weaponFields[0]);
+
+// A [DualWield.<Main>.<Off>] section, with a bit per weapon field it sets
+struct ProfileSection
+{
+	BlockCore::WeaponProfile profile;
+	uint32_t setFields;
+};
+
+static std::string Trim(const std::string &s)
+{
+	size_t begin = s.find_first_not_of(" \t\r");
+	if (begin == std::string::npos) return "";
+	size_t end = s.find_last_not_of(" \t\r");
+	return s.substr(begin, end - begin + 1);
+}
+
+// Like GetPrivateProfileString, section and key names ignore case
+static bool EqualsIgnoreCase(const std::string &a, const char *b)
+{
+	size_t i = 0;
+	for (; i < a.size() && b[i]; i++) {
+		char x = a[i], y = b[i];
+		if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+		if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+		if (x != y) return false;
+	}
+	return i == a.size() && !b[i];
+}
+
+static bool ParseFloat(const std::string &text, float &out)
+{
+	if (text.empty()) return false;
+	char *end;
+	float value = strtof(text.c_str(), &end);
+	if (*end || !std::isfinite(value)) return false;
+	out = value;
+	return true;
+}
+
+static bool ParseInt(const std::string &text, int &out)
+{
+	if (text.empty()) return false;
+	char *end;
+	long value = strtol(text.c_str(), &end, 10);
+	if (*end) return false;
+	out = (int)value;
+	return true;
+}
+
+// Checks value against field and stores it. Returns what is wrong with it, or nullptr.
+static const char * SetField(const Field &field, const std::string &value)
+{
+	switch (field.type) {
+	case kField_Float: {
+		float f;
+		if (!ParseFloat(value, f)) return "is not a number";
+		if (f < field.min || f > field.max) return "is out of range";
+		*(float *)field.value = f;
+		return nullptr;
+	}
+	case kField_Int: {
+		int i;
+		if (!ParseInt(value, i)) return "is not a whole number";
+		if (i < field.min || i > field.max) return "is out of range";
+		*(int *)field.value = i;
+		return nullptr;
+	}
+	default: {
+		if (value != "0" && value != "1") return "is not 0 or 1";
+		*(bool *)field.value = value == "1";
+		return nullptr;
+	}
+	}
+}
+
+bool ParseSettings(const std::string &text, Settings &settings, std::vector<std::string> &errors, std::vector<std::string> *missing)
+{
+	size_t numErrorsBefore = errors.size();
+	BlockCore::Config &config = settings.config;
+
+	Field fields[] = {
+		{ "Settings", "VanillaBlockingVelocityOverride", kField_Float, &settings.vanillaBlockingVelocityOverride, 0, s_noMax },
+		{ "Settings", "BlockCooldownMs", kField_Float, &config.blockCooldownMs, 0, 10000 },
+		{ "Settings", "NotifyTimeoutMs", kField_Float, &config.notifyTimeoutMs, 0, 10000 },
+		{ "Settings", "IsBlockingDebounceMs", kField_Float, &config.isBlockingDebounceMs, 0, 1000 }, // 0 turns the vote off
+		{ "Settings", "IsBlockingFromGraphEvents", kField_Bool, &settings.isBlockingFromGraphEvents },
+		{ "Settings", "IsBlockingPollIntervalMs", kField_Float, &settings.isBlockingPollIntervalMs, 0, 10000 },
+		{ "Settings", "PredictionLookaheadMs", kField_Float, &config.predictionLookaheadMs, 0, 200 },
+		{ "Settings", "SpeedFilterMinCutoffHz", kField_Float, &config.speedFilter.minCutoffHz, 0, 1000 },
+		{ "Settings", "SpeedFilterBeta", kField_Float, &config.speedFilter.beta, 0, s_noMax },
+		{ "Settings", "RotationFilterMinCutoffHz", kField_Float, &config.rotationFilter.minCutoffHz, 0, 1000 },
+		{ "Settings", "RotationFilterBeta", kField_Float, &config.rotationFilter.beta, 0, s_noMax },
+		{ "Settings", "MaxHandSampleAgeMs", kField_Float, &settings.maxHandSampleAgeMs, 0, 10000 },
+		{ "Settings", "ClassifyOnPoseThread", kField_Bool, &settings.classifyOnPoseThread },
+		{ "Settings", "ProfilerDumpIntervalSeconds", kField_Float, &settings.profilerDumpIntervalSeconds, 0, s_noMax },
+		{ "Settings", "LatencyReportIntervalSeconds", kField_Float, &settings.latencyReportIntervalSeconds, 0, s_noMax },
+		{ "Settings", "EnableTelemetry", kField_Bool, &settings.isTelemetryEnabled },
+		{ "Settings", "LogLevel", kField_Int, &settings.logLevel, 0, 3 },
+		{ "Settings", "RecordPoses", kField_Bool, &settings.recordPoses },
+		{ "Settings", "ReloadOnChange", kField_Bool, &settings.isReloadOnChangeEnabled },
+		{ "DualWield", "EnableShield", kField_Bool, &config.isShieldEnabled },
+		{ "Unarmed", "MaxSpeedEnter", kField_Float, &config.unarmed.maxSpeedEnter, 0, s_noMax },
+		{ "Unarmed", "MaxSpeedExit", kField_Float, &config.unarmed.maxSpeedExit, 0, s_noMax },
+		{ "Unarmed", "HandForwardDotWithHmdRightEnter", kField_Float, &config.unarmed.handForwardHmdRightEnter, -1, 1 },
+		{ "Unarmed", "HandForwardDotWithHmdRightExit", kField_Float, &config.unarmed.handForwardHmdRightExit, -1, 1 },
+		{ "Unarmed", "HmdToHandVerticalDistanceEnter", kField_Float, &config.unarmed.hmdToHandDistanceUpEnter, 0, s_noMax },
+		{ "Unarmed", "HmdToHandVerticalDistanceExit", kField_Float, &config.unarmed.hmdToHandDistanceUpExit, 0, s_noMax },
+		{ "CrossGuard", "Enable", kField_Bool, &config.isCrossGuardEnabled },
+		{ "CrossGuard", "BladeLength", kField_Float, &config.crossGuard.bladeLength, 0.05f, 3 },
+		{ "CrossGuard", "MaxSpeedEnter", kField_Float, &config.crossGuard.maxSpeedEnter, 0, s_noMax },
+		{ "CrossGuard", "MaxSpeedExit", kField_Float, &config.crossGuard.maxSpeedExit, 0, s_noMax },
+		{ "CrossGuard", "MaxBladeDistanceEnter", kField_Float, &config.crossGuard.maxBladeDistanceEnter, 0, s_noMax },
+		{ "CrossGuard", "MaxBladeDistanceExit", kField_Float, &config.crossGuard.maxBladeDistanceExit, 0, s_noMax },
+		{ "CrossGuard", "BladeDotEnter", kField_Float, &config.crossGuard.bladeDotEnter, 0, 1 },
+		{ "CrossGuard", "BladeDotExit", kField_Float, &config.crossGuard.bladeDotExit, 0, 1 },
+		{ "CrossGuard", "InFrontOfHmdEnter", kField_Float, &config.crossGuard.minForwardDistanceEnter, -s_noMax, s_noMax },
+		{ "CrossGuard", "InFrontOfHmdExit", kField_Float, &config.crossGuard.minForwardDistanceExit, -s_noMax, s_noMax },
+		{ "CrossGuard", "HmdToCrossingVerticalDistanceEnter", kField_Float, &config.crossGuard.maxVerticalDistanceEnter, 0, s_noMax },
+		{ "CrossGuard", "HmdToCrossingVerticalDistanceExit", kField_Float, &config.crossGuard.maxVerticalDistanceExit, 0, s_noMax },
+		{ "Parry", "WindowMs", kField_Float, &settings.parryWindowMs, 0, 1000 },
+	};
+	bool isWeaponFieldSeen[s_numWeaponFields] = {};
+	bool isProfileFieldSeen[s_numWeaponFields] = {}; // in the current profile section
+
+	static const std::string profilePrefix = "DualWield.";
+	std::vector<ProfileSection> profiles;
+
+	enum SectionKind { kSection_None, kSection_Plain, kSection_DualWield, kSection_Profile, kSection_Unknown };
+	SectionKind sectionKind = kSection_None;
+	std::string section;
+
+	std::istringstream stream(text);
+	std::string line;
+	for (int lineNumber = 1; std::getline(stream, line); lineNumber++) {
+		if (lineNumber == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3);
+		std::string trimmed = Trim(line);
+		if (trimmed.empty() || trimmed[0] == '#' || trimmed[0] == ';') continue;
+
+		auto report = [&](const std::string &message) {
+			errors.push_back("line " + std::to_string(lineNumber) + ": " + message);
+		};
+
+		if (trimmed[0] == '[') {
+			size_t close = trimmed.find(']');
+			section = Trim(trimmed.substr(1, close == std::string::npos ? std::string::npos : close - 1));
+			if (EqualsIgnoreCase(section, "DualWield")) {
+				sectionKind = kSection_DualWield;
+			}
+			else if (EqualsIgnoreCase(section, "Settings") || EqualsIgnoreCase(section, "Unarmed") || EqualsIgnoreCase(section, "CrossGuard") || EqualsIgnoreCase(section, "Parry")) {
+				sectionKind = kSection_Plain;
+			}
+			else if (EqualsIgnoreCase(section.substr(0, profilePrefix.size()), profilePrefix.c_str())) {
+				ProfileSection profile = {};
+				size_t dot = section.find('.', profilePrefix.size());
+				if (dot != std::string::npos &&
+					BlockCore::ParseWeaponType(section.substr(profilePrefix.size(), dot - profilePrefix.size()).c_str(), profile.profile.mainWeapon) &&
+					BlockCore::ParseWeaponType(section.substr(dot + 1).c_str(), profile.profile.offWeapon)) {
+					profiles.push_back(profile);
+					sectionKind = kSection_Profile;
+					for (bool &isSeen : isProfileFieldSeen) isSeen = false;
+				}
+				else {
+					report("[" + section + "] is not DualWield.<weapon type>.<weapon type>");
+					sectionKind = kSection_Unknown;
+				}
+			}
+			else {
+				report("unknown section [" + section + "]");
+				sectionKind = kSection_Unknown;
+			}
+			continue;
+		}
+
+		size_t equals = trimmed.find('=');
+		if (equals == std::string::npos) {
+			report("expected key = value");
+			continue;
+		}
+		std::string key = Trim(trimmed.substr(0, equals));
+		std::string value = Trim(trimmed.substr(equals + 1));
+		if (sectionKind == kSection_Unknown) continue; // already reported
+		if (sectionKind == kSection_None) {
+			report(key + " is not in a section");
+			continue;
+		}
+
+		// The weapon thresholds, in [DualWield] and the profiles
+		bool isFound = false;
+		if (sectionKind == kSection_DualWield || sectionKind == kSection_Profile) {
+			for (int i = 0; i < s_numWeaponFields && !isFound; i++) {
+				const WeaponField &weaponField = s_weaponFields[i];
+				if (!EqualsIgnoreCase(key, weaponField.key)) continue;
+				isFound = true;
+
+				bool isProfile = sectionKind == kSection_Profile;
+				BlockCore::WeaponThresholds &thresholds = isProfile ? profiles.back().profile.thresholds : config.dualWield;
+				bool &isSeen = isProfile ? isProfileFieldSeen[i] : isWeaponFieldSeen[i];
+				Field field = { nullptr, weaponField.key, kField_Float, &(thresholds.*weaponField.value), weaponField.min, weaponField.max };
+				if (isSeen) {
+					report("[" + section + "] " + weaponField.key + " is set twice, the first one is used");
+				}
+				else if (const char *problem = SetField(field, value)) {
+					report("[" + section + "] " + weaponField.key + " " + problem);
+				}
+				else if (isProfile) {
+					profiles.back().setFields |= 1u << i;
+				}
+				isSeen = true;
+			}
+		}
+		if (sectionKind == kSection_DualWield || sectionKind == kSection_Plain) {
+			for (Field &field : fields) {
+				if (isFound || !EqualsIgnoreCase(section, field.section) || !EqualsIgnoreCase(key, field.key)) continue;
+				isFound = true;
+
+				if (field.isSeen) {
+					report("[" + section + "] " + field.key + " is set twice, the first one is used");
+				}
+				else if (const char *problem = SetField(field, value)) {
+					report("[" + section + "] " + field.key + " " + problem);
+				}
+				field.isSeen = true;
+			}
+		}
+		if (!isFound) {
+			report("unknown key " + key + " in [" + section + "]");
+		}
+	}
+
+	if (missing) {
+		for (const Field &field : fields) {
+			if (!field.isSeen) missing->push_back(std::string("[") + field.section + "] " + field.key);
+		}
+		for (int i = 0; i < s_numWeaponFields; i++) {
+			if (!isWeaponFieldSeen[i]) missing->push_back(std::string("[DualWield] ") + s_weaponFields[i].key);
+		}
+	}
+
+	// Profiles start from [DualWield], wherever it is in the file
+	std::vector<BlockCore::WeaponProfile> flatProfiles;
+	for (ProfileSection &profile : profiles) {
+		for (int i = 0; i < s_numWeaponFields; i++) {
+			if (!(profile.setFields & (1u << i))) profile.profile.thresholds.*s_weaponFields[i].value = config.dualWield.*s_weaponFields[i].value;
+		}
+		flatProfiles.push_back(profile.profile);
+	}
+	BlockCore::BuildWeaponProfiles(config, flatProfiles.data(), (int)flatProfiles.size());
+
+	return errors.size() == numErrorsBefore;
+}
+
+bool LoadSettings(const std::string &path, Settings &settings, std::vector<std::string> &errors, std::vector<std::string> *missing)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		errors.push_back("could not open " + path);
+		return false;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+	return ParseSettings(text.str(), settings, errors, missing);
+}
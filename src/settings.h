@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+
+
+// Everything DualWieldBlockVR.ini sets, read in one pass over the file.
+// Every value is checked (a number, in range, 0 / 1 for switches). A bad value keeps its default and is reported, so a
+// typo never takes the rest of the file down with it.
+struct Settings
+{
+	BlockCore::Config config; // weaponProfiles already built
+
+	float vanillaBlockingVelocityOverride = 0.4f; // 0.4f is the game's default
+	bool recordPoses = false;
+	bool classifyOnPoseThread = false;
+	float profilerDumpIntervalSeconds = 0;
+	float latencyReportIntervalSeconds = 0;
+	bool isTelemetryEnabled = false;
+	int logLevel = 2;
+	bool isBlockingFromGraphEvents = false;
+	float isBlockingPollIntervalMs = 100;
+	float maxHandSampleAgeMs = 100; // 0 disables the check
+	bool isReloadOnChangeEnabled = true;
+	float parryWindowMs = 0; // 0 disables parries
+};
+
+// Parses the text of the ini. Returns false if anything was reported in errors, one short line per problem.
+// Keys that are not in the file keep their defaults and are listed in missing, which is not an error (older ini files).
+bool ParseSettings(const std::string &text, Settings &settings, std::vector<std::string> &errors, std::vector<std::string> *missing = nullptr);
+
+// The same from a file. Returns false with a single error if the file could not be read.
+bool LoadSettings(const std::string &path, Settings &settings, std::vector<std::string> &errors, std::vector<std::string> *missing = nullptr);
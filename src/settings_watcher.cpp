@@ -0,0 +1,82 @@
+#include <chrono>
+#include <filesystem>
+
+#include "settings_watcher.h"
+
+
+SettingsWatcher::~SettingsWatcher()
+{
+	// Same as the pose recorder: joining from a static destructor can deadlock on the loader lock at process exit
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopRequested = true;
+		}
+		wake.notify_one();
+		thread.detach();
+		return;
+	}
+	delete pending.exchange(nullptr);
+}
+
+bool SettingsWatcher::Start(const std::string &newPath, uint32_t newPollIntervalMs)
+{
+	if (IsWatching() || newPath.empty()) return false;
+
+	path = newPath;
+	pollIntervalMs = newPollIntervalMs ? newPollIntervalMs : 1;
+	stopRequested = false;
+	thread = std::thread(&SettingsWatcher::WatcherThread, this);
+	return true;
+}
+
+void SettingsWatcher::Stop()
+{
+	if (!IsWatching()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopRequested = true;
+	}
+	wake.notify_one();
+	thread.join();
+	delete pending.exchange(nullptr);
+}
+
+SettingsWatcher::Stamp SettingsWatcher::ReadStamp() const
+{
+	// The error_code overloads, a file that is briefly missing while an editor replaces it is not an exception
+	std::error_code error;
+	Stamp stamp;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	if (error) return stamp;
+	uintmax_t size = std::filesystem::file_size(path, error);
+	if (error) return stamp;
+
+	stamp.writeTime = (int64_t)writeTime.time_since_epoch().count();
+	stamp.size = (uint64_t)size;
+	stamp.isValid = true;
+	return stamp;
+}
+
+void SettingsWatcher::WatcherThread()
+{
+	Stamp loaded = ReadStamp(); // what the caller already has
+	Stamp seen = loaded;
+
+	std::unique_lock<std::mutex> lock(wakeMutex);
+	while (!wake.wait_for(lock, std::chrono::milliseconds(pollIntervalMs), [this]() { return stopRequested; })) {
+		Stamp stamp = ReadStamp();
+		bool isSettled = stamp == seen;
+		seen = stamp;
+		if (!stamp.isValid || stamp == loaded || !isSettled) continue;
+
+		loaded = stamp;
+		Reload *reload = new Reload;
+		LoadSettings(path, reload->settings, reload->errors);
+
+		// A reload the game thread never took is out of date now
+		delete pending.exchange(reload, std::memory_order_release);
+		numReloads.fetch_add(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "settings.h"
+
+
+// Loads the ini again whenever it changes, so settings can be tuned while the game runs.
+// A background thread polls the file's size and modification time, and parses it once they have held still for a poll
+// (editors often write a file in more than one go). The result is handed over through a single atomic pointer; the game
+// thread takes it between frames and swaps the whole config at once, so no frame sees half of an edit.
+class SettingsWatcher
+{
+public:
+	struct Reload
+	{
+		Settings settings;
+		std::vector<std::string> errors; // the reload should only be applied if this is empty
+	};
+
+	~SettingsWatcher();
+
+	// The file is expected to be loaded already, only changes after this are reported
+	bool Start(const std::string &path, uint32_t pollIntervalMs = 250);
+	void Stop();
+
+	bool IsWatching() const { return thread.joinable(); }
+
+	// The newest reload since the last call, or nullptr. One thread at a time.
+	std::unique_ptr<Reload> Take() { return std::unique_ptr<Reload>(pending.exchange(nullptr, std::memory_order_acquire)); }
+
+	uint32_t NumReloads() const { return numReloads.load(std::memory_order_relaxed); }
+
+private:
+	struct Stamp
+	{
+		int64_t writeTime = 0;
+		uint64_t size = 0;
+		bool isValid = false;
+
+		bool operator==(const Stamp &other) const { return writeTime == other.writeTime && size == other.size && isValid == other.isValid; }
+		bool operator!=(const Stamp &other) const { return !(*this == other); }
+	};
+
+	Stamp ReadStamp() const;
+	void WatcherThread();
+
+	std::string path;
+	uint32_t pollIntervalMs = 250;
+	std::thread thread;
+
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	bool stopRequested = false;
+
+	std::atomic<Reload *> pending = nullptr;
+	std::atomic<uint32_t> numReloads = 0;
+};
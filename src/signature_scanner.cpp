@@ -0,0 +1,492 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "signature_scanner.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIGNATURE_SCANNER_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+namespace SignatureScanner
+{
+	static int HexDigit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	// Rough rank of how often a byte turns up in x64 code and data, lower is rarer. Filtering on a rare byte means
+	// fewer candidates get compared in full.
+	static int Commonness(uint8_t byte)
+	{
+		switch (byte) {
+		case 0x00: return 4;
+		case 0xFF: case 0xCC: case 0x48: return 3;
+		case 0x8B: case 0x89: case 0x0F: case 0x4C: case 0x24: case 0x44: return 2;
+		case 0x01: case 0x83: case 0x8D: case 0xE8: case 0x20: case 0x40: return 1;
+		default: return 0;
+		}
+	}
+
+	static bool ChooseFilterBytes(Pattern &pattern)
+	{
+		const size_t none = pattern.bytes.size();
+		size_t first = none, second = none;
+		for (size_t i = 0; i < pattern.bytes.size(); i++) {
+			if (!pattern.mask[i]) continue;
+			if (first == none || Commonness(pattern.bytes[i]) < Commonness(pattern.bytes[first])) first = i;
+		}
+		if (first == none) return false;
+		for (size_t i = 0; i < pattern.bytes.size(); i++) {
+			if (!pattern.mask[i] || i == first) continue;
+			if (second == none || Commonness(pattern.bytes[i]) < Commonness(pattern.bytes[second])) second = i;
+		}
+		pattern.first = first;
+		pattern.second = second == none ? first : second;
+		return true;
+	}
+
+	bool ParsePattern(const char *text, Pattern &out)
+	{
+		out = Pattern();
+		std::istringstream tokens(text ? text : "");
+		std::string token;
+		while (tokens >> token) {
+			if (token == "?" || token == "??") {
+				out.bytes.push_back(0);
+				out.mask.push_back(0);
+				continue;
+			}
+			if (token.size() != 2 || HexDigit(token[0]) < 0 || HexDigit(token[1]) < 0) return false;
+			out.bytes.push_back((uint8_t)(HexDigit(token[0]) * 16 + HexDigit(token[1])));
+			out.mask.push_back(0xFF);
+		}
+		return ChooseFilterBytes(out);
+	}
+
+	Pattern LiteralPattern(const void *bytes, size_t size)
+	{
+		Pattern pattern;
+		pattern.bytes.assign((const uint8_t *)bytes, (const uint8_t *)bytes + size);
+		pattern.mask.assign(size, 0xFF);
+		ChooseFilterBytes(pattern);
+		return pattern;
+	}
+
+	bool Matches(const uint8_t *at, const Pattern &pattern)
+	{
+		for (size_t i = 0; i < pattern.bytes.size(); i++) {
+			if ((at[i] ^ pattern.bytes[i]) & pattern.mask[i]) return false;
+		}
+		return true;
+	}
+
+	const uint8_t * FindScalar(const uint8_t *begin, const uint8_t *end, const Pattern &pattern)
+	{
+		size_t size = pattern.bytes.size();
+		if (!size || end < begin || (size_t)(end - begin) < size) return nullptr;
+
+		const uint8_t first = pattern.bytes[pattern.first];
+		for (const uint8_t *at = begin, *last = end - size; at <= last; at++) {
+			if (at[pattern.first] == first && Matches(at, pattern)) return at;
+		}
+		return nullptr;
+	}
+
+#ifdef SIGNATURE_SCANNER_SSE2
+	static inline int LowestBit(unsigned bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, bits);
+		return (int)index;
+#else
+		return __builtin_ctz(bits);
+#endif
+	}
+
+	const uint8_t * Find(const uint8_t *begin, const uint8_t *end, const Pattern &pattern)
+	{
+		size_t size = pattern.bytes.size();
+		if (!size || end < begin || (size_t)(end - begin) < size) return nullptr;
+
+		// Every 16 starting positions at once: both filter bytes have to be there before the rest is compared
+		const __m128i first = _mm_set1_epi8((char)pattern.bytes[pattern.first]);
+		const __m128i second = _mm_set1_epi8((char)pattern.bytes[pattern.second]);
+		const uint8_t *last = end - size;
+		const uint8_t *at = begin;
+		for (; last - at >= 15; at += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(at + pattern.first));
+			__m128i b = _mm_loadu_si128((const __m128i *)(at + pattern.second));
+			unsigned bits = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second)));
+			while (bits) {
+				const uint8_t *candidate = at + LowestBit(bits);
+				if (Matches(candidate, pattern)) return candidate;
+				bits &= bits - 1;
+			}
+		}
+		return FindScalar(at, end, pattern);
+	}
+
+	bool IsFindVectorized() { return true; }
+#else
+	const uint8_t * Find(const uint8_t *begin, const uint8_t *end, const Pattern &pattern)
+	{
+		return FindScalar(begin, end, pattern);
+	}
+
+	bool IsFindVectorized() { return false; }
+#endif
+
+	// Image access
+
+	static uint16_t Read16(const uint8_t *at) { uint16_t value; memcpy(&value, at, sizeof(value)); return value; }
+	static uint32_t Read32(const uint8_t *at) { uint32_t value; memcpy(&value, at, sizeof(value)); return value; }
+	static uint64_t Read64(const uint8_t *at) { uint64_t value; memcpy(&value, at, sizeof(value)); return value; }
+
+	bool ReadImage(const uint8_t *base, uint64_t address, Image &out)
+	{
+		out = Image();
+		if (!base || base[0] != 'M' || base[1] != 'Z') return false;
+
+		uint32_t peOffset = Read32(base + 0x3C); // IMAGE_DOS_HEADER::e_lfanew
+		if (peOffset < 0x40 || peOffset > 0x1000) return false;
+		const uint8_t *pe = base + peOffset;
+		if (memcmp(pe, "PE\0\0", 4) != 0) return false;
+
+		// IMAGE_FILE_HEADER, then IMAGE_OPTIONAL_HEADER64
+		const uint8_t *fileHeader = pe + 4;
+		uint16_t numSections = Read16(fileHeader + 2);
+		uint16_t optionalHeaderSize = Read16(fileHeader + 16);
+		const uint8_t *optionalHeader = fileHeader + 20;
+		if (optionalHeaderSize < 64 || Read16(optionalHeader) != 0x20B) return false;
+		uint32_t sizeOfImage = Read32(optionalHeader + 56);
+		uint32_t sizeOfHeaders = Read32(optionalHeader + 60);
+		const uint8_t *sectionHeaders = optionalHeader + optionalHeaderSize;
+		if (sizeOfHeaders > sizeOfImage || sectionHeaders + numSections * 40 > base + sizeOfHeaders) return false;
+
+		out.base = base;
+		out.size = sizeOfImage;
+		out.address = address;
+
+		uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+		for (uint32_t i = 0; i < sizeOfHeaders; i++) {
+			hash = (hash ^ base[i]) * 0x100000001b3ull;
+		}
+		out.hash = hash;
+
+		for (int i = 0; i < numSections; i++) {
+			const uint8_t *header = sectionHeaders + i * 40; // IMAGE_SECTION_HEADER
+			Section section;
+			memcpy(section.name, header, 8);
+			section.name[8] = 0;
+			uint32_t virtualSize = Read32(header + 8);
+			section.rva = Read32(header + 12);
+			uint32_t rawSize = Read32(header + 16);
+			section.isExecutable = (Read32(header + 36) & 0x20000000) != 0; // IMAGE_SCN_MEM_EXECUTE
+			if (section.rva >= sizeOfImage) continue;
+			section.size = virtualSize ? virtualSize : rawSize;
+			if (section.size > sizeOfImage - section.rva) section.size = sizeOfImage - section.rva;
+			out.sections.push_back(section);
+		}
+		return true;
+	}
+
+	// nullptr unless [rva, rva + size) is inside the image
+	static const uint8_t * At(const Image &image, uint64_t rva, size_t size)
+	{
+		if (rva > image.size || size > image.size - rva) return nullptr;
+		return image.base + rva;
+	}
+
+	static bool PointerToRva(const Image &image, uint64_t pointer, uint32_t &rva)
+	{
+		if (pointer < image.address || pointer - image.address >= image.size) return false;
+		rva = (uint32_t)(pointer - image.address);
+		return true;
+	}
+
+	static bool IsStringAt(const Image &image, uint64_t rva, const char *text)
+	{
+		size_t size = strlen(text) + 1;
+		const uint8_t *at = At(image, rva, size);
+		return at && memcmp(at, text, size) == 0;
+	}
+
+	// Calls found(rva) for every match in the executable or the other sections, in order, until it returns true
+	template <typename Found>
+	static bool ForEachMatch(const Image &image, const Pattern &pattern, bool isExecutable, Found found)
+	{
+		for (const Section &section : image.sections) {
+			if (section.isExecutable != isExecutable) continue;
+			const uint8_t *begin = image.base + section.rva;
+			const uint8_t *end = begin + section.size;
+			for (const uint8_t *match = Find(begin, end, pattern); match; match = Find(match + 1, end, pattern)) {
+				if (found((uint32_t)(match - image.base))) return true;
+			}
+		}
+		return false;
+	}
+
+	// The same for every aligned pointer to rva outside the code
+	template <typename Found>
+	static bool ForEachPointerTo(const Image &image, uint32_t rva, Found found)
+	{
+		uint64_t pointer = image.address + rva;
+		return ForEachMatch(image, LiteralPattern(&pointer, sizeof(pointer)), false, [&](uint32_t at) {
+			return at % sizeof(pointer) == 0 && found(at);
+		});
+	}
+
+	// Game settings: class Setting { vtable; Data data; const char *name; }. Ini settings have the section after the name
+	// ("fName:Section"), game settings just the name.
+	static const uint32_t settingDataOffset = 0x08;
+	static const uint32_t settingNameOffset = 0x10;
+
+	static bool IsSettingNameAt(const Image &image, uint64_t rva, const char *name)
+	{
+		size_t length = strlen(name);
+		const uint8_t *at = At(image, rva, length + 1);
+		return at && memcmp(at, name, length) == 0 && (at[length] == 0 || at[length] == ':');
+	}
+
+	static bool VerifyGameSetting(const Image &image, const char *name, uint32_t settingRva)
+	{
+		const uint8_t *setting = At(image, settingRva, settingNameOffset + 8);
+		uint32_t vtableRva, nameRva;
+		return setting && PointerToRva(image, Read64(setting), vtableRva) &&
+			PointerToRva(image, Read64(setting + settingNameOffset), nameRva) && IsSettingNameAt(image, nameRva, name);
+	}
+
+	static bool FindGameSetting(const Image &image, const char *name, uint32_t &settingRva)
+	{
+		return ForEachMatch(image, LiteralPattern(name, strlen(name)), false, [&](uint32_t nameRva) {
+			// Not the tail or the start of a longer name
+			if ((nameRva && image.base[nameRva - 1] != 0) || !IsSettingNameAt(image, nameRva, name)) return false;
+			return ForEachPointerTo(image, nameRva, [&](uint32_t at) {
+				if (at < settingNameOffset || !VerifyGameSetting(image, name, at - settingNameOffset)) return false;
+				settingRva = at - settingNameOffset;
+				return true;
+			});
+		});
+	}
+
+	// MSVC x64 RTTI:
+	//   TypeDescriptor          { void *vtable; void *spare; char name[]; }
+	//   CompleteObjectLocator   { uint32 signature (1); uint32 offset; uint32 cdOffset; uint32 typeDescriptor;
+	//                             uint32 classDescriptor; uint32 self; } all RVAs
+	// and the locator pointer sits right before the vtable. offset is 0 for the primary vtable.
+	static const uint32_t typeDescriptorNameOffset = 0x10;
+	static const uint32_t locatorSize = 24;
+
+	static bool VerifyLocator(const Image &image, const char *rttiName, uint32_t locatorRva)
+	{
+		const uint8_t *locator = At(image, locatorRva, locatorSize);
+		return locator && Read32(locator) == 1 && Read32(locator + 4) == 0 && Read32(locator + 20) == locatorRva &&
+			IsStringAt(image, (uint64_t)Read32(locator + 12) + typeDescriptorNameOffset, rttiName);
+	}
+
+	static bool VerifyVtable(const Image &image, const char *rttiName, uint32_t vtableRva)
+	{
+		const uint8_t *locatorPointer = vtableRva >= 8 ? At(image, vtableRva - 8, 8) : nullptr;
+		uint32_t locatorRva;
+		return locatorPointer && PointerToRva(image, Read64(locatorPointer), locatorRva) && VerifyLocator(image, rttiName, locatorRva);
+	}
+
+	static bool FindVtable(const Image &image, const char *rttiName, uint32_t &vtableRva)
+	{
+		return ForEachMatch(image, LiteralPattern(rttiName, strlen(rttiName) + 1), false, [&](uint32_t nameRva) {
+			if (nameRva < typeDescriptorNameOffset) return false;
+			uint32_t typeDescriptorRva = nameRva - typeDescriptorNameOffset;
+
+			uint8_t locator[16] = { 1, 0, 0, 0, 0, 0, 0, 0 };
+			memcpy(locator + 12, &typeDescriptorRva, 4);
+			Pattern pattern = LiteralPattern(locator, sizeof(locator));
+			for (int i = 8; i < 12; i++) pattern.mask[i] = 0; // cdOffset
+			ChooseFilterBytes(pattern);
+
+			return ForEachMatch(image, pattern, false, [&](uint32_t locatorRva) {
+				if (locatorRva % 4 != 0 || !VerifyLocator(image, rttiName, locatorRva)) return false;
+				return ForEachPointerTo(image, locatorRva, [&](uint32_t at) {
+					if (!VerifyVtable(image, rttiName, at + 8)) return false;
+					vtableRva = at + 8;
+					return true;
+				});
+			});
+		});
+	}
+
+	static bool IsInExecutableSection(const Image &image, uint32_t rva, size_t size)
+	{
+		for (const Section &section : image.sections) {
+			if (section.isExecutable && rva >= section.rva && size <= section.size && rva - section.rva <= section.size - size) return true;
+		}
+		return false;
+	}
+
+	static bool FindCode(const Image &image, const Pattern &pattern, uint32_t &matchRva)
+	{
+		// A pattern that matches twice cannot tell which one is meant
+		int numMatches = 0;
+		ForEachMatch(image, pattern, true, [&](uint32_t rva) {
+			matchRva = rva;
+			return ++numMatches > 1;
+		});
+		return numMatches == 1;
+	}
+
+	// What the target points at, from its anchor
+	static bool TargetRva(const Image &image, const Target &target, uint32_t anchorRva, uint32_t &rva)
+	{
+		int64_t result = anchorRva;
+		switch (target.kind) {
+		case kTarget_Code:
+			if (target.operandOffset >= 0) {
+				const uint8_t *operand = At(image, (uint64_t)anchorRva + target.operandOffset, 4);
+				if (!operand) return false;
+				result += target.instructionEnd + (int32_t)Read32(operand);
+			}
+			break;
+		case kTarget_GameSetting:
+			result += settingDataOffset;
+			break;
+		case kTarget_VtableSlot:
+			break;
+		default:
+			return false;
+		}
+		result += target.adjust;
+		if (result < 0 || result >= image.size) return false;
+		rva = (uint32_t)result;
+		return true;
+	}
+
+	static bool Verify(const Image &image, const Target &target, uint32_t anchorRva)
+	{
+		switch (target.kind) {
+		case kTarget_Code: {
+			Pattern pattern;
+			return ParsePattern(target.signature, pattern) && IsInExecutableSection(image, anchorRva, pattern.bytes.size()) &&
+				Matches(image.base + anchorRva, pattern);
+		}
+		case kTarget_GameSetting: return VerifyGameSetting(image, target.signature, anchorRva);
+		case kTarget_VtableSlot: return VerifyVtable(image, target.signature, anchorRva);
+		default: return false;
+		}
+	}
+
+	bool Resolve(const Image &image, const Target &target, Resolved &out)
+	{
+		out = Resolved();
+		bool isFound = false;
+		switch (target.kind) {
+		case kTarget_Code: {
+			Pattern pattern;
+			isFound = ParsePattern(target.signature, pattern) && FindCode(image, pattern, out.anchorRva);
+			break;
+		}
+		case kTarget_GameSetting: isFound = FindGameSetting(image, target.signature, out.anchorRva); break;
+		case kTarget_VtableSlot: isFound = FindVtable(image, target.signature, out.anchorRva); break;
+		default: break;
+		}
+		out.isFound = isFound && TargetRva(image, target, out.anchorRva, out.rva);
+		return out.isFound;
+	}
+
+	void Resolve(const Image &image, const Target *targets, int numTargets, Cache &cache, Resolved *out, bool &isCacheChanged)
+	{
+		isCacheChanged = false;
+		if (cache.imageHash != image.hash) {
+			cache.imageHash = image.hash;
+			cache.entries.clear();
+			isCacheChanged = true;
+		}
+
+		for (int i = 0; i < numTargets; i++) {
+			const Target &target = targets[i];
+			out[i] = Resolved();
+			if (target.kind == kTarget_None) continue;
+
+			const Cache::Entry *entry = cache.Find(target.name);
+			if (entry && !entry->anchorRva) {
+				out[i].isCached = true; // already searched this image for it and not found it
+				continue;
+			}
+			if (entry && Verify(image, target, entry->anchorRva) && TargetRva(image, target, entry->anchorRva, out[i].rva)) {
+				out[i].anchorRva = entry->anchorRva;
+				out[i].isFound = out[i].isCached = true;
+				continue;
+			}
+
+			// Not cached, or stale
+			if (entry) cache.entries.erase(cache.entries.begin() + (entry - cache.entries.data()));
+			Resolve(image, target, out[i]);
+			cache.entries.push_back({ target.name, out[i].isFound ? out[i].anchorRva : 0 });
+			isCacheChanged = true;
+		}
+	}
+
+	// Cache file
+
+	const Cache::Entry * Cache::Find(const char *name) const
+	{
+		for (const Entry &entry : entries) {
+			if (entry.name == name) return &entry;
+		}
+		return nullptr;
+	}
+
+	bool ReadCache(const std::string &path, Cache &out)
+	{
+		out = Cache();
+		std::ifstream file(path);
+		if (!file) return false;
+
+		std::string line;
+		bool hasImage = false;
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '#') continue;
+			std::istringstream fields(line);
+			std::string name, value;
+			if (!(fields >> name >> value)) return false;
+			char *end = nullptr;
+			unsigned long long number = strtoull(value.c_str(), &end, 16);
+			if (!end || *end) return false;
+
+			if (name == "image") {
+				out.imageHash = number;
+				hasImage = true;
+			}
+			else {
+				out.entries.push_back({ name, (uint32_t)number });
+			}
+		}
+		return hasImage;
+	}
+
+	bool WriteCache(const std::string &path, const Cache &cache)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file) return false;
+
+		char line[128];
+		file << "# Where DualWieldBlockVR found its game addresses in this executable. Rebuilt whenever the executable changes.\n";
+		snprintf(line, sizeof(line), "image %016llx\n", (unsigned long long)cache.imageHash);
+		file << line;
+		for (const Cache::Entry &entry : cache.entries) {
+			snprintf(line, sizeof(line), " %08x\n", entry.anchorRva);
+			file << entry.name << line;
+		}
+		return (bool)file;
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Finds game addresses by searching the loaded executable instead of hard-coding offsets for one build, and remembers
+// what it found in a small cache file so later launches of the same executable only check the cached addresses.
+//
+// Three kinds of target:
+//   code          a byte pattern with wildcards, optionally followed through a rel32 operand (call, lea, mov [rip + x])
+//   game setting  a static Setting object, found from its name string and the pointer to it the object holds
+//   vtable slot   a class's primary vtable, found through its MSVC RTTI (type descriptor -> complete object locator
+//                 -> vtable[-1])
+//
+// No Windows dependencies, so it can be tested against synthetic images (tools/sigscan).
+namespace SignatureScanner
+{
+	// "48 8B 05 ?? ?? ?? ??": hex bytes, ? or ?? for a byte that can be anything
+	struct Pattern
+	{
+		std::vector<uint8_t> bytes;
+		std::vector<uint8_t> mask; // 0xFF where the byte has to match, 0 for a wildcard
+		// The fixed bytes candidates are filtered on before the whole pattern is compared. first is the least common
+		// looking one, second another one if the pattern has it (the same as first otherwise).
+		size_t first = 0;
+		size_t second = 0;
+	};
+
+	// False if the text is not a pattern, or has no fixed bytes at all
+	bool ParsePattern(const char *text, Pattern &out);
+	Pattern LiteralPattern(const void *bytes, size_t size);
+
+	bool Matches(const uint8_t *at, const Pattern &pattern);
+
+	// The first match starting in [begin, end) that fits before end, nullptr if none. Find filters 16 positions at a
+	// time with SSE2 where available, FindScalar is the reference.
+	const uint8_t * Find(const uint8_t *begin, const uint8_t *end, const Pattern &pattern);
+	const uint8_t * FindScalar(const uint8_t *begin, const uint8_t *end, const Pattern &pattern);
+	bool IsFindVectorized();
+
+	struct Section
+	{
+		char name[9];
+		uint32_t rva;
+		uint32_t size;
+		bool isExecutable;
+	};
+
+	// A PE32+ image laid out the way the loader maps it: sections at their RVAs
+	struct Image
+	{
+		const uint8_t *base = nullptr;
+		uint32_t size = 0; // SizeOfImage
+		uint64_t address = 0; // what absolute pointers in the image are relative to: base once loaded, ImageBase on disk
+		uint64_t hash = 0; // FNV-1a of the headers, which carry the link timestamp and every section's size
+		std::vector<Section> sections;
+	};
+
+	// Reads the headers of an image that is already laid out in memory. False if it does not look like a PE32+ image.
+	bool ReadImage(const uint8_t *base, uint64_t address, Image &out);
+
+	enum TargetKind
+	{
+		kTarget_Code = 0,
+		kTarget_GameSetting,
+		kTarget_VtableSlot,
+		kTarget_None // no signature, only the address of the known build
+	};
+
+	struct Target
+	{
+		const char *name; // also the key in the cache
+		TargetKind kind;
+		// Code: the pattern. Game setting: the setting's name. Vtable slot: the RTTI name, e.g. ".?AVPlayerCharacter@@".
+		const char *signature;
+		int operandOffset; // code: where a rel32 operand starts in the match, -1 to take the match itself
+		int instructionEnd; // code: the operand is relative to match + this
+		int adjust; // added to what was found: a vtable slot * 8, an offset into the object
+		uint32_t knownRva; // the address in the build the plugin was written against, 0 if none
+	};
+
+	struct Resolved
+	{
+		uint32_t rva = 0;
+		uint32_t anchorRva = 0; // the match, setting or vtable, what the cache stores
+		bool isFound = false;
+		bool isCached = false; // came out of the cache, no search was needed
+	};
+
+	// Cached anchors, valid only for the image with the same hash. An anchor of 0 means the target is not in the image.
+	struct Cache
+	{
+		struct Entry
+		{
+			std::string name;
+			uint32_t anchorRva;
+		};
+
+		uint64_t imageHash = 0;
+		std::vector<Entry> entries;
+
+		const Entry * Find(const char *name) const;
+	};
+
+	bool ReadCache(const std::string &path, Cache &out);
+	bool WriteCache(const std::string &path, const Cache &cache);
+
+	// Resolves every target into out. Cached anchors are used if the cache is for this image and the anchor still checks
+	// out, everything else is searched for. Afterwards cache holds the anchors of this image; isCacheChanged says whether
+	// it needs writing back.
+	void Resolve(const Image &image, const Target *targets, int numTargets, Cache &cache, Resolved *out, bool &isCacheChanged);
+
+	// One target without the cache
+	bool Resolve(const Image &image, const Target &target, Resolved &out);
+}
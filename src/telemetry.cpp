@@ -0,0 +1,229 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "telemetry.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace Telemetry
+{
+	static float CooldownLeftMs(uint64_t lastNs, uint64_t nowNs, float cooldownMs)
+	{
+		if (BlockCore::IsCooldownOver(lastNs, nowNs, cooldownMs)) return 0;
+		return cooldownMs - (float)NsToMs(nowNs - lastNs);
+	}
+
+	void FillFrame(const BlockCore::State *state, const BlockCore::Config &config, const BlockCore::FrameInput &input, BlockCore::Decision decision, Frame &frame)
+	{
+		uint64_t now = input.timestampNs;
+		frame.timestampNs = now;
+
+		frame.isActive = input.isActive;
+		frame.isLeftHanded = input.isLeftHanded;
+		frame.lastDecision = (uint8_t)decision;
+		frame.isBlockingGraph = input.isBlockingGraph;
+		frame.isBlockingInternal = input.isBlockingInternal;
+		memset(frame.padding, 0, sizeof(frame.padding));
+
+		if (!state) {
+			// The tests ran somewhere else, only what the game thread saw is known
+			frame.hasTestState = false;
+			memset(frame.hands, 0, sizeof(frame.hands));
+			frame.phase = (uint8_t)BlockCore::kBlockPhase_Idle;
+			frame.lastRequest = (uint8_t)BlockCore::kDecision_None;
+			frame.isBlockingDebounced = input.isBlockingGraph;
+			frame.startCooldownMs = frame.stopCooldownMs = frame.notifyTimeoutMs = 0;
+			frame.numStartsSent = frame.numStartsSuppressed = frame.numStopsSent = frame.numStopsSuppressed = 0;
+			return;
+		}
+
+		frame.hasTestState = true;
+		for (int i = 0; i < 2; i++) {
+			const BlockCore::HandReadout &readout = state->hands[i];
+			Hand &hand = frame.hands[i];
+			if (config.isHandReadoutEnabled) {
+				hand.speed = sqrtf(readout.speed);
+				hand.facing = readout.facing;
+				hand.across = readout.across;
+				hand.verticalDistance = readout.verticalDistance;
+				hand.mode = (uint8_t)readout.mode;
+				hand.status = (uint8_t)readout.status;
+			}
+			else {
+				memset(&hand, 0, sizeof(hand));
+			}
+			hand.padding[0] = hand.padding[1] = 0;
+		}
+
+		frame.phase = (uint8_t)state->phase;
+		frame.lastRequest = state->isLastUpdateValid ? (uint8_t)state->lastRequest : (uint8_t)BlockCore::kDecision_None;
+		frame.isBlockingDebounced = state->isBlocking;
+
+		frame.startCooldownMs = CooldownLeftMs(state->lastBlockStartNs, now, config.blockCooldownMs);
+		frame.stopCooldownMs = CooldownLeftMs(state->lastBlockStopNs, now, config.blockCooldownMs);
+		bool isWaitingOnGraph = state->phase == BlockCore::kBlockPhase_PendingStart || state->phase == BlockCore::kBlockPhase_PendingStop;
+		frame.notifyTimeoutMs = isWaitingOnGraph ? CooldownLeftMs(state->lastNotifyNs, now, config.notifyTimeoutMs) : 0;
+
+		const BlockCore::NotifyCounts &counts = state->notifyCounts;
+		frame.numStartsSent = counts.numStartsSent;
+		frame.numStartsSuppressed = counts.numStartsSuppressed;
+		frame.numStopsSent = counts.numStopsSent;
+		frame.numStopsSuppressed = counts.numStopsSuppressed;
+	}
+
+	void FillProfile(const Profiler &profiler, Frame &frame)
+	{
+		for (int i = 0; i < numProfilerStages; i++) {
+			const LatencyHistogram &histogram = profiler.GetStage((Profiler::Stage)i);
+			frame.stageP50Us[i] = (float)(histogram.Percentile(0.5) * 1e-3);
+			frame.stageP99Us[i] = (float)(histogram.Percentile(0.99) * 1e-3);
+			frame.stageMaxUs[i] = (float)(histogram.Max() * 1e-3);
+			frame.stageCounts[i] = histogram.Count();
+		}
+		for (int i = 0; i < numEarlyOuts; i++) {
+			frame.earlyOuts[i] = profiler.GetEarlyOutCount((Profiler::EarlyOut)i);
+		}
+	}
+
+	static bool MapBlock(Mapping &mapping, bool isWriter)
+	{
+#ifdef _WIN32
+		std::string name = std::string("Local\\") + blockName;
+		HANDLE handle;
+		if (isWriter) {
+			handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Block), name.c_str());
+		}
+		else {
+			handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		}
+		if (!handle) return false;
+
+		void *view = MapViewOfFile(handle, isWriter ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof(Block));
+		if (!view) {
+			CloseHandle(handle);
+			return false;
+		}
+		mapping.handle = handle;
+		mapping.block = (Block *)view;
+		return true;
+#else
+		std::string name = std::string("/") + blockName;
+		int fd = isWriter ? shm_open(name.c_str(), O_CREAT | O_RDWR, 0644) : shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) return false;
+
+		if (isWriter && ftruncate(fd, sizeof(Block)) != 0) {
+			close(fd);
+			return false;
+		}
+		if (!isWriter) {
+			// The writer may have created the name but not sized it yet
+			off_t size = lseek(fd, 0, SEEK_END);
+			if (size < (off_t)sizeof(Block)) {
+				close(fd);
+				return false;
+			}
+		}
+
+		void *view = mmap(nullptr, sizeof(Block), isWriter ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+		close(fd); // the mapping keeps the memory alive
+		if (view == MAP_FAILED) return false;
+		mapping.block = (Block *)view;
+		return true;
+#endif
+	}
+
+	static void UnmapBlock(Mapping &mapping)
+	{
+		if (!mapping.block) return;
+#ifdef _WIN32
+		UnmapViewOfFile(mapping.block);
+		CloseHandle((HANDLE)mapping.handle);
+#else
+		munmap(mapping.block, sizeof(Block));
+#endif
+		mapping.block = nullptr;
+		mapping.handle = nullptr;
+	}
+
+	bool Writer::Open()
+	{
+		if (IsOpen()) return true;
+		if (!MapBlock(mapping, true)) return false;
+
+		// Readers only trust the header once the magic is there, so it goes last
+		Block *block = mapping.block;
+		block->magic = 0;
+		std::atomic_thread_fence(std::memory_order_release);
+		block->sequence.store(0, std::memory_order_relaxed);
+		memset(&block->frame, 0, sizeof(block->frame));
+		block->version = version;
+		block->size = sizeof(Block);
+		std::atomic_thread_fence(std::memory_order_release);
+		block->magic = magic;
+		return true;
+	}
+
+	void Writer::Close()
+	{
+		if (!IsOpen()) return;
+#ifndef _WIN32
+		// Windows drops the mapping with its last handle, here the name has to go explicitly
+		shm_unlink((std::string("/") + blockName).c_str());
+#endif
+		UnmapBlock(mapping);
+	}
+
+	void Writer::Publish(const Frame &frame)
+	{
+		std::atomic<uint32_t> &sequence = mapping.block->sequence;
+		uint32_t start = sequence.load(std::memory_order_relaxed);
+		sequence.store(start + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release); // the odd sequence is visible before any of the frame is
+		memcpy(&mapping.block->frame, &frame, sizeof(frame));
+		sequence.store(start + 2, std::memory_order_release);
+	}
+
+	bool Reader::Open()
+	{
+		if (IsOpen()) return true;
+		if (!MapBlock(mapping, false)) return false;
+
+		const Block *block = mapping.block;
+		bool isValid = block->magic == magic;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (!isValid || block->version != version || block->size != sizeof(Block)) {
+			UnmapBlock(mapping);
+			return false;
+		}
+		return true;
+	}
+
+	void Reader::Close()
+	{
+		UnmapBlock(mapping);
+	}
+
+	bool Reader::Read(Frame &out, int maxTries, int *numRetries) const
+	{
+		const Block *block = mapping.block;
+		if (numRetries) *numRetries = 0;
+		for (int i = 0; i < maxTries; i++) {
+			uint32_t start = block->sequence.load(std::memory_order_acquire);
+			if (!(start & 1)) {
+				memcpy(&out, (const void *)&block->frame, sizeof(out));
+				std::atomic_thread_fence(std::memory_order_acquire); // the copy is done before the sequence is checked again
+				if (block->sequence.load(std::memory_order_relaxed) == start) return true;
+			}
+			if (numRetries) (*numRetries)++;
+		}
+		return false;
+	}
+}
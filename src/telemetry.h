@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "blocking.h"
+#include "profiler.h"
+
+
+// Live block state for overlays and other local tools, in a named shared memory block any process can map read only
+// (tools/telemetry is a reference reader). The game writes it once per frame under a sequence lock: the writer never
+// waits on anyone, and a reader that catches it halfway through a write just reads again, so readers can poll at any
+// rate without slowing the game down.
+//
+// A reader:
+//   1. loads sequence (acquire), and starts over if it is odd (a write is in progress)
+//   2. copies frame out
+//   3. issues an acquire fence and loads sequence again. The copy is good if it did not change, otherwise back to 1.
+namespace Telemetry
+{
+	const uint32_t magic = 0x54425744; // "DWBT"
+	const uint32_t version = 2;
+
+	// CreateFileMapping name on Windows ("Local\\" + name), shm_open name elsewhere ("/" + name)
+	const char * const blockName = "DualWieldBlockVR_Telemetry";
+
+	const int numProfilerStages = 5;
+	const int numEarlyOuts = 7;
+	static_assert(numProfilerStages == Profiler::kNumStages && numEarlyOuts == Profiler::kNumEarlyOuts, "Telemetry must match the profiler");
+
+	// Plain old data only, the layout is the interface. Anything added goes at the end, with a new version.
+	struct Hand
+	{
+		float speed; // m/s, not squared
+		float facing; // see BlockCore::HandReadout
+		float across;
+		float verticalDistance;
+		uint8_t mode; // BlockCore::HandMode
+		uint8_t status; // BlockCore::HandStatus
+		uint8_t padding[2];
+	};
+
+	struct Frame
+	{
+		uint64_t frameNumber; // counts published frames, starting at 1
+		uint64_t timestampNs; // game thread, steady clock (QueryPerformanceCounter on Windows)
+
+		// The hand tests as of the last valid update. hasTestState is 0 and all of these are 0 when the tests run on the
+		// pose thread (ClassifyOnPoseThread = 1), hands alone are 0 if the game is not filling them in.
+		Hand hands[2]; // main, off
+		uint8_t hasTestState;
+		uint8_t isActive; // weapons drawn, not in a menu, nodes present
+		uint8_t isLeftHanded;
+		uint8_t phase; // BlockCore::BlockPhase
+		uint8_t lastRequest; // BlockCore::Decision the tests asked for, before the cooldowns
+		uint8_t lastDecision; // BlockCore::Decision sent to the animation graph this frame
+		uint8_t isBlockingGraph; // IsBlocking as read from the animation graph
+		uint8_t isBlockingDebounced; // IsBlocking as the tests see it
+		uint8_t isBlockingInternal; // the actor state
+		uint8_t padding[7];
+
+		float startCooldownMs; // until another blockStart may be sent, 0 if it may now
+		float stopCooldownMs; // the same for blockStop
+		float notifyTimeoutMs; // until an unanswered blockStart / blockStop is given up on, 0 if none is waiting
+
+		// Since the game started
+		uint64_t numStartsSent;
+		uint64_t numStartsSuppressed;
+		uint64_t numStopsSent;
+		uint64_t numStopsSuppressed;
+
+		// Profiler::Stage timings in microseconds, all 0 unless ProfilerDumpIntervalSeconds is set. Like the log they cover
+		// the time since the last dump, and start over after each one. Refreshed a few times a second rather than every frame.
+		float stageP50Us[numProfilerStages];
+		float stageP99Us[numProfilerStages];
+		float stageMaxUs[numProfilerStages];
+		uint64_t stageCounts[numProfilerStages];
+		uint64_t earlyOuts[numEarlyOuts]; // Profiler::EarlyOut counts
+	};
+
+	struct Block
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t size; // sizeof(Block)
+		std::atomic<uint32_t> sequence; // odd while the frame is being written
+		Frame frame;
+	};
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The sequence must be a plain 32 bit word");
+
+	// The block state after BlockCore::Update(*state, config, input) returned decision, or with no state when the tests
+	// run on the pose thread. Leaves frameNumber and the profiler alone.
+	void FillFrame(const BlockCore::State *state, const BlockCore::Config &config, const BlockCore::FrameInput &input, BlockCore::Decision decision, Frame &frame);
+
+	// Copies what the profiler has recorded so far
+	void FillProfile(const Profiler &profiler, Frame &frame);
+
+	struct Mapping
+	{
+		void *handle = nullptr; // file mapping handle on Windows, unused elsewhere
+		Block *block = nullptr;
+	};
+
+	// Single writer, the game thread
+	class Writer
+	{
+	public:
+		~Writer() { Close(); }
+
+		// Creates (or takes over) the named block. False if it could not be created.
+		bool Open();
+		void Close();
+		bool IsOpen() const { return mapping.block != nullptr; }
+
+		void Publish(const Frame &frame);
+
+	private:
+		Mapping mapping;
+	};
+
+	class Reader
+	{
+	public:
+		~Reader() { Close(); }
+
+		// False if the game has not created the block, or it is from a different version
+		bool Open();
+		void Close();
+		bool IsOpen() const { return mapping.block != nullptr; }
+
+		// Copies the latest frame. False if every try caught the writer mid-write, which only happens if the reader
+		// itself is preempted for a long time. numRetries, if given, gets the number of torn copies thrown away.
+		bool Read(Frame &out, int maxTries = 64, int *numRetries = nullptr) const;
+
+	private:
+		Mapping mapping;
+	};
+}
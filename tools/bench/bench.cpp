@@ -0,0 +1,424 @@
+// Google Benchmark suite for math_utils and the block tests, with a stored baseline to catch regressions.
+//
+// math_utils builds against the NiTypes stand-in in tools/bench/stubs. The block tests run over random poses and over
+// the frames of a trace (or a generated session if none is given). The player node reads count the atomic refcount
+// operations they make per frame (refcount_ops).
+//
+// Build (Linux, needs libbenchmark-dev):
+//   g++ -std=c++17 -O2 -Isrc -Itools/common -Itools/bench/stubs tools/bench/bench.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp src/math_utils.cpp -lbenchmark -lpthread -o bench
+//
+// Examples:
+//   bench --benchmark_repetitions=5 --benchmark_out=tools/bench/baseline.json --benchmark_out_format=json   (save a new baseline)
+//   bench --benchmark_repetitions=5 --baseline tools/bench/baseline.json --max-regression 0.25
+//
+// The best of the repetitions is compared. Baselines are only comparable on the machine that made them.
+//   bench session.txt --baseline tools/bench/baseline.json --benchmark_filter=HandBlockingStatus
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "blocking.h"
+#include "dual_hand_classifier.h"
+#include "frame_trace.h"
+#include "math_utils.h"
+#include "player_context.h"
+#include "synthetic_session.h"
+
+
+static const int numInputs = 1024; // power of two, cycled through by every benchmark
+static const int inputMask = numInputs - 1;
+
+static std::vector<NiPoint3> s_points;
+static std::vector<NiQuaternion> s_quaternions;
+static std::vector<BlockCore::FrameInput> s_randomFrames;
+static std::vector<BlockCore::FrameInput> s_traceFrames;
+
+static void GenerateInputs()
+{
+	SyntheticSession::Random random(7);
+	for (int i = 0; i < numInputs; i++) {
+		s_points.push_back(NiPoint3(random.Range(-100, 100), random.Range(-100, 100), random.Range(-100, 100)));
+		s_quaternions.push_back({ random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1) });
+	}
+
+	// Hands anywhere within reach of the hmd, pointing anywhere
+	BlockCore::Config config;
+	auto randomRotation = [&random]() {
+		return SyntheticSession::BasisFromForward({ random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1) }, { 0, 0, 1 });
+	};
+	float reach = 0.6f / config.havokWorldScale;
+	for (int i = 0; i < numInputs; i++) {
+		BlockCore::FrameInput frame = {};
+		frame.isActive = true;
+		frame.hmd.rot = randomRotation();
+		frame.hmd.pos = { random.Range(-1000, 1000), random.Range(-1000, 1000), random.Range(0, 200) };
+		frame.rightWand.rot = randomRotation();
+		frame.rightWand.pos = frame.hmd.pos + BlockCore::Vector3{ random.Range(-reach, reach), random.Range(-reach, reach), random.Range(-reach, reach) };
+		frame.leftWand.rot = randomRotation();
+		frame.leftWand.pos = frame.hmd.pos + BlockCore::Vector3{ random.Range(-reach, reach), random.Range(-reach, reach), random.Range(-reach, reach) };
+		frame.rightHandSpeed = random.Range(0, 4);
+		frame.leftHandSpeed = random.Range(0, 4);
+		frame.isBlockingGraph = random.Uniform() < 0.5f;
+		s_randomFrames.push_back(frame);
+	}
+}
+
+// math_utils
+
+static void BM_VectorLength(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(VectorLength(s_points[i++ & inputMask]));
+	}
+}
+BENCHMARK(BM_VectorLength);
+
+static void BM_VectorNormalized(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(VectorNormalized(s_points[i++ & inputMask]));
+	}
+}
+BENCHMARK(BM_VectorNormalized);
+
+static void BM_CrossProduct(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(CrossProduct(s_points[i & inputMask], s_points[(i + 1) & inputMask]));
+		i++;
+	}
+}
+BENCHMARK(BM_CrossProduct);
+
+static void BM_DotProductSafe(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(DotProductSafe(s_points[i & inputMask], s_points[(i + 1) & inputMask]));
+		i++;
+	}
+}
+BENCHMARK(BM_DotProductSafe);
+
+static void BM_QuaternionNormalized(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(QuaternionNormalized(s_quaternions[i++ & inputMask]));
+	}
+}
+BENCHMARK(BM_QuaternionNormalized);
+
+static void BM_QuaternionMultiply(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(QuaternionMultiply(s_quaternions[i & inputMask], s_quaternions[(i + 1) & inputMask]));
+		i++;
+	}
+}
+BENCHMARK(BM_QuaternionMultiply);
+
+static void BM_QuaternionMultiplyScalar(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(QuaternionMultiply(s_quaternions[i & inputMask], s_points[i & inputMask].x));
+		i++;
+	}
+}
+BENCHMARK(BM_QuaternionMultiplyScalar);
+
+static void BM_QuaternionInverse(benchmark::State &state)
+{
+	int i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(QuaternionInverse(s_quaternions[i++ & inputMask]));
+	}
+}
+BENCHMARK(BM_QuaternionInverse);
+
+// Block tests. Both hands of every frame, so each iteration is two calls.
+
+static const std::vector<BlockCore::FrameInput> & Frames(int source) { return source ? s_traceFrames : s_randomFrames; }
+
+static void BM_GetHandBlockingStatus(benchmark::State &state)
+{
+	const std::vector<BlockCore::FrameInput> &frames = Frames((int)state.range(0));
+	BlockCore::Config config;
+	size_t i = 0;
+	for (auto _ : state) {
+		const BlockCore::FrameInput &frame = frames[i];
+		BlockCore::HandSample right = { frame.hmd, frame.rightWand, frame.rightHandSpeed };
+		BlockCore::HandSample left = { frame.hmd, frame.leftWand, frame.leftHandSpeed };
+		benchmark::DoNotOptimize(BlockCore::GetHandBlockingStatus(config, right, right, frame.isBlockingGraph));
+		benchmark::DoNotOptimize(BlockCore::GetHandBlockingStatus(config, left, left, frame.isBlockingGraph));
+		if (++i == frames.size()) i = 0;
+	}
+}
+BENCHMARK(BM_GetHandBlockingStatus)->ArgName("trace")->Arg(0)->Arg(1);
+
+static void BM_GetHandBlockingStatusUnarmed(benchmark::State &state)
+{
+	const std::vector<BlockCore::FrameInput> &frames = Frames((int)state.range(0));
+	BlockCore::Config config;
+	size_t i = 0;
+	for (auto _ : state) {
+		const BlockCore::FrameInput &frame = frames[i];
+		BlockCore::HandSample right = { frame.hmd, frame.rightWand, frame.rightHandSpeed };
+		BlockCore::HandSample left = { frame.hmd, frame.leftWand, frame.leftHandSpeed };
+		benchmark::DoNotOptimize(BlockCore::GetHandBlockingStatusUnarmed(config, right, right, frame.isBlockingGraph, false));
+		benchmark::DoNotOptimize(BlockCore::GetHandBlockingStatusUnarmed(config, left, left, frame.isBlockingGraph, true));
+		if (++i == frames.size()) i = 0;
+	}
+}
+BENCHMARK(BM_GetHandBlockingStatusUnarmed)->ArgName("trace")->Arg(0)->Arg(1);
+
+// Both blades against each other, once with the current poses and once with the predicted ones (the same here)
+static void BM_TestCrossGuard(benchmark::State &state)
+{
+	const std::vector<BlockCore::FrameInput> &frames = Frames((int)state.range(0));
+	BlockCore::Config config;
+	size_t i = 0;
+	for (auto _ : state) {
+		const BlockCore::FrameInput &frame = frames[i];
+		BlockCore::HandSample hands[BlockCore::kNumHandIndices] = {
+			{ frame.hmd, frame.rightWand, frame.rightHandSpeed },
+			{ frame.hmd, frame.leftWand, frame.leftHandSpeed }
+		};
+		BlockCore::CrossGuardTest test = BlockCore::TestCrossGuard(config, hands, hands);
+		benchmark::DoNotOptimize(test);
+		if (++i == frames.size()) i = 0;
+	}
+}
+BENCHMARK(BM_TestCrossGuard)->ArgName("trace")->Arg(0)->Arg(1);
+
+// The whole per frame path over the trace, state carried from frame to frame like in game
+static void BM_Update(benchmark::State &state)
+{
+	BlockCore::Config config;
+	BlockCore::State blockState;
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(BlockCore::Update(blockState, config, s_traceFrames[i]));
+		if (++i == s_traceFrames.size()) {
+			i = 0;
+			blockState = BlockCore::State();
+		}
+	}
+}
+BENCHMARK(BM_Update);
+
+static void BM_UpdateCrossGuard(benchmark::State &state)
+{
+	BlockCore::Config config;
+	config.isCrossGuardEnabled = true;
+	BlockCore::State blockState;
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(BlockCore::Update(blockState, config, s_traceFrames[i]));
+		if (++i == s_traceFrames.size()) {
+			i = 0;
+			blockState = BlockCore::State();
+		}
+	}
+}
+BENCHMARK(BM_UpdateCrossGuard);
+
+// Reading the player's hmd and wand nodes, the way the player update used to (copying the NiPointers) and through
+// ReadPlayerNodes. The stand-in node counts its refcount changes, each of which is an atomic operation in game.
+
+static uint64_t s_numRefCountOps = 0;
+
+struct BenchNode
+{
+	std::atomic<uint32_t> m_uiRefCount{ 1 };
+	NiTransform m_worldTransform;
+
+	void IncRef() { m_uiRefCount.fetch_add(1); s_numRefCountOps++; }
+	void DecRef() { m_uiRefCount.fetch_sub(1); s_numRefCountOps++; }
+};
+
+struct BenchPlayerNodes
+{
+	BenchNode nodes[3];
+	NiPointer<BenchNode> pointers[3] = { &nodes[0], &nodes[1], &nodes[2] };
+};
+
+static void BM_PlayerNodesCopyingPointers(benchmark::State &state)
+{
+	BenchPlayerNodes player;
+	s_numRefCountOps = 0;
+	for (auto _ : state) {
+		NiPointer<BenchNode> hmdNode = player.pointers[0];
+		NiPointer<BenchNode> rightWand = player.pointers[1];
+		NiPointer<BenchNode> leftWand = player.pointers[2];
+		if (!hmdNode || !rightWand || !leftWand) continue;
+
+		BlockCore::FrameInput input;
+		CopyTransform(hmdNode->m_worldTransform, input.hmd);
+		CopyTransform(rightWand->m_worldTransform, input.rightWand);
+		CopyTransform(leftWand->m_worldTransform, input.leftWand);
+		benchmark::DoNotOptimize(input);
+	}
+	state.counters["refcount_ops"] = benchmark::Counter((double)s_numRefCountOps / state.iterations());
+}
+BENCHMARK(BM_PlayerNodesCopyingPointers);
+
+static void BM_PlayerNodesInPlace(benchmark::State &state)
+{
+	BenchPlayerNodes player;
+	s_numRefCountOps = 0;
+	for (auto _ : state) {
+		PlayerNodes nodes;
+		if (!ReadPlayerNodes(player.pointers[0], player.pointers[1], player.pointers[2], nodes)) continue;
+		benchmark::DoNotOptimize(nodes);
+	}
+	state.counters["refcount_ops"] = benchmark::Counter((double)s_numRefCountOps / state.iterations());
+}
+BENCHMARK(BM_PlayerNodesInPlace);
+
+// Baseline comparison
+
+// Keeps the cpu time of every run, on top of the usual console output
+class RecordingReporter : public benchmark::ConsoleReporter
+{
+public:
+	std::map<std::string, double> cpuTimesNs;
+
+	void ReportRuns(const std::vector<Run> &runs) override
+	{
+		ConsoleReporter::ReportRuns(runs);
+		for (const Run &run : runs) {
+			if (run.error_occurred || run.run_type != Run::RT_Iteration) continue;
+			double ns = run.GetAdjustedCPUTime() * 1e9 / benchmark::GetTimeUnitMultiplier(run.time_unit);
+			std::string name = run.benchmark_name();
+			auto it = cpuTimesNs.find(name);
+			if (it == cpuTimesNs.end() || ns < it->second) cpuTimesNs[name] = ns; // best of repetitions
+		}
+	}
+};
+
+static double TimeUnitToNs(const std::string &unit)
+{
+	if (unit == "us") return 1e3;
+	if (unit == "ms") return 1e6;
+	if (unit == "s") return 1e9;
+	return 1;
+}
+
+// Reads the name / cpu_time / time_unit of every iteration run in a --benchmark_out JSON file
+static bool ReadBaseline(const std::string &path, std::map<std::string, double> &cpuTimesNs)
+{
+	std::ifstream file(path);
+	if (!file) return false;
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	const std::string json = buffer.str();
+
+	auto stringField = [&json](size_t begin, size_t end, const char *key, std::string &out) {
+		size_t at = json.find(std::string("\"") + key + "\":", begin);
+		if (at == std::string::npos || at >= end) return false;
+		size_t open = json.find('"', at + strlen(key) + 3);
+		size_t close = json.find('"', open + 1);
+		if (open == std::string::npos || close == std::string::npos || close >= end) return false;
+		out = json.substr(open + 1, close - open - 1);
+		return true;
+	};
+
+	size_t benchmarks = json.find("\"benchmarks\"");
+	if (benchmarks == std::string::npos) return false;
+	for (size_t begin = json.find('{', benchmarks); begin != std::string::npos; ) {
+		size_t end = json.find('}', begin);
+		if (end == std::string::npos) break;
+
+		std::string name, runType, unit;
+		size_t cpuTime = json.find("\"cpu_time\":", begin);
+		if (stringField(begin, end, "name", name) && stringField(begin, end, "time_unit", unit) && cpuTime < end &&
+			(!stringField(begin, end, "run_type", runType) || runType == "iteration")) {
+			double ns = atof(json.c_str() + cpuTime + strlen("\"cpu_time\":")) * TimeUnitToNs(unit);
+			auto it = cpuTimesNs.find(name);
+			if (it == cpuTimesNs.end() || ns < it->second) cpuTimesNs[name] = ns;
+		}
+		begin = json.find('{', end);
+	}
+	return !cpuTimesNs.empty();
+}
+
+int main(int argc, char **argv)
+{
+	// Our own options come out of argv before the library sees it
+	std::string tracePath, baselinePath;
+	double maxRegression = 0.25;
+	double minDeltaNs = 1; // the smallest functions move by about this much from run to run
+	std::vector<char *> args = { argv[0] };
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+		else if (arg == "--max-regression" && hasValue) maxRegression = atof(argv[++i]);
+		else if (arg == "--min-delta-ns" && hasValue) minDeltaNs = atof(argv[++i]);
+		else if (arg[0] != '-' && tracePath.empty()) tracePath = arg;
+		else args.push_back(argv[i]);
+	}
+	int benchmarkArgc = (int)args.size();
+	benchmark::Initialize(&benchmarkArgc, args.data());
+	if (benchmark::ReportUnrecognizedArguments(benchmarkArgc, args.data())) {
+		fprintf(stderr, "usage: bench [trace] [--baseline <json>] [--max-regression <fraction, default 0.25>] [--min-delta-ns <ns, default 1>] [--benchmark_... options]\n");
+		return 2;
+	}
+
+	GenerateInputs();
+	if (tracePath.empty()) {
+		SyntheticSession::Options options;
+		options.seconds = 120;
+		options.crossGuardChance = 0.5;
+		s_traceFrames = SyntheticSession::Generate(options, BlockCore::Config());
+	}
+	else {
+		std::string error;
+		if (!FrameTrace::Read(tracePath, s_traceFrames, error) || s_traceFrames.empty()) {
+			fprintf(stderr, "failed to read %s: %s\n", tracePath.c_str(), error.empty() ? "no frames" : error.c_str());
+			return 1;
+		}
+	}
+
+	RecordingReporter reporter;
+	benchmark::RunSpecifiedBenchmarks(&reporter);
+	benchmark::Shutdown();
+
+	if (baselinePath.empty()) return 0;
+
+	std::map<std::string, double> baseline;
+	if (!ReadBaseline(baselinePath, baseline)) {
+		fprintf(stderr, "failed to read baseline %s\n", baselinePath.c_str());
+		return 1;
+	}
+
+	int result = 0;
+	printf("\ncompared to %s (fail above +%.0f%% and +%.1f ns):\n", baselinePath.c_str(), maxRegression * 100, minDeltaNs);
+	for (const auto &entry : reporter.cpuTimesNs) {
+		auto it = baseline.find(entry.first);
+		if (it == baseline.end()) {
+			printf("  %-44s %9.2f ns   (not in baseline)\n", entry.first.c_str(), entry.second);
+			continue;
+		}
+		double change = it->second > 0 ? entry.second / it->second - 1 : 0;
+		bool isRegression = change > maxRegression && entry.second - it->second > minDeltaNs;
+		printf("  %-44s %9.2f ns   baseline %9.2f ns   %+6.1f%%%s\n", entry.first.c_str(), entry.second, it->second, change * 100, isRegression ? "   REGRESSION" : "");
+		if (isRegression) result = 1;
+	}
+	return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cmath>
+
+
+// Just enough of skse64/NiTypes.h for math_utils and player_context.h to build outside the game. Layouts match the real types.
+
+class NiPoint3
+{
+public:
+	float x, y, z;
+
+	NiPoint3() : x(0), y(0), z(0) {}
+	NiPoint3(float X, float Y, float Z) : x(X), y(Y), z(Z) {}
+
+	NiPoint3 operator-() const { return NiPoint3(-x, -y, -z); }
+	NiPoint3 operator+(const NiPoint3 &pt) const { return NiPoint3(x + pt.x, y + pt.y, z + pt.z); }
+	NiPoint3 operator-(const NiPoint3 &pt) const { return NiPoint3(x - pt.x, y - pt.y, z - pt.z); }
+	NiPoint3 operator*(float scalar) const { return NiPoint3(x * scalar, y * scalar, z * scalar); }
+	NiPoint3 operator/(float scalar) const { return NiPoint3(x / scalar, y / scalar, z / scalar); }
+};
+
+class NiMatrix33
+{
+public:
+	union
+	{
+		float data[3][3];
+		float arr[9];
+	};
+};
+
+class NiQuaternion
+{
+public:
+	float m_fW;
+	float m_fX;
+	float m_fY;
+	float m_fZ;
+};
+
+class NiTransform
+{
+public:
+	NiMatrix33 rot;
+	NiPoint3 pos;
+	float scale;
+
+	void Invert(NiTransform &kDest) const
+	{
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				kDest.rot.data[i][j] = rot.data[j][i];
+			}
+		}
+		kDest.scale = 1.f / scale;
+		NiPoint3 p = -pos;
+		kDest.pos = NiPoint3(
+			(kDest.rot.data[0][0] * p.x + kDest.rot.data[0][1] * p.y + kDest.rot.data[0][2] * p.z) * kDest.scale,
+			(kDest.rot.data[1][0] * p.x + kDest.rot.data[1][1] * p.y + kDest.rot.data[1][2] * p.z) * kDest.scale,
+			(kDest.rot.data[2][0] * p.x + kDest.rot.data[2][1] * p.y + kDest.rot.data[2][2] * p.z) * kDest.scale);
+	}
+};
+
+// Refcounting smart pointer, T_ provides IncRef / DecRef like NiRefObject
+template <class T_>
+class NiPointer
+{
+public:
+	T_ *m_pObject;
+
+	NiPointer(T_ *pObject = nullptr) : m_pObject(pObject) { if (m_pObject) m_pObject->IncRef(); }
+	NiPointer(const NiPointer &rhs) : m_pObject(rhs.m_pObject) { if (m_pObject) m_pObject->IncRef(); }
+	~NiPointer() { if (m_pObject) m_pObject->DecRef(); }
+
+	NiPointer & operator=(const NiPointer &rhs)
+	{
+		if (m_pObject != rhs.m_pObject) {
+			if (rhs.m_pObject) rhs.m_pObject->IncRef();
+			if (m_pObject) m_pObject->DecRef();
+			m_pObject = rhs.m_pObject;
+		}
+		return *this;
+	}
+
+	operator T_ *() const { return m_pObject; }
+	T_ * operator->() const { return m_pObject; }
+};
@@ -0,0 +1,275 @@
+// Microbenchmark for the dual hand classifier. Checks that GetDualHandBlockingStatus gives exactly the same statuses as
+// calling GetHandBlockingStatus / GetHandBlockingStatusUnarmed for each hand, on every frame of a trace (or a generated
+// session) and on random poses, then times both. Also times the cross guard test, and counts how often it passes.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -Isrc -Itools/common tools/classifierbench/classifierbench.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp -o classifierbench
+//
+// Examples:
+//   classifierbench
+//   classifierbench session.txt --iterations 50
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+#include "dual_hand_classifier.h"
+#include "frame_trace.h"
+#include "synthetic_session.h"
+
+using namespace BlockCore;
+
+
+// Everything both classifiers need for one frame, built the same way Update builds it
+struct Case
+{
+	Transform hmd, mainWand, offWand;
+	Transform predictedHmd, predictedMainWand, predictedOffWand;
+	float mainSpeed, offSpeed;
+	bool isBlocking;
+	bool isUnarmed;
+	bool isMainLeft;
+	bool isPredicted;
+};
+
+static Case MakeCase(const FrameInput &frame, const Config &config, bool isUnarmed, float lookaheadMs)
+{
+	Case c;
+	bool isLeftHanded = frame.isLeftHanded;
+	c.hmd = frame.hmd;
+	c.mainWand = isLeftHanded ? frame.leftWand : frame.rightWand;
+	c.offWand = isLeftHanded ? frame.rightWand : frame.leftWand;
+	c.mainSpeed = isLeftHanded ? frame.leftHandSpeed : frame.rightHandSpeed;
+	c.offSpeed = isLeftHanded ? frame.rightHandSpeed : frame.leftHandSpeed;
+	c.isBlocking = frame.isBlockingGraph;
+	c.isUnarmed = isUnarmed;
+	c.isMainLeft = isLeftHanded;
+	c.isPredicted = lookaheadMs > 0;
+
+	float seconds = lookaheadMs * 0.001f;
+	c.predictedHmd = PredictTransform(c.hmd, frame.hmdMotion, seconds, config.havokWorldScale);
+	c.predictedMainWand = PredictTransform(c.mainWand, isLeftHanded ? frame.leftWandMotion : frame.rightWandMotion, seconds, config.havokWorldScale);
+	c.predictedOffWand = PredictTransform(c.offWand, isLeftHanded ? frame.rightWandMotion : frame.leftWandMotion, seconds, config.havokWorldScale);
+	return c;
+}
+
+static void ClassifyPerHand(const Config &config, const Case &c, HandStatus (&out)[kNumHandIndices])
+{
+	HandSample main = { c.hmd, c.mainWand, c.mainSpeed };
+	HandSample off = { c.hmd, c.offWand, c.offSpeed };
+	HandSample predictedMain = { c.predictedHmd, c.predictedMainWand, c.mainSpeed };
+	HandSample predictedOff = { c.predictedHmd, c.predictedOffWand, c.offSpeed };
+	const HandSample &mainEnter = c.isPredicted ? predictedMain : main;
+	const HandSample &offEnter = c.isPredicted ? predictedOff : off;
+
+	if (c.isUnarmed) {
+		out[kHandIndex_Main] = GetHandBlockingStatusUnarmed(config, main, mainEnter, c.isBlocking, c.isMainLeft);
+		out[kHandIndex_Off] = GetHandBlockingStatusUnarmed(config, off, offEnter, c.isBlocking, !c.isMainLeft);
+	}
+	else {
+		out[kHandIndex_Main] = GetHandBlockingStatus(config, main, mainEnter, c.isBlocking);
+		out[kHandIndex_Off] = GetHandBlockingStatus(config, off, offEnter, c.isBlocking);
+	}
+}
+
+template <bool isVector>
+static void ClassifyDual(const Config &config, const Case &c, HandStatus (&out)[kNumHandIndices])
+{
+	HandSample current[kNumHandIndices] = { { c.hmd, c.mainWand, c.mainSpeed }, { c.hmd, c.offWand, c.offSpeed } };
+	HandSample predicted[kNumHandIndices] = { { c.predictedHmd, c.predictedMainWand, c.mainSpeed }, { c.predictedHmd, c.predictedOffWand, c.offSpeed } };
+	const HandSample (&enter)[kNumHandIndices] = c.isPredicted ? predicted : current;
+
+	if (isVector) GetDualHandBlockingStatus(config, config.dualWield, current, enter, c.isBlocking, c.isUnarmed, c.isMainLeft, out);
+	else GetDualHandBlockingStatusScalar(config, config.dualWield, current, enter, c.isBlocking, c.isUnarmed, c.isMainLeft, out);
+}
+
+// Random orientations and positions around the hmd, a share of them near the thresholds, plus the odd NaN
+static void AddRandomCases(std::vector<Case> &cases, const Config &config, int count)
+{
+	SyntheticSession::Random random(12345);
+	auto randomRotation = [&random]() {
+		Vector3 forward = { random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1) };
+		return SyntheticSession::BasisFromForward(forward, { random.Range(-1, 1), random.Range(-1, 1), 1 });
+	};
+
+	for (int i = 0; i < count; i++) {
+		FrameInput frame = {};
+		frame.hmd.rot = randomRotation();
+		frame.hmd.pos = { random.Range(-1000, 1000), random.Range(-1000, 1000), random.Range(0, 200) };
+		frame.rightWand.rot = randomRotation();
+		frame.leftWand.rot = randomRotation();
+		float reach = 0.6f / config.havokWorldScale;
+		frame.rightWand.pos = frame.hmd.pos + Vector3{ random.Range(-reach, reach), random.Range(-reach, reach), random.Range(-reach, reach) };
+		frame.leftWand.pos = frame.hmd.pos + Vector3{ random.Range(-reach, reach), random.Range(-reach, reach), random.Range(-reach, reach) };
+		frame.rightHandSpeed = random.Range(0, 4);
+		frame.leftHandSpeed = random.Range(0, 4);
+		if (i % 97 == 0) frame.leftHandSpeed = std::numeric_limits<float>::quiet_NaN();
+		frame.isBlockingGraph = random.Uniform() < 0.5f;
+		frame.isLeftHanded = random.Uniform() < 0.2f;
+		frame.rightWandMotion.velocity = { random.Range(-2, 2), random.Range(-2, 2), random.Range(-2, 2) };
+		frame.leftWandMotion.angularVelocity = { random.Range(-5, 5), random.Range(-5, 5), random.Range(-5, 5) };
+
+		cases.push_back(MakeCase(frame, config, random.Uniform() < 0.5f, random.Uniform() < 0.5f ? 30.f : 0.f));
+	}
+}
+
+// Random poses around the cross guard, so a good share of them land on either side of each threshold
+static void AddCrossedCases(std::vector<Case> &cases, const Config &config, int count)
+{
+	SyntheticSession::Random random(67890);
+	auto perturbed = [&random](const Vector3 &v, float amount) {
+		return Vector3{ v.x + random.Range(-amount, amount), v.y + random.Range(-amount, amount), v.z + random.Range(-amount, amount) };
+	};
+
+	for (int i = 0; i < count; i++) {
+		FrameInput frame = {};
+		float yaw = random.Range(-3, 3);
+		frame.hmd.rot = SyntheticSession::BasisFromForward({ std::sin(yaw), std::cos(yaw), random.Range(-0.4f, 0.4f) }, { 0, 0, 1 });
+		frame.hmd.pos = { random.Range(-1000, 1000), random.Range(-1000, 1000), random.Range(0, 200) };
+		SyntheticSession::Posture right = SyntheticSession::crossGuardPosture, left = SyntheticSession::crossGuardPosture;
+		right.offset = perturbed(right.offset, 0.15f);
+		left.offset = perturbed(left.offset, 0.15f);
+		right.bladeDirection = perturbed(right.bladeDirection, 0.5f);
+		left.bladeDirection = perturbed(left.bladeDirection, 0.5f);
+		SyntheticSession::PlaceHands(frame, config, right, left);
+		frame.rightHandSpeed = random.Range(0, 4);
+		frame.leftHandSpeed = random.Range(0, 4);
+		if (i % 97 == 0) frame.rightHandSpeed = std::numeric_limits<float>::quiet_NaN();
+		frame.isBlockingGraph = random.Uniform() < 0.5f;
+		frame.isLeftHanded = random.Uniform() < 0.2f;
+		frame.rightWandMotion.velocity = { random.Range(-2, 2), random.Range(-2, 2), random.Range(-2, 2) };
+		frame.leftWandMotion.angularVelocity = { random.Range(-5, 5), random.Range(-5, 5), random.Range(-5, 5) };
+
+		cases.push_back(MakeCase(frame, config, false, random.Uniform() < 0.5f ? 30.f : 0.f));
+	}
+}
+
+static CrossGuardTest TestCase(const Config &config, const Case &c)
+{
+	HandSample current[kNumHandIndices] = { { c.hmd, c.mainWand, c.mainSpeed }, { c.hmd, c.offWand, c.offSpeed } };
+	HandSample predicted[kNumHandIndices] = { { c.predictedHmd, c.predictedMainWand, c.mainSpeed }, { c.predictedHmd, c.predictedOffWand, c.offSpeed } };
+	const HandSample (&enter)[kNumHandIndices] = c.isPredicted ? predicted : current;
+	return TestCrossGuard(config, current, enter);
+}
+
+template <typename Classify>
+static double TimeNsPerCase(const std::vector<Case> &cases, int iterations, unsigned &sink, Classify classify)
+{
+	double bestNs = 1e30;
+	for (int pass = 0; pass < iterations; pass++) {
+		auto start = std::chrono::steady_clock::now();
+		for (const Case &c : cases) {
+			HandStatus statuses[kNumHandIndices];
+			classify(c, statuses);
+			sink += statuses[0] * 3 + statuses[1];
+		}
+		auto end = std::chrono::steady_clock::now();
+		double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / cases.size();
+		if (ns < bestNs) bestNs = ns;
+	}
+	return bestNs;
+}
+
+int main(int argc, char **argv)
+{
+	std::string tracePath;
+	int iterations = 20;
+	int numRandom = 200000;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--iterations" && hasValue) iterations = atoi(argv[++i]);
+		else if (arg == "--random" && hasValue) numRandom = atoi(argv[++i]);
+		else if (arg[0] != '-' && tracePath.empty()) tracePath = arg;
+		else {
+			printf("usage: classifierbench [trace] [--iterations <n>] [--random <n>]\n");
+			return 2;
+		}
+	}
+	if (iterations < 1) iterations = 1;
+
+	Config config;
+	std::vector<FrameInput> frames;
+	if (tracePath.empty()) {
+		SyntheticSession::Options options;
+		options.seconds = 300;
+		options.crossGuardChance = 0.5;
+		frames = SyntheticSession::Generate(options, config);
+	}
+	else {
+		std::string error;
+		if (!FrameTrace::Read(tracePath, frames, error)) {
+			fprintf(stderr, "failed to read %s: %s\n", tracePath.c_str(), error.c_str());
+			return 1;
+		}
+	}
+
+	// Every frame as weapons and as unarmed, with and without prediction
+	std::vector<Case> traceCases;
+	for (const FrameInput &frame : frames) {
+		for (int isUnarmed = 0; isUnarmed < 2; isUnarmed++) {
+			traceCases.push_back(MakeCase(frame, config, isUnarmed != 0, 0));
+			traceCases.push_back(MakeCase(frame, config, isUnarmed != 0, 30));
+		}
+	}
+	std::vector<Case> randomCases;
+	AddRandomCases(randomCases, config, numRandom);
+	std::vector<Case> crossedCases;
+	AddCrossedCases(crossedCases, config, numRandom);
+
+	int result = 0;
+	for (const std::vector<Case> *cases : { &traceCases, &randomCases }) {
+		size_t numScalarMismatches = 0, numVectorMismatches = 0;
+		int numStatuses[3] = {};
+		for (const Case &c : *cases) {
+			HandStatus expected[kNumHandIndices], scalar[kNumHandIndices], vector[kNumHandIndices];
+			ClassifyPerHand(config, c, expected);
+			ClassifyDual<false>(config, c, scalar);
+			ClassifyDual<true>(config, c, vector);
+			for (int hand = 0; hand < kNumHandIndices; hand++) {
+				numStatuses[expected[hand]]++;
+				if (scalar[hand] != expected[hand]) numScalarMismatches++;
+				if (vector[hand] != expected[hand]) numVectorMismatches++;
+			}
+		}
+		printf("%s: %zu cases (%d none, %d stop, %d start), %zu scalar / %zu vector mismatches\n", cases == &traceCases ? "trace" : "random",
+			cases->size(), numStatuses[kHandStatus_None], numStatuses[kHandStatus_Stop], numStatuses[kHandStatus_Start], numScalarMismatches, numVectorMismatches);
+		if (numScalarMismatches || numVectorMismatches) result = 1;
+	}
+
+	for (const std::vector<Case> *cases : { &traceCases, &randomCases, &crossedCases }) {
+		size_t numInside = 0, numOutside = 0;
+		for (const Case &c : *cases) {
+			CrossGuardTest test = TestCase(config, c);
+			numInside += test.isInside;
+			numOutside += test.isOutside;
+		}
+		printf("cross guard %s: %zu cases (%zu inside, %zu outside)\n",
+			cases == &traceCases ? "trace" : cases == &randomCases ? "random" : "crossed", cases->size(), numInside, numOutside);
+	}
+
+	unsigned sink = 0;
+	double perHandNs = TimeNsPerCase(traceCases, iterations, sink, [&config](const Case &c, HandStatus (&out)[kNumHandIndices]) { ClassifyPerHand(config, c, out); });
+	double scalarNs = TimeNsPerCase(traceCases, iterations, sink, [&config](const Case &c, HandStatus (&out)[kNumHandIndices]) { ClassifyDual<false>(config, c, out); });
+	double vectorNs = TimeNsPerCase(traceCases, iterations, sink, [&config](const Case &c, HandStatus (&out)[kNumHandIndices]) { ClassifyDual<true>(config, c, out); });
+
+	printf("per hand functions: %6.2f ns per frame\n", perHandNs);
+	printf("dual hand scalar:   %6.2f ns per frame\n", scalarNs);
+	printf("dual hand %s:      %6.2f ns per frame (sink %u)\n", IsDualHandClassifierVectorized() ? "sse" : "n/a", vectorNs, sink);
+
+	auto crossGuardStatuses = [](CrossGuardTest test, bool isBlocking, HandStatus (&out)[kNumHandIndices]) {
+		out[0] = GetCrossGuardStatus(test, isBlocking);
+		out[1] = kHandStatus_None;
+	};
+	double crossNs = TimeNsPerCase(traceCases, iterations, sink, [&](const Case &c, HandStatus (&out)[kNumHandIndices]) { crossGuardStatuses(TestCase(config, c), c.isBlocking, out); });
+	printf("cross guard:        %6.2f ns per frame (sink %u)\n", crossNs, sink);
+
+	if (result) printf("CLASSIFIERS DISAGREE\n");
+	return result;
+}
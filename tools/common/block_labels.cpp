@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "block_labels.h"
+
+
+namespace BlockLabels
+{
+	std::string PathForTrace(const std::string &tracePath)
+	{
+		return tracePath + ".labels";
+	}
+
+	bool Write(const std::string &path, const std::vector<Interval> &intervals)
+	{
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file) return false;
+
+		fprintf(file, "DWBVR_LABELS %d\n", version);
+		fprintf(file, "# start_ns end_ns of each guard\n");
+		for (const Interval &interval : intervals) {
+			fprintf(file, "%llu %llu\n", (unsigned long long)interval.startNs, (unsigned long long)interval.endNs);
+		}
+
+		bool ok = !ferror(file);
+		fclose(file);
+		return ok;
+	}
+
+	bool Read(const std::string &path, std::vector<Interval> &intervals, std::string &error)
+	{
+		std::ifstream file(path);
+		if (!file) {
+			error = "could not open " + path;
+			return false;
+		}
+
+		std::string line;
+		int fileVersion = 0;
+		if (!std::getline(file, line) || sscanf(line.c_str(), "DWBVR_LABELS %d", &fileVersion) != 1 || fileVersion < 1 || fileVersion > version) {
+			error = "not a version " + std::to_string(version) + " labels file";
+			return false;
+		}
+
+		int lineNumber = 1;
+		while (std::getline(file, line)) {
+			lineNumber++;
+			if (line.empty() || line[0] == '#') continue;
+
+			std::istringstream stream(line);
+			unsigned long long start, end;
+			if (!(stream >> start >> end) || end < start) {
+				error = "malformed interval on line " + std::to_string(lineNumber);
+				return false;
+			}
+			intervals.push_back({ start, end });
+		}
+
+		std::sort(intervals.begin(), intervals.end(), [](const Interval &a, const Interval &b) { return a.startNs < b.startNs; });
+		return true;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// When the player meant to block, as time intervals in the timestamps of a frame trace. Kept next to the trace as <trace>.labels.
+// Generated sessions know this exactly, recordings have to be labelled by hand.
+namespace BlockLabels
+{
+	const int version = 1;
+
+	struct Interval
+	{
+		uint64_t startNs; // started raising the guard
+		uint64_t endNs; // started lowering it
+	};
+
+	// The labels path that goes with a trace
+	std::string PathForTrace(const std::string &tracePath);
+
+	bool Write(const std::string &path, const std::vector<Interval> &intervals);
+	// Intervals come back sorted by start time
+	bool Read(const std::string &path, std::vector<Interval> &intervals, std::string &error);
+}
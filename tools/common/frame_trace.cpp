@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "frame_trace.h"
+
+
+namespace FrameTrace
+{
+	static const char *s_handEquipNames[] = { "unarmed", "onehanded", "twohanded", "spell", "torch", "shield", "other" };
+	static const int s_numHandEquipNames = sizeof(s_handEquipNames) / sizeof(s_handEquipNames[0]);
+
+	const char * HandEquipName(BlockCore::HandEquip equip)
+	{
+		int index = (int)equip;
+		return index < s_numHandEquipNames ? s_handEquipNames[index] : "other";
+	}
+
+	bool ParseHandEquip(const std::string &name, BlockCore::HandEquip &out)
+	{
+		for (int i = 0; i < s_numHandEquipNames; i++) {
+			if (name == s_handEquipNames[i]) {
+				out = (BlockCore::HandEquip)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void WriteTransform(FILE *file, const BlockCore::Transform &t)
+	{
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				fprintf(file, " %.9g", t.rot.data[i][j]);
+			}
+		}
+		fprintf(file, " %.9g %.9g %.9g", t.pos.x, t.pos.y, t.pos.z);
+	}
+
+	static bool ReadTransform(std::istringstream &stream, BlockCore::Transform &t)
+	{
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				if (!(stream >> t.rot.data[i][j])) return false;
+			}
+		}
+		t.scale = 1.f;
+		return bool(stream >> t.pos.x >> t.pos.y >> t.pos.z);
+	}
+
+	static void WriteMotion(FILE *file, const BlockCore::Motion &m)
+	{
+		fprintf(file, " %.9g %.9g %.9g %.9g %.9g %.9g", m.velocity.x, m.velocity.y, m.velocity.z, m.angularVelocity.x, m.angularVelocity.y, m.angularVelocity.z);
+	}
+
+	static bool ReadMotion(std::istringstream &stream, BlockCore::Motion &m)
+	{
+		return bool(stream >> m.velocity.x >> m.velocity.y >> m.velocity.z >> m.angularVelocity.x >> m.angularVelocity.y >> m.angularVelocity.z);
+	}
+
+	bool Write(const std::string &path, const std::vector<BlockCore::FrameInput> &frames)
+	{
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file) return false;
+
+		fprintf(file, "DWBVR_FRAMES %d\n", version);
+		fprintf(file, "# timestamp_ns active main off lefthanded isblocking isblockinginternal rightspeed leftspeed hmd[12] right[12] left[12] hmdmotion[6] rightmotion[6] leftmotion[6] mainweapon offweapon\n");
+		for (const BlockCore::FrameInput &frame : frames) {
+			fprintf(file, "%llu %d %s %s %d %d %d %.9g %.9g",
+				(unsigned long long)frame.timestampNs, (int)frame.isActive, HandEquipName(frame.mainHand), HandEquipName(frame.offHand),
+				(int)frame.isLeftHanded, (int)frame.isBlockingGraph, (int)frame.isBlockingInternal,
+				frame.rightHandSpeed, frame.leftHandSpeed);
+			WriteTransform(file, frame.hmd);
+			WriteTransform(file, frame.rightWand);
+			WriteTransform(file, frame.leftWand);
+			WriteMotion(file, frame.hmdMotion);
+			WriteMotion(file, frame.rightWandMotion);
+			WriteMotion(file, frame.leftWandMotion);
+			fprintf(file, " %s %s\n", BlockCore::WeaponTypeName(frame.mainWeapon), BlockCore::WeaponTypeName(frame.offWeapon));
+		}
+
+		bool ok = !ferror(file);
+		fclose(file);
+		return ok;
+	}
+
+	bool Read(const std::string &path, std::vector<BlockCore::FrameInput> &frames, std::string &error)
+	{
+		std::ifstream file(path);
+		if (!file) {
+			error = "could not open " + path;
+			return false;
+		}
+
+		std::string line;
+		if (!std::getline(file, line)) {
+			error = "empty file";
+			return false;
+		}
+
+		int fileVersion = 0;
+		if (sscanf(line.c_str(), "DWBVR_FRAMES %d", &fileVersion) != 1 || fileVersion < 1 || fileVersion > version) {
+			error = "not a version " + std::to_string(version) + " frame trace";
+			return false;
+		}
+
+		int lineNumber = 1;
+		while (std::getline(file, line)) {
+			lineNumber++;
+			if (line.empty() || line[0] == '#') continue;
+
+			std::istringstream stream(line);
+			BlockCore::FrameInput frame = {};
+			int isActive, isLeftHanded, isBlockingGraph, isBlockingInternal;
+			std::string mainHand, offHand;
+			unsigned long long timestamp = (unsigned long long)(frames.size() + 1) * 1000000000ull / 90;
+			bool ok = fileVersion < 2 || bool(stream >> timestamp);
+			ok = ok && bool(stream >> isActive >> mainHand >> offHand >> isLeftHanded >> isBlockingGraph >> isBlockingInternal
+				>> frame.rightHandSpeed >> frame.leftHandSpeed);
+			ok = ok && ParseHandEquip(mainHand, frame.mainHand) && ParseHandEquip(offHand, frame.offHand);
+			ok = ok && ReadTransform(stream, frame.hmd) && ReadTransform(stream, frame.rightWand) && ReadTransform(stream, frame.leftWand);
+			ok = ok && (fileVersion < 3 || (ReadMotion(stream, frame.hmdMotion) && ReadMotion(stream, frame.rightWandMotion) && ReadMotion(stream, frame.leftWandMotion)));
+			if (fileVersion < 4) {
+				frame.mainWeapon = BlockCore::WeaponTypeFromHandEquip(frame.mainHand);
+				frame.offWeapon = BlockCore::WeaponTypeFromHandEquip(frame.offHand);
+			}
+			else {
+				std::string mainWeapon, offWeapon;
+				ok = ok && bool(stream >> mainWeapon >> offWeapon);
+				ok = ok && BlockCore::ParseWeaponType(mainWeapon.c_str(), frame.mainWeapon) && BlockCore::ParseWeaponType(offWeapon.c_str(), frame.offWeapon);
+			}
+			if (!ok) {
+				error = "malformed frame on line " + std::to_string(lineNumber);
+				return false;
+			}
+
+			frame.timestampNs = timestamp;
+			frame.isActive = isActive != 0;
+			frame.isLeftHanded = isLeftHanded != 0;
+			frame.isBlockingGraph = isBlockingGraph != 0;
+			frame.isBlockingInternal = isBlockingInternal != 0;
+			frames.push_back(frame);
+		}
+
+		return true;
+	}
+}
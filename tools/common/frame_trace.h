@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+
+
+// Text trace of BlockCore::FrameInput, one frame per line. Exact float round trip, so decisions replay bit for bit.
+namespace FrameTrace
+{
+	// Version 2 added the frame timestamp, version 3 the hmd / wand velocities, version 4 the weapon types.
+	// Version 1 traces are read as 90 Hz, traces before version 3 as having no velocities, and the weapon types of traces
+	// before version 4 are worked out from the HandEquip.
+	const int version = 4;
+
+	bool Write(const std::string &path, const std::vector<BlockCore::FrameInput> &frames);
+	bool Read(const std::string &path, std::vector<BlockCore::FrameInput> &frames, std::string &error);
+
+	const char * HandEquipName(BlockCore::HandEquip equip);
+	bool ParseHandEquip(const std::string &name, BlockCore::HandEquip &out);
+}
@@ -0,0 +1,260 @@
+#include <cmath>
+
+#include "synthetic_session.h"
+
+
+namespace SyntheticSession
+{
+	using namespace BlockCore;
+
+	const Posture restPosture = { { 0.25f, 0.25f, -0.55f }, { 0.1f, 0.8f, 0.6f } };
+	const Posture guardPosture = { { 0.12f, 0.35f, -0.12f }, { 0.95f, 0.1f, -0.25f } };
+	const Posture highPosture = { { 0.3f, 0.1f, 0.25f }, { 0.2f, -0.3f, 0.93f } };
+	const Posture crossGuardPosture = { { 0.2f, 0.35f, -0.2f }, { -0.55f, 0.2f, 0.8f } };
+
+	enum SegmentKind
+	{
+		kSegment_Rest,
+		kSegment_Guard,
+		kSegment_GuardOneHand,
+		kSegment_Swing,
+		kSegment_Menu
+	};
+
+	static Vector3 Add(const Vector3 &a, const Vector3 &b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	static Vector3 Lerp(const Vector3 &a, const Vector3 &b, float t) { return Add(a, (b - a) * t); }
+	static Vector3 Normalized(const Vector3 &v) { float length = std::sqrt(DotProduct(v, v)); return length ? v * (1.f / length) : Vector3{ 0, 1, 0 }; }
+	static Vector3 Cross(const Vector3 &a, const Vector3 &b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	static Vector3 Mirrored(const Vector3 &v) { return { -v.x, v.y, v.z }; }
+
+	// Build a rotation whose forward column points along the given direction
+	Matrix33 BasisFromForward(const Vector3 &forwardIn, const Vector3 &upHint)
+	{
+		Vector3 forward = Normalized(forwardIn);
+		Vector3 right = Cross(forward, upHint);
+		if (DotProduct(right, right) < 1e-6f) right = Cross(forward, { 1, 0, 0 });
+		right = Normalized(right);
+		Vector3 up = Cross(right, forward);
+
+		Matrix33 m;
+		m.data[0][0] = right.x; m.data[1][0] = right.y; m.data[2][0] = right.z;
+		m.data[0][1] = forward.x; m.data[1][1] = forward.y; m.data[2][1] = forward.z;
+		m.data[0][2] = up.x; m.data[1][2] = up.y; m.data[2][2] = up.z;
+		return m;
+	}
+
+	static Vector3 LocalToWorld(const Matrix33 &rot, const Vector3 &local)
+	{
+		return Add(Add(RightVector(rot) * local.x, ForwardVector(rot) * local.y), UpVector(rot) * local.z);
+	}
+
+	// Angular velocity that turns prev into current over dt, in world axes
+	static Vector3 AngularVelocity(const Matrix33 &prev, const Matrix33 &current, double dt)
+	{
+		Matrix33 delta = current * Transpose(prev);
+		float cosAngle = (delta.data[0][0] + delta.data[1][1] + delta.data[2][2] - 1.f) * 0.5f;
+		cosAngle = cosAngle < -1 ? -1 : (cosAngle > 1 ? 1 : cosAngle);
+		float angle = std::acos(cosAngle);
+		Vector3 axis = { delta.data[2][1] - delta.data[1][2], delta.data[0][2] - delta.data[2][0], delta.data[1][0] - delta.data[0][1] };
+		float length = std::sqrt(DotProduct(axis, axis));
+		if (length < 1e-7f) return { 0, 0, 0 };
+		return axis * (float)(angle / (length * dt));
+	}
+
+	static float SmoothStep(float t)
+	{
+		t = t < 0 ? 0 : (t > 1 ? 1 : t);
+		return t * t * (3 - 2 * t);
+	}
+
+	struct HandTrack
+	{
+		Posture from;
+		Posture to;
+	};
+
+	static Posture Blend(const HandTrack &track, float t)
+	{
+		float s = SmoothStep(t);
+		return { Lerp(track.from.offset, track.to.offset, s), Normalized(Lerp(track.from.bladeDirection, track.to.bladeDirection, s)) };
+	}
+
+	static Posture Mirrored(const Posture &posture)
+	{
+		return { Mirrored(posture.offset), Mirrored(posture.bladeDirection) };
+	}
+
+	void PlaceHands(FrameInput &frame, const Config &config, const Posture &right, const Posture &left)
+	{
+		const float unitsPerMeter = 1.f / config.havokWorldScale;
+		Transform *wands[2] = { &frame.rightWand, &frame.leftWand };
+		Posture postures[2] = { right, Mirrored(left) };
+		for (int hand = 0; hand < 2; hand++) {
+			Vector3 direction = LocalToWorld(frame.hmd.rot, postures[hand].bladeDirection);
+			wands[hand]->rot = BasisFromForward(direction, UpVector(frame.hmd.rot));
+			wands[hand]->pos = Add(frame.hmd.pos, LocalToWorld(frame.hmd.rot, postures[hand].offset) * unitsPerMeter);
+			wands[hand]->scale = 1.f;
+		}
+	}
+
+	static uint64_t TimestampNs(double now)
+	{
+		return (uint64_t)((now + 1.0) * 1e9); // start a second in, 0 means "never" to the cooldowns
+	}
+
+	std::vector<FrameInput> Generate(const Options &options, const Config &config, std::vector<BlockLabels::Interval> *guards)
+	{
+		std::vector<FrameInput> frames;
+		Random random(options.seed);
+
+		const double dt = 1.0 / options.rate;
+		const int numFrames = (int)(options.seconds * options.rate);
+		const float unitsPerMeter = 1.f / config.havokWorldScale;
+		const double graphLatency = options.graphLatencyMs / 1000.0;
+		const float hitChancePerFrame = (float)(options.hitChancePerSecond * dt);
+
+		frames.reserve(numFrames);
+
+		State state;
+		GraphModel graph;
+
+		HandTrack right = { restPosture, restPosture };
+		HandTrack left = { restPosture, restPosture };
+		SegmentKind segment = kSegment_Rest;
+		double segmentStart = 0;
+		double transitionTime = 0.2;
+		double segmentEnd = 0;
+
+		// Separate stream for velocity noise, so adding it did not change the poses of existing seeds
+		Random velocityNoise(options.seed ^ 0x5DEECE66Dull);
+		auto noisy = [&velocityNoise](const Vector3 &v, float amount) {
+			return Vector3{ v.x + velocityNoise.Range(-amount, amount), v.y + velocityNoise.Range(-amount, amount), v.z + velocityNoise.Range(-amount, amount) };
+		};
+
+		// Separate stream too, so sessions without cross guards stay the same
+		Random crossGuardRandom(options.seed ^ 0xC2B2AE3D27D4EB4Full);
+
+		FrameInput prev = {};
+		bool hasPrev = false;
+
+		for (int i = 0; i < numFrames; i++) {
+			double now = i * dt;
+
+			if (now >= segmentEnd) {
+				bool wasGuard = segment == kSegment_Guard || segment == kSegment_GuardOneHand;
+				if (guards && wasGuard) guards->back().endNs = TimestampNs(now);
+
+				right.from = Blend(right, 1);
+				left.from = Blend(left, 1);
+
+				float roll = random.Uniform();
+				segment = roll < 0.33f ? kSegment_Rest : roll < 0.63f ? kSegment_Guard : roll < 0.78f ? kSegment_GuardOneHand : roll < 0.97f ? kSegment_Swing : kSegment_Menu;
+
+				right.to = restPosture;
+				left.to = restPosture;
+				transitionTime = random.Range(0.12f, 0.35f);
+				double hold = random.Range(0.2f, 1.5f);
+
+				switch (segment) {
+				case kSegment_Guard: {
+					bool isCrossed = options.crossGuardChance > 0 && crossGuardRandom.Uniform() < options.crossGuardChance;
+					right.to = isCrossed ? crossGuardPosture : guardPosture;
+					left.to = right.to;
+					break;
+				}
+				case kSegment_GuardOneHand:
+					(random.Uniform() < 0.5f ? right : left).to = guardPosture;
+					break;
+				case kSegment_Swing:
+					(random.Uniform() < 0.5f ? right : left).to = highPosture;
+					transitionTime = random.Range(0.06f, 0.12f);
+					hold = random.Range(0.05f, 0.15f);
+					break;
+				case kSegment_Menu:
+					hold = random.Range(1.f, 3.f);
+					break;
+				default:
+					break;
+				}
+
+				segmentStart = now;
+				segmentEnd = now + transitionTime + hold;
+
+				// Going from one guard straight into another is one long guard
+				bool isGuard = segment == kSegment_Guard || segment == kSegment_GuardOneHand;
+				if (guards && isGuard && wasGuard) guards->back().endNs = TimestampNs(segmentEnd);
+				else if (guards && isGuard) guards->push_back({ TimestampNs(now), TimestampNs(segmentEnd) });
+			}
+
+			float t = (float)((now - segmentStart) / transitionTime);
+			Posture rightPosture = Blend(right, t);
+			Posture leftPosture = Blend(left, t);
+
+			FrameInput frame;
+			frame.timestampNs = TimestampNs(now);
+			frame.isActive = segment != kSegment_Menu;
+			frame.mainHand = options.mainHand;
+			frame.offHand = options.offHand;
+			frame.mainWeapon = WeaponTypeFromHandEquip(options.mainHand);
+			frame.offWeapon = WeaponTypeFromHandEquip(options.offHand);
+			frame.isLeftHanded = options.isLeftHanded;
+			frame.isBlockingInternal = false;
+
+			// Head sways and looks around a little
+			float yaw = (float)(0.6 * std::sin(now * 0.37) + 0.2 * std::sin(now * 1.3));
+			float pitch = (float)(0.15 * std::sin(now * 0.53));
+			Vector3 hmdForward = { std::sin(yaw) * std::cos(pitch), std::cos(yaw) * std::cos(pitch), std::sin(pitch) };
+			frame.hmd.rot = BasisFromForward(hmdForward, { 0, 0, 1 });
+			frame.hmd.pos = Vector3{ (float)(0.05 * std::sin(now * 0.8)), (float)(0.05 * std::sin(now * 0.6)), 1.7f } * unitsPerMeter;
+			frame.hmd.scale = 1.f;
+
+			Vector3 jitter[2];
+			for (int hand = 0; hand < 2; hand++) {
+				jitter[hand] = { random.Range(-0.002f, 0.002f), random.Range(-0.002f, 0.002f), random.Range(-0.002f, 0.002f) };
+			}
+			rightPosture.offset = Add(rightPosture.offset, jitter[0]);
+			leftPosture.offset = Add(leftPosture.offset, Mirrored(jitter[1]));
+			PlaceHands(frame, config, rightPosture, leftPosture);
+
+			// Velocities in m/s like the openvr ones the game thread gets. The noise only goes on the motions used for
+			// prediction, the hand speeds stay exact so older seeds keep producing the same decisions.
+			frame.hmdMotion = {};
+			frame.rightWandMotion = {};
+			frame.leftWandMotion = {};
+			frame.rightHandSpeed = 0;
+			frame.leftHandSpeed = 0;
+			if (hasPrev) {
+				const float metersPerSecond = (float)(config.havokWorldScale / dt);
+				const Transform *current[3] = { &frame.hmd, &frame.rightWand, &frame.leftWand };
+				const Transform *last[3] = { &prev.hmd, &prev.rightWand, &prev.leftWand };
+				Motion *motions[3] = { &frame.hmdMotion, &frame.rightWandMotion, &frame.leftWandMotion };
+				for (int device = 0; device < 3; device++) {
+					Vector3 velocity = (current[device]->pos - last[device]->pos) * metersPerSecond;
+					if (device == 1) frame.rightHandSpeed = DotProduct(velocity, velocity);
+					if (device == 2) frame.leftHandSpeed = DotProduct(velocity, velocity);
+					motions[device]->velocity = noisy(velocity, 0.03f);
+					motions[device]->angularVelocity = noisy(AngularVelocity(last[device]->rot, current[device]->rot, dt), 0.2f);
+				}
+			}
+			prev = frame;
+			hasPrev = true;
+
+			graph.Advance(now);
+			bool isHit = graph.isBlocking && random.Uniform() < hitChancePerFrame;
+			frame.isBlockingGraph = graph.isBlocking && !isHit;
+
+			Decision decision = Update(state, config, frame);
+			if (decision == kDecision_StartBlocking) graph.Notify(true, now, graphLatency);
+			else if (decision == kDecision_StopBlocking) graph.Notify(false, now, graphLatency);
+
+			frames.push_back(frame);
+		}
+
+		// A guard still held at the end ends with the session
+		if (guards && !guards->empty() && !frames.empty() && guards->back().endNs > frames.back().timestampNs) {
+			guards->back().endNs = frames.back().timestampNs;
+		}
+
+		return frames;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "blocking.h"
+#include "block_labels.h"
+
+
+// Deterministic fake play sessions for when there is no recording at hand.
+// The player alternates between resting, raising a guard and swinging, and the animation graph is simulated
+// by feeding the block decisions back into IsBlocking after a delay, so the generated trace is self-consistent.
+namespace SyntheticSession
+{
+	struct Options
+	{
+		double seconds = 60;
+		double rate = 90; // game updates per second
+		uint64_t seed = 1;
+		BlockCore::HandEquip mainHand = BlockCore::HandEquip::OneHanded;
+		BlockCore::HandEquip offHand = BlockCore::HandEquip::OneHanded;
+		bool isLeftHanded = false;
+		double graphLatencyMs = 35; // time from blockStart / blockStop until IsBlocking follows
+		double hitChancePerSecond = 0.5; // IsBlocking drops out for one frame when a hit lands on the block
+		double crossGuardChance = 0; // fraction of two handed guards held with the blades crossed instead
+	};
+
+	// Small xorshift generator so sessions are identical on every platform and standard library
+	struct Random
+	{
+		uint64_t state;
+
+		explicit Random(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+		uint64_t Next()
+		{
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return state * 0x2545F4914F6CDD1Dull;
+		}
+
+		// [0, 1)
+		float Uniform() { return (float)(Next() >> 40) / (float)(1ull << 24); }
+		float Range(float min, float max) { return min + (max - min) * Uniform(); }
+	};
+
+	// Hand placement relative to the hmd, in meters along the hmd's right / forward / up axes, for the right hand. The left hand is mirrored.
+	struct Posture
+	{
+		BlockCore::Vector3 offset;
+		BlockCore::Vector3 bladeDirection;
+	};
+
+	extern const Posture restPosture; // hands low, blades pointing forward: not blocking
+	extern const Posture guardPosture; // hands in front of the face, blades sideways: blocking
+	extern const Posture highPosture; // wound up for a swing
+	extern const Posture crossGuardPosture; // blades pointing up and inwards, crossed in front of the face
+
+	// Places both wands relative to frame.hmd
+	void PlaceHands(BlockCore::FrameInput &frame, const BlockCore::Config &config, const Posture &right, const Posture &left);
+
+	BlockCore::Matrix33 BasisFromForward(const BlockCore::Vector3 &forward, const BlockCore::Vector3 &upHint);
+
+	// Stand-in for the animation graph: IsBlocking follows blockStart / blockStop after a delay
+	struct GraphModel
+	{
+		bool isBlocking = false;
+		bool hasPending = false;
+		bool pendingValue = false;
+		double pendingTime = 0;
+		int numStartsToIgnore = 0; // pretend the graph was busy and dropped this many blockStart events
+
+		void Notify(bool start, double now, double latency)
+		{
+			if (start && numStartsToIgnore > 0) {
+				numStartsToIgnore--;
+				return;
+			}
+			hasPending = true;
+			pendingValue = start;
+			pendingTime = now + latency;
+		}
+
+		void Advance(double now)
+		{
+			if (hasPending && now >= pendingTime) {
+				isBlocking = pendingValue;
+				hasPending = false;
+			}
+		}
+	};
+
+	// guards, if given, receives the intervals the generated player held a guard (with one hand or both)
+	std::vector<BlockCore::FrameInput> Generate(const Options &options, const BlockCore::Config &config, std::vector<BlockLabels::Interval> *guards = nullptr);
+}
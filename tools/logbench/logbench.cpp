@@ -0,0 +1,191 @@
+// Stress benchmark for AsyncLog. Several threads log as fast as they can (or at a steady pace), every call is timed,
+// and everything that was not dropped is checked to come out of the sink intact. Also checks that the profiler and
+// latency reports the plugin logs fit in a log record without being cut short.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread -Isrc tools/logbench/logbench.cpp src/async_log.cpp src/latency_tracer.cpp src/profiler.cpp -o logbench
+//
+// Examples:
+//   logbench
+//   logbench --threads 4 --messages 200000 --capacity 1024 --max-p999-ns 2000
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_log.h"
+#include "latency_tracer.h"
+#include "profiler.h"
+
+
+AsyncLog g_asyncLog;
+
+static std::atomic<uint64_t> s_numLines = 0;
+static std::atomic<uint64_t> s_numMalformed = 0;
+static FILE *s_out = nullptr;
+
+static void CheckingSink(AsyncLog::Level level, uint64_t, const char *text)
+{
+	if (level == AsyncLog::kLevel_Warning) return; // drop reports
+
+	int thread, index;
+	double value;
+	char name[32];
+	if (sscanf(text, "thread %d message %d value %lf name %31s", &thread, &index, &value, name) != 4 ||
+		value != index * 0.5 || std::string(name) != "worker" + std::to_string(thread)) {
+		s_numMalformed++;
+	}
+	s_numLines++;
+	if (s_out) fprintf(s_out, "%s\n", text);
+}
+
+static std::vector<std::string> s_reportLines;
+
+static void CollectingSink(AsyncLog::Level, uint64_t, const char *text)
+{
+	s_reportLines.push_back(text);
+}
+
+// Logs a profiler and a latency report the way DumpProfile and RecordBlockLatency do, with counts and times well past
+// any session's, and checks that every line comes out of the log whole
+static int CheckReportLines()
+{
+	const uint64_t hugeCount = 99999999999ull; // 35 years of frames at 90 fps
+	const uint64_t hourNs = 3600ull * 1000 * 1000 * 1000;
+
+	Profiler profiler;
+	for (int i = 0; i < Profiler::kNumStages; i++) profiler.Record((Profiler::Stage)i, hourNs);
+	for (int i = 0; i < Profiler::kNumEarlyOuts; i++) profiler.CountEarlyOut((Profiler::EarlyOut)i, hugeCount);
+
+	// Blocks every other second that the graph shows 900 ms late, and poses a minute old
+	LatencyTracer tracer;
+	for (int frame = 0; frame < 10000; frame++) {
+		LatencyTracer::Sample sample = {};
+		sample.timestampNs = 60 * 1000000000ull + frame * 11000000ull;
+		sample.poseTimestampNs = frame * 11000000ull;
+		int phase = frame % 200;
+		sample.request = phase < 100 ? BlockCore::kDecision_StartBlocking : BlockCore::kDecision_StopBlocking;
+		sample.decision = phase == 0 ? BlockCore::kDecision_StartBlocking : phase == 100 ? BlockCore::kDecision_StopBlocking : BlockCore::kDecision_None;
+		sample.isBlockingGraph = sample.isBlockingDebounced = sample.isBlockingInternal = phase >= 82 && phase < 182;
+		sample.hasTestState = true;
+		tracer.Record(sample);
+	}
+
+	std::vector<std::string> lines;
+	profiler.Report(lines);
+	tracer.Report(lines);
+
+	s_reportLines.clear();
+	AsyncLog log;
+	log.Start(CollectingSink);
+	for (const std::string &line : lines) log.Message("  %s", line);
+	log.Stop();
+
+	int numCut = 0;
+	size_t longest = 0;
+	for (size_t i = 0; i < lines.size(); i++) {
+		longest = lines[i].size() > longest ? lines[i].size() : longest;
+		if (i >= s_reportLines.size() || s_reportLines[i] != "  " + lines[i]) {
+			printf("REPORT LINE CUT: %s\n", lines[i].c_str());
+			numCut++;
+		}
+	}
+	printf("report lines: %zu, longest %zu of %d characters\n", lines.size(), longest, AsyncLog::textCapacity - 1);
+	return numCut ? 1 : 0;
+}
+
+struct Phase
+{
+	const char *name;
+	int pauseEveryN; // 0 = flood
+	int pauseUs;
+};
+
+int main(int argc, char **argv)
+{
+	int numThreads = 2; // the game thread and the pose thread
+	int numMessages = 100000; // per thread and phase
+	uint32_t capacity = 1024;
+	double maxP999Ns = 0;
+	std::string outPath;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--threads" && hasValue) numThreads = atoi(argv[++i]);
+		else if (arg == "--messages" && hasValue) numMessages = atoi(argv[++i]);
+		else if (arg == "--capacity" && hasValue) capacity = (uint32_t)atoi(argv[++i]);
+		else if (arg == "--max-p999-ns" && hasValue) maxP999Ns = atof(argv[++i]);
+		else if (arg == "--out" && hasValue) outPath = argv[++i];
+		else {
+			printf("usage: logbench [--threads n] [--messages n] [--capacity n] [--max-p999-ns n] [--out file]\n");
+			return 2;
+		}
+	}
+
+	if (!outPath.empty()) s_out = fopen(outPath.c_str(), "w");
+
+	// Paced is a few messages per frame like real play, flood is far more than the flusher can take
+	const Phase phases[] = { { "paced", 4, 1000 }, { "flood", 0, 0 } };
+
+	int result = 0;
+	printf("%d threads, %d messages per thread, ring of %u\n", numThreads, numMessages, capacity);
+	printf("%-6s %10s %10s %9s %9s %9s %9s\n", "phase", "written", "dropped", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+
+	for (const Phase &phase : phases) {
+		AsyncLog log;
+		log.Start(CheckingSink, capacity, 5);
+		s_numLines = 0;
+
+		std::vector<LatencyHistogram> histograms(numThreads);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++) {
+			threads.emplace_back([&, t]() {
+				std::string name = "worker" + std::to_string(t);
+				for (int i = 0; i < numMessages; i++) {
+					auto start = std::chrono::steady_clock::now();
+					log.Message("thread %d message %d value %.1f name %s", t, i, i * 0.5, name);
+					auto end = std::chrono::steady_clock::now();
+					histograms[t].Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+					if (phase.pauseEveryN && i % phase.pauseEveryN == phase.pauseEveryN - 1) {
+						std::this_thread::sleep_for(std::chrono::microseconds(phase.pauseUs));
+					}
+				}
+			});
+		}
+		for (std::thread &thread : threads) thread.join();
+		log.Stop();
+
+		LatencyHistogram total;
+		for (const LatencyHistogram &histogram : histograms) total.Add(histogram);
+
+		uint64_t expected = (uint64_t)numThreads * numMessages;
+		printf("%-6s %10llu %10llu %9llu %9llu %9llu %9llu\n", phase.name, (unsigned long long)log.NumWritten(), (unsigned long long)log.NumDropped(),
+			(unsigned long long)total.Percentile(0.5), (unsigned long long)total.Percentile(0.99), (unsigned long long)total.Percentile(0.999), (unsigned long long)total.Max());
+
+		if (log.NumWritten() + log.NumDropped() != expected || s_numLines != log.NumWritten()) {
+			printf("LOST MESSAGES in %s: %llu written + %llu dropped != %llu\n", phase.name,
+				(unsigned long long)log.NumWritten(), (unsigned long long)log.NumDropped(), (unsigned long long)expected);
+			result = 1;
+		}
+		if (maxP999Ns > 0 && total.Percentile(0.999) > maxP999Ns) {
+			printf("TOO SLOW in %s: p99.9 exceeds %.0f ns\n", phase.name, maxP999Ns);
+			result = 1;
+		}
+	}
+
+	if (s_numMalformed) {
+		printf("MALFORMED LINES: %llu\n", (unsigned long long)s_numMalformed.load());
+		result = 1;
+	}
+	if (s_out) fclose(s_out);
+
+	if (CheckReportLines()) result = 1;
+
+	return result;
+}
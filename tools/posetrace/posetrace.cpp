@@ -0,0 +1,203 @@
+// Inspect pose traces recorded with RecordPoses = 1, or write a synthetic one through the real recorder.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread -Isrc -Itools/common tools/posetrace/posetrace.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp src/pose_trace.cpp src/pose_recorder.cpp -o posetrace
+//
+// Examples:
+//   posetrace info DualWieldBlockVR_20240101_120000.dwbp
+//   posetrace dump DualWieldBlockVR_20240101_120000.dwbp > poses.csv
+//   posetrace synth synthetic.dwbp --seconds 600 --rate 144
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blocking.h"
+#include "pose_recorder.h"
+#include "pose_trace.h"
+#include "synthetic_session.h"
+
+
+static long long FileSize(const std::string &path)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return -1;
+	fseek(file, 0, SEEK_END);
+	long long size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+static void PrintInfo(const std::string &path, const std::vector<PoseTrace::Sample> &samples)
+{
+	long long size = FileSize(path);
+	double seconds = samples.size() > 1 ? (samples.back().timestampNs - samples.front().timestampNs) / 1e9 : 0;
+
+	printf("samples:      %zu\n", samples.size());
+	printf("duration:     %.1f s (%.1f Hz)\n", seconds, seconds > 0 ? (samples.size() - 1) / seconds : 0.0);
+	printf("file size:    %lld bytes (%.2f bytes/sample)\n", size, samples.empty() ? 0.0 : (double)size / samples.size());
+	if (seconds > 0) {
+		printf("per hour:     %.2f MB\n", size / seconds * 3600 / (1024 * 1024));
+	}
+}
+
+static int Info(const std::string &path)
+{
+	PoseTrace::FileHeader header;
+	std::vector<PoseTrace::Sample> samples;
+	std::string error;
+	if (!PoseTrace::ReadFile(path, header, samples, error)) {
+		fprintf(stderr, "failed to read %s: %s\n", path.c_str(), error.c_str());
+		return 1;
+	}
+
+	printf("version:      %d, %u samples per block\n", header.version, header.samplesPerBlock);
+	PrintInfo(path, samples);
+	return 0;
+}
+
+static int Dump(const std::string &path)
+{
+	PoseTrace::FileHeader header;
+	std::vector<PoseTrace::Sample> samples;
+	std::string error;
+	if (!PoseTrace::ReadFile(path, header, samples, error)) {
+		fprintf(stderr, "failed to read %s: %s\n", path.c_str(), error.c_str());
+		return 1;
+	}
+
+	static const char *deviceNames[PoseTrace::kNumDevices] = { "hmd", "right", "left" };
+
+	printf("t_ms");
+	for (const char *name : deviceNames) {
+		printf(",%s_flags,%s_tracking,%s_px,%s_py,%s_pz,%s_vx,%s_vy,%s_vz,%s_wx,%s_wy,%s_wz", name, name, name, name, name, name, name, name, name, name, name);
+	}
+	printf("\n");
+
+	uint64_t start = samples.empty() ? 0 : samples[0].timestampNs;
+	for (const PoseTrace::Sample &sample : samples) {
+		printf("%.3f", (sample.timestampNs - start) / 1e6);
+		for (const PoseTrace::DevicePose &pose : sample.devices) {
+			printf(",%d,%d,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", pose.flags, pose.trackingResult,
+				pose.matrix[0][3], pose.matrix[1][3], pose.matrix[2][3],
+				pose.velocity[0], pose.velocity[1], pose.velocity[2],
+				pose.angularVelocity[0], pose.angularVelocity[1], pose.angularVelocity[2]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+// Pushes a generated session through PoseRecorder in real time order (but not real time), then reads it back
+static int Synth(const std::string &path, int argc, char **argv)
+{
+	SyntheticSession::Options options;
+	options.seconds = 60;
+	options.rate = 144;
+	for (int i = 0; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--seconds" && i + 1 < argc) options.seconds = atof(argv[++i]);
+		else if (arg == "--rate" && i + 1 < argc) options.rate = atof(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc) options.seed = strtoull(argv[++i], nullptr, 10);
+	}
+
+	BlockCore::Config config;
+	std::vector<BlockCore::FrameInput> frames = SyntheticSession::Generate(options, config);
+
+	PoseRecorder recorder;
+	if (!recorder.Start(path)) {
+		fprintf(stderr, "failed to open %s\n", path.c_str());
+		return 1;
+	}
+
+	const double dt = 1.0 / options.rate;
+	std::vector<double> pushNs;
+	pushNs.reserve(frames.size());
+
+	PoseTrace::Sample prev = {};
+	for (size_t i = 0; i < frames.size(); i++) {
+		const BlockCore::FrameInput &frame = frames[i];
+
+		PoseTrace::Sample sample;
+		sample.timestampNs = (uint64_t)(i * dt * 1e9);
+		const BlockCore::Transform *transforms[PoseTrace::kNumDevices] = { &frame.hmd, &frame.rightWand, &frame.leftWand };
+		for (int d = 0; d < PoseTrace::kNumDevices; d++) {
+			PoseTrace::DevicePose &pose = sample.devices[d];
+			PoseTrace::FromGameTransform(*transforms[d], config.havokWorldScale, pose);
+			for (int axis = 0; axis < 3; axis++) {
+				// OpenVR reports filtered velocities, so smooth the finite difference instead of storing raw jitter
+				float rawVelocity = i ? (float)((pose.matrix[axis][3] - prev.devices[d].matrix[axis][3]) / dt) : 0.f;
+				pose.velocity[axis] = prev.devices[d].velocity[axis] + 0.2f * (rawVelocity - prev.devices[d].velocity[axis]);
+				pose.angularVelocity[axis] = 0.f;
+			}
+			pose.trackingResult = 200; // TrackingResult_Running_OK
+			pose.flags = PoseTrace::kDeviceFlag_Connected | PoseTrace::kDeviceFlag_PoseValid;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		recorder.Push(sample);
+		auto end = std::chrono::steady_clock::now();
+		pushNs.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+		prev = sample;
+
+		// Give the writer a chance to keep up, like the real pose thread would at 144 Hz
+		if ((i & 255) == 255) std::this_thread::sleep_for(std::chrono::milliseconds(4));
+	}
+
+	recorder.Stop();
+
+	std::sort(pushNs.begin(), pushNs.end());
+	printf("pushed:       %zu samples, %llu dropped\n", frames.size(), (unsigned long long)recorder.NumDropped());
+	printf("push latency: p50 %.0f ns, p99 %.0f ns, max %.0f ns\n", pushNs[pushNs.size() / 2], pushNs[pushNs.size() * 99 / 100], pushNs.back());
+
+	PoseTrace::FileHeader header;
+	std::vector<PoseTrace::Sample> samples;
+	std::string error;
+	if (!PoseTrace::ReadFile(path, header, samples, error)) {
+		fprintf(stderr, "failed to read back %s: %s\n", path.c_str(), error.c_str());
+		return 1;
+	}
+	PrintInfo(path, samples);
+
+	// Round trip check against what was pushed, within the quantization of the format
+	if (samples.size() != frames.size()) {
+		fprintf(stderr, "read back %zu samples, expected %zu\n", samples.size(), frames.size());
+		return 1;
+	}
+	float maxPositionError = 0, maxForwardError = 0;
+	for (size_t i = 0; i < frames.size(); i++) {
+		const BlockCore::Transform *transforms[PoseTrace::kNumDevices] = { &frames[i].hmd, &frames[i].rightWand, &frames[i].leftWand };
+		for (int d = 0; d < PoseTrace::kNumDevices; d++) {
+			BlockCore::Transform decoded;
+			PoseTrace::ToGameTransform(samples[i].devices[d], config.havokWorldScale, decoded);
+			BlockCore::Vector3 positionError = (decoded.pos - transforms[d]->pos) * config.havokWorldScale;
+			BlockCore::Vector3 forwardError = BlockCore::ForwardVector(decoded.rot) - BlockCore::ForwardVector(transforms[d]->rot);
+			maxPositionError = std::max(maxPositionError, std::sqrt(BlockCore::DotProduct(positionError, positionError)));
+			maxForwardError = std::max(maxForwardError, std::sqrt(BlockCore::DotProduct(forwardError, forwardError)));
+		}
+	}
+	printf("max error:    %.2f mm position, %.5f forward vector\n", maxPositionError * 1000, maxForwardError);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		printf("usage: posetrace info <file>\n       posetrace dump <file>\n       posetrace synth <file> [--seconds n] [--rate hz] [--seed n]\n");
+		return 2;
+	}
+
+	std::string command = argv[1];
+	if (command == "info") return Info(argv[2]);
+	if (command == "dump") return Dump(argv[2]);
+	if (command == "synth") return Synth(argv[2], argc - 3, argv + 3);
+
+	fprintf(stderr, "unknown command %s\n", command.c_str());
+	return 2;
+}
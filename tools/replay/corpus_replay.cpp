@@ -0,0 +1,243 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "clock.h"
+#include "corpus_replay.h"
+#include "pose_classifier.h"
+#include "pose_trace_reader.h"
+#include "synthetic_session.h"
+
+
+static const int32_t trackingRunningOk = 200; // vr::TrackingResult_Running_OK
+static const uint64_t timestampOffsetNs = 1000000000ull; // start a second in, 0 means "never" to the cooldowns
+
+// One replay of consecutive samples from a fresh state, as the plugin would see them with ClassifyOnPoseThread = 1
+class PoseSession
+{
+public:
+	PoseSession(const BlockCore::Config &config, const CorpusOptions &options) : config(config), graphLatency(options.graphLatencyMs / 1000.0)
+	{
+		context = {};
+		context.isActive = true;
+		context.mainHand = options.mainHand;
+		context.offHand = options.offHand;
+		context.mainWeapon = BlockCore::WeaponTypeFromHandEquip(options.mainHand);
+		context.offWeapon = BlockCore::WeaponTypeFromHandEquip(options.offHand);
+		context.isLeftHanded = options.isLeftHanded;
+		context.havokWorldScale = config.havokWorldScale;
+
+		// The traces are in tracking space, so that is the world, and the wands are the controllers
+		BlockCore::Transform identity = {};
+		for (int i = 0; i < 3; i++) identity.rot.data[i][i] = 1;
+		identity.scale = 1;
+		context.trackingToWorld = identity;
+		for (BlockCore::Transform &controllerToWand : context.controllerToWand) controllerToWand = identity;
+
+		kinematics = {};
+	}
+
+	BlockCore::Decision Step(const PoseTrace::Sample &sample)
+	{
+		// Like the pose callback: nothing happens without a tracked hmd, hands that are not tracked keep their last pose
+		uint64_t now = sample.timestampNs + timestampOffsetNs;
+		if (!IsTracked(sample.devices[PoseTrace::kDevice_Hmd])) return BlockCore::kDecision_None;
+		SetDevice(kinematics.hmd, sample.devices[PoseTrace::kDevice_Hmd], now);
+		if (IsTracked(sample.devices[PoseTrace::kDevice_RightHand])) SetDevice(kinematics.hands[kHand_Right], sample.devices[PoseTrace::kDevice_RightHand], now);
+		if (IsTracked(sample.devices[PoseTrace::kDevice_LeftHand])) SetDevice(kinematics.hands[kHand_Left], sample.devices[PoseTrace::kDevice_LeftHand], now);
+		kinematics.timestampNs = now;
+
+		double seconds = now * 1e-9;
+		graph.Advance(seconds);
+		context.timestampNs = now;
+		context.isBlockingGraph = graph.isBlocking;
+
+		BlockCore::FrameInput frame = {};
+		if (!PoseClassifier::BuildFrameInput(context, kinematics, now, frame)) return BlockCore::kDecision_None;
+		BlockCore::Decision decision = BlockCore::Update(state, config, frame);
+		if (decision == BlockCore::kDecision_StartBlocking) graph.Notify(true, seconds, graphLatency);
+		else if (decision == BlockCore::kDecision_StopBlocking) graph.Notify(false, seconds, graphLatency);
+		return decision;
+	}
+
+private:
+	static bool IsTracked(const PoseTrace::DevicePose &pose)
+	{
+		const uint8_t tracked = PoseTrace::kDeviceFlag_Connected | PoseTrace::kDeviceFlag_PoseValid;
+		return (pose.flags & tracked) == tracked && pose.trackingResult == trackingRunningOk;
+	}
+
+	static void SetDevice(DeviceKinematics &device, const PoseTrace::DevicePose &pose, uint64_t now)
+	{
+		PoseTrace::ToGameTransform(pose, 1.f, device.pose);
+		device.velocity = PoseTrace::ToGameAxes(pose.velocity);
+		device.angularVelocity = PoseTrace::ToGameAxes(pose.angularVelocity);
+		device.timestampNs = now;
+	}
+
+	const BlockCore::Config &config;
+	const double graphLatency;
+	BlockCore::State state;
+	SyntheticSession::GraphModel graph;
+	PoseClassifier::GameContext context;
+	KinematicsSnapshot kinematics;
+};
+
+// Blocks [first, end) of one file, replayed from warmupBlock on
+struct Chunk
+{
+	size_t file;
+	size_t warmupBlock;
+	size_t firstBlock;
+	size_t endBlock;
+	std::vector<CorpusDecision> decisions;
+	bool isCorrupt = false;
+};
+
+static void ReplayChunk(const PoseTrace::MappedTrace &trace, uint64_t firstSample, const BlockCore::Config &config, const CorpusOptions &options,
+	std::vector<PoseTrace::Sample> &samples, Chunk &chunk)
+{
+	PoseSession session(config, options);
+	for (size_t block = chunk.warmupBlock; block < chunk.endBlock; block++) {
+		if (!trace.DecodeBlock(block, samples)) {
+			chunk.isCorrupt = true;
+			return;
+		}
+		bool isWarmup = block < chunk.firstBlock;
+		uint64_t sample = firstSample + trace.Blocks()[block].firstSample;
+		for (const PoseTrace::Sample &poses : samples) {
+			BlockCore::Decision decision = session.Step(poses);
+			if (decision != BlockCore::kDecision_None && !isWarmup) chunk.decisions.push_back({ sample, decision });
+			sample++;
+		}
+	}
+}
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000;
+}
+
+// The baseline the chunks have to agree with: every file read whole into memory, then replayed start to end
+static int ReplaySequentially(const std::vector<std::string> &paths, const BlockCore::Config &config, const CorpusOptions &options,
+	std::vector<CorpusDecision> &decisions)
+{
+	uint64_t firstSample = 0;
+	for (const std::string &path : paths) {
+		PoseTrace::FileHeader header;
+		std::vector<PoseTrace::Sample> samples;
+		std::string error;
+		if (!PoseTrace::ReadFile(path, header, samples, error)) {
+			fprintf(stderr, "failed to read %s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+
+		PoseSession session(config, options);
+		for (size_t i = 0; i < samples.size(); i++) {
+			BlockCore::Decision decision = session.Step(samples[i]);
+			if (decision != BlockCore::kDecision_None) decisions.push_back({ firstSample + i, decision });
+		}
+		firstSample += samples.size();
+	}
+	return 0;
+}
+
+int RunCorpusReplay(const std::vector<std::string> &paths, const BlockCore::Config &config, const CorpusOptions &options, std::vector<CorpusDecision> &decisions)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::unique_ptr<PoseTrace::MappedTrace>> traces;
+	std::vector<uint64_t> firstSamples;
+	uint64_t numSamples = 0, durationNs = 0;
+	size_t numBlocks = 0;
+	for (const std::string &path : paths) {
+		traces.emplace_back(new PoseTrace::MappedTrace);
+		std::string error;
+		if (!traces.back()->Open(path, error)) {
+			fprintf(stderr, "failed to read %s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+		const std::vector<PoseTrace::BlockIndexEntry> &blocks = traces.back()->Blocks();
+		firstSamples.push_back(numSamples);
+		numSamples += traces.back()->NumSamples();
+		numBlocks += blocks.size();
+		if (!blocks.empty()) durationNs += blocks.back().header.firstTimestampNs - blocks.front().header.firstTimestampNs;
+	}
+
+	// Cut on block boundaries, every chunk at least chunkSeconds long except the last of a file
+	const uint64_t chunkNs = MsToNs(options.chunkSeconds * 1000);
+	const uint64_t warmupNs = MsToNs(options.warmupSeconds * 1000);
+	std::vector<Chunk> chunks;
+	for (size_t file = 0; file < traces.size(); file++) {
+		const std::vector<PoseTrace::BlockIndexEntry> &blocks = traces[file]->Blocks();
+		for (size_t first = 0; first < blocks.size(); ) {
+			uint64_t firstNs = blocks[first].header.firstTimestampNs;
+			size_t end = first + 1;
+			while (end < blocks.size() && blocks[end].header.firstTimestampNs - firstNs < chunkNs) end++;
+
+			Chunk chunk;
+			chunk.file = file;
+			chunk.warmupBlock = first ? traces[file]->FindBlock(firstNs > warmupNs ? firstNs - warmupNs : 0) : 0;
+			chunk.firstBlock = first;
+			chunk.endBlock = end;
+			chunks.push_back(std::move(chunk));
+			first = end;
+		}
+	}
+
+	int numThreads = options.numThreads > 0 ? options.numThreads : (int)std::thread::hardware_concurrency();
+	if (numThreads < 1) numThreads = 1;
+	if (numThreads > (int)chunks.size()) numThreads = chunks.size() ? (int)chunks.size() : 1;
+
+	std::atomic<size_t> nextChunk(0);
+	auto worker = [&]() {
+		std::vector<PoseTrace::Sample> samples;
+		for (size_t i = nextChunk++; i < chunks.size(); i = nextChunk++) {
+			Chunk &chunk = chunks[i];
+			ReplayChunk(*traces[chunk.file], firstSamples[chunk.file], config, options, samples, chunk);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++) threads.emplace_back(worker);
+	worker();
+	for (std::thread &thread : threads) thread.join();
+
+	// Chunks are in file and time order, so this is too
+	for (const Chunk &chunk : chunks) {
+		if (chunk.isCorrupt) {
+			fprintf(stderr, "failed to read %s: corrupt block\n", paths[chunk.file].c_str());
+			return 1;
+		}
+		decisions.insert(decisions.end(), chunk.decisions.begin(), chunk.decisions.end());
+	}
+	double parallelMs = MsSince(start);
+
+	printf("poses:     %zu files, %llu samples, %.2f hours, %zu blocks\n", paths.size(), (unsigned long long)numSamples, durationNs / 3.6e12, numBlocks);
+	printf("parallel:  %zu chunks of %.0f s after %.0f s of warm up, %d threads: %.1f ms (%.2f M samples/s)\n", chunks.size(), options.chunkSeconds,
+		options.warmupSeconds, numThreads, parallelMs, parallelMs > 0 ? numSamples / parallelMs / 1000 : 0.0);
+
+	if (!options.isVerifying) return 0;
+
+	start = std::chrono::steady_clock::now();
+	std::vector<CorpusDecision> expected;
+	if (ReplaySequentially(paths, config, options, expected)) return 1;
+	double sequentialMs = MsSince(start);
+	printf("sequential, whole files read first: %.1f ms (%.1fx the parallel time)\n", sequentialMs, parallelMs > 0 ? sequentialMs / parallelMs : 0.0);
+
+	size_t count = expected.size() < decisions.size() ? expected.size() : decisions.size();
+	for (size_t i = 0; i < count; i++) {
+		if (expected[i].sample != decisions[i].sample || expected[i].decision != decisions[i].decision) {
+			printf("PARALLEL REPLAY DIFFERS: decision %zu is %d at sample %llu, %d at sample %llu sequentially\n", i, (int)decisions[i].decision,
+				(unsigned long long)decisions[i].sample, (int)expected[i].decision, (unsigned long long)expected[i].sample);
+			return 1;
+		}
+	}
+	if (expected.size() != decisions.size()) {
+		printf("PARALLEL REPLAY DIFFERS: %zu decisions, %zu sequentially\n", decisions.size(), expected.size());
+		return 1;
+	}
+	printf("  same decisions as the sequential replay\n");
+	return 0;
+}
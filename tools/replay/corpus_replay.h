@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "blocking.h"
+
+
+struct CorpusOptions
+{
+	BlockCore::HandEquip mainHand = BlockCore::HandEquip::OneHanded;
+	BlockCore::HandEquip offHand = BlockCore::HandEquip::OneHanded;
+	bool isLeftHanded = false;
+	double graphLatencyMs = 35; // time from blockStart / blockStop until IsBlocking follows
+	int numThreads = 0; // 0 for one per core
+	double chunkSeconds = 60; // how much of a trace one thread replays at a time
+	double warmupSeconds = 5; // replayed ahead of each chunk and thrown away, so the chunk starts from a settled state
+	bool isVerifying = false; // also read every file whole and replay it start to end on one thread, and compare
+};
+
+struct CorpusDecision
+{
+	uint64_t sample; // counted across the files, in the order given
+	BlockCore::Decision decision;
+};
+
+// Replays pose traces (RecordPoses = 1) through BlockCore::Update. The traces are read in place with
+// PoseTrace::MappedTrace and cut into chunks on block boundaries, which are replayed on all threads at once. Each sample
+// becomes a frame the way the pose thread builds one (PoseClassifier::BuildFrameInput) with the given equipment, and a
+// stand-in for the animation graph answers the decisions, so the replay is closed loop. A chunk starts from a fresh state
+// warmupSeconds early. The cooldowns, the graph and the jitter filters settle well within that, so the decisions should be
+// the ones a replay from the start of the file makes; isVerifying checks that they are. Prints the timings.
+// Returns 0 if every file could be read and nothing differed.
+int RunCorpusReplay(const std::vector<std::string> &paths, const BlockCore::Config &config, const CorpusOptions &options, std::vector<CorpusDecision> &decisions);
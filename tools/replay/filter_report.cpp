@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "filter_report.h"
+
+
+// A filtered start counts as the same block as an unfiltered one if it follows it within this window
+static const double matchWindowMs = 250;
+
+static const char *filterNames[BlockCore::kNumJitterFilters] = { "right speed", "left speed", "hmd rotation", "right rotation", "left rotation" };
+
+struct FilterRun
+{
+	std::vector<uint64_t> starts;
+	int numStops = 0;
+	std::vector<double> lagsMs[BlockCore::kNumJitterFilters];
+};
+
+static FilterRun Run(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config)
+{
+	FilterRun run;
+	BlockCore::State state;
+	for (const BlockCore::FrameInput &frame : frames) {
+		BlockCore::Decision decision = BlockCore::Update(state, config, frame);
+		if (decision == BlockCore::kDecision_StartBlocking) run.starts.push_back(frame.timestampNs);
+		else if (decision == BlockCore::kDecision_StopBlocking) run.numStops++;
+
+		if (!state.isLastUpdateValid) continue;
+		for (int filter = 0; filter < BlockCore::kNumJitterFilters; filter++) {
+			run.lagsMs[filter].push_back(state.jitterFilter.lagSeconds[filter] * 1000.0);
+		}
+	}
+	return run;
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+	if (values.empty()) return 0;
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+	return values[index];
+}
+
+static double Mean(const std::vector<double> &values)
+{
+	double sum = 0;
+	for (double value : values) sum += value;
+	return values.empty() ? 0 : sum / values.size();
+}
+
+void PrintFilterReport(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config)
+{
+	if (frames.empty()) return;
+
+	BlockCore::Config unfilteredConfig = config;
+	unfilteredConfig.speedFilter.minCutoffHz = 0;
+	unfilteredConfig.rotationFilter.minCutoffHz = 0;
+	FilterRun unfiltered = Run(frames, unfilteredConfig);
+	FilterRun filtered = Run(frames, config);
+
+	printf("filters:   speed %.2f Hz + %.2f beta, rotation %.2f Hz + %.2f beta\n", config.speedFilter.minCutoffHz, config.speedFilter.beta,
+		config.rotationFilter.minCutoffHz, config.rotationFilter.beta);
+	printf("  filter           lag (ms) mean / p50 / p99\n");
+	for (int filter = 0; filter < BlockCore::kNumJitterFilters; filter++) {
+		bool isEnabled = filter < BlockCore::kJitterFilter_HmdRotation ? config.speedFilter.IsEnabled() : config.rotationFilter.IsEnabled();
+		if (!isEnabled) {
+			printf("  %-15s  off\n", filterNames[filter]);
+			continue;
+		}
+		const std::vector<double> &lags = filtered.lagsMs[filter];
+		printf("  %-15s  %6.1f / %5.1f / %5.1f\n", filterNames[filter], Mean(lags), Percentile(lags, 0.5), Percentile(lags, 0.99));
+	}
+
+	// Both lists are sorted, walk them together
+	std::vector<double> delaysMs;
+	size_t unmatched = 0, next = 0;
+	for (uint64_t start : unfiltered.starts) {
+		while (next < filtered.starts.size() && filtered.starts[next] < start) next++;
+
+		if (next < filtered.starts.size() && (double)filtered.starts[next] <= (double)start + matchWindowMs * 1e6) {
+			delaysMs.push_back(((double)filtered.starts[next] - (double)start) / 1e6);
+			next++;
+		}
+		else {
+			unmatched++;
+		}
+	}
+
+	printf("  decisions        %zu start, %d stop unfiltered -> %zu start, %d stop filtered\n", unfiltered.starts.size(), unfiltered.numStops,
+		filtered.starts.size(), filtered.numStops);
+	printf("  start delay (ms) %.1f mean / %.1f p50 / %.1f p90, %zu unfiltered starts with no filtered start\n", Mean(delaysMs),
+		Percentile(delaysMs, 0.5), Percentile(delaysMs, 0.9), unmatched);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include "blocking.h"
+
+
+// Replays the frames with the jitter filters in config and prints the lag each filter adds (mean / p50 / p99 over the
+// frames it ran on), then how the block decisions moved compared to a replay with the filters off: how many starts and
+// stops each run made and how much later the filtered starts come.
+void PrintFilterReport(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config);
@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstdio>
+
+#include "is_blocking_check.h"
+#include "is_blocking_tracker.h"
+
+
+enum EventTiming
+{
+	kEvent_AtStart = 0,
+	kEvent_FrameBefore,
+	kEvent_BothEnds,
+	kNumEventTimings
+};
+
+static const char *eventTimingNames[kNumEventTimings] = { "at start", "frame before", "both ends" };
+
+struct DipResult
+{
+	int firstDifferingFrame = -1;
+	int numReads = 0;
+	int numFrames = 0;
+};
+
+// Blocking throughout, one dip of dipMs starting at 1 s, then a second of nothing happening
+static DipResult PlayDip(const BlockCore::Config &config, float pollIntervalMs, double rate, double dipMs, EventTiming timing)
+{
+	const double dt = 1.0 / rate;
+	const double dipStart = 1.0;
+	const double dipEnd = dipStart + dipMs / 1000;
+	const double endTime = 2.0;
+	const double epsilon = 1e-9;
+
+	DipResult result;
+	BlockCore::State everyFrame, tracked;
+	IsBlockingTracker tracker;
+	tracker.pollIntervalMs = pollIntervalMs;
+	tracker.debounceMs = config.isBlockingDebounceMs;
+
+	for (int i = 0; i * dt < endTime; i++) {
+		double now = i * dt;
+		uint64_t nowNs = (uint64_t)llround((now + 1.0) * 1e9);
+		bool isBlocking = now < dipStart - epsilon || now >= dipEnd - epsilon;
+
+		// Events are delivered during the graph update, before the variable is read on the same frame
+		bool isStartFrame = now >= dipStart - epsilon && now < dipStart + dt - epsilon;
+		bool isFrameBefore = now >= dipStart - dt - epsilon && now < dipStart - epsilon;
+		bool isEndFrame = now >= dipEnd - epsilon && now < dipEnd + dt - epsilon;
+		if ((timing == kEvent_FrameBefore ? isFrameBefore : isStartFrame) || (timing == kEvent_BothEnds && isEndFrame)) {
+			tracker.OnGraphEvent();
+		}
+
+		bool wanted = BlockCore::GetIsBlockingMode(everyFrame, config, isBlocking, nowNs);
+		bool read = tracker.Get(nowNs, [&]() { return isBlocking; });
+		bool got = BlockCore::GetIsBlockingMode(tracked, config, read, nowNs);
+		if (wanted != got && result.firstDifferingFrame < 0) result.firstDifferingFrame = i;
+	}
+	result.numReads = tracker.numPolls;
+	result.numFrames = tracker.numFrames;
+	return result;
+}
+
+int RunIsBlockingCheck(const BlockCore::Config &config)
+{
+	const float pollIntervalMs = IsBlockingTracker().pollIntervalMs;
+	static const double rates[] = { 72, 90, 144 };
+
+	BlockCore::Config noDebounce = config;
+	noDebounce.isBlockingDebounceMs = 0;
+	const BlockCore::Config *configs[] = { &config, &noDebounce };
+
+	int result = 0, numDips = 0;
+	uint64_t numReads = 0, numFrames = 0;
+	for (const BlockCore::Config *dipConfig : configs) {
+		for (double rate : rates) {
+			// Every whole number of frames up to the poll interval
+			for (int frames = 1; frames * 1000 / rate < pollIntervalMs; frames++) {
+				double dipMs = frames * 1000 / rate;
+				for (int timing = 0; timing < kNumEventTimings; timing++) {
+					DipResult dip = PlayDip(*dipConfig, pollIntervalMs, rate, dipMs, (EventTiming)timing);
+					numDips++;
+					numReads += dip.numReads;
+					numFrames += dip.numFrames;
+					if (dip.firstDifferingFrame >= 0) {
+						printf("IS BLOCKING CHECK FAILED: debounce %.0f ms, %.0f Hz, %.1f ms dip, event %s: differs from reading every frame at frame %d\n",
+							dipConfig->isBlockingDebounceMs, rate, dipMs, eventTimingNames[timing], dip.firstDifferingFrame);
+						result = 1;
+					}
+				}
+			}
+		}
+	}
+
+	printf("is blocking: %d dips of up to %.0f ms, IsBlocking read on %llu of %llu frames\n", numDips, pollIntervalMs,
+		(unsigned long long)numReads, (unsigned long long)numFrames);
+	if (!result) printf("debounced IsBlocking matches reading every frame on every dip\n");
+	return result;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "blocking.h"
+
+
+// Dips IsBlocking for one frame up to just under the default poll interval, the way a blocked hit does, with the graph event
+// on the first frame of the dip, a frame before it, or at both ends. Each dip is debounced twice: from IsBlocking read
+// every frame, and from the reads IsBlockingTracker (IsBlockingFromGraphEvents = 1) asks for. Checks that the two are
+// the same on every frame at 72, 90 and 144 Hz, with the configured debounce and with none. Returns 0 if so.
+int RunIsBlockingCheck(const BlockCore::Config &config);
@@ -0,0 +1,163 @@
+#include <cmath>
+#include <cstdio>
+
+#include "mailbox_check.h"
+#include "pose_classifier.h"
+#include "synthetic_session.h"
+
+
+enum Script
+{
+	kScript_Replaced = 0,
+	kScript_Dropped,
+	kNumScripts
+};
+
+static const char *scriptNames[kNumScripts] = { "replaced", "dropped" };
+
+struct MailboxResult
+{
+	double decideMs = -1; // hands moved -> the notification that gets lost is decided on the pose thread
+	double responseMs = -1; // hands moved again / menu closed -> the next one reaches the graph
+	bool isCountMatching = false; // the state's sent counts are what the graph got
+};
+
+// The pose thread runs first on every frame and sees the game thread's isActive from the frame before.
+// Replaced: guard up at 1 s and down at 1.5 s. The game thread is stuck on a long frame from the one the blockStop is
+// posted on, the graph drops the block by itself (a stagger) and the guard goes up again, so a blockStart replaces the
+// blockStop. The game thread takes that, and the guard goes down 150 ms later, once the graph shows the block again.
+// Dropped: guard up at 1 s, a menu opens on the frame the blockStart is posted and closes 200 ms later.
+static MailboxResult PlayScript(const BlockCore::Config &config, double rate, Script script, bool isReconciled)
+{
+	using namespace SyntheticSession;
+
+	const double dt = 1.0 / rate;
+	const double graphLatency = 0.035;
+	const double guardTime = 1.0;
+	const double lowerTime = 1.5;
+	const double maxHitch = 0.2;
+	const double lowerAgainDelay = llround(0.15 / dt) * dt; // whole frames, so the response is measured from a frame
+	const double menuTime = llround(0.2 / dt) * dt;
+	const double endTime = 3.0;
+	const double epsilon = 1e-9;
+
+	MailboxResult result;
+	BlockCore::State state;
+	PoseClassifier::DecisionMailbox mailbox;
+	GraphModel graph;
+	uint64_t numStartsReceived = 0, numStopsReceived = 0;
+
+	double lostPost = -1, raiseAgainTime = -1, lowerAgainTime = -1, menuCloseTime = -1;
+	bool wasGameActive = true;
+
+	for (int i = 0; i * dt < endTime; i++) {
+		double now = i * dt;
+		uint64_t nowNs = (uint64_t)llround((now + 1.0) * 1e9);
+		graph.Advance(now);
+
+		// Pose thread
+		bool isGuard;
+		if (script == kScript_Replaced) {
+			bool isFirstGuard = now >= guardTime - epsilon && now < lowerTime - epsilon;
+			bool isSecondGuard = raiseAgainTime >= 0 && now >= raiseAgainTime - epsilon && (lowerAgainTime < 0 || now < lowerAgainTime - epsilon);
+			isGuard = isFirstGuard || isSecondGuard;
+		}
+		else {
+			isGuard = now >= guardTime - epsilon;
+		}
+
+		BlockCore::FrameInput frame = {};
+		frame.timestampNs = nowNs;
+		frame.isActive = wasGameActive;
+		frame.mainHand = BlockCore::HandEquip::OneHanded;
+		frame.offHand = BlockCore::HandEquip::OneHanded;
+		frame.hmd.rot = BasisFromForward({ 0, 1, 0 }, { 0, 0, 1 });
+		frame.hmd.pos = BlockCore::Vector3{ 0, 0, 1.7f } * (1.f / config.havokWorldScale);
+		frame.hmd.scale = 1.f;
+		frame.isBlockingGraph = graph.isBlocking;
+		const Posture &posture = isGuard ? guardPosture : restPosture;
+		PlaceHands(frame, config, posture, posture);
+
+		if (isReconciled) mailbox.Reconcile(state);
+		BlockCore::Decision posted = BlockCore::Update(state, config, frame);
+		mailbox.Post(posted, nowNs);
+
+		BlockCore::Decision lost = script == kScript_Replaced ? BlockCore::kDecision_StopBlocking : BlockCore::kDecision_StartBlocking;
+		double movedTime = script == kScript_Replaced ? lowerTime : guardTime;
+		if (posted == lost && lostPost < 0 && now >= movedTime - epsilon) {
+			lostPost = now;
+			result.decideMs = (now - movedTime) * 1000;
+			if (script == kScript_Replaced) {
+				graph.isBlocking = false;
+				graph.hasPending = false;
+				raiseAgainTime = now + dt;
+			}
+			else {
+				menuCloseTime = now + menuTime;
+			}
+		}
+
+		// Game thread
+		bool isGameActive = !(script == kScript_Dropped && lostPost >= 0 && now < menuCloseTime - epsilon);
+		wasGameActive = isGameActive;
+		bool isHitched = script == kScript_Replaced && lostPost >= 0 && lowerAgainTime < 0 && now < lostPost + maxHitch - epsilon &&
+			posted != BlockCore::kDecision_StartBlocking;
+		if (isHitched) continue;
+
+		uint64_t ageNs = 0;
+		BlockCore::Decision decision = mailbox.Take(nowNs, ageNs);
+		if (!isGameActive && decision != BlockCore::kDecision_None) {
+			mailbox.ReturnTaken();
+			decision = BlockCore::kDecision_None;
+		}
+		if (decision == BlockCore::kDecision_None) continue;
+
+		graph.Notify(decision == BlockCore::kDecision_StartBlocking, now, graphLatency);
+		if (decision == BlockCore::kDecision_StartBlocking) {
+			numStartsReceived++;
+			if (raiseAgainTime >= 0 && lowerAgainTime < 0) lowerAgainTime = now + lowerAgainDelay;
+		}
+		else {
+			numStopsReceived++;
+		}
+
+		double sinceTime = script == kScript_Replaced ? lowerAgainTime : menuCloseTime;
+		if (decision == lost && sinceTime >= 0 && now >= sinceTime - epsilon && result.responseMs < 0) {
+			result.responseMs = (now - sinceTime) * 1000;
+		}
+	}
+
+	if (isReconciled) mailbox.Reconcile(state);
+	result.isCountMatching = state.notifyCounts.numStartsSent == numStartsReceived && state.notifyCounts.numStopsSent == numStopsReceived;
+	return result;
+}
+
+int RunMailboxCheck(const BlockCore::Config &config)
+{
+	static const double rates[] = { 72, 90, 144 };
+
+	printf("mailbox (ms), cooldown %.0f ms, notify timeout %.0f ms, without handing decisions back in brackets\n",
+		config.blockCooldownMs, config.notifyTimeoutMs);
+	printf("  rate  script    decide  next         counts\n");
+
+	int result = 0;
+	for (double rate : rates) {
+		const double frameMs = 1000.0 / rate; // one frame is allowed, the pose thread sees the menu close a frame late
+		for (int script = 0; script < kNumScripts; script++) {
+			MailboxResult reconciled = PlayScript(config, rate, (Script)script, true);
+			MailboxResult unreconciled = PlayScript(config, rate, (Script)script, false);
+			printf("  %4.0f  %-8s  %6.1f  %6.1f (%6.1f)  %s (%s)\n", rate, scriptNames[script], reconciled.decideMs,
+				reconciled.responseMs, unreconciled.responseMs, reconciled.isCountMatching ? "match" : "off",
+				unreconciled.isCountMatching ? "match" : "off");
+
+			bool isMissing = reconciled.decideMs < 0 || reconciled.responseMs < 0;
+			if (isMissing || llround((reconciled.responseMs - reconciled.decideMs) / frameMs) > 1 || !reconciled.isCountMatching) {
+				printf("MAILBOX CHECK FAILED at %.0f Hz: %s notification\n", rate, scriptNames[script]);
+				result = 1;
+			}
+		}
+	}
+
+	if (!result) printf("a replaced or dropped decision does not hold up the next one at any rate\n");
+	return result;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "blocking.h"
+
+
+// Runs the block tests the way the pose thread does, handing decisions to a simulated game thread through
+// PoseClassifier::DecisionMailbox. In one script a blockStop is replaced by a blockStart while the game thread is stuck
+// on a long frame, in the other a blockStart is taken on the frame a menu opens and dropped. Checks that the next
+// notification reaches the graph as soon as the hands ask for it, not a cooldown or notify timeout later, and that the
+// state's sent counts are what the graph got, at 72, 90 and 144 Hz. Returns 0 if so.
+int RunMailboxCheck(const BlockCore::Config &config);
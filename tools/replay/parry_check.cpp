@@ -0,0 +1,102 @@
+#include <cstdio>
+
+#include "clock.h"
+#include "parry.h"
+#include "parry_check.h"
+#include "synthetic_session.h"
+
+
+struct ParryTimes
+{
+	int numMisjudged = 0; // verdicts that differ from the one the true time between guard and hit gives
+	double maxErrorMs = 0; // how far the guard's age at the hit was from the truth
+};
+
+// Poses arrive every poseIntervalNs, the last one lastPoseNs. The newest one at or before t.
+static uint64_t NewestPose(uint64_t t, uint64_t lastPoseNs, uint64_t poseIntervalNs)
+{
+	if (t >= lastPoseNs) return lastPoseNs;
+	uint64_t numBack = (lastPoseNs - t + poseIntervalNs - 1) / poseIntervalNs;
+	return lastPoseNs - numBack * poseIntervalNs;
+}
+
+// One hit, with the guard raised leadNs before it. The guard is timed every intervalNs up to lastNs, each time on the
+// posture of the newest pose.
+static Parry::Verdict PlayHit(const BlockCore::Config &config, uint64_t hitNs, uint64_t leadNs, uint64_t lastPoseNs, uint64_t poseIntervalNs,
+	uint64_t lastNs, uint64_t intervalNs, float windowMs)
+{
+	using namespace SyntheticSession;
+
+	Parry::OnsetHistory histories[BlockCore::kNumHandIndices];
+	Parry::GuardState state;
+	uint64_t guardNs = hitNs - leadNs;
+
+	BlockCore::FrameInput frame = {};
+	frame.isActive = true;
+	frame.mainHand = BlockCore::HandEquip::OneHanded;
+	frame.offHand = BlockCore::HandEquip::OneHanded;
+	frame.hmd.rot = BasisFromForward({ 0, 1, 0 }, { 0, 0, 1 });
+	frame.hmd.pos = BlockCore::Vector3{ 0, 0, 1.7f } * (1.f / config.havokWorldScale);
+	frame.hmd.scale = 1.f;
+
+	// Start at rest, well before any guard in the sweep
+	uint64_t firstNs = lastNs - (MsToNs(windowMs * 2 + 100) / intervalNs + 1) * intervalNs;
+	for (uint64_t t = firstNs; t <= lastNs; t += intervalNs) {
+		frame.timestampNs = t;
+		const Posture &posture = NewestPose(t, lastPoseNs, poseIntervalNs) >= guardNs ? guardPosture : restPosture;
+		PlaceHands(frame, config, posture, posture);
+		Parry::UpdateGuards(state, config, frame, histories);
+	}
+	return Parry::Judge(histories, hitNs, windowMs);
+}
+
+static void Score(const Parry::Verdict &verdict, uint64_t leadNs, float windowMs, ParryTimes &times)
+{
+	bool isParry = leadNs <= MsToNs(windowMs);
+	if (verdict.isParry != isParry) times.numMisjudged++;
+	// A guard that went up after the last timing before the hit is missed altogether, as if it went up with the hit
+	uint64_t ageNs = verdict.hand >= 0 ? verdict.guardAgeNs : 0;
+	double errorMs = NsToMs(leadNs > ageNs ? leadNs - ageNs : ageNs - leadNs);
+	if (errorMs > times.maxErrorMs) times.maxErrorMs = errorMs;
+}
+
+int RunParryCheck(const BlockCore::Config &config, float windowMs)
+{
+	static const double frameRates[] = { 30, 45, 60, 90 };
+	const int numRates = sizeof(frameRates) / sizeof(frameRates[0]);
+	const uint64_t poseIntervalNs = 11111111; // 90 Hz
+	const uint64_t stepNs = 250 * 1000;
+	// Hits are handled in game frames, the poses do not line up with them
+	const uint64_t hitNs = 3000000000ull;
+	const uint64_t lastPoseNs = hitNs - 370 * 1000;
+
+	ParryTimes poseTimes[numRates], frameTimes[numRates];
+	for (int i = 0; i < numRates; i++) {
+		uint64_t frameIntervalNs = (uint64_t)(1e9 / frameRates[i]);
+		for (uint64_t leadNs = stepNs; leadNs <= MsToNs(windowMs * 2); leadNs += stepNs) {
+			// Pose timing: the pose thread runs on every pose. Frame timing: the game thread, on the frames up to the one with the hit.
+			Score(PlayHit(config, hitNs, leadNs, lastPoseNs, poseIntervalNs, lastPoseNs, poseIntervalNs, windowMs), leadNs, windowMs, poseTimes[i]);
+			Score(PlayHit(config, hitNs, leadNs, lastPoseNs, poseIntervalNs, hitNs, frameIntervalNs, windowMs), leadNs, windowMs, frameTimes[i]);
+		}
+	}
+
+	int numLeads = (int)(MsToNs(windowMs * 2) / stepNs);
+	printf("parry window %.0f ms, guard raised 0.25 to %.0f ms before %d hits per rate\n", windowMs, windowMs * 2, numLeads);
+	printf("  fps   pose timing: misjudged  max error   frame timing: misjudged  max error\n");
+	for (int i = 0; i < numRates; i++) {
+		printf("  %3.0f   %20d  %6.1f ms   %21d  %6.1f ms\n", frameRates[i], poseTimes[i].numMisjudged, poseTimes[i].maxErrorMs,
+			frameTimes[i].numMisjudged, frameTimes[i].maxErrorMs);
+	}
+
+	const double toleranceMs = NsToMs(poseIntervalNs);
+	int result = 0;
+	for (int i = 0; i < numRates; i++) {
+		if (poseTimes[i].maxErrorMs > toleranceMs || poseTimes[i].numMisjudged != poseTimes[0].numMisjudged) {
+			printf("PARRY CHECK FAILED at %.0f fps\n", frameRates[i]);
+			result = 1;
+		}
+	}
+
+	if (!result) printf("parry timing within %.1f ms at all frame rates\n", toleranceMs);
+	return result;
+}
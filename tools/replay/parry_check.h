@@ -0,0 +1,9 @@
+#pragma once
+
+#include "blocking.h"
+
+
+// Raises a guard at every point in the windowMs before a hit and after, and judges each hit as a parry twice: with the
+// guard timed from 90 Hz poses the way the plugin does it, and from the game's own frames at 30, 45, 60 and 90 fps.
+// Checks that the pose timing is never off by more than one pose interval, whatever the frame rate. Returns 0 if so.
+int RunParryCheck(const BlockCore::Config &config, float windowMs);
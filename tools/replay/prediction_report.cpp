@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "prediction_report.h"
+
+
+// A predicted start counts as the same block as an unpredicted one if that one follows within this window
+static const double confirmWindowMs = 250;
+// Cooldowns can push a predicted start slightly behind the unpredicted one, still the same block
+static const double lateWindowMs = 100;
+
+static std::vector<uint64_t> GetStartTimes(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config)
+{
+	std::vector<uint64_t> starts;
+	BlockCore::State state;
+	for (const BlockCore::FrameInput &frame : frames) {
+		if (BlockCore::Update(state, config, frame) == BlockCore::kDecision_StartBlocking) {
+			starts.push_back(frame.timestampNs);
+		}
+	}
+	return starts;
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+	if (values.empty()) return 0;
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+	return values[index];
+}
+
+void PrintPredictionReport(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config, const std::vector<float> &lookaheadsMs)
+{
+	if (frames.empty()) return;
+
+	BlockCore::Config baselineConfig = config;
+	baselineConfig.predictionLookaheadMs = 0;
+	std::vector<uint64_t> baseline = GetStartTimes(frames, baselineConfig);
+
+	double minutes = (double)(frames.back().timestampNs - frames.front().timestampNs) / 60e9;
+	if (minutes <= 0) minutes = 1.0 / 60;
+
+	printf("prediction: %zu starts without prediction over %.1f min\n", baseline.size(), minutes);
+	printf("  lookahead  starts  earlier (ms) mean / p50 / p90   unconfirmed (per min)   missed\n");
+
+	for (float lookaheadMs : lookaheadsMs) {
+		BlockCore::Config predictedConfig = config;
+		predictedConfig.predictionLookaheadMs = lookaheadMs;
+		std::vector<uint64_t> predicted = GetStartTimes(frames, predictedConfig);
+
+		// Both lists are sorted, walk them together
+		std::vector<double> leadsMs;
+		std::vector<bool> isBaselineMatched(baseline.size(), false);
+		size_t unconfirmed = 0, next = 0;
+		for (uint64_t start : predicted) {
+			while (next < baseline.size() && (double)baseline[next] + lateWindowMs * 1e6 < (double)start) next++;
+
+			if (next < baseline.size() && (double)baseline[next] <= (double)start + confirmWindowMs * 1e6) {
+				leadsMs.push_back(((double)baseline[next] - (double)start) / 1e6);
+				isBaselineMatched[next] = true;
+				next++;
+			}
+			else {
+				unconfirmed++;
+			}
+		}
+		size_t missed = std::count(isBaselineMatched.begin(), isBaselineMatched.end(), false);
+
+		double meanMs = 0;
+		for (double lead : leadsMs) meanMs += lead;
+		if (!leadsMs.empty()) meanMs /= leadsMs.size();
+
+		printf("  %6.0f ms  %6zu  %8.1f / %5.1f / %5.1f         %5zu (%5.2f)         %4zu\n",
+			lookaheadMs, predicted.size(), meanMs, Percentile(leadsMs, 0.5), Percentile(leadsMs, 0.9), unconfirmed, unconfirmed / minutes, missed);
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include "blocking.h"
+
+
+// Replays the frames once without pose prediction and once per lookahead with it, and prints how much earlier blocks
+// start and how many extra starts the prediction makes that the unpredicted tests never confirm (false positives).
+// The replay is open loop: IsBlocking comes from the trace, so it reflects the decisions made when it was recorded.
+void PrintPredictionReport(const std::vector<BlockCore::FrameInput> &frames, const BlockCore::Config &config, const std::vector<float> &lookaheadsMs);
@@ -0,0 +1,458 @@
+// Headless replay driver for the block detection logic.
+//
+// Feeds recorded (or generated) frames through BlockCore::Update, reports ns/frame and the decisions made,
+// and optionally fails if the decisions differ from a saved baseline or the hot path got slower than a budget.
+// Pose traces recorded with RecordPoses = 1 (.dwbp) are replayed in parallel, any number of them at once.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread -Isrc -Itools/common tools/replay/*.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp src/latency_tracer.cpp src/parry.cpp src/pose_classifier.cpp src/pose_trace.cpp src/pose_trace_reader.cpp src/profiler.cpp -o replay
+//
+// Examples:
+//   replay --synthetic 600 --rate 90 --write-trace session.txt --decisions baseline.txt
+//   replay session.txt --expect baseline.txt --max-ns 200
+//   replay session.txt --prediction 20,40,60
+//   replay session.txt --dual-hand --expect baseline.txt
+//   replay session.txt --speed-filter 1,0.5 --rotation-filter 1,0.2
+//   replay session.txt --latency
+//   replay recordings/*.dwbp --threads 8 --verify --expect corpus_baseline.txt
+//   replay --response-check
+//   replay --parry-check 150
+//   replay --is-blocking-check
+//   replay --mailbox-check
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "block_labels.h"
+#include "blocking.h"
+#include "corpus_replay.h"
+#include "filter_report.h"
+#include "frame_trace.h"
+#include "is_blocking_check.h"
+#include "latency_tracer.h"
+#include "mailbox_check.h"
+#include "parry_check.h"
+#include "prediction_report.h"
+#include "profiler.h"
+#include "response_check.h"
+#include "synthetic_session.h"
+
+
+struct DecisionEvent
+{
+	int frame;
+	BlockCore::Decision decision;
+};
+
+static const char * DecisionName(BlockCore::Decision decision)
+{
+	switch (decision) {
+	case BlockCore::kDecision_StartBlocking: return "start";
+	case BlockCore::kDecision_StopBlocking: return "stop";
+	default: return "none";
+	}
+}
+
+static bool WriteDecisions(const std::string &path, const std::vector<DecisionEvent> &events)
+{
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) return false;
+	fprintf(file, "# frame decision\n");
+	for (const DecisionEvent &event : events) {
+		fprintf(file, "%d %s\n", event.frame, DecisionName(event.decision));
+	}
+	fclose(file);
+	return true;
+}
+
+static bool ReadDecisions(const std::string &path, std::vector<DecisionEvent> &events)
+{
+	std::ifstream file(path);
+	if (!file) return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		int frame; char name[16];
+		if (sscanf(line.c_str(), "%d %15s", &frame, name) != 2) return false;
+		BlockCore::Decision decision = !strcmp(name, "start") ? BlockCore::kDecision_StartBlocking : !strcmp(name, "stop") ? BlockCore::kDecision_StopBlocking : BlockCore::kDecision_None;
+		events.push_back({ frame, decision });
+	}
+	return true;
+}
+
+static uint64_t HashDecisions(const std::vector<DecisionEvent> &events)
+{
+	uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+	for (const DecisionEvent &event : events) {
+		uint32_t values[2] = { (uint32_t)event.frame, (uint32_t)event.decision };
+		const unsigned char *bytes = (const unsigned char *)values;
+		for (size_t i = 0; i < sizeof(values); i++) {
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+	}
+	return hash;
+}
+
+// Fails if the decisions differ from the ones in expectPath
+static int CheckDecisions(const std::string &expectPath, const std::vector<DecisionEvent> &events)
+{
+	std::vector<DecisionEvent> expected;
+	if (!ReadDecisions(expectPath, expected)) {
+		fprintf(stderr, "failed to read %s\n", expectPath.c_str());
+		return 1;
+	}
+
+	size_t count = expected.size() < events.size() ? expected.size() : events.size();
+	size_t mismatch = count;
+	for (size_t i = 0; i < count; i++) {
+		if (expected[i].frame != events[i].frame || expected[i].decision != events[i].decision) {
+			mismatch = i;
+			break;
+		}
+	}
+
+	if (mismatch < count || expected.size() != events.size()) {
+		if (mismatch < count) {
+			printf("DECISIONS CHANGED: event %zu expected %s at frame %d, got %s at frame %d\n", mismatch,
+				DecisionName(expected[mismatch].decision), expected[mismatch].frame, DecisionName(events[mismatch].decision), events[mismatch].frame);
+		}
+		else {
+			printf("DECISIONS CHANGED: expected %zu events, got %zu\n", expected.size(), events.size());
+		}
+		return 1;
+	}
+	printf("decisions match %s\n", expectPath.c_str());
+	return 0;
+}
+
+// "<minCutoffHz>,<beta>"
+static bool ParseFilterParams(const char *value, BlockCore::OneEuroParams &params)
+{
+	char *end;
+	params.minCutoffHz = strtof(value, &end);
+	if (end == value || *end != ',' || params.minCutoffHz <= 0) return false;
+	const char *beta = end + 1;
+	params.beta = strtof(beta, &end);
+	return end != beta && *end == 0 && params.beta >= 0;
+}
+
+static int ReplayCorpus(const std::vector<std::string> &paths, const BlockCore::Config &config, const CorpusOptions &options,
+	const std::string &decisionsPath, const std::string &expectPath)
+{
+	std::vector<CorpusDecision> decisions;
+	if (RunCorpusReplay(paths, config, options, decisions)) return 1;
+
+	// Frames are the samples of all the traces one after the other
+	std::vector<DecisionEvent> events;
+	int numStarts = 0, numStops = 0;
+	for (const CorpusDecision &decision : decisions) {
+		events.push_back({ (int)decision.sample, decision.decision });
+		if (decision.decision == BlockCore::kDecision_StartBlocking) numStarts++;
+		else numStops++;
+	}
+	printf("decisions: %d start, %d stop (hash %016llx)\n", numStarts, numStops, (unsigned long long)HashDecisions(events));
+
+	if (!decisionsPath.empty() && !WriteDecisions(decisionsPath, events)) {
+		fprintf(stderr, "failed to write %s\n", decisionsPath.c_str());
+		return 1;
+	}
+	return expectPath.empty() ? 0 : CheckDecisions(expectPath, events);
+}
+
+static void PrintUsage()
+{
+	printf(
+		"usage: replay [trace | pose traces (.dwbp)...] [options]\n"
+		"  --synthetic <seconds>   generate a session instead of reading a trace\n"
+		"  --rate <hz>             update rate of the generated session (default 90)\n"
+		"  --seed <n>              generator seed (default 1)\n"
+		"  --equip <main>,<off>    equipment of a generated session or the pose traces, e.g. onehanded,spell\n"
+		"                          (default onehanded,onehanded)\n"
+		"  --left-handed           generate a left handed session, or replay the pose traces left handed\n"
+		"  --cross-guards <0..1>   fraction of the generated two handed guards held with the blades crossed\n"
+		"  --write-trace <path>    save the frames that were replayed, and the guards of a generated session to <path>.labels\n"
+		"  --iterations <n>        timed passes over the frames (default 20)\n"
+		"  --decisions <path>      write the decisions made\n"
+		"  --expect <path>         fail if decisions differ from this file\n"
+		"  --max-ns <n>            fail if the average cost per frame exceeds this\n"
+		"  --profile               time every Update call and print the distribution the plugin's profiler would log\n"
+		"  --latency               trace each block from the poses to IsBlocking and print where the time went\n"
+		"  --prediction <ms,...>   report how much earlier blocks start with these prediction lookaheads\n"
+		"  --dual-hand             test both hands with the vectorized dual hand classifier\n"
+		"  --cross-guard           also block on the cross guard ([CrossGuard] Enable = 1)\n"
+		"  --speed-filter <hz>,<beta>     smooth the hand speeds, and report the lag it adds\n"
+		"  --rotation-filter <hz>,<beta>  smooth the hmd and controller orientations, and report the lag it adds\n"
+		"  --threads <n>           threads to replay pose traces on (default one per core)\n"
+		"  --chunk-seconds <s>     how much of a pose trace each thread replays at a time (default 60)\n"
+		"  --verify                also replay each pose trace start to end on one thread, and fail if that decides differently\n"
+		"  --response-check        check that response times are the same at 72, 90, 120 and 144 Hz\n"
+		"  --parry-check <ms>      check that parries with this window are timed the same at 30, 45, 60 and 90 fps\n"
+		"  --is-blocking-check     check that IsBlockingFromGraphEvents debounces short IsBlocking dips like reading every frame\n"
+		"  --mailbox-check         check that a pose thread decision the game thread never applies does not hold up the next one\n");
+}
+
+int main(int argc, char **argv)
+{
+	std::string tracePath, writeTracePath, decisionsPath, expectPath;
+	std::vector<std::string> posePaths;
+	CorpusOptions corpus;
+	SyntheticSession::Options synthetic;
+	bool isSynthetic = false;
+	bool isResponseCheck = false;
+	bool isIsBlockingCheck = false;
+	bool isMailboxCheck = false;
+	float parryCheckWindowMs = 0;
+	bool isProfiling = false;
+	bool isTracingLatency = false;
+	bool isDualHand = false;
+	bool isCrossGuard = false;
+	BlockCore::OneEuroParams speedFilter, rotationFilter;
+	std::vector<float> predictionLookaheadsMs;
+	int iterations = 20;
+	double maxNs = 0;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--synthetic" && hasValue) { isSynthetic = true; synthetic.seconds = atof(argv[++i]); }
+		else if (arg == "--rate" && hasValue) synthetic.rate = atof(argv[++i]);
+		else if (arg == "--seed" && hasValue) synthetic.seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--equip" && hasValue) {
+			std::string equip = argv[++i];
+			size_t comma = equip.find(',');
+			if (comma == std::string::npos ||
+				!FrameTrace::ParseHandEquip(equip.substr(0, comma), synthetic.mainHand) ||
+				!FrameTrace::ParseHandEquip(equip.substr(comma + 1), synthetic.offHand)) {
+				fprintf(stderr, "bad --equip value: %s\n", equip.c_str());
+				return 2;
+			}
+		}
+		else if (arg == "--left-handed") synthetic.isLeftHanded = true;
+		else if (arg == "--cross-guards" && hasValue) synthetic.crossGuardChance = atof(argv[++i]);
+		else if (arg == "--write-trace" && hasValue) writeTracePath = argv[++i];
+		else if (arg == "--iterations" && hasValue) iterations = atoi(argv[++i]);
+		else if (arg == "--decisions" && hasValue) decisionsPath = argv[++i];
+		else if (arg == "--expect" && hasValue) expectPath = argv[++i];
+		else if (arg == "--max-ns" && hasValue) maxNs = atof(argv[++i]);
+		else if (arg == "--prediction" && hasValue) {
+			for (const char *value = argv[++i]; *value; ) {
+				char *end;
+				float lookaheadMs = strtof(value, &end);
+				if (end == value || lookaheadMs <= 0) {
+					fprintf(stderr, "bad --prediction value: %s\n", argv[i]);
+					return 2;
+				}
+				predictionLookaheadsMs.push_back(lookaheadMs);
+				value = *end == ',' ? end + 1 : end;
+			}
+		}
+		else if (arg == "--profile") isProfiling = true;
+		else if (arg == "--latency") isTracingLatency = true;
+		else if (arg == "--dual-hand") isDualHand = true;
+		else if (arg == "--cross-guard") isCrossGuard = true;
+		else if ((arg == "--speed-filter" || arg == "--rotation-filter") && hasValue) {
+			if (!ParseFilterParams(argv[++i], arg == "--speed-filter" ? speedFilter : rotationFilter)) {
+				fprintf(stderr, "bad %s value: %s\n", arg.c_str(), argv[i]);
+				return 2;
+			}
+		}
+		else if (arg == "--threads" && hasValue) corpus.numThreads = atoi(argv[++i]);
+		else if (arg == "--chunk-seconds" && hasValue) corpus.chunkSeconds = atof(argv[++i]);
+		else if (arg == "--verify") corpus.isVerifying = true;
+		else if (arg == "--response-check") isResponseCheck = true;
+		else if (arg == "--is-blocking-check") isIsBlockingCheck = true;
+		else if (arg == "--mailbox-check") isMailboxCheck = true;
+		else if (arg == "--parry-check" && hasValue) {
+			parryCheckWindowMs = strtof(argv[++i], nullptr);
+			if (parryCheckWindowMs <= 0) {
+				fprintf(stderr, "bad --parry-check value: %s\n", argv[i]);
+				return 2;
+			}
+		}
+		else if (arg == "--help" || arg == "-h") { PrintUsage(); return 0; }
+		else if (arg[0] != '-' && arg.size() > 5 && arg.compare(arg.size() - 5, 5, ".dwbp") == 0) posePaths.push_back(arg);
+		else if (arg[0] != '-' && tracePath.empty()) tracePath = arg;
+		else { PrintUsage(); return 2; }
+	}
+
+	BlockCore::Config config;
+	config.isDualHandClassifierEnabled = isDualHand;
+	config.isCrossGuardEnabled = isCrossGuard;
+
+	if (isResponseCheck) {
+		return RunResponseCheck(config);
+	}
+	if (parryCheckWindowMs > 0) {
+		return RunParryCheck(config, parryCheckWindowMs);
+	}
+	if (isIsBlockingCheck) {
+		return RunIsBlockingCheck(config);
+	}
+	if (isMailboxCheck) {
+		return RunMailboxCheck(config);
+	}
+
+	if (!posePaths.empty()) {
+		config.speedFilter = speedFilter;
+		config.rotationFilter = rotationFilter;
+		corpus.mainHand = synthetic.mainHand;
+		corpus.offHand = synthetic.offHand;
+		corpus.isLeftHanded = synthetic.isLeftHanded;
+		corpus.graphLatencyMs = synthetic.graphLatencyMs;
+		return ReplayCorpus(posePaths, config, corpus, decisionsPath, expectPath);
+	}
+
+	if (!isSynthetic && tracePath.empty()) {
+		PrintUsage();
+		return 2;
+	}
+	if (iterations < 1) iterations = 1;
+
+	std::vector<BlockCore::FrameInput> frames;
+	std::vector<BlockLabels::Interval> guards;
+
+	if (isSynthetic) {
+		frames = SyntheticSession::Generate(synthetic, config, &guards);
+	}
+	else {
+		std::string error;
+		if (!FrameTrace::Read(tracePath, frames, error)) {
+			fprintf(stderr, "failed to read %s: %s\n", tracePath.c_str(), error.c_str());
+			return 1;
+		}
+	}
+
+	// Generated without the filters, so every filter setting replays the same session
+	config.speedFilter = speedFilter;
+	config.rotationFilter = rotationFilter;
+
+	if (frames.empty()) {
+		fprintf(stderr, "no frames to replay\n");
+		return 1;
+	}
+
+	if (!writeTracePath.empty() && !FrameTrace::Write(writeTracePath, frames)) {
+		fprintf(stderr, "failed to write %s\n", writeTracePath.c_str());
+		return 1;
+	}
+	if (!writeTracePath.empty() && isSynthetic && !BlockLabels::Write(BlockLabels::PathForTrace(writeTracePath), guards)) {
+		fprintf(stderr, "failed to write %s\n", BlockLabels::PathForTrace(writeTracePath).c_str());
+		return 1;
+	}
+
+	// Decisions come from a fresh state, exactly like a new game session
+	std::vector<DecisionEvent> events;
+	BlockCore::NotifyCounts notifyCounts;
+	{
+		BlockCore::State state;
+		for (size_t i = 0; i < frames.size(); i++) {
+			BlockCore::Decision decision = BlockCore::Update(state, config, frames[i]);
+			if (decision != BlockCore::kDecision_None) events.push_back({ (int)i, decision });
+		}
+		notifyCounts = state.notifyCounts;
+	}
+
+	// Timed passes. Keep the result live so the compiler cannot drop the work.
+	double bestNs = 1e30, totalNs = 0;
+	unsigned sink = 0;
+	for (int pass = 0; pass < iterations; pass++) {
+		BlockCore::State state;
+		auto start = std::chrono::steady_clock::now();
+		for (const BlockCore::FrameInput &frame : frames) {
+			sink += (unsigned)BlockCore::Update(state, config, frame);
+		}
+		auto end = std::chrono::steady_clock::now();
+		double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / frames.size();
+		totalNs += ns;
+		if (ns < bestNs) bestNs = ns;
+	}
+	double meanNs = totalNs / iterations;
+
+	int numStarts = 0, numStops = 0;
+	for (const DecisionEvent &event : events) {
+		if (event.decision == BlockCore::kDecision_StartBlocking) numStarts++;
+		else numStops++;
+	}
+
+	printf("frames:    %zu\n", frames.size());
+	printf("decisions: %d start, %d stop (hash %016llx)\n", numStarts, numStops, (unsigned long long)HashDecisions(events));
+	printf("notifies:  %llu start, %llu stop sent, %llu start, %llu stop suppressed\n", (unsigned long long)notifyCounts.numStartsSent,
+		(unsigned long long)notifyCounts.numStopsSent, (unsigned long long)notifyCounts.numStartsSuppressed, (unsigned long long)notifyCounts.numStopsSuppressed);
+	if (isSynthetic) {
+		// IsBlocking comes from generating the session, which ran the same config, so a guard the block never came up
+		// during (or shortly after, for the graph's latency) was missed
+		const uint64_t graceNs = MsToNs(synthetic.graphLatencyMs + 100);
+		size_t numMissed = 0, frame = 0;
+		for (const BlockLabels::Interval &guard : guards) {
+			while (frame < frames.size() && frames[frame].timestampNs < guard.startNs) frame++;
+			bool isBlocked = false;
+			for (size_t i = frame; i < frames.size() && frames[i].timestampNs <= guard.endNs + graceNs && !isBlocked; i++) {
+				isBlocked = frames[i].isBlockingGraph;
+			}
+			if (!isBlocked) numMissed++;
+		}
+		printf("guards:    %zu, %zu never blocked\n", guards.size(), numMissed);
+	}
+	printf("time:      %.2f ns/frame mean, %.2f ns/frame best over %d passes (sink %u)\n", meanNs, bestNs, iterations, sink);
+
+	if (isProfiling) {
+		// Per call timings through the same histograms the plugin uses. The clock reads add their own cost to every sample.
+		Profiler profiler;
+		profiler.isEnabled = true;
+		BlockCore::State state;
+		for (const BlockCore::FrameInput &frame : frames) {
+			ScopedProfile profile(profiler, Profiler::kStage_Tests);
+			sink += (unsigned)BlockCore::Update(state, config, frame);
+		}
+		const LatencyHistogram &histogram = profiler.GetStage(Profiler::kStage_Tests);
+		printf("per call:  %llu ns p50, %llu ns p99, %llu ns max\n", (unsigned long long)histogram.Percentile(0.5),
+			(unsigned long long)histogram.Percentile(0.99), (unsigned long long)histogram.Max());
+	}
+
+	if (isTracingLatency) {
+		// IsBlocking comes from the frames, so the graph stages are those of the session as it was recorded (or generated)
+		LatencyTracer tracer;
+		tracer.isEnabled = true;
+		BlockCore::State state;
+		for (const BlockCore::FrameInput &frame : frames) {
+			BlockCore::Decision decision = BlockCore::Update(state, config, frame);
+			if (frame.isActive) tracer.Record(LatencyTracer::MakeSample(frame, state, decision));
+		}
+		std::vector<std::string> lines;
+		tracer.Report(lines);
+		printf("latency:\n");
+		for (const std::string &line : lines) printf("  %s\n", line.c_str());
+	}
+
+	if (!predictionLookaheadsMs.empty()) {
+		PrintPredictionReport(frames, config, predictionLookaheadsMs);
+	}
+
+	if (config.speedFilter.IsEnabled() || config.rotationFilter.IsEnabled()) {
+		PrintFilterReport(frames, config);
+	}
+
+	if (!decisionsPath.empty() && !WriteDecisions(decisionsPath, events)) {
+		fprintf(stderr, "failed to write %s\n", decisionsPath.c_str());
+		return 1;
+	}
+
+	int result = 0;
+
+	if (!expectPath.empty() && CheckDecisions(expectPath, events)) {
+		result = 1;
+	}
+
+	if (maxNs > 0 && meanNs > maxNs) {
+		printf("TOO SLOW: %.2f ns/frame exceeds budget of %.2f\n", meanNs, maxNs);
+		result = 1;
+	}
+
+	return result;
+}
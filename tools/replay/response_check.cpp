@@ -0,0 +1,141 @@
+#include <cmath>
+#include <cstdio>
+
+#include "response_check.h"
+#include "synthetic_session.h"
+
+
+struct ResponseTimes
+{
+	double startLatencyMs = -1; // guard raised -> first blockStart
+	double retryMs = -1; // first blockStart was dropped by the graph -> second blockStart
+	double stopAfterConfirmMs = -1; // hands lowered the moment the graph confirms a block -> blockStop (the IsBlocking debounce lag)
+	int numStopsDuringHit = 0; // IsBlocking dropped for one frame while blocking, must not cause a blockStop
+};
+
+// Timeline: guard up at 1.0 s with the first blockStart dropped by the graph, a hit at 2.5 s, guard down at 3.0 s,
+// guard up again at 3.5 s and down the moment the graph reports IsBlocking.
+static ResponseTimes PlayScript(const BlockCore::Config &config, double rate)
+{
+	using namespace SyntheticSession;
+
+	const double dt = 1.0 / rate;
+	const double graphLatency = 0.035;
+	const double firstGuardTime = 1.0;
+	const double hitTime = 2.5;
+	const double firstLowerTime = 3.0;
+	const double secondGuardTime = 3.5;
+	const double endTime = 4.5;
+	const double epsilon = 1e-9;
+
+	ResponseTimes result;
+	BlockCore::State state;
+	GraphModel graph;
+	graph.numStartsToIgnore = 1;
+
+	double firstStart = -1, confirmTime = -1;
+
+	for (int i = 0; i * dt < endTime; i++) {
+		double now = i * dt;
+
+		BlockCore::FrameInput frame = {};
+		frame.timestampNs = (uint64_t)llround((now + 1.0) * 1e9);
+		frame.isActive = true;
+		frame.mainHand = BlockCore::HandEquip::OneHanded;
+		frame.offHand = BlockCore::HandEquip::OneHanded;
+		frame.hmd.rot = BasisFromForward({ 0, 1, 0 }, { 0, 0, 1 });
+		frame.hmd.pos = BlockCore::Vector3{ 0, 0, 1.7f } * (1.f / config.havokWorldScale);
+		frame.hmd.scale = 1.f;
+
+		graph.Advance(now);
+		bool isHit = std::fabs(now - hitTime) < dt * 0.5;
+		frame.isBlockingGraph = graph.isBlocking && !isHit;
+
+		bool isSecondGuard = now >= secondGuardTime - epsilon;
+		if (isSecondGuard && confirmTime < 0 && graph.isBlocking) {
+			confirmTime = now;
+		}
+
+		bool isGuard = (now >= firstGuardTime - epsilon && now < firstLowerTime - epsilon) || (isSecondGuard && confirmTime < 0);
+		const Posture &posture = isGuard ? guardPosture : restPosture;
+		PlaceHands(frame, config, posture, posture);
+
+		BlockCore::Decision decision = BlockCore::Update(state, config, frame);
+		if (decision == BlockCore::kDecision_StartBlocking) {
+			graph.Notify(true, now, graphLatency);
+			if (firstStart < 0) {
+				firstStart = now;
+				result.startLatencyMs = (now - firstGuardTime) * 1000;
+			}
+			else if (result.retryMs < 0) {
+				result.retryMs = (now - firstStart) * 1000;
+			}
+		}
+		else if (decision == BlockCore::kDecision_StopBlocking) {
+			graph.Notify(false, now, graphLatency);
+			if (now > hitTime - 0.1 && now < firstLowerTime - epsilon) {
+				result.numStopsDuringHit++;
+			}
+			else if (confirmTime >= 0 && result.stopAfterConfirmMs < 0) {
+				result.stopAfterConfirmMs = (now - confirmTime) * 1000;
+			}
+		}
+	}
+
+	return result;
+}
+
+// With IsBlockingDebounceMs = 0 the debounced IsBlocking has to be the graph's, frame for frame
+static bool IsUndebouncedPassedThrough(const BlockCore::Config &config)
+{
+	BlockCore::Config noDebounce = config;
+	noDebounce.isBlockingDebounceMs = 0;
+	BlockCore::State state;
+	for (int i = 0; i < 200; i++) {
+		bool isBlocking = i >= 100 && (i % 7) != 0; // never blocking, then blocking with one frame drops
+		uint64_t nowNs = (uint64_t)(i + 90) * 11111111ull;
+		if (BlockCore::GetIsBlockingMode(state, noDebounce, isBlocking, nowNs) != isBlocking) return false;
+	}
+	return true;
+}
+
+int RunResponseCheck(const BlockCore::Config &config)
+{
+	static const double rates[] = { 72, 90, 120, 144 };
+	const int numRates = sizeof(rates) / sizeof(rates[0]);
+	const double toleranceMs = 1000.0 / rates[0]; // one frame at the slowest rate
+
+	ResponseTimes times[numRates];
+	for (int i = 0; i < numRates; i++) {
+		times[i] = PlayScript(config, rates[i]);
+	}
+
+	printf("response times (ms), cooldown %.0f ms, debounce %.0f ms\n", config.blockCooldownMs, config.isBlockingDebounceMs);
+	printf("  rate   start   retry   stop   stops during hit\n");
+	for (int i = 0; i < numRates; i++) {
+		printf("  %4.0f  %6.1f  %6.1f  %5.1f   %d\n", rates[i], times[i].startLatencyMs, times[i].retryMs, times[i].stopAfterConfirmMs, times[i].numStopsDuringHit);
+	}
+
+	// Compare everything against 90 Hz
+	const ResponseTimes &reference = times[1];
+	int result = 0;
+	for (int i = 0; i < numRates; i++) {
+		const ResponseTimes &t = times[i];
+		bool isMissing = t.startLatencyMs < 0 || t.retryMs < 0 || t.stopAfterConfirmMs < 0;
+		bool isOff = std::fabs(t.startLatencyMs - reference.startLatencyMs) > toleranceMs ||
+			std::fabs(t.retryMs - reference.retryMs) > toleranceMs ||
+			std::fabs(t.stopAfterConfirmMs - reference.stopAfterConfirmMs) > toleranceMs;
+		if (isMissing || isOff || t.numStopsDuringHit) {
+			printf("RESPONSE CHECK FAILED at %.0f Hz\n", rates[i]);
+			result = 1;
+		}
+	}
+
+	if (!IsUndebouncedPassedThrough(config)) {
+		printf("RESPONSE CHECK FAILED: with no debounce IsBlocking does not follow the graph\n");
+		result = 1;
+	}
+
+	if (!result) printf("response times match within %.1f ms at all rates\n", toleranceMs);
+	return result;
+}
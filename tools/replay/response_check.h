@@ -0,0 +1,9 @@
+#pragma once
+
+#include "blocking.h"
+
+
+// Plays the same scripted guard sequence at 72, 90, 120 and 144 Hz and checks that block start, retry and stop
+// happen after the same amount of wall time at every rate (within one frame of the slowest rate), and that with the
+// debounce off IsBlocking is passed through unchanged. Returns 0 if so.
+int RunResponseCheck(const BlockCore::Config &config);
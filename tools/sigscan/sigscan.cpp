@@ -0,0 +1,508 @@
+// Tests src/signature_scanner.cpp against synthetic PE images, and scans real executables for the plugin's addresses or
+// for a pattern, to help write new signatures.
+//
+// selftest builds an image with the kinds of target the plugin looks for planted among random bytes and decoys, then
+// checks that the SSE2 search agrees with the scalar one, that every target resolves to where it was planted, and that
+// the cache is used for the same image and thrown away for a changed one. It also checks that the plugin's code
+// signatures parse, and times a full scan. Whether they find the right code takes a real executable: scan prints where
+// each one lands next to its 1.4.15 address.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -Isrc -Itools/common tools/sigscan/sigscan.cpp src/game_addresses.cpp src/signature_scanner.cpp -o sigscan
+//
+// Examples:
+//   sigscan selftest
+//   sigscan selftest --image-mb 256 --searches 20000 --seed 3
+//   sigscan scan SkyrimVR.exe
+//   sigscan scan SkyrimVR.exe --pattern "F3 0F 59 05 ?? ?? ?? ?? 0F 28"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "game_addresses.h"
+#include "signature_scanner.h"
+#include "synthetic_session.h"
+
+using namespace SignatureScanner;
+
+
+static void PrintUsage()
+{
+	printf("usage: sigscan selftest [--image-mb n] [--searches n] [--seed n]\n");
+	printf("       sigscan scan <exe> [--pattern \"48 8B ?? ...\"]\n");
+	printf("\n");
+	printf("  selftest    check the scanner on a synthetic image of n MiB (default 64) with n random searches (default 5000)\n");
+	printf("  scan        resolve the plugin's addresses in an executable on disk. Game settings are only filled in once\n");
+	printf("              the game runs, so those are not found this way.\n");
+	printf("  --pattern   also list every match of a pattern in the code\n");
+}
+
+static double NowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void Write16(std::vector<uint8_t> &image, size_t at, uint16_t value) { memcpy(&image[at], &value, sizeof(value)); }
+static void Write32(std::vector<uint8_t> &image, size_t at, uint32_t value) { memcpy(&image[at], &value, sizeof(value)); }
+static void Write64(std::vector<uint8_t> &image, size_t at, uint64_t value) { memcpy(&image[at], &value, sizeof(value)); }
+
+static void WriteBytes(std::vector<uint8_t> &image, size_t at, const char *pattern)
+{
+	Pattern parsed;
+	ParsePattern(pattern, parsed);
+	for (size_t i = 0; i < parsed.bytes.size(); i++) image[at + i] = parsed.bytes[i];
+}
+
+// NUL terminated, and after the end of another string like in a real string table
+static void WriteString(std::vector<uint8_t> &image, size_t at, const char *text)
+{
+	image[at - 1] = 0;
+	memcpy(&image[at], text, strlen(text) + 1);
+}
+
+// A PE32+ image with a code section and two data sections, laid out as if loaded at address
+struct SyntheticImage
+{
+	static const uint32_t headersSize = 0x400;
+	static const uint64_t address = 0x140000000ull;
+
+	std::vector<uint8_t> bytes;
+	uint32_t textRva, textSize, rdataRva, rdataSize, dataRva, dataSize;
+
+	void Build(uint32_t size, SyntheticSession::Random &random)
+	{
+		textRva = 0x1000;
+		textSize = (size / 2) & ~0xFFFu;
+		rdataRva = textRva + textSize;
+		rdataSize = (size / 3) & ~0xFFFu;
+		dataRva = rdataRva + rdataSize;
+		dataSize = (size - dataRva) & ~0xFFFu;
+		bytes.assign(dataRva + dataSize, 0);
+
+		// Code leans on the bytes x64 code is full of, so the filter bytes see realistic hit rates
+		static const uint8_t common[] = { 0x48, 0x8B, 0x89, 0x0F, 0x4C, 0x24, 0x44, 0x00, 0xFF, 0xE8, 0x83, 0x8D, 0xCC, 0x01 };
+		for (uint32_t i = 0; i < textSize; i++) {
+			bytes[textRva + i] = random.Uniform() < 0.4f ? common[random.Next() % sizeof(common)] : (uint8_t)random.Next();
+		}
+		// Read only data: strings and small numbers
+		for (uint32_t i = 0; i < rdataSize; i++) {
+			float roll = random.Uniform();
+			bytes[rdataRva + i] = roll < 0.3f ? 0 : roll < 0.8f ? (uint8_t)('a' + random.Next() % 26) : (uint8_t)random.Next();
+		}
+		// Data: mostly zero, some pointers into the image
+		for (uint32_t i = 0; i + 8 <= dataSize; i += 8) {
+			if (random.Uniform() < 0.2f) Write64(bytes, dataRva + i, address + random.Next() % (dataRva + dataSize));
+		}
+
+		// Headers
+		bytes[0] = 'M';
+		bytes[1] = 'Z';
+		const uint32_t peOffset = 0x80;
+		Write32(bytes, 0x3C, peOffset);
+		memcpy(&bytes[peOffset], "PE\0\0", 4);
+		const uint32_t fileHeader = peOffset + 4;
+		const uint16_t numSections = 3, optionalHeaderSize = 240;
+		Write16(bytes, fileHeader, 0x8664);
+		Write16(bytes, fileHeader + 2, numSections);
+		Write32(bytes, fileHeader + 4, (uint32_t)random.Next()); // TimeDateStamp
+		Write16(bytes, fileHeader + 16, optionalHeaderSize);
+		const uint32_t optionalHeader = fileHeader + 20;
+		Write16(bytes, optionalHeader, 0x20B);
+		Write64(bytes, optionalHeader + 24, address); // ImageBase
+		Write32(bytes, optionalHeader + 56, (uint32_t)bytes.size()); // SizeOfImage
+		Write32(bytes, optionalHeader + 60, headersSize);
+
+		struct
+		{
+			const char *name;
+			uint32_t rva, size, characteristics;
+		} sections[numSections] = {
+			{ ".text", textRva, textSize, 0x60000020 },
+			{ ".rdata", rdataRva, rdataSize, 0x40000040 },
+			{ ".data", dataRva, dataSize, 0xC0000040 }
+		};
+		uint32_t sectionHeader = optionalHeader + optionalHeaderSize;
+		for (const auto &section : sections) {
+			memcpy(&bytes[sectionHeader], section.name, strlen(section.name));
+			Write32(bytes, sectionHeader + 8, section.size);
+			Write32(bytes, sectionHeader + 12, section.rva);
+			Write32(bytes, sectionHeader + 16, section.size);
+			Write32(bytes, sectionHeader + 20, section.rva);
+			Write32(bytes, sectionHeader + 36, section.characteristics);
+			sectionHeader += 40;
+		}
+	}
+};
+
+// What selftest plants, and where
+struct Planted
+{
+	std::vector<Target> targets;
+	std::vector<uint32_t> rvas; // expected, 0 if the target must not be found
+};
+
+static Planted Plant(SyntheticImage &image, SyntheticSession::Random &random)
+{
+	std::vector<uint8_t> &bytes = image.bytes;
+	const uint64_t address = SyntheticImage::address;
+	auto textAt = [&](double fraction) { return image.textRva + ((uint32_t)(image.textSize * fraction) & ~15u); };
+	auto rdataAt = [&](double fraction) { return image.rdataRva + ((uint32_t)(image.rdataSize * fraction) & ~15u); };
+	auto dataAt = [&](double fraction) { return image.dataRva + ((uint32_t)(image.dataSize * fraction) & ~15u); };
+	Planted planted;
+
+	// mulss xmm0, [rip + scale], near the end so a search goes through most of the code. A decoy with one fixed byte off
+	// comes first.
+	const char *mulssPattern = "F3 0F 59 05 ?? ?? ?? ?? 0F 28 C8 F3 0F 5C 0D";
+	uint32_t scaleRva = dataAt(0.9);
+	uint32_t mulssRva = textAt(0.97);
+	WriteBytes(bytes, textAt(0.3), "F3 0F 59 05 00 00 00 00 0F 28 C8 F3 0F 5C 0E");
+	WriteBytes(bytes, mulssRva, "F3 0F 59 05 00 00 00 00 0F 28 C8 F3 0F 5C 0D");
+	Write32(bytes, mulssRva + 4, scaleRva - (mulssRva + 8));
+	planted.targets.push_back({ "Scale", kTarget_Code, mulssPattern, 4, 8, 0, 0 });
+	planted.rvas.push_back(scaleRva);
+
+	// A function start taken as is, and one that is there twice so cannot be told apart
+	const char *functionPattern = "40 53 48 83 EC 20 80 3D ?? ?? ?? ?? 00 48 8B D9 74";
+	uint32_t functionRva = textAt(0.6);
+	WriteBytes(bytes, functionRva, "40 53 48 83 EC 20 80 3D 11 22 33 44 00 48 8B D9 74");
+	planted.targets.push_back({ "Function", kTarget_Code, functionPattern, -1, 0, 0, 0 });
+	planted.rvas.push_back(functionRva);
+
+	const char *twicePattern = "55 41 56 41 57 48 8D 6C 24 ?? 48 81 EC";
+	WriteBytes(bytes, textAt(0.2), "55 41 56 41 57 48 8D 6C 24 90 48 81 EC");
+	WriteBytes(bytes, textAt(0.8), "55 41 56 41 57 48 8D 6C 24 A0 48 81 EC");
+	planted.targets.push_back({ "Ambiguous", kTarget_Code, twicePattern, -1, 0, 0, 0 });
+	planted.rvas.push_back(0);
+
+	// A game setting, with names that contain its name around it, and a stray pointer to its name first
+	uint32_t settingVtableRva = rdataAt(0.05);
+	uint32_t settingNameRva = rdataAt(0.5);
+	WriteString(bytes, rdataAt(0.2), "xfTestSetting_Blocking");
+	WriteString(bytes, rdataAt(0.25), "fTestSetting_BlockingSpeed");
+	WriteString(bytes, settingNameRva, "fTestSetting_Blocking");
+	Write64(bytes, dataAt(0.1), 0);
+	Write64(bytes, dataAt(0.1) + 16, address + settingNameRva);
+	uint32_t settingRva = dataAt(0.4);
+	Write64(bytes, settingRva, address + settingVtableRva);
+	float value = 0.4f;
+	memcpy(&bytes[settingRva + 8], &value, sizeof(value));
+	Write64(bytes, settingRva + 16, address + settingNameRva);
+	planted.targets.push_back({ "TestSetting", kTarget_GameSetting, "fTestSetting_Blocking", -1, 0, 0, 0 });
+	planted.rvas.push_back(settingRva + 8);
+
+	// An ini setting, which carries its section in the name
+	uint32_t iniNameRva = rdataAt(0.55);
+	WriteString(bytes, iniNameRva, "fIniSetting:Combat");
+	uint32_t iniSettingRva = dataAt(0.45);
+	Write64(bytes, iniSettingRva, address + settingVtableRva);
+	Write64(bytes, iniSettingRva + 16, address + iniNameRva);
+	planted.targets.push_back({ "IniSetting", kTarget_GameSetting, "fIniSetting", -1, 0, 0, 0 });
+	planted.rvas.push_back(iniSettingRva + 8);
+
+	// RTTI for a class with a second base: the secondary vtable and its locator come first
+	uint32_t typeDescriptorRva = dataAt(0.6);
+	WriteString(bytes, typeDescriptorRva + 16, ".?AVTestCharacter@@");
+	WriteString(bytes, dataAt(0.65) + 16, ".?AVTestCharacterBase@@");
+	uint32_t locatorRvas[2] = { rdataAt(0.6), rdataAt(0.7) };
+	uint32_t vtableRvas[2] = { rdataAt(0.62) + 8, rdataAt(0.72) + 8 };
+	uint32_t offsets[2] = { 0x10, 0 };
+	for (int i = 0; i < 2; i++) {
+		Write32(bytes, locatorRvas[i], 1);
+		Write32(bytes, locatorRvas[i] + 4, offsets[i]);
+		Write32(bytes, locatorRvas[i] + 8, 0);
+		Write32(bytes, locatorRvas[i] + 12, typeDescriptorRva);
+		Write32(bytes, locatorRvas[i] + 16, (uint32_t)random.Next());
+		Write32(bytes, locatorRvas[i] + 20, locatorRvas[i]);
+		Write64(bytes, vtableRvas[i] - 8, address + locatorRvas[i]);
+	}
+	planted.targets.push_back({ "TestCharacter_Slot", kTarget_VtableSlot, ".?AVTestCharacter@@", -1, 0, 0x55 * 8, 0 });
+	planted.rvas.push_back(vtableRvas[1] + 0x55 * 8);
+
+	planted.targets.push_back({ "Missing", kTarget_VtableSlot, ".?AVMissing@@", -1, 0, 0, 0 });
+	planted.rvas.push_back(0);
+	return planted;
+}
+
+static int CheckResolved(const char *what, const Planted &planted, const Resolved *resolved, bool isCachedExpected)
+{
+	int numFailed = 0;
+	for (size_t i = 0; i < planted.targets.size(); i++) {
+		bool isExpected = planted.rvas[i] != 0;
+		bool isRight = resolved[i].isFound == isExpected && (!isExpected || resolved[i].rva == planted.rvas[i]) &&
+			resolved[i].isCached == isCachedExpected;
+		if (!isRight) {
+			printf("  FAILED %s: %s found %d at %08x (cached %d), expected %d at %08x\n", what, planted.targets[i].name,
+				resolved[i].isFound, resolved[i].rva, resolved[i].isCached, isExpected, planted.rvas[i]);
+			numFailed++;
+		}
+	}
+	return numFailed;
+}
+
+static int SelfTest(uint32_t imageMb, int numSearches, uint64_t seed)
+{
+	SyntheticSession::Random random(seed);
+	SyntheticImage synthetic;
+	synthetic.Build(imageMb << 20, random);
+	Planted planted = Plant(synthetic, random);
+	std::vector<uint8_t> &bytes = synthetic.bytes;
+	int numFailed = 0;
+
+	Image image;
+	if (!ReadImage(bytes.data(), SyntheticImage::address, image) || image.sections.size() != 3) {
+		printf("FAILED to read the synthetic image's headers\n");
+		return 1;
+	}
+	printf("image: %u MiB, %zu sections, hash %016llx\n", imageMb, image.sections.size(), (unsigned long long)image.hash);
+
+	// Random patterns cut out of the code with some bytes wildcarded, searched for over a window around where they came
+	// from. Half are made to miss by changing a fixed byte.
+	int numMismatches = 0, numFound = 0;
+	const uint8_t *code = bytes.data() + synthetic.textRva;
+	const uint32_t window = 1 << 20;
+	for (int i = 0; i < numSearches; i++) {
+		const uint8_t *begin = code + random.Next() % (synthetic.textSize - window);
+		const uint8_t *end = begin + window;
+		size_t size = 1 + random.Next() % 24;
+		size_t from = random.Next() % (window - size);
+		std::string text;
+		for (size_t j = 0; j < size; j++) {
+			char token[4];
+			bool isWildcard = j && random.Uniform() < 0.3f;
+			uint8_t byte = begin[from + j] ^ (uint8_t)(i % 2 && j == size - 1 ? 0x5A : 0);
+			snprintf(token, sizeof(token), isWildcard ? "?? " : "%02X ", byte);
+			text += token;
+		}
+		Pattern pattern;
+		ParsePattern(text.c_str(), pattern);
+		const uint8_t *start = begin + random.Next() % (window / 2);
+		const uint8_t *vector = Find(start, end, pattern);
+		const uint8_t *scalar = FindScalar(start, end, pattern);
+		numFound += scalar != nullptr;
+		if (vector != scalar) {
+			if (numMismatches < 5) printf("  FAILED search %d: %s from +%zx, sse %p scalar %p\n", i, text.c_str(), (size_t)(start - begin), (const void *)vector, (const void *)scalar);
+			numMismatches++;
+		}
+	}
+	printf("search: %d random patterns (%d found), %d sse / scalar mismatches\n", numSearches, numFound, numMismatches);
+	numFailed += numMismatches;
+
+	// The plugin's own code signatures have to parse, and hold the operand they follow
+	for (const Target &target : GameAddresses::targets) {
+		if (target.kind != kTarget_Code) continue;
+		Pattern pattern;
+		bool isParsed = ParsePattern(target.signature, pattern);
+		if (!isParsed || target.operandOffset + 4 > (int)pattern.bytes.size() || target.instructionEnd > (int)pattern.bytes.size()) {
+			printf("  FAILED: the signature for %s is not a pattern or is too short for its operand\n", target.name);
+			numFailed++;
+		}
+	}
+
+	// Every target from scratch, then from the cache
+	const std::string cachePath = "sigscan_selftest_cache.txt";
+	const int numTargets = (int)planted.targets.size();
+	std::vector<Resolved> resolved(numTargets);
+	Cache cache;
+	bool isCacheChanged;
+	double startMs = NowMs();
+	Resolve(image, planted.targets.data(), numTargets, cache, resolved.data(), isCacheChanged);
+	double coldMs = NowMs() - startMs;
+	numFailed += CheckResolved("cold", planted, resolved.data(), false);
+	if (!isCacheChanged || !WriteCache(cachePath, cache)) {
+		printf("  FAILED to write the cache\n");
+		numFailed++;
+	}
+
+	Cache readCache;
+	if (!ReadCache(cachePath, readCache) || readCache.imageHash != image.hash || readCache.entries.size() != cache.entries.size()) {
+		printf("  FAILED to read the cache back\n");
+		numFailed++;
+	}
+	startMs = NowMs();
+	Resolve(image, planted.targets.data(), numTargets, readCache, resolved.data(), isCacheChanged);
+	double cachedMs = NowMs() - startMs;
+	numFailed += CheckResolved("cached", planted, resolved.data(), true);
+	if (isCacheChanged) {
+		printf("  FAILED: resolving from a good cache changed it\n");
+		numFailed++;
+	}
+	printf("resolve: %d targets in %.2f ms, %.3f ms from the cache\n", numTargets, coldMs, cachedMs);
+
+	// A cached anchor that no longer checks out is searched for again
+	Cache staleCache = readCache;
+	staleCache.entries[0].anchorRva += 1;
+	Resolve(image, planted.targets.data(), numTargets, staleCache, resolved.data(), isCacheChanged);
+	if (!resolved[0].isFound || resolved[0].isCached || resolved[0].rva != planted.rvas[0] || !isCacheChanged) {
+		printf("  FAILED: a stale cache entry was used or not replaced\n");
+		numFailed++;
+	}
+
+	// A relinked executable has a different timestamp, the whole cache goes
+	bytes[0x80 + 8] ^= 0xFF;
+	Image changed;
+	ReadImage(bytes.data(), SyntheticImage::address, changed);
+	Cache oldCache = readCache;
+	Resolve(changed, planted.targets.data(), numTargets, oldCache, resolved.data(), isCacheChanged);
+	numFailed += CheckResolved("changed image", planted, resolved.data(), false);
+	if (changed.hash == image.hash || oldCache.imageHash != changed.hash) {
+		printf("  FAILED: the cache was not rebuilt for a changed image\n");
+		numFailed++;
+	}
+	bytes[0x80 + 8] ^= 0xFF;
+	std::remove(cachePath.c_str());
+
+	// A pattern that is not there, so every byte of the image is looked at
+	Pattern absent;
+	ParsePattern("E8 ?? ?? ?? ?? 90 C3 CC 13 37 ?? 42", absent);
+	const uint8_t *all = bytes.data();
+	const uint8_t *allEnd = all + bytes.size();
+	auto timeScan = [&](const uint8_t *(*find)(const uint8_t *, const uint8_t *, const Pattern &)) {
+		double best = 1e9;
+		for (int i = 0; i < 5; i++) {
+			double start = NowMs();
+			if (find(all, allEnd, absent)) printf("  FAILED: found a pattern that is not there\n");
+			best = std::min(best, NowMs() - start);
+		}
+		return best;
+	};
+	double vectorMs = timeScan(Find);
+	double scalarMs = timeScan(FindScalar);
+	double mib = (double)bytes.size() / (1 << 20);
+	printf("full scan: %s %.2f ms (%.1f GiB/s), scalar %.2f ms (%.1f GiB/s)\n", IsFindVectorized() ? "sse2" : "n/a",
+		vectorMs, mib / 1024 / (vectorMs / 1000), scalarMs, mib / 1024 / (scalarMs / 1000));
+
+	printf(numFailed ? "%d checks FAILED\n" : "all checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+// Lays the file's sections out at their RVAs, the way the loader would
+static bool LoadImageFile(const std::string &path, std::vector<uint8_t> &memory, Image &image)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+	std::vector<uint8_t> raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (raw.size() < 0x400) return false;
+
+	// The headers are the same on disk, read them in place first for the sizes
+	std::vector<uint8_t> headers(raw.begin(), raw.begin() + std::min<size_t>(raw.size(), 0x1000));
+	headers.resize(0x1000, 0);
+	uint32_t peOffset;
+	memcpy(&peOffset, &headers[0x3C], 4);
+	if (peOffset > 0x1000 - 0x200) return false;
+	uint32_t optionalHeader = peOffset + 24;
+	uint64_t imageBase;
+	uint32_t sizeOfImage, sizeOfHeaders;
+	uint16_t numSections, optionalHeaderSize;
+	memcpy(&numSections, &headers[peOffset + 6], 2);
+	memcpy(&optionalHeaderSize, &headers[peOffset + 20], 2);
+	memcpy(&imageBase, &headers[optionalHeader + 24], 8);
+	memcpy(&sizeOfImage, &headers[optionalHeader + 56], 4);
+	memcpy(&sizeOfHeaders, &headers[optionalHeader + 60], 4);
+	if (sizeOfHeaders > raw.size() || sizeOfHeaders > sizeOfImage) return false;
+
+	memory.assign(sizeOfImage, 0);
+	memcpy(memory.data(), raw.data(), sizeOfHeaders);
+	uint32_t sectionHeader = optionalHeader + optionalHeaderSize;
+	for (int i = 0; i < numSections && sectionHeader + 40 <= 0x1000; i++, sectionHeader += 40) {
+		uint32_t rva, rawSize, rawOffset;
+		memcpy(&rva, &headers[sectionHeader + 12], 4);
+		memcpy(&rawSize, &headers[sectionHeader + 16], 4);
+		memcpy(&rawOffset, &headers[sectionHeader + 20], 4);
+		if (rva >= sizeOfImage || rawOffset >= raw.size()) continue;
+		size_t size = std::min<size_t>({ rawSize, sizeOfImage - rva, raw.size() - rawOffset });
+		memcpy(&memory[rva], &raw[rawOffset], size);
+	}
+	return ReadImage(memory.data(), imageBase, image);
+}
+
+static int Scan(const std::string &path, const std::string &patternText)
+{
+	std::vector<uint8_t> memory;
+	Image image;
+	double startMs = NowMs();
+	if (!LoadImageFile(path, memory, image)) {
+		fprintf(stderr, "failed to read %s as a PE32+ image\n", path.c_str());
+		return 1;
+	}
+	printf("%s: %.1f MiB at %016llx, hash %016llx, loaded in %.1f ms\n", path.c_str(), image.size / 1048576.0,
+		(unsigned long long)image.address, (unsigned long long)image.hash, NowMs() - startMs);
+	for (const Section &section : image.sections) {
+		printf("  %-8s %08x  %9u bytes%s\n", section.name, section.rva, section.size, section.isExecutable ? "  code" : "");
+	}
+
+	for (const Target &target : GameAddresses::targets) {
+		if (target.kind == kTarget_None) {
+			printf("  %-40s no signature, 1.4.15 address %08x\n", target.name, target.knownRva);
+			continue;
+		}
+		Resolved resolved;
+		startMs = NowMs();
+		bool isFound = Resolve(image, target, resolved);
+		double ms = NowMs() - startMs;
+		if (isFound) printf("  %-40s %08x (1.4.15 %08x) in %.2f ms\n", target.name, resolved.rva, target.knownRva, ms);
+		else printf("  %-40s not found (1.4.15 %08x) in %.2f ms\n", target.name, target.knownRva, ms);
+	}
+
+	if (!patternText.empty()) {
+		Pattern pattern;
+		if (!ParsePattern(patternText.c_str(), pattern)) {
+			fprintf(stderr, "not a pattern: %s\n", patternText.c_str());
+			return 2;
+		}
+		int numMatches = 0;
+		startMs = NowMs();
+		for (const Section &section : image.sections) {
+			if (!section.isExecutable) continue;
+			const uint8_t *begin = image.base + section.rva, *end = begin + section.size;
+			for (const uint8_t *match = Find(begin, end, pattern); match; match = Find(match + 1, end, pattern)) {
+				if (numMatches++ < 20) printf("  match at %08x\n", (uint32_t)(match - image.base));
+			}
+		}
+		printf("  %d matches in %.2f ms\n", numMatches, NowMs() - startMs);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		PrintUsage();
+		return 2;
+	}
+
+	std::string command = argv[1];
+	std::string path, patternText;
+	uint32_t imageMb = 64;
+	int numSearches = 5000;
+	uint64_t seed = 1;
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--image-mb" && hasValue) imageMb = (uint32_t)atoi(argv[++i]);
+		else if (arg == "--searches" && hasValue) numSearches = atoi(argv[++i]);
+		else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--pattern" && hasValue) patternText = argv[++i];
+		else if (arg[0] != '-' && path.empty()) path = arg;
+		else {
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (command == "selftest") {
+		if (imageMb < 4 || imageMb > 1024) {
+			fprintf(stderr, "--image-mb must be between 4 and 1024\n");
+			return 2;
+		}
+		return SelfTest(imageMb, numSearches, seed);
+	}
+	if (command == "scan" && !path.empty()) return Scan(path, patternText);
+	PrintUsage();
+	return 2;
+}
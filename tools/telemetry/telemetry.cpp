@@ -0,0 +1,316 @@
+// Reference reader for the telemetry the game shares with EnableTelemetry = 1 (src/telemetry.h), and a self test of the
+// sequence lock with a writer and readers in one process.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread -Isrc -Itools/common tools/telemetry/telemetry.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp src/profiler.cpp src/telemetry.cpp -lrt -o telemetry
+//
+// Examples:
+//   telemetry watch --rate 10
+//   telemetry watch --rate 2 --count 20 --profile
+//   telemetry selftest --seconds 5 --readers 3
+//   telemetry selftest --seconds 5 --writer-rate 144
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blocking.h"
+#include "synthetic_session.h"
+#include "telemetry.h"
+
+
+static void PrintUsage()
+{
+	printf("usage: telemetry watch [--rate hz] [--count n] [--profile]\n");
+	printf("       telemetry selftest [--seconds n] [--readers n] [--writer-rate hz] [--session-seconds n] [--seed n]\n");
+	printf("\n");
+	printf("  watch      print the game's block state every 1 / rate seconds (default 10 Hz) until stopped, or count lines\n");
+	printf("  --profile  also print the profiler stages, when ProfilerDumpIntervalSeconds is set in the game\n");
+	printf("  selftest   publish a synthetic session as fast as possible for n seconds (default 5) while n readers\n");
+	printf("             (default 2) poll flat out, and check every frame read against what was published\n");
+	printf("  --writer-rate  publish at this many frames per second instead, like the game would (0, as fast as possible)\n");
+}
+
+static const char * ModeName(uint8_t mode)
+{
+	switch (mode) {
+	case BlockCore::kHandMode_Armed: return "armed";
+	case BlockCore::kHandMode_Unarmed: return "unarmed";
+	case BlockCore::kHandMode_Shield: return "shield";
+	case BlockCore::kHandMode_Stop: return "stop";
+	default: return "?";
+	}
+}
+
+static const char * StatusName(uint8_t status)
+{
+	switch (status) {
+	case BlockCore::kHandStatus_None: return "-";
+	case BlockCore::kHandStatus_Stop: return "stop";
+	case BlockCore::kHandStatus_Start: return "start";
+	default: return "?";
+	}
+}
+
+static const char * PhaseName(uint8_t phase)
+{
+	switch (phase) {
+	case BlockCore::kBlockPhase_Idle: return "idle";
+	case BlockCore::kBlockPhase_PendingStart: return "pending start";
+	case BlockCore::kBlockPhase_Blocking: return "blocking";
+	case BlockCore::kBlockPhase_PendingStop: return "pending stop";
+	default: return "?";
+	}
+}
+
+static void PrintFrame(const Telemetry::Frame &frame, bool showProfile)
+{
+	printf("#%llu %s", (unsigned long long)frame.frameNumber, frame.isActive ? "active" : "inactive");
+	if (frame.hasTestState) {
+		static const char *handNames[2] = { "main", "off" };
+		for (int i = 0; i < 2; i++) {
+			const Telemetry::Hand &hand = frame.hands[i];
+			printf("  %s %s %.2f m/s facing %+.2f across %+.2f vertical %+.2f -> %s", handNames[i], ModeName(hand.mode), hand.speed,
+				hand.facing, hand.across, hand.verticalDistance, StatusName(hand.status));
+		}
+		printf("  | %s, cooldowns %.0f / %.0f ms", PhaseName(frame.phase), frame.startCooldownMs, frame.stopCooldownMs);
+		if (frame.notifyTimeoutMs > 0) printf(", timeout %.0f ms", frame.notifyTimeoutMs);
+	}
+	printf("  | IsBlocking %d, actor %d | sent %llu / %llu, held back %llu / %llu\n", frame.isBlockingGraph, frame.isBlockingInternal,
+		(unsigned long long)frame.numStartsSent, (unsigned long long)frame.numStopsSent,
+		(unsigned long long)frame.numStartsSuppressed, (unsigned long long)frame.numStopsSuppressed);
+
+	if (showProfile) {
+		for (int i = 0; i < Telemetry::numProfilerStages; i++) {
+			if (!frame.stageCounts[i]) continue;
+			printf("    %-11s p50 %7.1f us  p99 %7.1f us  max %8.1f us  (%llu)\n", Profiler::StageName((Profiler::Stage)i),
+				frame.stageP50Us[i], frame.stageP99Us[i], frame.stageMaxUs[i], (unsigned long long)frame.stageCounts[i]);
+		}
+	}
+}
+
+static int Watch(double rate, int count, bool showProfile)
+{
+	Telemetry::Reader reader;
+	bool hasWaited = false;
+	while (!reader.Open()) {
+		if (!hasWaited) printf("waiting for the game (EnableTelemetry = 1 in DualWieldBlockVR.ini)...\n");
+		hasWaited = true;
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+
+	auto interval = std::chrono::duration<double>(1.0 / rate);
+	uint64_t lastFrameNumber = 0;
+	for (int i = 0; count <= 0 || i < count; i++) {
+		Telemetry::Frame frame;
+		if (!reader.Read(frame)) {
+			fprintf(stderr, "could not get a consistent copy\n");
+		}
+		else if (frame.frameNumber == lastFrameNumber) {
+			printf("no new frame (game paused or closed)\n");
+		}
+		else {
+			PrintFrame(frame, showProfile);
+			lastFrameNumber = frame.frameNumber;
+		}
+		fflush(stdout);
+		std::this_thread::sleep_for(interval);
+	}
+	return 0;
+}
+
+// The frames a synthetic session would publish, in order. The writer loops over them, numbering every publish.
+static std::vector<Telemetry::Frame> MakeFrames(double sessionSeconds, uint64_t seed)
+{
+	SyntheticSession::Options options;
+	options.seconds = sessionSeconds;
+	options.seed = seed;
+
+	BlockCore::Config config;
+	config.isHandReadoutEnabled = true;
+	std::vector<BlockCore::FrameInput> inputs = SyntheticSession::Generate(options, config);
+
+	BlockCore::State state;
+	std::vector<Telemetry::Frame> frames(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++) {
+		BlockCore::Decision decision = BlockCore::Update(state, config, inputs[i]);
+		Telemetry::Frame &frame = frames[i];
+		memset(&frame, 0, sizeof(frame));
+		Telemetry::FillFrame(&state, config, inputs[i], decision, frame);
+		// Fill the profiler part with something that changes every frame, so a torn copy shows there too
+		for (int s = 0; s < Telemetry::numProfilerStages; s++) frame.stageCounts[s] = i * (s + 1);
+	}
+	return frames;
+}
+
+struct ReaderStats
+{
+	uint64_t numReads = 0;
+	uint64_t numNewFrames = 0;
+	uint64_t numRetries = 0;
+	uint64_t numFailedReads = 0;
+	uint64_t numTorn = 0; // consistent by the sequence, but not the frame that was published under its number. Must stay 0.
+	uint64_t numBackwards = 0; // older than a frame already read. Must stay 0.
+};
+
+// Frame number n is frames[(n - 1) % size] with that number
+static void PublishFor(Telemetry::Writer &writer, const std::vector<Telemetry::Frame> &frames, double seconds, double rate, std::vector<double> *publishNs, uint64_t &frameNumber, uint64_t &numPublished)
+{
+	auto begin = std::chrono::steady_clock::now();
+	auto end = begin + std::chrono::duration<double>(seconds);
+	numPublished = 0;
+	Telemetry::Frame frame;
+	while (std::chrono::steady_clock::now() < end) {
+		if (rate > 0) {
+			auto next = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(numPublished / rate));
+			while (std::chrono::steady_clock::now() < next) std::this_thread::yield();
+		}
+
+		frameNumber++;
+		frame = frames[(frameNumber - 1) % frames.size()];
+		frame.frameNumber = frameNumber;
+
+		auto start = std::chrono::steady_clock::now();
+		writer.Publish(frame);
+		if (publishNs && (rate > 0 || (numPublished & 63) == 0)) {
+			publishNs->push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+		numPublished++;
+	}
+}
+
+static void PrintPublishLatency(const char *label, std::vector<double> &publishNs, uint64_t numPublished, double seconds)
+{
+	std::sort(publishNs.begin(), publishNs.end());
+	printf("%-22s %llu frames (%.0f /s), publish p50 %.0f ns, p99 %.0f ns, max %.0f ns\n", label, (unsigned long long)numPublished,
+		numPublished / seconds, publishNs[publishNs.size() / 2], publishNs[publishNs.size() * 99 / 100], publishNs.back());
+}
+
+static int SelfTest(double seconds, int numReaders, double writerRate, double sessionSeconds, uint64_t seed)
+{
+	std::vector<Telemetry::Frame> frames = MakeFrames(sessionSeconds, seed);
+	printf("session:               %zu frames of %zu bytes\n", frames.size(), sizeof(Telemetry::Frame));
+
+	Telemetry::Writer writer;
+	if (!writer.Open()) {
+		fprintf(stderr, "could not create the shared memory block\n");
+		return 1;
+	}
+
+	// The same writer on its own first, so what the readers cost it can be seen
+	std::vector<double> aloneNs;
+	uint64_t frameNumber = 0, numAlone = 0;
+	PublishFor(writer, frames, std::min(seconds, 1.0), writerRate, &aloneNs, frameNumber, numAlone);
+	PrintPublishLatency("writer alone:", aloneNs, numAlone, std::min(seconds, 1.0));
+
+	std::atomic<bool> isDone(false);
+	std::vector<ReaderStats> stats(numReaders);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < numReaders; r++) {
+		readers.emplace_back([&, r]() {
+			// Each reader maps the block on its own, like a separate process would
+			Telemetry::Reader reader;
+			if (!reader.Open()) return;
+			ReaderStats &s = stats[r];
+			uint64_t lastFrameNumber = 0;
+			Telemetry::Frame frame;
+			while (!isDone.load(std::memory_order_relaxed)) {
+				int numRetries = 0;
+				bool isRead = reader.Read(frame, 64, &numRetries);
+				s.numReads++;
+				s.numRetries += numRetries;
+				if (!isRead) {
+					s.numFailedReads++;
+					continue;
+				}
+				Telemetry::Frame expected = frames[(frame.frameNumber - 1) % frames.size()];
+				expected.frameNumber = frame.frameNumber;
+				if (!frame.frameNumber || memcmp(&frame, &expected, sizeof(frame)) != 0) {
+					s.numTorn++;
+					continue;
+				}
+				if (frame.frameNumber < lastFrameNumber) s.numBackwards++;
+				if (frame.frameNumber != lastFrameNumber) s.numNewFrames++;
+				lastFrameNumber = frame.frameNumber;
+			}
+		});
+	}
+
+	std::vector<double> publishNs;
+	uint64_t numPublished = 0;
+	PublishFor(writer, frames, seconds, writerRate, &publishNs, frameNumber, numPublished);
+	isDone = true;
+	for (std::thread &thread : readers) thread.join();
+
+	char label[64];
+	snprintf(label, sizeof(label), "writer, %d readers:", numReaders);
+	PrintPublishLatency(label, publishNs, numPublished, seconds);
+
+	ReaderStats total;
+	for (int r = 0; r < numReaders; r++) {
+		const ReaderStats &s = stats[r];
+		printf("reader %d:              %llu reads, %llu new frames, %llu retries, %llu failed, %llu torn, %llu backwards\n", r,
+			(unsigned long long)s.numReads, (unsigned long long)s.numNewFrames, (unsigned long long)s.numRetries,
+			(unsigned long long)s.numFailedReads, (unsigned long long)s.numTorn, (unsigned long long)s.numBackwards);
+		total.numReads += s.numReads;
+		total.numTorn += s.numTorn;
+		total.numBackwards += s.numBackwards;
+	}
+
+	if (!total.numReads) {
+		fprintf(stderr, "no reader could open the block\n");
+		return 1;
+	}
+	if (total.numTorn || total.numBackwards) {
+		fprintf(stderr, "FAILED: %llu torn and %llu out of order reads\n", (unsigned long long)total.numTorn, (unsigned long long)total.numBackwards);
+		return 1;
+	}
+	printf("no torn or out of order reads\n");
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		PrintUsage();
+		return 2;
+	}
+
+	std::string command = argv[1];
+	double rate = 10;
+	int count = 0;
+	bool showProfile = false;
+	double seconds = 5;
+	int numReaders = 2;
+	double writerRate = 0;
+	double sessionSeconds = 60;
+	uint64_t seed = 1;
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--rate" && hasValue) rate = atof(argv[++i]);
+		else if (arg == "--count" && hasValue) count = atoi(argv[++i]);
+		else if (arg == "--profile") showProfile = true;
+		else if (arg == "--seconds" && hasValue) seconds = atof(argv[++i]);
+		else if (arg == "--readers" && hasValue) numReaders = atoi(argv[++i]);
+		else if (arg == "--writer-rate" && hasValue) writerRate = atof(argv[++i]);
+		else if (arg == "--session-seconds" && hasValue) sessionSeconds = atof(argv[++i]);
+		else if (arg == "--seed" && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+		else {
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (command == "watch" && rate > 0) return Watch(rate, count, showProfile);
+	if (command == "selftest" && seconds > 0 && numReaders > 0 && writerRate >= 0 && sessionSeconds > 0) return SelfTest(seconds, numReaders, writerRate, sessionSeconds, seed);
+
+	PrintUsage();
+	return 2;
+}
@@ -0,0 +1,560 @@
+// Offline threshold tuner. Loads labelled traces (or generates labelled sessions), searches a grid of [DualWield] and
+// [Unarmed] thresholds on every core, scores each candidate on false starts, dropped blocks, missed guards, how long
+// a block takes to come up and how long it lingers after the guard is lowered, and writes the best thresholds into a
+// copy of DualWieldBlockVR.ini.
+//
+// The search is successive halving: every candidate is scored on a few chunks of the traces, the best part of them
+// on twice as many, and so on until the survivors have seen everything. The finalists are then replayed through
+// BlockCore::Update itself, and the tuner fails if that does not give exactly the same scores as the fast path.
+//
+// Traces are replay's frame traces, with the guards in <trace>.labels next to each one (replay --synthetic --write-trace
+// writes both). The animation graph is simulated, so the IsBlocking values recorded in the traces are not used.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 -pthread -Isrc -Itools/common tools/tuner/*.cpp tools/common/*.cpp src/blocking.cpp src/dual_hand_classifier.cpp src/settings.cpp -o tuner
+//
+// Examples:
+//   tuner --synthetic 20 --out DualWieldBlockVR.tuned.ini
+//   tuner session1.txt session2.txt --ini DualWieldBlockVR.ini --steps 8 --threads 16
+//   tuner session.txt --groups unarmed --weights 1,2,3,10,2
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "block_labels.h"
+#include "blocking.h"
+#include "frame_trace.h"
+#include "settings.h"
+#include "synthetic_session.h"
+#include "tuning.h"
+#include "work_stealing_pool.h"
+
+using namespace Tuning;
+
+
+static const char *s_groupSections[kNumGroups] = { "DualWield", "Unarmed" };
+static const char *s_metricKeys[kNumGroups][kNumMetrics] = {
+	{ "MaxSpeed", "HandForwardDotWithHmdDown", "HandForwardDotWithHmdForward", "HmdToHandVerticalDistance" },
+	{ "MaxSpeed", "HandForwardDotWithHmdRight", nullptr, "HmdToHandVerticalDistance" },
+};
+
+// Where each grid runs from its strictest to its loosest value by default
+struct AxisRange
+{
+	float strictest;
+	float loosest;
+};
+
+static const AxisRange s_defaultRanges[kNumGroups][kNumMetrics] = {
+	{ { 0.5f, 6.f }, { 0.2f, -0.9f }, { 0.1f, 0.9f }, { 0.1f, 0.6f } },
+	{ { 0.25f, 4.f }, { 0.9f, 0.f }, { 0.f, 0.f }, { 0.1f, 0.6f } },
+};
+
+// ---- ini ----
+
+struct IniLine
+{
+	std::string text;
+	std::string section; // the section the line is in
+	std::string key; // empty if the line is not key = value
+	std::string value;
+};
+
+static std::string Trim(const std::string &s)
+{
+	size_t begin = s.find_first_not_of(" \t\r");
+	if (begin == std::string::npos) return "";
+	size_t end = s.find_last_not_of(" \t\r");
+	return s.substr(begin, end - begin + 1);
+}
+
+static bool ReadIni(const std::string &path, std::vector<IniLine> &lines)
+{
+	std::ifstream file(path);
+	if (!file) return false;
+
+	std::string text, section;
+	while (std::getline(file, text)) {
+		if (!text.empty() && text.back() == '\r') text.pop_back();
+		IniLine line;
+		line.text = text;
+		std::string trimmed = Trim(text);
+		if (!trimmed.empty() && trimmed[0] == '[' && trimmed.back() == ']') {
+			section = trimmed.substr(1, trimmed.size() - 2);
+		}
+		else if (!trimmed.empty() && trimmed[0] != '#' && trimmed[0] != ';') {
+			size_t equals = trimmed.find('=');
+			if (equals != std::string::npos) {
+				line.key = Trim(trimmed.substr(0, equals));
+				line.value = Trim(trimmed.substr(equals + 1));
+			}
+		}
+		line.section = section;
+		lines.push_back(line);
+	}
+	return true;
+}
+
+static std::string ThresholdKey(Group group, Metric metric, bool isExit)
+{
+	return std::string(s_metricKeys[group][metric]) + (isExit ? "Exit" : "Enter");
+}
+
+// Copies the template with the thresholds replaced. Without a template, writes just the thresholds.
+static bool WriteIni(const std::string &path, const std::vector<IniLine> &lines, BlockCore::Config &config)
+{
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) return false;
+
+	auto findThreshold = [](const IniLine &line, Group &group, Metric &metric, bool &isExit) {
+		for (int g = 0; g < kNumGroups; g++) {
+			if (line.section != s_groupSections[g]) continue;
+			for (int m = 0; m < kNumMetrics; m++) {
+				if (!HasMetric((Group)g, (Metric)m)) continue;
+				for (bool exit : { false, true }) {
+					if (line.key == ThresholdKey((Group)g, (Metric)m, exit)) {
+						group = (Group)g;
+						metric = (Metric)m;
+						isExit = exit;
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	};
+
+	if (lines.empty()) {
+		for (int group = 0; group < kNumGroups; group++) {
+			fprintf(file, "%s[%s]\n\n", group ? "\n" : "", s_groupSections[group]);
+			for (int metric = 0; metric < kNumMetrics; metric++) {
+				if (!HasMetric((Group)group, (Metric)metric)) continue;
+				for (bool isExit : { false, true }) {
+					fprintf(file, "%s = %g\n", ThresholdKey((Group)group, (Metric)metric, isExit).c_str(), Threshold(config, (Group)group, (Metric)metric, isExit));
+				}
+			}
+		}
+	}
+	else {
+		for (size_t i = 0; i < lines.size(); i++) {
+			const IniLine &line = lines[i];
+			Group group;
+			Metric metric;
+			bool isExit;
+			if (!line.key.empty() && findThreshold(line, group, metric, isExit)) {
+				fprintf(file, "%s = %g", line.key.c_str(), Threshold(config, group, metric, isExit));
+			}
+			else {
+				fprintf(file, "%s", line.text.c_str());
+			}
+			if (i + 1 < lines.size()) fprintf(file, "\n");
+		}
+	}
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+// ---- search ----
+
+static void BuildAxes(Axes &axes, const BlockCore::Config &config, int steps)
+{
+	BlockCore::Config current = config;
+	for (int group = 0; group < kNumGroups; group++) {
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			Axis &axis = axes.axes[group][metric];
+			const AxisRange &range = s_defaultRanges[group][metric];
+			axis.isMinimum = metric == kMetric_A;
+			axis.values.clear();
+			if (!HasMetric((Group)group, (Metric)metric)) {
+				axis.values.push_back(0);
+				continue;
+			}
+
+			for (int i = 0; i < steps; i++) {
+				float t = steps > 1 ? (float)i / (steps - 1) : 0;
+				float value = range.strictest + (range.loosest - range.strictest) * t;
+				axis.values.push_back(std::round(value * 1000) / 1000);
+			}
+			// The current values are always candidates, so the search can only do better than them
+			axis.values.push_back(Threshold(current, (Group)group, (Metric)metric, false));
+			axis.values.push_back(Threshold(current, (Group)group, (Metric)metric, true));
+
+			std::sort(axis.values.begin(), axis.values.end());
+			axis.values.erase(std::unique(axis.values.begin(), axis.values.end()), axis.values.end());
+			if (axis.isMinimum) std::reverse(axis.values.begin(), axis.values.end());
+			if (axis.values.size() > 250) axis.values.resize(250); // ranks are bytes
+		}
+	}
+}
+
+// The candidates of one group: every pair of enter / exit indices per metric where the exit value is at least as
+// loose as the enter one, so the block cannot flicker between entering and leaving on the same pose.
+struct Search
+{
+	Group group;
+	GroupSetting fixed[kNumGroups]; // the setting of the group that is not being tuned
+	std::vector<std::pair<uint8_t, uint8_t>> pairs[kNumMetrics];
+	uint64_t numCandidates = 1;
+
+	void Init(Group tunedGroup, const Axes &axes, const GroupSetting (&current)[kNumGroups])
+	{
+		group = tunedGroup;
+		fixed[0] = current[0];
+		fixed[1] = current[1];
+		numCandidates = 1;
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			pairs[metric].clear();
+			int size = (int)axes.axes[group][metric].values.size();
+			for (int enter = 0; enter < size; enter++) {
+				for (int exit = enter; exit < size; exit++) {
+					pairs[metric].push_back({ (uint8_t)enter, (uint8_t)exit });
+				}
+			}
+			numCandidates *= pairs[metric].size();
+		}
+	}
+
+	void Decode(uint64_t id, GroupSetting (&out)[kNumGroups]) const
+	{
+		out[0] = fixed[0];
+		out[1] = fixed[1];
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			const std::pair<uint8_t, uint8_t> &pair = pairs[metric][id % pairs[metric].size()];
+			id /= pairs[metric].size();
+			out[group].enter[metric] = pair.first;
+			out[group].exit[metric] = pair.second;
+		}
+	}
+};
+
+struct Candidate
+{
+	uint64_t id;
+	Metrics metrics;
+	double score;
+};
+
+static bool IsSameMetrics(const Metrics &a, const Metrics &b)
+{
+	return a.numGuards == b.numGuards && a.numMissed == b.numMissed && a.numFalseStarts == b.numFalseStarts && a.numDrops == b.numDrops &&
+		a.latencySeconds == b.latencySeconds && a.lingerSeconds == b.lingerSeconds;
+}
+
+static void PrintMetrics(const char *name, const Metrics &m, double score)
+{
+	double meanLatencyMs = m.numGuards > m.numMissed ? m.latencySeconds * 1000 / (m.numGuards - m.numMissed) : 0;
+	printf("  %-10s score %9.2f  missed %4u / %-4u  false starts %4u  drops %4u  latency %6.1f ms  linger %7.2f s\n",
+		name, score, m.numMissed, m.numGuards, m.numFalseStarts, m.numDrops, meanLatencyMs, m.lingerSeconds);
+}
+
+static void PrintSetting(const Axes &axes, Group group, const GroupSetting &setting)
+{
+	printf("   ");
+	for (int metric = 0; metric < kNumMetrics; metric++) {
+		if (!HasMetric(group, (Metric)metric)) continue;
+		const std::vector<float> &values = axes.axes[group][metric].values;
+		printf(" %s %g / %g", s_metricKeys[group][metric], values[setting.enter[metric]], values[setting.exit[metric]]);
+	}
+	printf("\n");
+}
+
+static void PrintUsage()
+{
+	printf(
+		"usage: tuner [trace...] [options]\n"
+		"  --synthetic <minutes>   tune on generated sessions (default 20 minutes if no traces are given)\n"
+		"  --ini <path>            settings to start from, and the template for the output (default DualWieldBlockVR.ini)\n"
+		"  --out <path>            where to write the tuned ini (default DualWieldBlockVR.tuned.ini)\n"
+		"  --groups <list>         dualwield,unarmed (default both, in that order)\n"
+		"  --steps <n>             grid values per threshold, besides the current ones (default 6)\n"
+		"  --threads <n>           worker threads (default all hardware threads)\n"
+		"  --keep <fraction>       share of the candidates that survive each round (default 0.25)\n"
+		"  --top <n>               finalists checked against BlockCore::Update (default 10)\n"
+		"  --chunk-seconds <s>     traces are simulated in pieces this long (default 30)\n"
+		"  --weights <f,d,m,l,g>   cost of a false start, a dropped block, a missed guard, a second of latency,\n"
+		"                          and a second of lingering block (default 1,2,3,10,5)\n"
+		"  --lookahead <ms>        prediction lookahead to tune for, instead of the ini's PredictionLookaheadMs\n"
+		"  --graph-latency-ms <n>  simulated blockStart / blockStop -> IsBlocking latency (default 35)\n"
+		"  --hit-chance <n>        simulated hits on the block per second (default 0.5)\n");
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> tracePaths;
+	std::string iniPath = "DualWieldBlockVR.ini", outPath = "DualWieldBlockVR.tuned.ini";
+	double syntheticMinutes = 0;
+	bool isGroupTuned[kNumGroups] = { true, true };
+	int steps = 6;
+	int numThreads = 0;
+	double keep = 0.25;
+	size_t numFinalists = 10;
+	double chunkSeconds = 30;
+	float lookaheadMs = -1;
+	Weights weights;
+	SimOptions simOptions;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--synthetic" && hasValue) syntheticMinutes = atof(argv[++i]);
+		else if (arg == "--ini" && hasValue) iniPath = argv[++i];
+		else if (arg == "--out" && hasValue) outPath = argv[++i];
+		else if (arg == "--groups" && hasValue) {
+			std::string groups = argv[++i];
+			isGroupTuned[kGroup_DualWield] = groups.find("dualwield") != std::string::npos;
+			isGroupTuned[kGroup_Unarmed] = groups.find("unarmed") != std::string::npos;
+		}
+		else if (arg == "--steps" && hasValue) steps = atoi(argv[++i]);
+		else if (arg == "--threads" && hasValue) numThreads = atoi(argv[++i]);
+		else if (arg == "--keep" && hasValue) keep = atof(argv[++i]);
+		else if (arg == "--top" && hasValue) numFinalists = (size_t)atoi(argv[++i]);
+		else if (arg == "--chunk-seconds" && hasValue) chunkSeconds = atof(argv[++i]);
+		else if (arg == "--weights" && hasValue) {
+			if (sscanf(argv[++i], "%lf,%lf,%lf,%lf,%lf", &weights.falseStart, &weights.drop, &weights.missed, &weights.latencyPerSecond, &weights.lingerPerSecond) != 5) {
+				fprintf(stderr, "bad --weights value: %s\n", argv[i]);
+				return 2;
+			}
+		}
+		else if (arg == "--lookahead" && hasValue) lookaheadMs = (float)atof(argv[++i]);
+		else if (arg == "--graph-latency-ms" && hasValue) simOptions.graphLatencyMs = atof(argv[++i]);
+		else if (arg == "--hit-chance" && hasValue) simOptions.hitChancePerSecond = atof(argv[++i]);
+		else if (arg == "--help" || arg == "-h") { PrintUsage(); return 0; }
+		else if (arg[0] != '-') tracePaths.push_back(arg);
+		else { PrintUsage(); return 2; }
+	}
+	if (steps < 1) steps = 1;
+	if (keep <= 0 || keep > 1) keep = 0.25;
+	if (numFinalists < 1) numFinalists = 1;
+	if (tracePaths.empty() && syntheticMinutes <= 0) syntheticMinutes = 20;
+
+	std::vector<IniLine> iniLines;
+	if (!ReadIni(iniPath, iniLines)) {
+		printf("no %s, starting from the built in defaults and writing only the thresholds\n", iniPath.c_str());
+	}
+	// The settings the plugin would read from the same file, with its loader
+	Settings iniSettings;
+	std::vector<std::string> iniErrors;
+	if (!iniLines.empty() && !LoadSettings(iniPath, iniSettings, iniErrors)) {
+		for (const std::string &error : iniErrors) printf("%s: %s, using the default\n", iniPath.c_str(), error.c_str());
+	}
+	BlockCore::Config config = iniSettings.config;
+	if (lookaheadMs >= 0) config.predictionLookaheadMs = lookaheadMs;
+
+	// ---- frames ----
+
+	auto loadStart = std::chrono::steady_clock::now();
+	std::vector<Chunk> chunks;
+	double totalSeconds = 0;
+	size_t numFrames = 0;
+	auto addSession = [&](const std::vector<BlockCore::FrameInput> &frames, const std::vector<BlockLabels::Interval> &guards) {
+		if (frames.empty()) return;
+		totalSeconds += (double)(frames.back().timestampNs - frames.front().timestampNs) * 1e-9;
+		numFrames += frames.size();
+		AddChunks(chunks, frames, guards, chunkSeconds);
+	};
+
+	for (const std::string &path : tracePaths) {
+		std::vector<BlockCore::FrameInput> frames;
+		std::vector<BlockLabels::Interval> guards;
+		std::string error;
+		if (!FrameTrace::Read(path, frames, error) || !BlockLabels::Read(BlockLabels::PathForTrace(path), guards, error)) {
+			fprintf(stderr, "failed to read %s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+		addSession(frames, guards);
+	}
+
+	// Five minute sessions, alternating weapons and fists so both groups have something to tune on
+	for (int session = 0; session * 5 < syntheticMinutes; session++) {
+		SyntheticSession::Options options;
+		options.seconds = std::min(5.0, syntheticMinutes - session * 5) * 60;
+		options.seed = session + 1;
+		options.graphLatencyMs = simOptions.graphLatencyMs;
+		options.hitChancePerSecond = simOptions.hitChancePerSecond;
+		bool isUnarmed = session % 2 == 1;
+		options.mainHand = isUnarmed ? BlockCore::HandEquip::Unarmed : BlockCore::HandEquip::OneHanded;
+		options.offHand = options.mainHand;
+		options.isLeftHanded = session % 4 == 3;
+
+		std::vector<BlockLabels::Interval> guards;
+		std::vector<BlockCore::FrameInput> frames = SyntheticSession::Generate(options, config, &guards);
+		addSession(frames, guards);
+	}
+
+	if (chunks.empty()) {
+		fprintf(stderr, "no frames to tune on\n");
+		return 1;
+	}
+
+	Axes axes;
+	BuildAxes(axes, config, steps);
+
+	WorkStealingPool pool(numThreads);
+	pool.Run(chunks.size(), [&](size_t index, int) { Prepare(chunks[index], axes, config, simOptions, 0x7475AE5ull + index); });
+
+	double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+	printf("%zu frames, %.1f min in %zu chunks, prepared in %.1f s on %d threads\n", numFrames, totalSeconds / 60, chunks.size(), loadSeconds, pool.NumThreads());
+
+	// The order chunks are revealed to the candidates in, mixed so every round sees a bit of every trace
+	std::vector<size_t> chunkOrder(chunks.size());
+	std::iota(chunkOrder.begin(), chunkOrder.end(), 0);
+	SyntheticSession::Random shuffle(0xC0FFEE);
+	for (size_t i = chunkOrder.size(); i > 1; i--) {
+		std::swap(chunkOrder[i - 1], chunkOrder[shuffle.Next() % i]);
+	}
+
+	// A group's thresholds only change the outcome of chunks with frames that use them, the rest score the same for every candidate
+	std::vector<size_t> groupChunks[kNumGroups];
+	for (size_t index : chunkOrder) {
+		bool usesGroup[kNumGroups] = {};
+		for (const PreparedFrame &p : chunks[index].prepared) {
+			if (p.kind != kFrame_DualWielding) continue;
+			for (HandTest test : p.tests) {
+				if (test == kHandTest_Weapon) usesGroup[kGroup_DualWield] = true;
+				else if (test == kHandTest_Unarmed) usesGroup[kGroup_Unarmed] = true;
+			}
+		}
+		for (int group = 0; group < kNumGroups; group++) {
+			if (usesGroup[group]) groupChunks[group].push_back(index);
+		}
+	}
+
+	// Current settings as grid indices. The axes include them, so they are always found.
+	GroupSetting settings[kNumGroups];
+	for (int group = 0; group < kNumGroups; group++) {
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			bool hasMetric = HasMetric((Group)group, (Metric)metric);
+			settings[group].enter[metric] = hasMetric ? (uint8_t)axes.Find((Group)group, (Metric)metric, Threshold(config, (Group)group, (Metric)metric, false)) : 0;
+			settings[group].exit[metric] = hasMetric ? (uint8_t)axes.Find((Group)group, (Metric)metric, Threshold(config, (Group)group, (Metric)metric, true)) : 0;
+		}
+	}
+
+	// Sums in the order given, like the search does, so the totals match to the last bit
+	auto scoreExact = [&](const BlockCore::Config &candidateConfig, const std::vector<size_t> &order) {
+		std::vector<Metrics> perChunk(order.size());
+		pool.Run(order.size(), [&](size_t i, int) { perChunk[i] = SimulateExact(chunks[order[i]], candidateConfig, simOptions); });
+		Metrics total;
+		for (const Metrics &metrics : perChunk) total.Add(metrics);
+		return total;
+	};
+
+	int result = 0;
+	{
+		Metrics current = scoreExact(config, chunkOrder);
+		printf("current settings:\n");
+		PrintMetrics("current", current, Score(current, weights));
+	}
+
+	for (int groupIndex = 0; groupIndex < kNumGroups; groupIndex++) {
+		Group group = (Group)groupIndex;
+		if (!isGroupTuned[group]) continue;
+		const std::vector<size_t> &order = groupChunks[group];
+		if (order.empty()) {
+			printf("[%s]: no frames use these thresholds, skipped\n", s_groupSections[group]);
+			continue;
+		}
+
+		auto groupStart = std::chrono::steady_clock::now();
+		Search search;
+		search.Init(group, axes, settings);
+
+		std::vector<Candidate> survivors(search.numCandidates);
+		for (uint64_t id = 0; id < search.numCandidates; id++) survivors[id] = { id, Metrics(), 0 };
+		printf("[%s]: %llu candidates over %zu chunks\n", s_groupSections[group], (unsigned long long)search.numCandidates, order.size());
+
+		// Successive halving: each round adds chunks, scores are sums so only the new chunks need simulating
+		size_t numSeen = 0;
+		// The first round costs the most, so it sees at most a couple of minutes however much there is to tune on
+		size_t numChunksNext = std::min<size_t>(std::max<size_t>(1, order.size() / 16), 4);
+		uint64_t numSimulated = 0;
+		const size_t blockSize = 64;
+		while (true) {
+			size_t begin = numSeen, end = std::min(numChunksNext, order.size());
+			size_t numBlocks = (survivors.size() + blockSize - 1) / blockSize;
+			pool.Run(numBlocks, [&](size_t block, int) {
+				size_t first = block * blockSize, last = std::min(first + blockSize, survivors.size());
+				BlockCore::Config candidateConfig = config;
+				for (size_t i = first; i < last; i++) {
+					GroupSetting candidate[kNumGroups];
+					search.Decode(survivors[i].id, candidate);
+					axes.Apply(group, candidate[group], candidateConfig);
+					for (size_t c = begin; c < end; c++) {
+						survivors[i].metrics.Add(SimulatePrepared(chunks[order[c]], candidateConfig, candidate, simOptions));
+					}
+					survivors[i].score = Score(survivors[i].metrics, weights);
+				}
+			});
+			for (size_t c = begin; c < end; c++) numSimulated += chunks[order[c]].prepared.size() * survivors.size();
+			numSeen = end;
+
+			auto isBetter = [](const Candidate &a, const Candidate &b) { return a.score < b.score || (a.score == b.score && a.id < b.id); };
+			size_t numKept = numSeen == order.size() ? numFinalists : std::max(numFinalists, (size_t)(survivors.size() * keep));
+			if (numKept < survivors.size()) {
+				std::nth_element(survivors.begin(), survivors.begin() + numKept, survivors.end(), isBetter);
+				survivors.resize(numKept);
+			}
+			std::sort(survivors.begin(), survivors.end(), isBetter);
+			printf("  %3zu / %zu chunks, %zu left, best score %.2f\n", numSeen, order.size(), survivors.size(), survivors.front().score);
+
+			if (numSeen == order.size()) break;
+			numChunksNext *= 2;
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - groupStart).count();
+		printf("  searched in %.1f s, %.1f M candidate frames / s, %llu steals\n", seconds, numSimulated / seconds / 1e6, (unsigned long long)pool.NumSteals());
+
+		// The finalists again through Update, which has to agree exactly
+		size_t numMismatches = 0;
+		size_t bestIndex = 0;
+		double bestScore = 0;
+		for (size_t i = 0; i < survivors.size(); i++) {
+			GroupSetting candidate[kNumGroups];
+			search.Decode(survivors[i].id, candidate);
+			BlockCore::Config candidateConfig = config;
+			axes.Apply(group, candidate[group], candidateConfig);
+			Metrics exact = scoreExact(candidateConfig, order);
+			if (!IsSameMetrics(exact, survivors[i].metrics)) numMismatches++;
+
+			double score = Score(exact, weights);
+			if (i == 0 || score < bestScore) {
+				bestScore = score;
+				bestIndex = i;
+			}
+			char name[24];
+			snprintf(name, sizeof(name), "#%zu", i + 1);
+			PrintMetrics(name, exact, score);
+			PrintSetting(axes, group, candidate[group]);
+		}
+		if (numMismatches) {
+			printf("  FAST PATH DISAGREES WITH Update ON %zu FINALISTS\n", numMismatches);
+			result = 1;
+		}
+
+		GroupSetting best[kNumGroups];
+		search.Decode(survivors[bestIndex].id, best);
+		settings[group] = best[group];
+		axes.Apply(group, best[group], config);
+	}
+
+	{
+		Metrics tuned = scoreExact(config, chunkOrder);
+		printf("tuned settings:\n");
+		PrintMetrics("tuned", tuned, Score(tuned, weights));
+	}
+
+	if (!WriteIni(outPath, iniLines, config)) {
+		fprintf(stderr, "failed to write %s\n", outPath.c_str());
+		return 1;
+	}
+	printf("wrote %s\n", outPath.c_str());
+	return result;
+}
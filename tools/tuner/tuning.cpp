@@ -0,0 +1,379 @@
+#include <cmath>
+
+#include "synthetic_session.h"
+#include "tuning.h"
+
+using namespace BlockCore;
+
+
+namespace Tuning
+{
+	int Axes::Find(Group group, Metric metric, float value) const
+	{
+		const std::vector<float> &values = axes[group][metric].values;
+		for (size_t i = 0; i < values.size(); i++) {
+			if (values[i] == value) return (int)i;
+		}
+		return -1;
+	}
+
+	void Axes::Apply(Group group, const GroupSetting &setting, Config &config) const
+	{
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			if (!HasMetric(group, (Metric)metric)) continue;
+			const std::vector<float> &values = axes[group][metric].values;
+			Threshold(config, group, (Metric)metric, false) = values[setting.enter[metric]];
+			Threshold(config, group, (Metric)metric, true) = values[setting.exit[metric]];
+		}
+
+		// Update reads the weapon thresholds from the flattened table. The tuner only tunes [DualWield], so every pair gets it.
+		if (group == kGroup_DualWield) BuildWeaponProfiles(config, nullptr, 0);
+	}
+
+	bool HasMetric(Group group, Metric metric)
+	{
+		return group == kGroup_DualWield || metric != kMetric_B;
+	}
+
+	float & Threshold(Config &config, Group group, Metric metric, bool isExit)
+	{
+		if (group == kGroup_Unarmed) {
+			UnarmedThresholds &t = config.unarmed;
+			switch (metric) {
+			case kMetric_Speed: return isExit ? t.maxSpeedExit : t.maxSpeedEnter;
+			case kMetric_A: return isExit ? t.handForwardHmdRightExit : t.handForwardHmdRightEnter;
+			default: return isExit ? t.hmdToHandDistanceUpExit : t.hmdToHandDistanceUpEnter; // there is no B unarmed
+			}
+		}
+
+		WeaponThresholds &t = config.dualWield;
+		switch (metric) {
+		case kMetric_Speed: return isExit ? t.maxSpeedExit : t.maxSpeedEnter;
+		case kMetric_A: return isExit ? t.handForwardHmdDownExit : t.handForwardHmdDownEnter;
+		case kMetric_B: return isExit ? t.handForwardHmdForwardExit : t.handForwardHmdForwardEnter;
+		default: return isExit ? t.hmdToHandDistanceUpExit : t.hmdToHandDistanceUpEnter;
+		}
+	}
+
+	void Metrics::Add(const Metrics &other)
+	{
+		numGuards += other.numGuards;
+		numMissed += other.numMissed;
+		numFalseStarts += other.numFalseStarts;
+		numDrops += other.numDrops;
+		latencySeconds += other.latencySeconds;
+		lingerSeconds += other.lingerSeconds;
+	}
+
+	double Score(const Metrics &metrics, const Weights &weights)
+	{
+		return metrics.numFalseStarts * weights.falseStart + metrics.numDrops * weights.drop + metrics.numMissed * weights.missed +
+			metrics.latencySeconds * weights.latencyPerSecond + metrics.lingerSeconds * weights.lingerPerSecond;
+	}
+
+	void AddChunks(std::vector<Chunk> &chunks, const std::vector<FrameInput> &frames, const std::vector<BlockLabels::Interval> &guards, double chunkSeconds)
+	{
+		const uint64_t chunkNs = chunkSeconds > 0 ? (uint64_t)(chunkSeconds * 1e9) : UINT64_MAX;
+
+		size_t begin = 0;
+		while (begin < frames.size()) {
+			size_t end = begin + 1;
+			while (end < frames.size() && frames[end].timestampNs - frames[begin].timestampNs < chunkNs) end++;
+
+			Chunk chunk;
+			chunk.frames.assign(frames.begin() + begin, frames.begin() + end);
+			uint64_t firstNs = chunk.frames.front().timestampNs;
+			uint64_t lastNs = chunk.frames.back().timestampNs;
+			for (const BlockLabels::Interval &guard : guards) {
+				if (guard.endNs < firstNs || guard.startNs > lastNs) continue;
+				chunk.guards.push_back({ guard.startNs < firstNs ? firstNs : guard.startNs, guard.endNs > lastNs ? lastNs : guard.endNs });
+			}
+			chunks.push_back(std::move(chunk));
+			begin = end;
+		}
+	}
+
+	// First index the value passes at, the axis size if none
+	static uint8_t PassRank(const Axis &axis, float value)
+	{
+		size_t k = 0;
+		for (; k < axis.values.size(); k++) {
+			if (axis.isMinimum ? value >= axis.values[k] : value <= axis.values[k]) break;
+		}
+		return (uint8_t)k;
+	}
+
+	// Number of indices (all at the bottom) the value fails at. A NaN fails none, the same as the exit tests.
+	static uint8_t FailRank(const Axis &axis, float value)
+	{
+		size_t k = 0;
+		for (; k < axis.values.size(); k++) {
+			if (!(axis.isMinimum ? value < axis.values[k] : value > axis.values[k])) break;
+		}
+		return (uint8_t)k;
+	}
+
+	// The same metrics as blocking.cpp, with the same operations in the same order, so the ranks agree with its comparisons
+	static void GetMetrics(const Config &config, const HandSample &sample, HandTest test, bool isLeft, float (&out)[kNumMetrics])
+	{
+		Vector3 handForward = ForwardVector(sample.hand.rot);
+		Vector3 hmdToHand = (sample.hand.pos - sample.hmd.pos) * config.havokWorldScale;
+
+		out[kMetric_Speed] = sample.speed;
+		if (test == kHandTest_Unarmed) {
+			out[kMetric_A] = DotProduct(handForward, RightVector(sample.hmd.rot));
+			if (isLeft) out[kMetric_A] *= -1.f;
+			out[kMetric_B] = 0;
+			out[kMetric_C] = std::abs(DotProduct(UpVector(sample.hmd.rot), hmdToHand));
+		}
+		else {
+			Vector3 hmdDown = -UpVector(sample.hmd.rot);
+			out[kMetric_A] = DotProduct(handForward, hmdDown);
+			out[kMetric_B] = std::abs(DotProduct(handForward, ForwardVector(sample.hmd.rot)));
+			out[kMetric_C] = std::abs(DotProduct(hmdDown, hmdToHand));
+		}
+	}
+
+	static void GetRanks(const Axes &axes, const Config &config, const HandSample &current, const HandSample &predicted, HandTest test, bool isLeft, HandRanks &out)
+	{
+		if (test != kHandTest_Weapon && test != kHandTest_Unarmed) {
+			out = {};
+			return;
+		}
+		Group group = test == kHandTest_Unarmed ? kGroup_Unarmed : kGroup_DualWield;
+
+		float currentMetrics[kNumMetrics], predictedMetrics[kNumMetrics];
+		GetMetrics(config, current, test, isLeft, currentMetrics);
+		GetMetrics(config, predicted, test, isLeft, predictedMetrics);
+
+		for (int metric = 0; metric < kNumMetrics; metric++) {
+			if (!HasMetric(group, (Metric)metric)) {
+				out.enter[metric] = 0; // always passes
+				out.exit[metric] = 0; // never fails
+				continue;
+			}
+			out.enter[metric] = PassRank(axes.axes[group][metric], predictedMetrics[metric]);
+			out.exit[metric] = FailRank(axes.axes[group][metric], currentMetrics[metric]);
+		}
+	}
+
+	static HandTest GetOffHandTest(HandEquip equip)
+	{
+		switch (equip) {
+		case HandEquip::Unarmed: return kHandTest_Unarmed;
+		case HandEquip::OneHanded:
+		case HandEquip::TwoHanded:
+		case HandEquip::Torch: return kHandTest_Weapon;
+		case HandEquip::Shield: return kHandTest_Shield;
+		default: return kHandTest_Stop;
+		}
+	}
+
+	void Prepare(Chunk &chunk, const Axes &axes, const Config &config, const SimOptions &options, uint64_t seed)
+	{
+		SyntheticSession::Random random(seed);
+
+		// The parts of State that Update keeps whatever the thresholds are
+		bool isLastUpdateValid = false;
+		float lastRightHandSpeed = 0, lastLeftHandSpeed = 0;
+		uint64_t lastHandSpeedNs = 0;
+
+		chunk.prepared.resize(chunk.frames.size());
+		for (size_t i = 0; i < chunk.frames.size(); i++) {
+			const FrameInput &input = chunk.frames[i];
+			PreparedFrame &p = chunk.prepared[i];
+			p = {};
+			p.timestampNs = input.timestampNs;
+			p.seconds = (double)(input.timestampNs - chunk.frames.front().timestampNs) * 1e-9;
+			p.isBlockingInternal = input.isBlockingInternal;
+
+			double dt = i ? (double)(input.timestampNs - chunk.frames[i - 1].timestampNs) * 1e-9 : 0;
+			p.isHitRoll = random.Uniform() < (float)(options.hitChancePerSecond * dt);
+
+			if (!input.isActive) {
+				p.kind = kFrame_Inactive;
+				continue;
+			}
+			bool wasLastUpdateValid = isLastUpdateValid;
+			isLastUpdateValid = false;
+			if (!IsDualWielding(config, input.mainHand, input.offHand)) {
+				p.kind = kFrame_NotDualWielding;
+				continue;
+			}
+			p.kind = kFrame_DualWielding;
+
+			// Same samples as Update
+			bool isLeftHanded = input.isLeftHanded;
+			const Transform &mainWand = isLeftHanded ? input.leftWand : input.rightWand;
+			const Transform &offhandWand = isLeftHanded ? input.rightWand : input.leftWand;
+			float mainWandSpeed = isLeftHanded ? input.leftHandSpeed : input.rightHandSpeed;
+			float offhandWandSpeed = isLeftHanded ? input.rightHandSpeed : input.leftHandSpeed;
+
+			HandSample mainSample = { input.hmd, mainWand, mainWandSpeed };
+			HandSample offhandSample = { input.hmd, offhandWand, offhandWandSpeed };
+
+			Transform predictedHmd, predictedMainWand, predictedOffhandWand;
+			HandSample predictedMainSample = { predictedHmd, predictedMainWand, mainWandSpeed };
+			HandSample predictedOffhandSample = { predictedHmd, predictedOffhandWand, offhandWandSpeed };
+			bool isPredicting = config.predictionLookaheadMs > 0;
+			if (isPredicting) {
+				float seconds = config.predictionLookaheadMs * 0.001f;
+				predictedHmd = PredictTransform(input.hmd, input.hmdMotion, seconds, config.havokWorldScale);
+				predictedMainWand = PredictTransform(mainWand, isLeftHanded ? input.leftWandMotion : input.rightWandMotion, seconds, config.havokWorldScale);
+				predictedOffhandWand = PredictTransform(offhandWand, isLeftHanded ? input.rightWandMotion : input.leftWandMotion, seconds, config.havokWorldScale);
+
+				if (wasLastUpdateValid && input.timestampNs > lastHandSpeedNs) {
+					float secondsSinceLast = (float)((input.timestampNs - lastHandSpeedNs) * 1e-9);
+					predictedMainSample.speed = PredictSpeed(mainWandSpeed, isLeftHanded ? lastLeftHandSpeed : lastRightHandSpeed, secondsSinceLast, seconds);
+					predictedOffhandSample.speed = PredictSpeed(offhandWandSpeed, isLeftHanded ? lastRightHandSpeed : lastLeftHandSpeed, secondsSinceLast, seconds);
+				}
+			}
+			const HandSample &mainEnterSample = isPredicting ? predictedMainSample : mainSample;
+			const HandSample &offhandEnterSample = isPredicting ? predictedOffhandSample : offhandSample;
+
+			lastRightHandSpeed = input.rightHandSpeed;
+			lastLeftHandSpeed = input.leftHandSpeed;
+			lastHandSpeedNs = input.timestampNs;
+			isLastUpdateValid = true;
+
+			p.tests[0] = input.mainHand == HandEquip::Unarmed ? kHandTest_Unarmed : kHandTest_Weapon;
+			p.tests[1] = GetOffHandTest(input.offHand);
+			GetRanks(axes, config, mainSample, mainEnterSample, p.tests[0], isLeftHanded, p.hands[0]);
+			GetRanks(axes, config, offhandSample, offhandEnterSample, p.tests[1], !isLeftHanded, p.hands[1]);
+
+			p.hasCrossGuard = config.isCrossGuardEnabled && p.tests[0] == kHandTest_Weapon && p.tests[1] == kHandTest_Weapon;
+			if (p.hasCrossGuard) {
+				HandSample current[kNumHandIndices] = { mainSample, offhandSample };
+				HandSample enter[kNumHandIndices] = { mainEnterSample, offhandEnterSample };
+				p.crossGuard = TestCrossGuard(config, current, enter);
+			}
+		}
+	}
+
+	// Turns the decisions and IsBlocking of each frame into Metrics, walking the guards alongside
+	class Scorer
+	{
+	public:
+		Scorer(const std::vector<BlockLabels::Interval> &guards, const SimOptions &options)
+			: guards(guards), lingerGraceNs((uint64_t)(options.lingerGraceMs * 1e6)) {}
+
+		void Frame(uint64_t nowNs, Decision decision, bool isBlocking)
+		{
+			while (next < guards.size() && guards[next].endNs < nowNs) FinishGuard();
+
+			bool isInGuard = next < guards.size() && guards[next].startNs <= nowNs;
+			if (isInGuard) {
+				if (!isReached && isBlocking) {
+					isReached = true;
+					metrics.latencySeconds += (double)(nowNs - guards[next].startNs) * 1e-9;
+				}
+				if (decision == kDecision_StopBlocking) metrics.numDrops++;
+			}
+			else {
+				if (decision == kDecision_StartBlocking) metrics.numFalseStarts++;
+				bool isGrace = hasGuardEnded && nowNs - lastGuardEndNs < lingerGraceNs;
+				if (isBlocking && !isGrace && lastFrameNs) metrics.lingerSeconds += (double)(nowNs - lastFrameNs) * 1e-9;
+			}
+			lastFrameNs = nowNs;
+		}
+
+		Metrics Finish()
+		{
+			while (next < guards.size()) FinishGuard();
+			return metrics;
+		}
+
+	private:
+		void FinishGuard()
+		{
+			metrics.numGuards++;
+			if (!isReached) metrics.numMissed++;
+			hasGuardEnded = true;
+			lastGuardEndNs = guards[next].endNs;
+			isReached = false;
+			next++;
+		}
+
+		const std::vector<BlockLabels::Interval> &guards;
+		const uint64_t lingerGraceNs;
+		Metrics metrics;
+		size_t next = 0;
+		bool isReached = false;
+		bool hasGuardEnded = false;
+		uint64_t lastGuardEndNs = 0;
+		uint64_t lastFrameNs = 0;
+	};
+
+	static inline HandStatus GetStatus(HandTest test, const HandRanks &ranks, const GroupSetting (&settings)[kNumGroups], bool isBlocking, bool isBlockingInternal)
+	{
+		if (test == kHandTest_Shield) return !isBlockingInternal && isBlocking ? kHandStatus_Stop : kHandStatus_None;
+		if (test == kHandTest_Stop) return kHandStatus_Stop;
+
+		const GroupSetting &s = settings[test == kHandTest_Unarmed ? kGroup_Unarmed : kGroup_DualWield];
+		// & and | rather than && and ||: the ranks change from frame to frame, and branching on each compare mispredicts
+		bool isInside = (s.enter[0] >= ranks.enter[0]) & (s.enter[1] >= ranks.enter[1]) & (s.enter[2] >= ranks.enter[2]) & (s.enter[3] >= ranks.enter[3]);
+		bool isOutside = (s.exit[0] < ranks.exit[0]) | (s.exit[1] < ranks.exit[1]) | (s.exit[2] < ranks.exit[2]) | (s.exit[3] < ranks.exit[3]);
+		if (isInside) return isBlocking ? kHandStatus_None : kHandStatus_Start;
+		return isOutside && isBlocking ? kHandStatus_Stop : kHandStatus_None;
+	}
+
+	Metrics SimulatePrepared(const Chunk &chunk, const Config &config, const GroupSetting (&settings)[kNumGroups], const SimOptions &options)
+	{
+		State state;
+		SyntheticSession::GraphModel graph;
+		Scorer scorer(chunk.guards, options);
+		const double graphLatency = options.graphLatencyMs / 1000.0;
+
+		for (const PreparedFrame &p : chunk.prepared) {
+			double now = p.seconds;
+			graph.Advance(now);
+
+			// The same steps as Update, with the block tests reduced to comparing ranks
+			Decision decision = kDecision_None;
+			if (p.kind == kFrame_NotDualWielding) {
+				decision = CancelBlock(state, state.isLastUpdateValid);
+				state.isLastUpdateValid = false;
+			}
+			else if (p.kind == kFrame_DualWielding) {
+				bool isBlocking = GetIsBlockingMode(state, config, graph.isBlocking && !p.isHitRoll, p.timestampNs);
+				HandStatus mainStatus = GetStatus(p.tests[0], p.hands[0], settings, isBlocking, p.isBlockingInternal);
+				HandStatus offStatus = GetStatus(p.tests[1], p.hands[1], settings, isBlocking, p.isBlockingInternal);
+				HandStatus crossGuardStatus = p.hasCrossGuard ? GetCrossGuardStatus(p.crossGuard, isBlocking) : kHandStatus_Stop;
+
+				Decision request = kDecision_None;
+				if (mainStatus == kHandStatus_Start || offStatus == kHandStatus_Start || crossGuardStatus == kHandStatus_Start) request = kDecision_StartBlocking;
+				else if (mainStatus == kHandStatus_Stop && offStatus == kHandStatus_Stop && crossGuardStatus == kHandStatus_Stop) request = kDecision_StopBlocking;
+				decision = ApplyRequest(state, config, request, isBlocking, p.timestampNs);
+				state.isLastUpdateValid = true;
+			}
+
+			if (decision == kDecision_StartBlocking) graph.Notify(true, now, graphLatency);
+			else if (decision == kDecision_StopBlocking) graph.Notify(false, now, graphLatency);
+			scorer.Frame(p.timestampNs, decision, graph.isBlocking);
+		}
+
+		return scorer.Finish();
+	}
+
+	Metrics SimulateExact(const Chunk &chunk, const Config &config, const SimOptions &options)
+	{
+		State state;
+		SyntheticSession::GraphModel graph;
+		Scorer scorer(chunk.guards, options);
+		const double graphLatency = options.graphLatencyMs / 1000.0;
+
+		for (size_t i = 0; i < chunk.frames.size(); i++) {
+			FrameInput frame = chunk.frames[i];
+			double now = chunk.prepared[i].seconds;
+			graph.Advance(now);
+			frame.isBlockingGraph = graph.isBlocking && !chunk.prepared[i].isHitRoll;
+
+			Decision decision = Update(state, config, frame);
+			if (decision == kDecision_StartBlocking) graph.Notify(true, now, graphLatency);
+			else if (decision == kDecision_StopBlocking) graph.Notify(false, now, graphLatency);
+			scorer.Frame(frame.timestampNs, decision, graph.isBlocking);
+		}
+
+		return scorer.Finish();
+	}
+}
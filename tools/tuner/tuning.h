@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "block_labels.h"
+#include "blocking.h"
+#include "dual_hand_classifier.h"
+
+
+// Scoring a set of block thresholds against labelled frames, fast enough to try millions of them.
+//
+// Everything the block tests look at (speeds, the three pose metrics of the current and predicted poses) is the same
+// whatever the thresholds are, so it is worked out once per frame and stored as a rank on each threshold's grid of
+// candidate values. Trying a candidate is then a handful of byte compares per hand and frame, plus the parts of
+// Update that do depend on the thresholds: the IsBlocking debounce, the cooldowns and the simulated animation graph.
+namespace Tuning
+{
+	// The thresholds of each block test, as one axis per metric. Each axis has one grid that both its enter and its exit value come from.
+	enum Group
+	{
+		kGroup_DualWield = 0,
+		kGroup_Unarmed,
+		kNumGroups
+	};
+
+	enum Metric
+	{
+		kMetric_Speed = 0, // squared hand speed <= threshold
+		kMetric_A, // hand forward . hmd down (weapon) or hmd outwards (unarmed) >= threshold
+		kMetric_B, // |hand forward . hmd forward| <= threshold. Weapon only, always passes unarmed.
+		kMetric_C, // |hmd to hand vertical distance| <= threshold
+		kNumMetrics
+	};
+
+	// Candidate values of one threshold, strictest first: any sample that passes at index k passes at every index above k
+	struct Axis
+	{
+		std::vector<float> values;
+		bool isMinimum = false; // the test is metric >= value, so values go down. Otherwise metric <= value, values go up.
+	};
+
+	// A value per metric for entering and for leaving the block, as indices into the axes
+	struct GroupSetting
+	{
+		uint8_t enter[kNumMetrics];
+		uint8_t exit[kNumMetrics];
+	};
+
+	struct Axes
+	{
+		Axis axes[kNumGroups][kNumMetrics];
+
+		// Index of value on the axis, or -1
+		int Find(Group group, Metric metric, float value) const;
+		// Writes the setting's values into config. Weapon profiles are dropped, every weapon pair uses the [DualWield] values.
+		void Apply(Group group, const GroupSetting &setting, BlockCore::Config &config) const;
+	};
+
+	// The config field behind each axis
+	float & Threshold(BlockCore::Config &config, Group group, Metric metric, bool isExit);
+	bool HasMetric(Group group, Metric metric);
+
+	// What the tests need from one frame, for every candidate at once
+	enum FrameKind : uint8_t
+	{
+		kFrame_Inactive = 0,
+		kFrame_NotDualWielding,
+		kFrame_DualWielding
+	};
+
+	enum HandTest : uint8_t
+	{
+		kHandTest_Weapon = 0,
+		kHandTest_Unarmed,
+		kHandTest_Shield, // stops the block if the game is not blocking with the shield itself
+		kHandTest_Stop // spells etc. always say stop
+	};
+
+	struct HandRanks
+	{
+		uint8_t enter[kNumMetrics]; // first axis index the predicted sample passes at, the axis size if none
+		uint8_t exit[kNumMetrics]; // the current sample fails at every axis index below this. 0 if it never fails (NaN).
+	};
+
+	struct PreparedFrame
+	{
+		uint64_t timestampNs;
+		double seconds; // since the start of the chunk, the clock the simulated graph runs on
+		FrameKind kind;
+		HandTest tests[2]; // main, off
+		bool isBlockingInternal;
+		bool isHitRoll; // a hit lands on the block this frame, if there is a block
+		HandRanks hands[2];
+		bool hasCrossGuard; // both hands armed with the cross guard enabled. Its thresholds are not tuned, so it is tested once here.
+		BlockCore::CrossGuardTest crossGuard;
+	};
+
+	// A stretch of frames simulated from a fresh state, and the guards the player held during it
+	struct Chunk
+	{
+		std::vector<BlockCore::FrameInput> frames;
+		std::vector<BlockLabels::Interval> guards; // clipped to the chunk
+		std::vector<PreparedFrame> prepared;
+	};
+
+	struct SimOptions
+	{
+		double graphLatencyMs = 35; // blockStart / blockStop -> IsBlocking
+		double hitChancePerSecond = 0.5;
+		double lingerGraceMs = 500; // how long a block may outlast the guard before it counts as lingering
+	};
+
+	// Splits frames into chunks of about chunkSeconds each
+	void AddChunks(std::vector<Chunk> &chunks, const std::vector<BlockCore::FrameInput> &frames, const std::vector<BlockLabels::Interval> &guards, double chunkSeconds);
+
+	// Fills chunk.prepared. Only config's non threshold settings matter (prediction, world scale, shield).
+	void Prepare(Chunk &chunk, const Axes &axes, const BlockCore::Config &config, const SimOptions &options, uint64_t seed);
+
+	struct Metrics
+	{
+		uint32_t numGuards = 0;
+		uint32_t numMissed = 0; // guards the block never came up during
+		uint32_t numFalseStarts = 0; // blockStart outside any guard
+		uint32_t numDrops = 0; // blockStop while the guard is still held
+		double latencySeconds = 0; // summed over the guards that were not missed, from raising the guard until IsBlocking
+		double lingerSeconds = 0; // time blocking with no guard held, past lingerGraceMs
+
+		void Add(const Metrics &other);
+	};
+
+	struct Weights
+	{
+		double falseStart = 1;
+		double drop = 2;
+		double missed = 3;
+		double latencyPerSecond = 10;
+		double lingerPerSecond = 5;
+	};
+
+	// Lower is better
+	double Score(const Metrics &metrics, const Weights &weights);
+
+	// Candidate run against the prepared frames
+	Metrics SimulatePrepared(const Chunk &chunk, const BlockCore::Config &config, const GroupSetting (&settings)[kNumGroups], const SimOptions &options);
+	// The same through BlockCore::Update, to check the fast version against
+	Metrics SimulateExact(const Chunk &chunk, const BlockCore::Config &config, const SimOptions &options);
+}
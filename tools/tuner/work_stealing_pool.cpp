@@ -0,0 +1,119 @@
+#include "work_stealing_pool.h"
+
+
+WorkStealingPool::WorkStealingPool(int numThreads)
+{
+	if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0) numThreads = 1;
+
+	for (int i = 0; i < numThreads; i++) {
+		queues.push_back(std::make_unique<Queue>());
+	}
+	for (int i = 1; i < numThreads; i++) {
+		threads.emplace_back(&WorkStealingPool::WorkerThread, this, i);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
+
+void WorkStealingPool::Run(size_t numTasks, const std::function<void(size_t, int)> &newTask)
+{
+	if (numTasks == 0) return;
+
+	// Deal the tasks out in contiguous runs, so neighbouring tasks (which usually share data) start on the same worker
+	const size_t numQueues = queues.size();
+	for (size_t worker = 0; worker < numQueues; worker++) {
+		size_t begin = numTasks * worker / numQueues;
+		size_t end = numTasks * (worker + 1) / numQueues;
+		std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+		for (size_t index = begin; index < end; index++) {
+			queues[worker]->tasks.push_back(index);
+		}
+	}
+	numRemaining.store(numTasks, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &newTask;
+		generation++;
+		numWorking = (int)threads.size();
+	}
+	wake.notify_all();
+
+	Work(0);
+
+	// Every task is done once numRemaining hits 0, but the workers may still be looking for more to steal
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return numWorking == 0; });
+	task = nullptr;
+}
+
+bool WorkStealingPool::Pop(int worker, size_t &out)
+{
+	Queue &queue = *queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) return false;
+	out = queue.tasks.back();
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::Steal(int worker, size_t &out)
+{
+	const int numQueues = (int)queues.size();
+	for (int offset = 1; offset < numQueues; offset++) {
+		Queue &victim = *queues[(worker + offset) % numQueues];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			out = victim.tasks.front();
+			victim.tasks.pop_front();
+			numSteals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::Work(int worker)
+{
+	size_t index;
+	while (numRemaining.load(std::memory_order_acquire) > 0) {
+		if (!Pop(worker, index) && !Steal(worker, index)) {
+			// Nothing left to take, the rest is already running on other workers
+			break;
+		}
+		(*task)(index, worker);
+		numRemaining.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+void WorkStealingPool::WorkerThread(int worker)
+{
+	uint64_t lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, lastGeneration]() { return isStopping || generation != lastGeneration; });
+			if (isStopping) return;
+			lastGeneration = generation;
+		}
+
+		Work(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			numWorking--;
+		}
+		done.notify_one();
+	}
+}
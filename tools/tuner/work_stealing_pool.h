@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed set of threads that run batches of indexed tasks. Each worker has its own deque: it takes tasks from the back of
+// its own and, once that is empty, steals from the front of the others. Tasks that take very different amounts of time
+// still keep every core busy without a shared queue everyone fights over. The calling thread works as worker 0.
+class WorkStealingPool
+{
+public:
+	// numThreads 0 uses every hardware thread
+	explicit WorkStealingPool(int numThreads = 0);
+	~WorkStealingPool();
+
+	int NumThreads() const { return (int)queues.size(); }
+	uint64_t NumSteals() const { return numSteals.load(std::memory_order_relaxed); }
+
+	// Calls task(index, worker) for every index in [0, numTasks) and returns once all of them are done.
+	// worker is in [0, NumThreads()), for per-thread scratch space.
+	void Run(size_t numTasks, const std::function<void(size_t, int)> &task);
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	bool Pop(int worker, size_t &task);
+	bool Steal(int worker, size_t &task);
+	void Work(int worker);
+	void WorkerThread(int worker);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex; // guards everything below apart from the atomics
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(size_t, int)> *task = nullptr;
+	uint64_t generation = 0; // bumped for every batch, so a worker does not run the same batch twice
+	int numWorking = 0;
+	bool isStopping = false;
+
+	std::atomic<size_t> numRemaining = 0;
+	std::atomic<uint64_t> numSteals = 0;
+};